@@ -29,11 +29,23 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L // for fileno() and posix_madvise() with strict ISO C
+#endif
+
 #include "oapv.h"
 #include "oapv_app_util.h"
 #include "oapv_app_args.h"
 #include "oapv_app_y4m.h"
 
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define BS_USE_MMAP 1
+#else
+#define BS_USE_MMAP 0
+#endif
+
 #define MAX_BS_BUF          128 * 1024 * 1024 /* byte */
 
 // check generic frame or not
@@ -43,6 +55,14 @@
 
 #define OUTPUT_CSP_NATIVE   (0)
 #define OUTPUT_CSP_P210     (1)
+#define OUTPUT_CSP_RGB      (2)
+#define OUTPUT_CSP_RGBA     (3)
+#define OUTPUT_CSP_RGBF     (4)
+#define OUTPUT_CSP_RGBAF    (5)
+#define OUTPUT_CSP_UYVY     (6)
+#define OUTPUT_CSP_V210     (7)
+// frames are decoded in coded CSP, and packed ones are converted from them
+#define IS_OUTPUT_NATIVE(csp) ((csp) == OUTPUT_CSP_NATIVE || (csp) == OUTPUT_CSP_UYVY || (csp) == OUTPUT_CSP_V210)
 
 // clang-format off
 
@@ -73,6 +93,11 @@ static const args_opt_t dec_args_opts[] = {
         "force use of a specific number of threads\n"
         "      - 'auto' means that the value is internally determined"
     },
+    {
+        ARGS_NO_KEY,  "simd", ARGS_VAL_TYPE_STRING, 0, NULL,
+        "SIMD kernels to be used, among the ones supported by CPU\n"
+        "      - 'auto': all, 'none': C only, 'sse': up to SSE (x86)"
+    },
     {
         'd',  "output-depth", ARGS_VAL_TYPE_INTEGER, 0, NULL,
         "output bit depth (8, 10, 12) "
@@ -81,11 +106,52 @@ static const args_opt_t dec_args_opts[] = {
         ARGS_NO_KEY,  "hash", ARGS_VAL_TYPE_NONE, 0, NULL,
         "parse frame hash value for conformance checking in decoding"
     },
+    {
+        ARGS_NO_KEY,  "huge-page", ARGS_VAL_TYPE_NONE, 0, NULL,
+        "use huge pages for decoded frame buffers, if available"
+    },
     {
         ARGS_NO_KEY,  "output-csp", ARGS_VAL_TYPE_INTEGER, 0, NULL,
         "output color space (chroma format)\n"
         "      - 0: coded CSP\n"
         "      - 1: convert to P210 in case of YCbCr422\n"
+        "      - 2: RGB (Planar R, G, B in output depth)\n"
+        "      - 3: RGBA (Planar R, G, B, alpha in output depth)\n"
+        "      - 4: RGB (Planar R, G, B in 32-bit float)\n"
+        "      - 5: RGBA (Planar R, G, B, alpha in 32-bit float)\n"
+        "      - 6: UYVY (Packed 422, 8-bit) in case of YCbCr422\n"
+        "      - 7: V210 (Packed 422, 10-bit) in case of YCbCr422\n"
+        "      Note: RGB uses matrix of bitstream and 2-tap chroma upsampling\n"
+    },
+    {
+        ARGS_NO_KEY,  "crop", ARGS_VAL_TYPE_STRING, 0, NULL,
+        "file name of bitstream cropped to tiles without decoding\n"
+        "      - the cropped bitstream is transcoded or decoded if\n"
+        "        '--transcode' or '--output' is given"
+    },
+    {
+        ARGS_NO_KEY,  "crop-rect", ARGS_VAL_TYPE_STRING, 0, NULL,
+        "rectangle of cropping as 'x,y,w,h' in pixel\n"
+        "      - extended to the boundaries of tiles covering it"
+    },
+    {
+        ARGS_NO_KEY,  "transcode", ARGS_VAL_TYPE_STRING, 0, NULL,
+        "file name of bitstream requantized in coefficient domain\n"
+        "      - the requantized bitstream is decoded if '--output' is given"
+    },
+    {
+        ARGS_NO_KEY,  "transcode-dqp", ARGS_VAL_TYPE_INTEGER, 0, NULL,
+        "QP value added to every tile in transcoding"
+    },
+    {
+        ARGS_NO_KEY,  "transcode-deadzone-y", ARGS_VAL_TYPE_INTEGER, 0, NULL,
+        "dead-zone offset of luma requantization (0 ~ 511)\n"
+        "      - default: same as block coding of encoder"
+    },
+    {
+        ARGS_NO_KEY,  "transcode-deadzone-c", ARGS_VAL_TYPE_INTEGER, 0, NULL,
+        "dead-zone offset of chroma requantization (0 ~ 511)\n"
+        "      - default: same as block coding of encoder"
     },
     {ARGS_END_KEY, "", ARGS_VAL_TYPE_NONE, 0, NULL, ""} /* termination */
 };
@@ -99,9 +165,16 @@ typedef struct args_var {
     char fname_out[256];
     int  max_au;
     int  hash;
+    int  huge_page;
     char threads[16];
+    char simd[16];
     int  output_depth;
     int  output_csp;
+    char fname_tc[256];
+    int  tc_dqp;
+    int  tc_deadzone[2];
+    char fname_crop[256];
+    char crop_rect[64];
 } args_var_t;
 
 static args_var_t *args_init_vars(args_parser_t *args)
@@ -118,13 +191,23 @@ static args_var_t *args_init_vars(args_parser_t *args)
     args_set_variable_by_key_long(opts, "output", vars->fname_out);
     args_set_variable_by_key_long(opts, "max-au", &vars->max_au);
     args_set_variable_by_key_long(opts, "hash", &vars->hash);
+    args_set_variable_by_key_long(opts, "huge-page", &vars->huge_page);
     args_set_variable_by_key_long(opts, "verbose", &op_verbose);
     op_verbose = VERBOSE_SIMPLE; /* default */
     args_set_variable_by_key_long(opts, "threads", vars->threads);
     strcpy(vars->threads, "auto");
+    args_set_variable_by_key_long(opts, "simd", vars->simd);
+    strcpy(vars->simd, "auto");
     args_set_variable_by_key_long(opts, "output-depth", &vars->output_depth);
     args_set_variable_by_key_long(opts, "output-csp", &vars->output_csp);
     vars->output_csp = 0; /* default: coded CSP */
+    args_set_variable_by_key_long(opts, "crop", vars->fname_crop);
+    args_set_variable_by_key_long(opts, "crop-rect", vars->crop_rect);
+    args_set_variable_by_key_long(opts, "transcode", vars->fname_tc);
+    args_set_variable_by_key_long(opts, "transcode-dqp", &vars->tc_dqp);
+    args_set_variable_by_key_long(opts, "transcode-deadzone-y", &vars->tc_deadzone[0]);
+    args_set_variable_by_key_long(opts, "transcode-deadzone-c", &vars->tc_deadzone[1]);
+    vars->tc_deadzone[0] = vars->tc_deadzone[1] = OAPVE_PARAM_TUNE_AUTO; /* default */
 
     return vars;
 }
@@ -161,54 +244,92 @@ ERR:
         free(args_var);
 }
 
-static int read_au_size(FILE *fp)
+/* input bitstream; file is mapped into memory when possible, so that access
+   units are decoded in place. otherwise, each access unit is read by a
+   fread() call into bitstream buffer */
+typedef struct {
+    FILE          *fp;
+    unsigned char *map;      // mapped file, or NULL
+    size_t         map_size;
+    size_t         pos;      // read position in mapped file
+} bs_reader_t;
+
+static int bs_reader_open(bs_reader_t *rd, const char *fname)
 {
-    unsigned char buf[4];
+    memset(rd, 0, sizeof(bs_reader_t));
+    rd->fp = fopen(fname, "rb");
+    if(rd->fp == NULL) {
+        return -1;
+    }
+#if BS_USE_MMAP
+    struct stat st;
+    if(fstat(fileno(rd->fp), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fileno(rd->fp), 0);
+        if(map != MAP_FAILED) {
+            rd->map = (unsigned char *)map;
+            rd->map_size = (size_t)st.st_size;
+            posix_madvise(map, rd->map_size, POSIX_MADV_SEQUENTIAL);
+        }
+    }
+#endif
+    return 0;
+}
 
-    for(int i = 0; i < 4; i++) {
-        if(1 != fread(&buf[i], 1, 1, fp))
-            return -1;
+static void bs_reader_close(bs_reader_t *rd)
+{
+#if BS_USE_MMAP
+    if(rd->map != NULL) {
+        munmap(rd->map, rd->map_size);
     }
-    return ((buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | (buf[3]));
+#endif
+    if(rd->fp != NULL) {
+        fclose(rd->fp);
+    }
+    memset(rd, 0, sizeof(bs_reader_t));
 }
 
-static int read_bitstream(FILE *fp, unsigned char *bs_buf, int *bs_buf_size)
+/* read an access unit; '*au' points to the mapped file or 'bs_buf' */
+static int read_bitstream(bs_reader_t *rd, unsigned char *bs_buf, unsigned char **au, int *au_size)
 {
-    int           au_size, read_size = 0;
-    unsigned char b = 0;
-    if(!fseek(fp, 0, SEEK_CUR)) {
-        /* read size first */
-        au_size = read_au_size(fp);
-        if(au_size > 0) {
-            while(au_size > 0) {
-                /* read byte */
-                if(1 != fread(&b, 1, 1, fp)) {
-                    logerr("Cannot read bitstream!\n");
-                    return -1;
-                }
-                bs_buf[read_size] = b;
-                read_size++;
-                au_size--;
-            }
-            *bs_buf_size = read_size;
-        }
-        else {
-            if(feof(fp)) {
-                logv2_line("");
-                logv2("End of file\n");
-                return 0;
-            }
-            else {
-                logerr("Cannot read bitstream size!\n")
-                return -1;
-            };
-        }
+    unsigned char buf[4];
+    size_t        remain;
+    int           size;
+
+    if(rd->map != NULL) {
+        remain = rd->map_size - rd->pos;
+        memcpy(buf, rd->map + rd->pos, remain < 4 ? remain : 4);
     }
     else {
-        logerr("Cannot seek bitstream!\n");
+        remain = fread(buf, 1, 4, rd->fp);
+    }
+    if(remain == 0) {
+        logv2_line("");
+        logv2("End of file\n");
+        return 0;
+    }
+    size = (remain < 4) ? 0 : ((buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | (buf[3]));
+    if(size <= 0 || size > MAX_BS_BUF) {
+        logerr("Cannot read bitstream size!\n");
         return -1;
     }
-    return read_size + 4;
+
+    if(rd->map != NULL) {
+        if(remain - 4 < (size_t)size) {
+            logerr("Cannot read bitstream!\n");
+            return -1;
+        }
+        *au = rd->map + rd->pos + 4;
+        rd->pos += (size_t)size + 4;
+    }
+    else {
+        if(fread(bs_buf, 1, size, rd->fp) != (size_t)size) {
+            logerr("Cannot read bitstream!\n");
+            return -1;
+        }
+        *au = bs_buf;
+    }
+    *au_size = size;
+    return size + 4;
 }
 
 static int set_extra_config(oapvd_t id, args_var_t *args_vars)
@@ -224,9 +345,28 @@ static int set_extra_config(oapvd_t id, args_var_t *args_vars)
             return -1;
         }
     }
+    if(args_vars->huge_page) {
+        value = 1;
+        size = 4;
+        ret = oapvd_config(id, OAPV_CFG_SET_USE_HUGE_PAGE, &value, &size);
+        if(OAPV_FAILED(ret)) {
+            logerr("failed to set config for using huge page\n");
+            return -1;
+        }
+    }
     return 0;
 }
 
+/* write access unit having 4 bytes of room for its size in front */
+static int write_au(char *fname, unsigned char *buf, int au_size)
+{
+    buf[0] = (unsigned char)((au_size >> 24) & 0xFF);
+    buf[1] = (unsigned char)((au_size >> 16) & 0xFF);
+    buf[2] = (unsigned char)((au_size >> 8) & 0xFF);
+    buf[3] = (unsigned char)(au_size & 0xFF);
+    return write_data(fname, buf, au_size + 4);
+}
+
 static int write_dec_img(char *fname, oapv_imgb_t *img, int flag_y4m)
 {
     if(flag_y4m) {
@@ -240,7 +380,8 @@ static int write_dec_img(char *fname, oapv_imgb_t *img, int flag_y4m)
 
 static int check_frm_hash(oapvm_t mid, oapv_imgb_t *imgb, int group_id)
 {
-    unsigned char uuid_frm_hash[16] = { 0xf8, 0x72, 0x1b, 0x3e, 0xcd, 0xee, 0x47, 0x21, 0x98, 0x0d, 0x9b, 0x9e, 0x39, 0x20, 0x28, 0x49 };
+    unsigned char uuid_frm_hash[16] = OAPV_UUID_FRM_HASH_MD5;
+    unsigned char uuid_frm_hash64[16] = OAPV_UUID_FRM_HASH_FAST;
     void         *buf;
     int           size;
     if(OAPV_SUCCEEDED(oapvm_get(mid, group_id, OAPV_METADATA_USER_DEFINED, &buf, &size, uuid_frm_hash))) {
@@ -254,6 +395,17 @@ static int check_frm_hash(oapvm_t mid, oapv_imgb_t *imgb, int group_id)
         }
         return 0; // frame hash is correct
     }
+    if(OAPV_SUCCEEDED(oapvm_get(mid, group_id, OAPV_METADATA_USER_DEFINED, &buf, &size, uuid_frm_hash64))) {
+        if(size != (imgb->np * 8) /* hash */ + 16 /* uuid */) {
+            return 1; // unexpected error
+        }
+        for(int i = 0; i < imgb->np; i++) {
+            if(memcmp((unsigned char *)buf + 16 + (i * 8), imgb->hash[i], 8) != 0) {
+                return -1; // frame hash is mismatched
+            }
+        }
+        return 0; // frame hash is correct
+    }
     return 1; // frame hash data is not available
 }
 
@@ -274,7 +426,7 @@ static void print_stat_au(oapvd_stat_t *stat, int au_cnt, args_var_t *args_var,
 {
     if(op_verbose >= VERBOSE_FRAME) {
         if(au_cnt == 0) {
-            if(args_var->output_csp != OUTPUT_CSP_NATIVE && args_var->hash != 0) {
+            if(!IS_OUTPUT_NATIVE(args_var->output_csp) && args_var->hash != 0) {
                 logv2("[Warning] cannot check frame hash value if special output CSP is defined\n")
             }
         }
@@ -332,7 +484,7 @@ static void print_stat_frm(oapvd_stat_t *stat, oapv_frms_t *frms, oapvm_t mid, a
         if(args_var->hash) {
             char *str_hash[4] = { "unsupport", "mismatch", "unavail", "match" };
 
-            if(args_var->output_csp != OUTPUT_CSP_NATIVE) {
+            if(!IS_OUTPUT_NATIVE(args_var->output_csp)) {
                 hash_idx = 0;
             }
             else {
@@ -355,6 +507,7 @@ int main(int argc, const char **argv)
     args_parser_t   *args;
     args_var_t      *args_var = NULL;
     unsigned char   *bs_buf = NULL;
+    unsigned char   *au = NULL; // access unit to be decoded
     oapvd_t          did = NULL;
     oapvm_t          mid = NULL;
     oapvd_cdesc_t    cdesc;
@@ -369,10 +522,19 @@ int main(int argc, const char **argv)
     oapv_clk_t       clk_beg, clk_end, clk_tot;
     int              au_cnt, frm_cnt[OAPV_MAX_NUM_FRAMES];
     int              read_size, bs_buf_size = 0;
-    FILE            *fp_bs = NULL;
+    bs_reader_t      bs_rd = { 0 };
     int              is_y4m = 0;
     char            *errstr = NULL;
     oapv_frm_info_t *finfo = NULL;
+    unsigned char   *tc_buf = NULL;
+    oapv_bitb_t      tc_bitb;
+    oapv_transcode_param_t tcp;
+    oapv_clk_t       clk_tc = 0;
+    long long        tc_bytes[2] = { 0, 0 };
+    unsigned char   *crop_buf = NULL;
+    oapv_bitb_t      crop_bitb;
+    int              crop[4];
+    oapv_clk_t       clk_crop = 0;
 
     memset(frm_cnt, 0, sizeof(int) * OAPV_MAX_NUM_FRAMES);
     memset(&aui, 0, sizeof(oapv_au_info_t));
@@ -419,8 +581,7 @@ int main(int argc, const char **argv)
     }
 
     /* open input file */
-    fp_bs = fopen(args_var->fname_inp, "rb");
-    if(fp_bs == NULL) {
+    if(bs_reader_open(&bs_rd, args_var->fname_inp)) {
         logerr("ERR: cannot open bitstream file = %s\n", args_var->fname_inp);
         print_usage(argv);
         ret = -1; goto ERR;
@@ -438,12 +599,42 @@ int main(int argc, const char **argv)
             logerr("ERR: unknown file type name for decoded video\n");
             ret = -1; goto ERR;
         }
+        if(is_y4m && args_var->output_csp >= OUTPUT_CSP_RGB) {
+            logerr("ERR: RGB or packed output cannot be written in Y4M\n");
+            ret = -1; goto ERR;
+        }
         clear_data(args_var->fname_out); /* remove decoded file contents if exists */
     }
+    if(strlen(args_var->fname_crop) > 0) {
+        if(sscanf(args_var->crop_rect, "%d,%d,%d,%d", &crop[0], &crop[1], &crop[2], &crop[3]) != 4) {
+            logerr("ERR: '--crop-rect' has to be given as 'x,y,w,h'\n");
+            ret = -1;
+            goto ERR;
+        }
+        crop_buf = malloc(MAX_BS_BUF);
+        if(crop_buf == NULL) {
+            logerr("ERR: cannot allocate bitstream buffer, size=%d\n", MAX_BS_BUF);
+            ret = -1;
+            goto ERR;
+        }
+        clear_data(args_var->fname_crop);
+    }
+    if(strlen(args_var->fname_tc) > 0) {
+        memset(&tcp, 0, sizeof(oapv_transcode_param_t));
+        tcp.dqp = args_var->tc_dqp;
+        tcp.deadzone[0] = args_var->tc_deadzone[0];
+        tcp.deadzone[1] = args_var->tc_deadzone[1];
+        tc_buf = malloc(MAX_BS_BUF);
+        if(tc_buf == NULL) {
+            logerr("ERR: cannot allocate bitstream buffer, size=%d\n", MAX_BS_BUF);
+            ret = -1;
+            goto ERR;
+        }
+        clear_data(args_var->fname_tc);
+    }
 
-    // create bitstream buffer
-    bs_buf = malloc(MAX_BS_BUF);
-    if(bs_buf == NULL) {
+    // create bitstream buffer; not used when input file is mapped
+    if(bs_rd.map == NULL && (bs_buf = malloc(MAX_BS_BUF)) == NULL) {
         logerr("ERR: cannot allocate bitstream buffer, size=%d\n", MAX_BS_BUF);
         ret = -1;
         goto ERR;
@@ -455,6 +646,12 @@ int main(int argc, const char **argv)
     else {
         cdesc.threads = atoi(args_var->threads);
     }
+    cdesc.simd = get_simd(args_var->simd);
+    if(cdesc.simd < 0) {
+        logerr("ERR: invalid SIMD kernels (%s)\n", args_var->simd);
+        ret = -1;
+        goto ERR;
+    }
     did = oapvd_create(&cdesc, &ret);
     if(did == NULL) {
         logerr("ERR: cannot create OAPV decoder (err=%d)\n", ret);
@@ -480,7 +677,7 @@ int main(int argc, const char **argv)
 
     /* decoding loop */
     while(args_var->max_au == 0 || (au_cnt < args_var->max_au)) {
-        read_size = read_bitstream(fp_bs, bs_buf, &bs_buf_size);
+        read_size = read_bitstream(&bs_rd, bs_buf, &au, &bs_buf_size);
         if (read_size == 0) {
             logv3("--> end of bitstream\n")
             break;
@@ -491,7 +688,62 @@ int main(int argc, const char **argv)
             goto ERR;
         }
 
-        if(OAPV_FAILED(oapvd_info(bs_buf, bs_buf_size, &aui))) {
+        if(crop_buf != NULL) {
+            /* crop access unit, which replaces input of following steps */
+            bitb.addr = au;
+            bitb.ssize = bs_buf_size;
+            crop_bitb.addr = crop_buf + 4;
+            crop_bitb.bsize = MAX_BS_BUF - 4;
+
+            clk_beg = oapv_clk_get();
+            ret = oapv_crop(&bitb, crop[0], crop[1], crop[2], crop[3], &crop_bitb);
+            clk_crop += oapv_clk_from(clk_beg);
+            if(OAPV_FAILED(ret)) {
+                logerr("ERR: failed to crop bitstream (err=%d)\n", ret);
+                ret = -1;
+                goto END;
+            }
+            if(write_au(args_var->fname_crop, crop_buf, crop_bitb.ssize)) {
+                ret = -1;
+                goto ERR;
+            }
+            logv3("AU %-5d  %10d-bytes -> %10d-bytes (cropped)\n", au_cnt, bs_buf_size, crop_bitb.ssize);
+            au = crop_bitb.addr;
+            bs_buf_size = crop_bitb.ssize;
+        }
+
+        if(tc_buf != NULL) {
+            /* requantize access unit, which replaces input of decoding */
+            bitb.addr = au;
+            bitb.ssize = bs_buf_size;
+            tc_bitb.addr = tc_buf + 4;
+            tc_bitb.bsize = MAX_BS_BUF - 4;
+            memset(&stat, 0, sizeof(oapvd_stat_t));
+
+            clk_beg = oapv_clk_get();
+            ret = oapv_transcode(did, &bitb, &tcp, &tc_bitb, &stat);
+            clk_tc += oapv_clk_from(clk_beg);
+            if(OAPV_FAILED(ret)) {
+                logerr("ERR: failed to transcode bitstream (err=%d)\n", ret);
+                ret = -1;
+                goto END;
+            }
+            if(write_au(args_var->fname_tc, tc_buf, tc_bitb.ssize)) {
+                ret = -1;
+                goto ERR;
+            }
+            tc_bytes[0] += bs_buf_size;
+            tc_bytes[1] += tc_bitb.ssize;
+            logv3("AU %-5d  %10d-bytes -> %10d-bytes (transcoded)\n", au_cnt, bs_buf_size, tc_bitb.ssize);
+            au = tc_bitb.addr;
+            bs_buf_size = tc_bitb.ssize;
+        }
+        if((crop_buf != NULL || tc_buf != NULL) && strlen(args_var->fname_out) == 0) {
+            au_cnt++;
+            continue;
+        }
+
+        if(OAPV_FAILED(oapvd_info(au, bs_buf_size, &aui))) {
             logerr("ERR: cannot get information from bitstream\n");
             ret = -1;
             goto ERR;
@@ -503,17 +755,27 @@ int main(int argc, const char **argv)
             finfo = &aui.frm_info[i];
             frm = &ofrms.frm[i];
 
-            if(frm->imgb != NULL && (frm->imgb->w[0] != finfo->w || frm->imgb->h[0] != finfo->h)) {
+            if(frm->imgb != NULL && (IS_OUTPUT_NATIVE(args_var->output_csp) || frm->imgb->w[0] != finfo->w || frm->imgb->h[0] != finfo->h)) {
+                // native frames are returned to the decoder's frame pool
                 frm->imgb->release(frm->imgb);
                 frm->imgb = NULL;
             }
 
+            if(IS_OUTPUT_NATIVE(args_var->output_csp)) {
+                continue; // allocated by decoder
+            }
             if(frm->imgb == NULL) {
                 if(args_var->output_csp == 1) {
                     frm->imgb = imgb_create(finfo->w, finfo->h, OAPV_CS_SET(OAPV_CF_PLANAR2, 10, 0));
                 }
-                else {
-                    frm->imgb = imgb_create(finfo->w, finfo->h, finfo->cs);
+                else if(args_var->output_csp == OUTPUT_CSP_RGB || args_var->output_csp == OUTPUT_CSP_RGBA) {
+                    // converted to output depth in decoding
+                    int depth = args_var->output_depth ? args_var->output_depth : OAPV_CS_GET_BIT_DEPTH(finfo->cs);
+                    int cf = (args_var->output_csp == OUTPUT_CSP_RGB) ? OAPV_CF_RGB : OAPV_CF_RGBA;
+                    frm->imgb = imgb_create(finfo->w, finfo->h, OAPV_CS_SET(cf, depth, 0));
+                }
+                else if(args_var->output_csp == OUTPUT_CSP_RGBF || args_var->output_csp == OUTPUT_CSP_RGBAF) {
+                    frm->imgb = imgb_create(finfo->w, finfo->h, (args_var->output_csp == OUTPUT_CSP_RGBF) ? OAPV_CS_RGBF : OAPV_CS_RGBAF);
                 }
                 if(frm->imgb == NULL) {
                     logerr("ERR: cannot allocate image buffer (w:%d, h:%d, cs:%d)\n",
@@ -529,7 +791,7 @@ int main(int argc, const char **argv)
         }
 
         /* main decoding block */
-        bitb.addr = bs_buf;
+        bitb.addr = au;
         bitb.ssize = bs_buf_size;
         memset(&stat, 0, sizeof(oapvd_stat_t));
 
@@ -583,7 +845,7 @@ int main(int argc, const char **argv)
         for(i = 0; i < ofrms.num_frms; i++) {
             frm = &ofrms.frm[i];
             if(ofrms.num_frms > 0) {
-                if(OAPV_CS_GET_BIT_DEPTH(frm->imgb->cs) != args_var->output_depth && args_var->output_csp != 1) {
+                if(OAPV_CS_GET_BIT_DEPTH(frm->imgb->cs) != args_var->output_depth && args_var->output_csp == OUTPUT_CSP_NATIVE) {
                     if(imgb_w == NULL) {
                         imgb_w = imgb_create(frm->imgb->w[0], frm->imgb->h[0],
                                              OAPV_CS_SET(OAPV_CS_GET_FORMAT(frm->imgb->cs), args_var->output_depth, 0));
@@ -597,6 +859,24 @@ int main(int argc, const char **argv)
                     imgb_cpy(imgb_w, frm->imgb);
                     imgb_o = imgb_w;
                 }
+                else if(args_var->output_csp == OUTPUT_CSP_UYVY || args_var->output_csp == OUTPUT_CSP_V210) {
+                    if(imgb_w == NULL) {
+                        imgb_w = imgb_create(frm->imgb->w[0], frm->imgb->h[0],
+                                             (args_var->output_csp == OUTPUT_CSP_UYVY) ? OAPV_CS_UYVY : OAPV_CS_V210);
+                        if(imgb_w == NULL) {
+                            logerr("ERR: cannot allocate image buffer (w:%d, h:%d, cs:%d)\n",
+                                   frm->imgb->w[0], frm->imgb->h[0], frm->imgb->cs);
+                            ret = -1;
+                            goto ERR;
+                        }
+                    }
+                    if(imgb_pack_422(imgb_w, frm->imgb)) {
+                        logerr("ERR: packed output is only for YCbCr422\n");
+                        ret = -1;
+                        goto ERR;
+                    }
+                    imgb_o = imgb_w;
+                }
                 else {
                     imgb_o = frm->imgb;
                 }
@@ -631,6 +911,13 @@ END:
     for(i = 0; i < OAPV_MAX_NUM_FRAMES; i++)
         total_frame_count += frm_cnt[i];
     logv2("Decoded frame count               = %d\n", total_frame_count);
+    if(crop_buf != NULL) {
+        logv2("Total cropping time               = %d msec\n", (int)oapv_clk_msec(clk_crop));
+    }
+    if(tc_buf != NULL) {
+        logv2("Total transcoding time            = %d msec\n", (int)oapv_clk_msec(clk_tc));
+        logv2("Transcoded bitstream size         = %lld -> %lld bytes\n", tc_bytes[0], tc_bytes[1]);
+    }
     if(total_frame_count > 0) {
         logv2("Total decoding time               = %d msec,", (int)oapv_clk_msec(clk_tot));
         logv2(" %.3f sec\n", (float)(oapv_clk_msec(clk_tot) / 1000.0));
@@ -640,6 +927,10 @@ END:
     logv2_line(NULL);
 
 ERR:
+    if(wr_close()) {
+        logerr("ERR: cannot write output files\n");
+        ret = -1;
+    }
     if(did)
         oapvd_delete(did);
 
@@ -653,10 +944,13 @@ ERR:
     }
     if(imgb_w != NULL)
         imgb_w->release(imgb_w);
-    if(fp_bs)
-        fclose(fp_bs);
+    bs_reader_close(&bs_rd);
     if(bs_buf)
         free(bs_buf);
+    if(tc_buf)
+        free(tc_buf);
+    if(crop_buf)
+        free(crop_buf);
     if(args)
         args->release(args);
     if(args_var)
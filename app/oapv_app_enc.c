@@ -93,10 +93,58 @@ static const args_opt_t enc_args_opts[] = {
         "force use of a specific number of threads\n"
         "      - 'auto' means that the value is internally determined"
     },
+    {
+        ARGS_NO_KEY,  "simd", ARGS_VAL_TYPE_STRING, 0, NULL,
+        "SIMD kernels to be used, among the ones supported by CPU\n"
+        "      - 'auto': all, 'none': C only, 'sse': up to SSE (x86)"
+    },
     {
         ARGS_NO_KEY,  "preset", ARGS_VAL_TYPE_STRING, 0, NULL,
         "encoder preset [fastest, fast, medium, slow, placebo]"
     },
+    {
+        ARGS_NO_KEY,  "frm-time-budget", ARGS_VAL_TYPE_STRING, 0, NULL,
+        "time budget for encoding a frame in unit of micro-second\n"
+        "      - remaining tiles are encoded with 'fast' preset, if encoding\n"
+        "        is behind the budget"
+    },
+    {
+        ARGS_NO_KEY,  "rc-subsample", ARGS_VAL_TYPE_STRING, 0, NULL,
+        "analyze one of every N rows of 8x8 blocks for rate control (0 ~ 16)\n"
+        "      - 0 or 1: all rows are analyzed"
+    },
+    {
+        ARGS_NO_KEY,  "deadzone-y", ARGS_VAL_TYPE_STRING, 0, NULL,
+        "dead-zone offset of luma quantization (0 ~ 511, 256: rounding)"
+    },
+    {
+        ARGS_NO_KEY,  "deadzone-c", ARGS_VAL_TYPE_STRING, 0, NULL,
+        "dead-zone offset of chroma quantization (0 ~ 511, 256: rounding)"
+    },
+    {
+        ARGS_NO_KEY,  "rdo-itr-y", ARGS_VAL_TYPE_STRING, 0, NULL,
+        "iterations of luma coefficient refinement in 'slow' preset"
+    },
+    {
+        ARGS_NO_KEY,  "rdo-itr-c", ARGS_VAL_TYPE_STRING, 0, NULL,
+        "iterations of chroma coefficient refinement in 'slow' preset"
+    },
+    {
+        ARGS_NO_KEY,  "rdo-adj-rng-y", ARGS_VAL_TYPE_STRING, 0, NULL,
+        "adjustment range of luma coefficient in 'slow' preset (1 ~ 15)"
+    },
+    {
+        ARGS_NO_KEY,  "rdo-adj-rng-c", ARGS_VAL_TYPE_STRING, 0, NULL,
+        "adjustment range of chroma coefficient in 'slow' preset (1 ~ 15)"
+    },
+    {
+        ARGS_NO_KEY,  "rdo-max-cand", ARGS_VAL_TYPE_STRING, 0, NULL,
+        "max number of candidates per iteration in 'placebo' preset (1 ~ 8)"
+    },
+    {
+        ARGS_NO_KEY,  "rdo-full-itr", ARGS_VAL_TYPE_STRING, 0, NULL,
+        "iterations of full RDO in 'placebo' preset"
+    },
     {
         'd',  "input-depth", ARGS_VAL_TYPE_INTEGER, 0, NULL,
         "input bit depth (8, 10-12)\n"
@@ -109,7 +157,14 @@ static const args_opt_t enc_args_opts[] = {
         "      - 2: 422\n"
         "      - 3: 444\n"
         "      - 4: 4444\n"
-        "      - 5: P2(Planar Y, Combined CbCr, 422)"
+        "      - 5: P2(Planar Y, Combined CbCr, 422)\n"
+        "      - 6: UYVY(Packed 422, 8-bit)\n"
+        "      - 7: V210(Packed 422, 10-bit)\n"
+        "      - 8: RGB(Planar R, G, B, 444)\n"
+        "      - 9: GBR(Planar G, B, R, 444)\n"
+        "      - 10: RGBA(Planar R, G, B, alpha, 4444)\n"
+        "      - 11: GBRA(Planar G, B, R, alpha, 4444)\n"
+        "      Note: RGB input is converted by '--color-matrix' (gbr, bt709 or bt2020nc)"
     },
     {
         ARGS_NO_KEY,  "family", ARGS_VAL_TYPE_STRING, 0, NULL,
@@ -180,6 +235,61 @@ static const args_opt_t enc_args_opts[] = {
         "      bitrate in terms of kbits per second: Kbps(none,K,k), Mbps(M,m)\n"
         "      ex) 100 = 100K = 0.1M"
     },
+    {
+        ARGS_NO_KEY,  "use-filler", ARGS_VAL_TYPE_STRING, 0, NULL,
+        "pad every frame with filler data up to the bitrate (0: off, 1: on)\n"
+        "      - it works with 'bitrate' option only"
+    },
+    {
+        ARGS_NO_KEY,  "au-size-max", ARGS_VAL_TYPE_INTEGER, 0, NULL,
+        "max byte size of an access unit (0: no limit)\n"
+        "      - QPs of tiles are raised to fit, if needed\n"
+        "      - QPs are guessed by 'fast' preset quantization and\n"
+        "        corrected by re-encoding of tiles"
+    },
+    {
+        ARGS_NO_KEY,  "bs-buf-max", ARGS_VAL_TYPE_INTEGER, 0, NULL,
+        "max byte size of bitstream buffers of tiles in encoder\n"
+        "      (0: size of output buffer)"
+    },
+    {
+        ARGS_NO_KEY,  "extra-out", ARGS_VAL_TYPE_STRING, 0, NULL,
+        "additional outputs encoded along with the main output, sharing\n"
+        "      forward transform (max 3); 'file:rate' separated by comma\n"
+        "      rate is QP with 'q' prefix, bitrate or family name\n"
+        "      ex) lq.apv:q40,sq.apv:50M,hq.apv:422-HQ"
+    },
+    {
+        ARGS_NO_KEY,  "extra-out-au", ARGS_VAL_TYPE_INTEGER, 0, NULL,
+        "number of access units written to additional outputs; the rest\n"
+        "      are encoded only to main output (0: all)"
+    },
+    {
+        ARGS_NO_KEY,  "tile-reuse", ARGS_VAL_TYPE_NONE, 0, NULL,
+        "reuse bitstream of tiles not changed since previous access unit"
+    },
+    {
+        ARGS_NO_KEY,  "lazy-rec", ARGS_VAL_TYPE_NONE, 0, NULL,
+        "make reconstructed picture by decoding of tiles after encoding\n"
+        "      them, instead of in encoding loop"
+    },
+    {
+        ARGS_NO_KEY,  "metric", ARGS_VAL_TYPE_NONE, 0, NULL,
+        "measure PSNR and SSIM inside encoder, which needs no reconstructed\n"
+        "      picture option"
+    },
+    {
+        ARGS_NO_KEY,  "tile-range", ARGS_VAL_TYPE_STRING, 0, NULL,
+        "encode only the tiles of index in [beg, end) of every frame into\n"
+        "      tile payloads to be stitched later; 'beg,end'\n"
+        "      - bitrate option is the budget of the tiles"
+    },
+    {
+        ARGS_NO_KEY,  "stitch", ARGS_VAL_TYPE_STRING, 0, NULL,
+        "stitch tile payloads of 'tile-range' output files into access units\n"
+        "      instead of encoding; files are separated by comma\n"
+        "      ex) top.tiles,bottom.tiles"
+    },
     {
         ARGS_NO_KEY,  "q-matrix-c0", ARGS_VAL_TYPE_STRING, 0, NULL,
         "custom quantization matrix for component 0 (Y) \"q1 q2 ... q63 q64\""
@@ -196,10 +306,49 @@ static const args_opt_t enc_args_opts[] = {
         ARGS_NO_KEY,  "q-matrix-c3", ARGS_VAL_TYPE_STRING, 0, NULL,
         "custom quantization matrix for component 3 \"q1 q2 ... q63 q64\""
     },
+    {
+        ARGS_NO_KEY,  "color-primaries", ARGS_VAL_TYPE_STRING, 0, NULL,
+        "color primaries of color description (ex. bt709, bt2020)"
+    },
+    {
+        ARGS_NO_KEY,  "color-transfer", ARGS_VAL_TYPE_STRING, 0, NULL,
+        "transfer characteristics of color description (ex. bt709, smpte2084)"
+    },
+    {
+        ARGS_NO_KEY,  "color-matrix", ARGS_VAL_TYPE_STRING, 0, NULL,
+        "matrix coefficients of color description (ex. gbr, bt709, bt2020nc)"
+    },
+    {
+        ARGS_NO_KEY,  "color-range", ARGS_VAL_TYPE_STRING, 0, NULL,
+        "color range of color description; 'limited' or 'full'"
+    },
     {
         ARGS_NO_KEY,  "hash", ARGS_VAL_TYPE_NONE, 0, NULL,
         "embed frame hash value for conformance checking in decoding"
     },
+    {
+        ARGS_NO_KEY,  "hash-fast", ARGS_VAL_TYPE_NONE, 0, NULL,
+        "embed fast frame hash made of 64-bit hash values of tiles, instead of MD5"
+    },
+    {
+        ARGS_NO_KEY,  "stream", ARGS_VAL_TYPE_NONE, 0, NULL,
+        "write each tile to output file as soon as it is encoded"
+    },
+    {
+        ARGS_NO_KEY,  "no-lookahead", ARGS_VAL_TYPE_NONE, 0, NULL,
+        "analyze complexity of an access unit for rate control when it is\n"
+        "      encoded, instead of while encoding previous one"
+    },
+    {
+        ARGS_NO_KEY,  "no-scatter", ARGS_VAL_TYPE_NONE, 0, NULL,
+        "copy tile bitstreams into output buffer in encoder, instead of\n"
+        "      getting them as segments"
+    },
+    {
+        ARGS_NO_KEY,  "no-flat-blk", ARGS_VAL_TYPE_NONE, 0, NULL,
+        "run forward transform also for flat blocks, instead of coding them\n"
+        "      as DC-only blocks directly"
+    },
     {ARGS_END_KEY, "", ARGS_VAL_TYPE_NONE, 0, NULL, ""} /* termination */
 };
 
@@ -212,12 +361,27 @@ typedef struct args_var {
     char           fname_inp[256];
     char           fname_out[256];
     char           fname_rec[256];
+    char           extra_out[1024];
+    int            extra_out_au;
+    char           tile_range[32];
+    char           stitch[1024];
     int            max_au;
     int            hash;
+    int            hash_fast;
+    int            au_size_max;
+    int            bs_buf_max;
+    int            tile_reuse;
+    int            lazy_rec;
+    int            metric;
+    int            stream;
+    int            no_scatter;
+    int            no_lookahead;
+    int            no_flat_blk;
     int            input_depth;
     int            input_csp;
     int            seek;
     char           threads[16];
+    char           simd[16];
 
     char           profile[16];
     char           level[16];
@@ -233,8 +397,19 @@ typedef struct args_var {
     char           qp_offset_c3[16];
     char           family[16];
     char           bitrate[32];
+    char           use_filler[16];
 
     char           preset[16];
+    char           frm_time_budget[16];
+    char           rc_subsample[16];
+    char           deadzone_y[16];
+    char           deadzone_c[16];
+    char           rdo_itr_y[16];
+    char           rdo_itr_c[16];
+    char           rdo_adj_rng_y[16];
+    char           rdo_adj_rng_c[16];
+    char           rdo_max_cand[16];
+    char           rdo_full_itr[16];
 
     char           q_matrix_c0[512]; // raster-scan order
     char           q_matrix_c1[512]; // raster-scan order
@@ -267,8 +442,22 @@ static args_var_t *args_init_vars(args_parser_t *args, oapve_param_t *param)
     args_set_variable_by_key_long(opts, "input", vars->fname_inp);
     args_set_variable_by_key_long(opts, "output", vars->fname_out);
     args_set_variable_by_key_long(opts, "recon", vars->fname_rec);
+    args_set_variable_by_key_long(opts, "extra-out", vars->extra_out);
+    args_set_variable_by_key_long(opts, "extra-out-au", &vars->extra_out_au);
     args_set_variable_by_key_long(opts, "max-au", &vars->max_au);
     args_set_variable_by_key_long(opts, "hash", &vars->hash);
+    args_set_variable_by_key_long(opts, "hash-fast", &vars->hash_fast);
+    args_set_variable_by_key_long(opts, "stream", &vars->stream);
+    args_set_variable_by_key_long(opts, "no-scatter", &vars->no_scatter);
+    args_set_variable_by_key_long(opts, "no-lookahead", &vars->no_lookahead);
+    args_set_variable_by_key_long(opts, "no-flat-blk", &vars->no_flat_blk);
+    args_set_variable_by_key_long(opts, "au-size-max", &vars->au_size_max);
+    args_set_variable_by_key_long(opts, "bs-buf-max", &vars->bs_buf_max);
+    args_set_variable_by_key_long(opts, "tile-reuse", &vars->tile_reuse);
+    args_set_variable_by_key_long(opts, "lazy-rec", &vars->lazy_rec);
+    args_set_variable_by_key_long(opts, "metric", &vars->metric);
+    args_set_variable_by_key_long(opts, "tile-range", vars->tile_range);
+    args_set_variable_by_key_long(opts, "stitch", vars->stitch);
     args_set_variable_by_key_long(opts, "verbose", &op_verbose);
     op_verbose = VERBOSE_SIMPLE; /* default */
     args_set_variable_by_key_long(opts, "input-depth", &vars->input_depth);
@@ -295,19 +484,37 @@ static args_var_t *args_init_vars(args_parser_t *args, oapve_param_t *param)
 
     args_set_variable_by_key_long(opts, "family", vars->family);
     args_set_variable_by_key_long(opts, "bitrate", vars->bitrate);
+    args_set_variable_by_key_long(opts, "use-filler", vars->use_filler);
 
     args_set_variable_by_key_long(opts, "q-matrix-c0", vars->q_matrix_c0);
     args_set_variable_by_key_long(opts, "q-matrix-c1", vars->q_matrix_c1);
     args_set_variable_by_key_long(opts, "q-matrix-c2", vars->q_matrix_c2);
     args_set_variable_by_key_long(opts, "q-matrix-c3", vars->q_matrix_c3);
 
+    args_set_variable_by_key_long(opts, "color-primaries", vars->color_primaries);
+    args_set_variable_by_key_long(opts, "color-transfer", vars->color_transfer);
+    args_set_variable_by_key_long(opts, "color-matrix", vars->color_matrix);
+    args_set_variable_by_key_long(opts, "color-range", vars->color_range);
+
     args_set_variable_by_key_long(opts, "threads", vars->threads);
     strcpy(vars->threads, "auto");
+    args_set_variable_by_key_long(opts, "simd", vars->simd);
+    strcpy(vars->simd, "auto");
 
     args_set_variable_by_key_long(opts, "tile-w", vars->tile_w);
     args_set_variable_by_key_long(opts, "tile-h", vars->tile_h);
 
     args_set_variable_by_key_long(opts, "preset", vars->preset);
+    args_set_variable_by_key_long(opts, "frm-time-budget", vars->frm_time_budget);
+    args_set_variable_by_key_long(opts, "rc-subsample", vars->rc_subsample);
+    args_set_variable_by_key_long(opts, "deadzone-y", vars->deadzone_y);
+    args_set_variable_by_key_long(opts, "deadzone-c", vars->deadzone_c);
+    args_set_variable_by_key_long(opts, "rdo-itr-y", vars->rdo_itr_y);
+    args_set_variable_by_key_long(opts, "rdo-itr-c", vars->rdo_itr_c);
+    args_set_variable_by_key_long(opts, "rdo-adj-rng-y", vars->rdo_adj_rng_y);
+    args_set_variable_by_key_long(opts, "rdo-adj-rng-c", vars->rdo_adj_rng_c);
+    args_set_variable_by_key_long(opts, "rdo-max-cand", vars->rdo_max_cand);
+    args_set_variable_by_key_long(opts, "rdo-full-itr", vars->rdo_full_itr);
     return vars;
 }
 
@@ -369,8 +576,16 @@ static int check_conf(oapve_cdesc_t *cdesc, args_var_t *vars)
     int i;
     for(i = 0; i < cdesc->max_num_frms; i++) {
         // ensure frame width multiple of 2 in case of 422 format
-        if ((vars->input_csp == 2) && (cdesc->param[i].w & 0x1)) {
-            logerr("ERR: %d-th frame's width should be a multiple of 2 for '--input-csp 2'\n", i);
+        if ((vars->input_csp == 2 || (vars->input_csp >= 5 && vars->input_csp <= 7)) && (cdesc->param[i].w & 0x1)) {
+            logerr("ERR: %d-th frame's width should be a multiple of 2 for '--input-csp %d'\n", i, vars->input_csp);
+            return -1;
+        }
+        if(vars->input_csp >= 8 && strlen(vars->color_matrix) == 0) {
+            logerr("ERR: '--color-matrix' is required for RGB input\n");
+            return -1;
+        }
+        if(cdesc->param[i].use_filler && strlen(vars->extra_out) > 0) {
+            logerr("ERR: 'use-filler' cannot be used with 'extra-out'\n");
             return -1;
         }
         if(vars->hash && strlen(vars->fname_rec) == 0) {
@@ -378,6 +593,14 @@ static int check_conf(oapve_cdesc_t *cdesc, args_var_t *vars)
             return -1;
         }
     }
+    if(strlen(vars->tile_range) > 0 || strlen(vars->stitch) > 0) {
+        // no reconstruction is available in both of them
+        if((strlen(vars->tile_range) > 0 && strlen(vars->stitch) > 0) || strlen(vars->extra_out) > 0 ||
+           strlen(vars->fname_rec) > 0 || vars->hash || vars->stream || vars->au_size_max > 0 || vars->tile_reuse) {
+            logerr("ERR: 'tile-range' and 'stitch' cannot be used with each other or other output options\n");
+            return -1;
+        }
+    }
     if(strlen(vars->family) > 0) {
         int f = get_val_from_key(opts_family, vars->family);
         if(f < 0) {
@@ -417,8 +640,16 @@ static int set_extra_config(oapve_t id, args_var_t *vars, oapve_param_t *param)
 {
     int ret = 0, size, value;
 
+    // get tile bitstreams as segments to avoid copying them in encoder
+    value = vars->no_scatter ? 0 : 1;
+    size = 4;
+    ret = oapve_config(id, OAPV_CFG_SET_USE_BS_SCATTER, &value, &size);
+    if(OAPV_FAILED(ret)) {
+        logerr("ERR: failed to set config for bitstream scatter output\n");
+        return -1;
+    }
     if(vars->hash) {
-        value = 1;
+        value = vars->hash_fast ? OAPV_CFG_VAL_FRM_HASH_FAST : OAPV_CFG_VAL_FRM_HASH_MD5;
         size = 4;
         ret = oapve_config(id, OAPV_CFG_SET_USE_FRM_HASH, &value, &size);
         if(OAPV_FAILED(ret)) {
@@ -426,9 +657,67 @@ static int set_extra_config(oapve_t id, args_var_t *vars, oapve_param_t *param)
             return -1;
         }
     }
+    if(vars->au_size_max > 0) {
+        size = 4;
+        ret = oapve_config(id, OAPV_CFG_SET_AU_SIZE_MAX, &vars->au_size_max, &size);
+        if(OAPV_FAILED(ret)) {
+            logerr("ERR: failed to set config for max access unit size\n");
+            return -1;
+        }
+    }
+    if(vars->tile_reuse) {
+        value = 1;
+        size = 4;
+        ret = oapve_config(id, OAPV_CFG_SET_USE_TILE_REUSE, &value, &size);
+        if(OAPV_FAILED(ret)) {
+            logerr("ERR: failed to set config for tile reuse\n");
+            return -1;
+        }
+    }
+    if(vars->lazy_rec) {
+        value = 1;
+        size = 4;
+        ret = oapve_config(id, OAPV_CFG_SET_USE_LAZY_REC, &value, &size);
+        if(OAPV_FAILED(ret)) {
+            logerr("ERR: failed to set config for lazy reconstruction\n");
+            return -1;
+        }
+    }
+    if(vars->metric) {
+        value = OAPV_CFG_VAL_METRIC_PSNR | OAPV_CFG_VAL_METRIC_SSIM;
+        size = 4;
+        ret = oapve_config(id, OAPV_CFG_SET_USE_METRIC, &value, &size);
+        if(OAPV_FAILED(ret)) {
+            logerr("ERR: failed to set config for quality metric\n");
+            return -1;
+        }
+    }
+    if(vars->no_flat_blk) {
+        value = 0;
+        size = 4;
+        ret = oapve_config(id, OAPV_CFG_SET_USE_FLAT_BLK, &value, &size);
+        if(OAPV_FAILED(ret)) {
+            logerr("ERR: failed to set config for flat block shortcut\n");
+            return -1;
+        }
+    }
     return ret;
 }
 
+/* read frames of an access unit; frames are kept in the format of input
+   file, since encoder converts them while reading blocks */
+static int read_frms(FILE *fp, oapv_frms_t *frms, int w, int h, int is_y4m)
+{
+    for(int i = 0; i < frms->num_frms; i++) {
+        if(imgb_read(fp, frms->frm[i].imgb, w, h, is_y4m) < 0) {
+            return -1;
+        }
+        frms->frm[i].group_id = 1; // FIX-ME : need to set properly in case of multi-frame
+        frms->frm[i].pbu_type = OAPV_PBU_TYPE_PRIMARY_FRAME;
+    }
+    return 0;
+}
+
 static int write_rec_img(char *fname, oapv_imgb_t *img, int flag_y4m)
 {
     if(flag_y4m) {
@@ -476,6 +765,30 @@ static void add_thousands_comma_to_number(char *in, char *out)
     *out='\0';
 }
 
+typedef struct stream_out {
+    FILE *fp;
+    long  au_pos; // file position of current access unit
+} stream_out_t;
+
+static int stream_write(void *arg, int type, int offset, void *data, int size)
+{
+    stream_out_t *so = (stream_out_t *)arg;
+
+    if(type == OAPVE_STREAM_PATCH) {
+        // overwrite the size field that was streamed as zero
+        fseek(so->fp, so->au_pos + offset, SEEK_SET);
+        fwrite(data, 1, size, so->fp);
+        fseek(so->fp, 0, SEEK_END);
+    }
+    else {
+        if(fwrite(data, 1, size, so->fp) != (size_t)size) {
+            return -1;
+        }
+    }
+    fflush(so->fp);
+    return 0;
+}
+
 static void print_config(args_var_t *vars, oapve_param_t *param)
 {
     if(op_verbose < VERBOSE_FRAME)
@@ -484,7 +797,7 @@ static void print_config(args_var_t *vars, oapve_param_t *param)
     logv3_line("Configurations");
     logv3("Input sequence : %s \n", vars->fname_inp);
     if(strlen(vars->fname_out) > 0) {
-        logv3("Output bitstream : %s \n", vars->fname_out);
+        logv3("Output bitstream : %s%s \n", vars->fname_out, vars->stream ? " (streaming)" : "");
     }
     if(strlen(vars->fname_rec) > 0) {
         logv3("Reconstructed sequence : %s \n", vars->fname_rec);
@@ -504,10 +817,22 @@ static void print_config(args_var_t *vars, oapve_param_t *param)
     }
     else if(param->rc_type == OAPV_RC_ABR) {
         //add_thousands_comma_to_number(vars->bitrate, tstr);
-        logv3("    target bitrate      = %s\n", vars->bitrate);
+        logv3("    target bitrate      = %s%s\n", vars->bitrate, param->use_filler ? " (constant, filler)" : "");
+        if(param->rc_subsample > 1) {
+            logv3("    rc subsampling      = 1/%d block rows\n", param->rc_subsample);
+        }
     }
     logv3("    max number of AUs   = %d\n", vars->max_au);
     logv3("    tile size           = %d x %d\n", param->tile_w, param->tile_h);
+    if(vars->au_size_max > 0) {
+        logv3("    max AU size         = %d bytes\n", vars->au_size_max);
+    }
+    if(strlen(vars->extra_out) > 0) {
+        logv3("    extra outputs       = %s\n", vars->extra_out);
+    }
+    if(param->frm_time_budget > 0) {
+        logv3("    frame time budget   = %d usec\n", param->frm_time_budget);
+    }
 }
 
 static void print_stat_au(oapve_stat_t *stat, int au_cnt, oapve_param_t *param, int max_au, double bitrate_tot, oapv_clk_t clk_au, oapv_clk_t clk_tot)
@@ -533,9 +858,10 @@ static void print_stat_au(oapve_stat_t *stat, int au_cnt, oapve_param_t *param,
     }
 }
 
-static void print_stat_frms(oapve_stat_t *stat, oapv_frms_t *ifrms, oapv_frms_t *rfrms, double psnr_avg[MAX_NUM_FRMS][MAX_NUM_CC])
+static void print_stat_frms(oapve_stat_t *stat, oapv_frms_t *ifrms, oapv_frms_t *rfrms, oapve_param_t *param, int metric,
+                            double psnr_avg[MAX_NUM_FRMS][MAX_NUM_CC], double ssim_avg[MAX_NUM_FRMS][MAX_NUM_CC])
 {
-    int              i, j, cfmt;
+    int              i, j, cfmt, num_down;
     oapv_frm_info_t *finfo;
     double           psnr[MAX_NUM_FRMS][MAX_NUM_CC] = { 0 };
 
@@ -543,9 +869,21 @@ static void print_stat_frms(oapve_stat_t *stat, oapv_frms_t *ifrms, oapv_frms_t
     assert(stat->aui.num_frms <= MAX_NUM_FRMS);
 
     // calculate PSNRs
-    if(rfrms != NULL) {
+    if(metric) {
+        // measured by encoder
+        for(i = 0; i < stat->aui.num_frms; i++) {
+            for(j = 0; j < MAX_NUM_CC; j++) {
+                psnr[i][j] = stat->psnr[i][j];
+                psnr_avg[i][j] += stat->psnr[i][j];
+                ssim_avg[i][j] += stat->ssim[i][j];
+            }
+        }
+    }
+    else if(rfrms != NULL) {
         for(i = 0; i < stat->aui.num_frms; i++) {
-            if(rfrms->frm[i].imgb) {
+            // no PSNR of RGB input against YCbCr reconstruction
+            cfmt = OAPV_CS_GET_FORMAT(ifrms->frm[i].imgb->cs);
+            if(rfrms->frm[i].imgb && cfmt != OAPV_CF_RGB && cfmt != OAPV_CF_GBR && cfmt != OAPV_CF_RGBA && cfmt != OAPV_CF_GBRA) {
                 measure_psnr(ifrms->frm[i].imgb, rfrms->frm[i].imgb, psnr[i], OAPV_CS_GET_BIT_DEPTH(ifrms->frm[i].imgb->cs));
                 for(j = 0; j < MAX_NUM_CC; j++) {
                     psnr_avg[i][j] += psnr[i][j];
@@ -583,6 +921,28 @@ static void print_stat_frms(oapve_stat_t *stat, oapv_frms_t *ifrms, oapv_frms_t
             logv3("- FRM %-2d GID %-5d %-11s %9d-bytes %8.4fdB %8.4fdB %8.4fdB\n",
                 i, finfo[i].group_id, str_frm_type, stat->frm_size[i], psnr[i][0], psnr[i][1], psnr[i][2]);
         }
+        if(metric) {
+            int num_cc = (cfmt == OAPV_CF_YCBCR400) ? 1 : (cfmt == OAPV_CF_YCBCR4444) ? 4 : 3;
+            logv3("         SSIM");
+            for(j = 0; j < num_cc; j++) {
+                logv3(" %.4f", stat->ssim[i][j]);
+            }
+            logv3("\n");
+        }
+        if(param[i].frm_time_budget > 0 && stat->tile[i] != NULL) {
+            for(j = 0, num_down = 0; j < stat->num_tiles[i] && j < stat->tile_max; j++) {
+                if(stat->tile[i][j].preset != param[i].preset) {
+                    num_down++;
+                }
+            }
+            logv3("         %d/%d tile(s) encoded with lower preset\n", num_down, stat->num_tiles[i]);
+        }
+        if(stat->size_over[i]) {
+            logv3("         over size limit\n");
+        }
+        if(stat->num_tiles_reused[i] > 0) {
+            logv3("         %d/%d tile(s) reused from previous AU\n", stat->num_tiles_reused[i], stat->num_tiles[i]);
+        }
     }
     fflush(stdout);
     fflush(stderr);
@@ -603,6 +963,116 @@ static int family_to_bitrate(char * family, oapve_param_t *param)
     return kbps;
 }
 
+/* additional output of multi-rate encoding */
+typedef struct extra_out {
+    char          fname[256];
+    oapv_bitb_t   bitb;
+    oapve_stat_t  stat;
+    oapv_frms_t   rfrms;
+    double        bytes_tot;
+} extra_out_t;
+
+#define MAX_STITCH_PARTS (16)
+
+/* tile payloads of a frame are stored with their byte size in front */
+static int write_tiles(char *fname, unsigned char *data, int size)
+{
+    unsigned char sz[4] = { (unsigned char)(size >> 24), (unsigned char)(size >> 16), (unsigned char)(size >> 8), (unsigned char)size };
+
+    if(write_data(fname, sz, 4)) {
+        return -1;
+    }
+    return write_data(fname, data, size);
+}
+
+static int read_tiles(FILE *fp, oapv_bitb_t *bitb)
+{
+    unsigned char sz[4];
+
+    if(fread(sz, 1, 4, fp) != 4) {
+        return -1; // end of file
+    }
+    bitb->ssize = (sz[0] << 24) | (sz[1] << 16) | (sz[2] << 8) | sz[3];
+    if(bitb->ssize <= 0 || bitb->ssize > bitb->bsize || fread(bitb->addr, 1, bitb->ssize, fp) != (size_t)bitb->ssize) {
+        logerr("ERR: invalid tile payloads\n");
+        return -1;
+    }
+    return 0;
+}
+
+static int parse_stitch(char *str, FILE **fps, oapv_bitb_t *parts, int *num_parts)
+{
+    char buf[1024], *tok;
+
+    *num_parts = 0;
+    strncpy(buf, str, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    for(tok = strtok(buf, ","); tok != NULL; tok = strtok(NULL, ",")) {
+        if(*num_parts >= MAX_STITCH_PARTS) {
+            logerr("ERR: too many files to stitch\n");
+            return -1;
+        }
+        fps[*num_parts] = fopen(tok, "rb");
+        if(fps[*num_parts] == NULL) {
+            logerr("ERR: cannot open tile payload file = (%s)\n", tok);
+            return -1;
+        }
+        memset(&parts[*num_parts], 0, sizeof(oapv_bitb_t));
+        parts[*num_parts].addr = malloc(MAX_BS_BUF);
+        parts[*num_parts].bsize = MAX_BS_BUF;
+        (*num_parts)++;
+        if(parts[*num_parts - 1].addr == NULL) {
+            logerr("ERR: cannot allocate bitstream buffer, size=%d", MAX_BS_BUF);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* parse 'file:rate' list of additional outputs */
+static int parse_extra_out(char *str, oapve_param_t *param, extra_out_t *outs, oapve_rate_t *rates, int *num_outs)
+{
+    char          buf[1024], *tok, *val;
+    oapve_param_t tmp;
+
+    *num_outs = 0;
+    strncpy(buf, str, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    for(tok = strtok(buf, ","); tok != NULL; tok = strtok(NULL, ",")) {
+        extra_out_t  *out = &outs[*num_outs];
+        oapve_rate_t *rate = &rates[*num_outs];
+        val = strrchr(tok, ':');
+        if(*num_outs >= OAPV_MAX_NUM_RATES || val == NULL || val == tok || strlen(val + 1) == 0) {
+            logerr("ERR: invalid extra output (%s)\n", tok);
+            return -1;
+        }
+        *val++ = '\0';
+        memset(out, 0, sizeof(extra_out_t));
+        memset(rate, 0, sizeof(oapve_rate_t));
+        strncpy(out->fname, tok, sizeof(out->fname) - 1);
+
+        if(val[0] == 'q' || val[0] == 'Q') {
+            rate->qp = atoi(val + 1);
+        }
+        else if(get_val_from_key(opts_family, val) >= 0) {
+            rate->bitrate = family_to_bitrate(val, param);
+        }
+        else {
+            memcpy(&tmp, param, sizeof(oapve_param_t));
+            if(OAPV_FAILED(oapve_param_parse(&tmp, "bitrate", val))) {
+                logerr("ERR: invalid rate of extra output (%s)\n", val);
+                return -1;
+            }
+            rate->bitrate = tmp.bitrate;
+        }
+        if(rate->bitrate < 0) {
+            return -1;
+        }
+        (*num_outs)++;
+    }
+    return 0;
+}
+
 #define UPDATE_A_PARAM_W_KEY_VAL(param, key, val) \
     if(strlen(val) > 0) { \
         if(OAPV_FAILED(oapve_param_parse(param, key, val))) { \
@@ -639,8 +1109,19 @@ static int update_param(args_var_t *vars, oapve_param_t *param)
         sprintf(vars->bitrate, "%d", kbps);
     }
     UPDATE_A_PARAM_W_KEY_VAL(param, "bitrate", vars->bitrate);
+    UPDATE_A_PARAM_W_KEY_VAL(param, "use-filler", vars->use_filler);
 
     UPDATE_A_PARAM_W_KEY_VAL(param, "preset", vars->preset);
+    UPDATE_A_PARAM_W_KEY_VAL(param, "frm-time-budget", vars->frm_time_budget);
+    UPDATE_A_PARAM_W_KEY_VAL(param, "rc-subsample", vars->rc_subsample);
+    UPDATE_A_PARAM_W_KEY_VAL(param, "deadzone-y", vars->deadzone_y);
+    UPDATE_A_PARAM_W_KEY_VAL(param, "deadzone-c", vars->deadzone_c);
+    UPDATE_A_PARAM_W_KEY_VAL(param, "rdo-itr-y", vars->rdo_itr_y);
+    UPDATE_A_PARAM_W_KEY_VAL(param, "rdo-itr-c", vars->rdo_itr_c);
+    UPDATE_A_PARAM_W_KEY_VAL(param, "rdo-adj-rng-y", vars->rdo_adj_rng_y);
+    UPDATE_A_PARAM_W_KEY_VAL(param, "rdo-adj-rng-c", vars->rdo_adj_rng_c);
+    UPDATE_A_PARAM_W_KEY_VAL(param, "rdo-max-cand", vars->rdo_max_cand);
+    UPDATE_A_PARAM_W_KEY_VAL(param, "rdo-full-itr", vars->rdo_full_itr);
 
     UPDATE_A_PARAM_W_KEY_VAL(param, "q-matrix-c0", vars->q_matrix_c0);
     UPDATE_A_PARAM_W_KEY_VAL(param, "q-matrix-c1", vars->q_matrix_c1);
@@ -669,22 +1150,34 @@ int main(int argc, const char **argv)
     oapve_cdesc_t  cdesc;
     oapve_param_t *param = NULL;
     oapv_bitb_t    bitb;
-    oapve_stat_t   stat;
-    oapv_imgb_t   *imgb_r = NULL; // image buffer for read
+    oapve_stat_t   stat = { 0 };
+    oapve_tile_stat_t *tile_stat = NULL; // status of tiles
     oapv_imgb_t   *imgb_w = NULL; // image buffer for write
-    oapv_imgb_t   *imgb_i = NULL; // image buffer for input
     oapv_imgb_t   *imgb_o = NULL; // image buffer for output
     oapv_frms_t    ifrms = { 0 }; // frames for input
     oapv_frms_t    rfrms = { 0 }; // frames for reconstruction
+    oapv_frms_t    lfrms = { 0 }; // frames read ahead for lookahead
+    int            use_la, la_ready = 0;
     int            ret;
     oapv_clk_t     clk_beg, clk_end, clk_tot;
     oapv_mtime_t   au_cnt, au_skip;
     int            frm_cnt[MAX_NUM_FRMS] = { 0 };
     double         bitrate_tot; // total bitrate (byte)
     double         psnr_avg[MAX_NUM_FRMS][MAX_NUM_CC] = { 0 };
+    double         ssim_avg[MAX_NUM_FRMS][MAX_NUM_CC] = { 0 };
     int            is_inp_y4m, is_rec_y4m = 0;
     y4m_params_t   y4m;
     int            is_out = 0, is_rec = 0;
+    stream_out_t   sout = { 0 };
+    extra_out_t    extra[OAPV_MAX_NUM_RATES];
+    oapve_rate_t   rates[OAPV_MAX_NUM_RATES];
+    int            num_extra = 0;
+    int            num_extra_au; // number of additional outputs of current access unit
+    int            num_over = 0; // number of frames over size limit
+    int            tile_beg = 0, tile_end = 0;
+    FILE          *fp_parts[MAX_STITCH_PARTS] = { NULL };
+    oapv_bitb_t    parts[MAX_STITCH_PARTS];
+    int            num_parts = 0;
     char          *errstr = NULL;
     int            cfmt;                      // color format
     const int      num_frames = MAX_NUM_FRMS; // number of frames in an access unit
@@ -792,7 +1285,13 @@ int main(int argc, const char **argv)
             (args_var->input_csp == 2 ? OAPV_CF_YCBCR422 : \
             (args_var->input_csp == 3 ? OAPV_CF_YCBCR444  : \
             (args_var->input_csp == 4 ? OAPV_CF_YCBCR4444 : \
-            (args_var->input_csp == 5 ? OAPV_CF_PLANAR2   : OAPV_CF_UNKNOWN)))));
+            (args_var->input_csp == 5 ? OAPV_CF_PLANAR2   : \
+            (args_var->input_csp == 6 ? OAPV_CF_UYVY      : \
+            (args_var->input_csp == 7 ? OAPV_CF_V210      : \
+            (args_var->input_csp == 8 ? OAPV_CF_RGB       : \
+            (args_var->input_csp == 9 ? OAPV_CF_GBR       : \
+            (args_var->input_csp == 10 ? OAPV_CF_RGBA     : \
+            (args_var->input_csp == 11 ? OAPV_CF_GBRA     : OAPV_CF_UNKNOWN)))))))))));
         // clang-format on
     }
     if(cfmt == OAPV_CF_UNKNOWN) {
@@ -807,8 +1306,19 @@ int main(int argc, const char **argv)
         ret = -1;
         goto ERR;
     }
+    if(strlen(args_var->extra_out) > 0 && parse_extra_out(args_var->extra_out, param, extra, rates, &num_extra)) {
+        logerr("ERR: the extra outputs are not set correctly\n");
+        ret = -1;
+        goto ERR;
+    }
+    if(strlen(args_var->tile_range) > 0 && (sscanf(args_var->tile_range, "%d,%d", &tile_beg, &tile_end) != 2 || tile_beg < 0 || tile_end <= tile_beg)) {
+        logerr("ERR: invalid tile range (%s)\n", args_var->tile_range);
+        ret = -1;
+        goto ERR;
+    }
 
-    cdesc.max_bs_buf_size = MAX_BS_BUF; /* maximum bitstream buffer size */
+    /* maximum bitstream buffer size */
+    cdesc.max_bs_buf_size = (args_var->bs_buf_max > 0) ? args_var->bs_buf_max : MAX_BS_BUF;
     cdesc.max_num_frms = MAX_NUM_FRMS;
     if(!strcmp(args_var->threads, "auto")){
         cdesc.threads = OAPV_CDESC_THREADS_AUTO;
@@ -816,12 +1326,25 @@ int main(int argc, const char **argv)
     else {
         cdesc.threads = atoi(args_var->threads);
     }
+    cdesc.simd = get_simd(args_var->simd);
+    if(cdesc.simd < 0) {
+        logerr("ERR: invalid SIMD kernels (%s)\n", args_var->simd);
+        ret = -1;
+        goto ERR;
+    }
+    if(args_var->hash_fast) {
+        args_var->hash = 1; // fast hash is a kind of frame hash
+    }
 
     if(check_conf(&cdesc, args_var)) {
         logerr("ERR: invalid configuration\n");
         ret = -1;
         goto ERR;
     }
+    if(strlen(args_var->stitch) > 0 && parse_stitch(args_var->stitch, fp_parts, parts, &num_parts)) {
+        ret = -1;
+        goto ERR;
+    }
 
     if(strlen(args_var->fname_out) > 0) {
         clear_data(args_var->fname_out);
@@ -851,6 +1374,20 @@ int main(int argc, const char **argv)
         ret = -1;
         goto ERR;
     }
+    for(int i = 0; i < num_extra; i++) {
+        extra[i].bitb.addr = malloc(MAX_BS_BUF);
+        extra[i].bitb.bsize = MAX_BS_BUF;
+        if(extra[i].bitb.addr == NULL) {
+            logerr("ERR: cannot allocate bitstream buffer, size=%d", MAX_BS_BUF);
+            ret = -1;
+            goto ERR;
+        }
+        clear_data(extra[i].fname);
+        rates[i].bitb = &extra[i].bitb;
+        rates[i].stat = &extra[i].stat;
+        // reconstruction is needed only for frame hash
+        rates[i].rfrms = args_var->hash ? &extra[i].rfrms : NULL;
+    }
 
     /* create encoder */
     id = oapve_create(&cdesc, &ret);
@@ -873,9 +1410,44 @@ int main(int argc, const char **argv)
         goto ERR;
     }
 
+    // tile status is used for counting tiles of lower preset
+    if(param->frm_time_budget > 0) {
+        int num_tiles = ((param->w + param->tile_w - 1) / param->tile_w) * ((param->h + param->tile_h - 1) / param->tile_h);
+        tile_stat = (oapve_tile_stat_t *)malloc(sizeof(oapve_tile_stat_t) * num_tiles * num_frames);
+        if(tile_stat == NULL) {
+            logerr("ERR: cannot allocate tile status\n");
+            ret = -1;
+            goto ERR;
+        }
+        for(int i = 0; i < num_frames; i++) {
+            stat.tile[i] = tile_stat + num_tiles * i;
+        }
+        stat.tile_max = num_tiles;
+    }
+
+    if(is_out && args_var->stream) {
+        oapve_stream_t stream;
+        int            size = sizeof(oapve_stream_t);
+
+        sout.fp = fopen(args_var->fname_out, "wb");
+        if(sout.fp == NULL) {
+            logerr("ERR: cannot open the output file=%s\n", args_var->fname_out);
+            ret = -1;
+            goto ERR;
+        }
+        stream.fn = stream_write;
+        stream.arg = &sout;
+        if(OAPV_FAILED(oapve_config(id, OAPV_CFG_SET_STREAM, &stream, &size))) {
+            logerr("ERR: failed to set config for streaming output\n");
+            ret = -1;
+            goto ERR;
+        }
+    }
+
     print_config(args_var, param);
 
     bitrate_tot = 0;
+    memset(&bitb, 0, sizeof(oapv_bitb_t));
     bitb.addr = bs_buf;
     bitb.bsize = MAX_BS_BUF;
 
@@ -891,13 +1463,21 @@ int main(int argc, const char **argv)
     memset(&ifrms, 0, sizeof(oapv_frm_t));
     memset(&rfrms, 0, sizeof(oapv_frm_t));
 
+    // input frames are given to encoder in the format of input file; packed
+    // formats have the fixed bit depth
+    int input_cs = (cfmt == OAPV_CF_UYVY) ? OAPV_CS_UYVY :
+        (cfmt == OAPV_CF_V210) ? OAPV_CS_V210 :
+        (cfmt == OAPV_CF_PLANAR2) ? OAPV_CS_P210 : OAPV_CS_SET(cfmt, args_var->input_depth, 0);
+    int input_depth = OAPV_CS_GET_BIT_DEPTH(input_cs);
+
+    // encoder takes the nearest bit depth allowed by profile
     int codec_depth = (param->profile_idc == OAPV_PROFILE_422_10 ||
         param->profile_idc == OAPV_PROFILE_400_10 ||
         param->profile_idc == OAPV_PROFILE_444_10 ||
         param->profile_idc == OAPV_PROFILE_4444_10) ? 10 : (
         param->profile_idc == OAPV_PROFILE_422_12 ||
         param->profile_idc == OAPV_PROFILE_444_12 ||
-        param->profile_idc == OAPV_PROFILE_4444_12) ? 12 : 0;
+        param->profile_idc == OAPV_PROFILE_4444_12) ? CLIP_VAL(input_depth, 10, 12) : 0;
 
     if (codec_depth == 0) {
         logerr("ERR: invalid profile\n");
@@ -905,67 +1485,94 @@ int main(int argc, const char **argv)
         goto ERR;
     }
 
+    // reconstruction is in planar YCbCr for packed and RGB input formats
+    int rec_cs = (cfmt == OAPV_CF_PLANAR2) ? OAPV_CS_P210 :
+        (cfmt == OAPV_CF_UYVY || cfmt == OAPV_CF_V210) ? OAPV_CS_SET(OAPV_CF_YCBCR422, codec_depth, 0) :
+        (cfmt == OAPV_CF_RGB || cfmt == OAPV_CF_GBR) ? OAPV_CS_SET(OAPV_CF_YCBCR444, codec_depth, 0) :
+        (cfmt == OAPV_CF_RGBA || cfmt == OAPV_CF_GBRA) ? OAPV_CS_SET(OAPV_CF_YCBCR4444, codec_depth, 0) :
+        OAPV_CS_SET(cfmt, codec_depth, 0);
+
+    // complexity of next access unit is analyzed while encoding current one
+    use_la = (param->rc_type == OAPV_RC_ABR) && tile_end == 0 && num_parts == 0 && !args_var->no_lookahead;
+
+    if(is_rec && input_cs != rec_cs && OAPV_CS_GET_FORMAT(rec_cs) == cfmt) {
+        // reconstructed video is written in the bit depth of input
+        imgb_w = imgb_create(param->w, param->h, OAPV_CS_SET(cfmt, input_depth, 0));
+    }
     for(int i = 0; i < num_frames; i++) {
-        if(args_var->input_depth == codec_depth) {
-            ifrms.frm[i].imgb = imgb_create(param->w, param->h, OAPV_CS_SET(cfmt, args_var->input_depth, 0));
-        }
-        else {
-            if (cfmt == OAPV_CF_PLANAR2) {
-                ifrms.frm[i].imgb = imgb_create(param->w, param->h, OAPV_CS_SET(cfmt, codec_depth, 0));
-            }
-            else {
-                imgb_r = imgb_create(param->w, param->h, OAPV_CS_SET(cfmt, args_var->input_depth, 0));
-                ifrms.frm[i].imgb = imgb_create(param->w, param->h, OAPV_CS_SET(cfmt, codec_depth, 0));
-            }
+        ifrms.frm[i].imgb = imgb_create(param->w, param->h, input_cs);
+        if(use_la) {
+            lfrms.frm[i].imgb = imgb_create(param->w, param->h, input_cs);
+            lfrms.num_frms++;
         }
 
         if(is_rec) {
-            if(args_var->input_depth == codec_depth) {
-                rfrms.frm[i].imgb = imgb_create(param->w, param->h, OAPV_CS_SET(cfmt, args_var->input_depth, 0));
-            }
-            else {
-                if (cfmt == OAPV_CF_PLANAR2) {
-                    rfrms.frm[i].imgb = imgb_create(param->w, param->h, OAPV_CS_SET(cfmt, codec_depth, 0));
-                }
-                else
-                {
-                    imgb_w = imgb_create(param->w, param->h, OAPV_CS_SET(cfmt, args_var->input_depth, 0));
-                    rfrms.frm[i].imgb = imgb_create(param->w, param->h, OAPV_CS_SET(cfmt, codec_depth, 0));
-                }
-            }
+            rfrms.frm[i].imgb = imgb_create(param->w, param->h, rec_cs);
             rfrms.num_frms++;
         }
+        for(int j = 0; j < num_extra; j++) {
+            if(rates[j].rfrms != NULL) {
+                extra[j].rfrms.frm[i].imgb = imgb_create(param->w, param->h, rec_cs);
+                extra[j].rfrms.num_frms++;
+            }
+        }
         ifrms.num_frms++;
     }
 
     /* encode pictures *******************************************************/
     while(args_var->max_au == 0 || (au_cnt < args_var->max_au)) {
-        for(int i = 0; i < num_frames; i++) {
-            if(args_var->input_depth == codec_depth || cfmt == OAPV_CF_PLANAR2) {
-                imgb_i = ifrms.frm[i].imgb;
-            }
-            else {
-                imgb_i = imgb_r;
-            }
-            ret = imgb_read(fp_inp, imgb_i, param->w, param->h, is_inp_y4m);
-            if(ret < 0) {
-                logv3("reached out the end of input file\n");
-                ret = OAPV_OK;
-                state = STATE_STOP;
-                break;
-            }
-            if(args_var->input_depth != codec_depth && cfmt != OAPV_CF_PLANAR2) {
-                imgb_cpy(ifrms.frm[i].imgb, imgb_i);
+        if(la_ready) {
+            // current access unit was read ahead already
+            oapv_frms_t t = ifrms;
+            ifrms = lfrms;
+            lfrms = t;
+            la_ready = 0;
+        }
+        else if(read_frms(fp_inp, &ifrms, param->w, param->h, is_inp_y4m)) {
+            logv3("reached out the end of input file\n");
+            ret = OAPV_OK;
+            state = STATE_STOP;
+        }
+
+        if(state == STATE_ENCODING && use_la && (args_var->max_au == 0 || au_cnt + 1 < args_var->max_au)) {
+            if(!read_frms(fp_inp, &lfrms, param->w, param->h, is_inp_y4m)) {
+                ret = oapve_lookahead(id, &lfrms);
+                if(OAPV_FAILED(ret)) {
+                    logerr("ERR: failed to set lookahead (return: %d)\n", ret);
+                    goto ERR;
+                }
+                la_ready = 1;
             }
-            ifrms.frm[i].group_id = 1; // FIX-ME : need to set properly in case of multi-frame
-            ifrms.frm[i].pbu_type = OAPV_PBU_TYPE_PRIMARY_FRAME;
         }
 
         if(state == STATE_ENCODING) {
             /* encoding */
             clk_beg = oapv_clk_get();
+            num_extra_au = (args_var->extra_out_au > 0 && au_cnt >= args_var->extra_out_au) ? 0 : num_extra;
 
-            ret = oapve_encode(id, &ifrms, mid, &bitb, &stat, &rfrms);
+            if(sout.fp != NULL) {
+                sout.au_pos = ftell(sout.fp);
+            }
+            if(tile_end > 0) {
+                ret = oapve_encode_tiles(id, &ifrms.frm[FRM_IDX], tile_beg, tile_end, &bitb, &stat);
+            }
+            else if(num_parts > 0) {
+                for(int i = 0; i < num_parts; i++) {
+                    if(read_tiles(fp_parts[i], &parts[i])) {
+                        logv3("reached out the end of tile payloads\n");
+                        state = STATE_STOP;
+                        break;
+                    }
+                }
+                if(state == STATE_STOP) {
+                    ret = OAPV_OK;
+                    break;
+                }
+                ret = oapve_stitch(id, &ifrms.frm[FRM_IDX], parts, num_parts, mid, &bitb, &stat);
+            }
+            else {
+                ret = oapve_encode_multi(id, &ifrms, mid, &bitb, &stat, &rfrms, num_extra_au, rates);
+            }
 
             clk_end = oapv_clk_from(clk_beg);
             clk_tot += clk_end;
@@ -976,12 +1583,23 @@ int main(int argc, const char **argv)
             }
 
             bitrate_tot += stat.frm_size[FRM_IDX];
+            if(stat.size_over[FRM_IDX]) {
+                num_over++;
+            }
+            for(int i = 0; i < num_extra_au; i++) {
+                extra[i].bytes_tot += extra[i].stat.frm_size[FRM_IDX];
+                if(write_data(extra[i].fname, extra[i].bitb.addr, extra[i].stat.write)) {
+                    logerr("ERR: cannot write bitstream\n");
+                    ret = -1;
+                    goto ERR;
+                }
+            }
 
             print_stat_au(&stat, au_cnt, param, args_var->max_au, bitrate_tot, clk_end, clk_tot);
 
             for(int fidx = 0; fidx < num_frames; fidx++) {
                 if(is_rec) {
-                    if(args_var->input_depth != codec_depth && cfmt != OAPV_CF_PLANAR2) {
+                    if(imgb_w != NULL) {
                         imgb_cpy(imgb_w, rfrms.frm[fidx].imgb);
                         imgb_o = imgb_w;
                     }
@@ -992,8 +1610,20 @@ int main(int argc, const char **argv)
 
                 /* store bitstream */
                 if(OAPV_SUCCEEDED(ret)) {
-                    if(is_out && stat.write > 0) {
-                        if(write_data(args_var->fname_out, bs_buf, stat.write)) {
+                    if(is_out && stat.write > 0 && sout.fp == NULL) {
+                        if(tile_end > 0) {
+                            ret = write_tiles(args_var->fname_out, bitb.addr, stat.write);
+                        }
+                        else if(num_parts > 0) {
+                            ret = write_data(args_var->fname_out, bitb.addr, stat.write);
+                        }
+                        else if(bitb.num_segs > 0) {
+                            ret = write_data_segs(args_var->fname_out, bitb.segs, bitb.num_segs);
+                        }
+                        else {
+                            ret = write_data(args_var->fname_out, bitb.addr, stat.write);
+                        }
+                        if(ret) {
                             logerr("ERR: cannot write bitstream\n");
                             ret = -1;
                             goto ERR;
@@ -1021,7 +1651,9 @@ int main(int argc, const char **argv)
                         goto ERR;
                     }
                 }
-                print_stat_frms(&stat, &ifrms, &rfrms, psnr_avg);
+                if(tile_end == 0) { // complete frame; a tile range has no frame statistics
+                    print_stat_frms(&stat, &ifrms, &rfrms, cdesc.param, args_var->metric, psnr_avg, ssim_avg);
+                }
                 frm_cnt[fidx] += 1;
             }
             au_cnt++;
@@ -1059,6 +1691,19 @@ int main(int argc, const char **argv)
             logv3("  PSNR T(dB)       : %-5.4f\n", psnr_avg[FRM_IDX][3]);
         }
     }
+    if(args_var->metric) {
+        for(int c = 0; c < MAX_NUM_CC; c++) {
+            ssim_avg[FRM_IDX][c] /= au_cnt;
+        }
+        logv3("  SSIM Y           : %-5.4f\n", ssim_avg[FRM_IDX][0]);
+        if (cfmt != OAPV_CF_YCBCR400) {
+            logv3("  SSIM U           : %-5.4f\n", ssim_avg[FRM_IDX][1]);
+            logv3("  SSIM V           : %-5.4f\n", ssim_avg[FRM_IDX][2]);
+            if (cfmt == OAPV_CF_YCBCR4444) {
+                logv3("  SSIM T           : %-5.4f\n", ssim_avg[FRM_IDX][3]);
+            }
+        }
+    }
     logv3("  Total bits(bits) : %.0f\n", bitrate_tot * 8);
     bitrate_tot *= (((float)param->fps_num / param->fps_den) * 8);
     bitrate_tot /= au_cnt;
@@ -1082,7 +1727,15 @@ int main(int argc, const char **argv)
     }
 
     logv2("Bitrate                           = %.4f kbps\n", bitrate_tot);
+    for(int i = 0; i < num_extra; i++) {
+        int    extra_cnt = (args_var->extra_out_au > 0) ? CLIP_VAL((int)au_cnt, 1, args_var->extra_out_au) : (int)au_cnt;
+        double kbps = extra[i].bytes_tot * 8 * ((float)param->fps_num / param->fps_den) / extra_cnt / 1000;
+        logv2("Bitrate of %-22s = %.4f kbps\n", extra[i].fname, kbps);
+    }
     logv2("Encoded frame count               = %d\n", (int)au_cnt);
+    if(num_over > 0) {
+        logv2("Frames over size limit            = %d\n", num_over);
+    }
     logv2("Total encoding time               = %.3f msec,",
           (float)oapv_clk_msec(clk_tot));
     logv2(" %.3f sec\n", (float)(oapv_clk_msec(clk_tot) / 1000.0));
@@ -1097,9 +1750,11 @@ int main(int argc, const char **argv)
         logv3("Wrong frames count: should be %d was %d\n", args_var->max_au, (int)au_cnt);
     }
 ERR:
+    if(wr_close()) {
+        logerr("ERR: cannot write output files\n");
+        ret = -1;
+    }
 
-    if(imgb_r != NULL)
-        imgb_r->release(imgb_r);
     if(imgb_w != NULL)
         imgb_w->release(imgb_w);
 
@@ -1113,6 +1768,27 @@ ERR:
             rfrms.frm[i].imgb->release(rfrms.frm[i].imgb);
         }
     }
+    for(int i = 0; i < num_frames; i++) {
+        if(lfrms.frm[i].imgb != NULL) {
+            lfrms.frm[i].imgb->release(lfrms.frm[i].imgb);
+        }
+    }
+    for(int j = 0; j < num_extra; j++) {
+        for(int i = 0; i < num_frames; i++) {
+            if(extra[j].rfrms.frm[i].imgb != NULL) {
+                extra[j].rfrms.frm[i].imgb->release(extra[j].rfrms.frm[i].imgb);
+            }
+        }
+        if(extra[j].bitb.addr)
+            free(extra[j].bitb.addr);
+    }
+
+    for(int i = 0; i < num_parts; i++) {
+        if(fp_parts[i])
+            fclose(fp_parts[i]);
+        if(parts[i].addr)
+            free(parts[i].addr);
+    }
 
     if(id)
         oapve_delete(id);
@@ -1120,8 +1796,12 @@ ERR:
         oapvm_delete(mid);
     if(fp_inp)
         fclose(fp_inp);
+    if(sout.fp)
+        fclose(sout.fp);
     if(bs_buf)
         free(bs_buf); /* release bitstream buffer */
+    if(tile_stat)
+        free(tile_stat);
     if(args)
         args->release(args);
     if(args_var)
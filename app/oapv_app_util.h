@@ -47,6 +47,10 @@
 #if LINUX
 #include <signal.h>
 #include <unistd.h>
+#include <pthread.h>
+#define WR_USE_THREAD 1
+#else
+#define WR_USE_THREAD 0
 #endif
 
 #define VERBOSE_NONE   0
@@ -235,6 +239,22 @@ static __inline oapv_clk_t oapv_clk_sec(oapv_clk_t clk)
 #define CLIP_VAL(n, min, max) (((n) > (max)) ? (max) : (((n) < (min)) ? (min) : (n)))
 #define ALIGN_VAL(val, align) ((((val) + (align) - 1) / (align)) * (align))
 
+/* SIMD kernels option of encoder and decoder into OAPV_CDESC_SIMD_* value;
+   -1 for unknown one */
+static int get_simd(const char *str)
+{
+    if(!strcmp(str, "auto")) {
+        return OAPV_CDESC_SIMD_AUTO;
+    }
+    else if(!strcmp(str, "none")) {
+        return OAPV_CDESC_SIMD_NONE;
+    }
+    else if(!strcmp(str, "sse")) {
+        return OAPV_CDESC_SIMD_SSE;
+    }
+    return -1;
+}
+
 /* Function for atomic increment:
    This function might need to modify according to O/S or CPU platform
 */
@@ -304,9 +324,22 @@ static int imgb_release(oapv_imgb_t *imgb)
     return refcnt;
 }
 
+/* bytes of a row having 'w' samples of the first plane */
+static int imgb_row_size(int cs, int w)
+{
+    switch(OAPV_CS_GET_FORMAT(cs)) {
+    case OAPV_CF_UYVY:
+        return w * 2;
+    case OAPV_CF_V210:
+        return ((w + 47) / 48) * 128; // 48 pixels in 128 bytes
+    default:
+        return w * OAPV_CS_GET_BYTE_DEPTH(cs);
+    }
+}
+
 oapv_imgb_t *imgb_create(int w, int h, int cs)
 {
-    int          i, bd;
+    int          i;
     oapv_imgb_t *imgb;
 
     imgb = (oapv_imgb_t *)malloc(sizeof(oapv_imgb_t));
@@ -314,8 +347,6 @@ oapv_imgb_t *imgb_create(int w, int h, int cs)
         goto ERR;
     memset(imgb, 0, sizeof(oapv_imgb_t));
 
-    bd = OAPV_CS_GET_BYTE_DEPTH(cs); /* byte unit */
-
     imgb->w[0] = w;
     imgb->h[0] = h;
     switch(OAPV_CS_GET_FORMAT(cs)) {
@@ -349,6 +380,24 @@ oapv_imgb_t *imgb_create(int w, int h, int cs)
         imgb->h[1] = h;
         imgb->np = 2;
         break;
+    case OAPV_CF_UYVY:
+    case OAPV_CF_V210:
+        imgb->np = 1;
+        break;
+    case OAPV_CF_RGB:
+    case OAPV_CF_GBR:
+    case OAPV_CF_RGBF:
+        imgb->w[1] = imgb->w[2] = w;
+        imgb->h[1] = imgb->h[2] = h;
+        imgb->np = 3;
+        break;
+    case OAPV_CF_RGBA:
+    case OAPV_CF_GBRA:
+    case OAPV_CF_RGBAF:
+        imgb->w[1] = imgb->w[2] = imgb->w[3] = w;
+        imgb->h[1] = imgb->h[2] = imgb->h[3] = h;
+        imgb->np = 4;
+        break;
     default:
         logv3("unsupported color format\n");
         goto ERR;
@@ -357,7 +406,7 @@ oapv_imgb_t *imgb_create(int w, int h, int cs)
     for(i = 0; i < imgb->np; i++) {
         // width and height need to be aligned to macroblock size
         imgb->aw[i] = ALIGN_VAL(imgb->w[i], OAPV_MB_W);
-        imgb->s[i] = imgb->aw[i] * bd;
+        imgb->s[i] = imgb_row_size(cs, imgb->aw[i]);
         imgb->ah[i] = ALIGN_VAL(imgb->h[i], OAPV_MB_H);
         imgb->e[i] = imgb->ah[i];
 
@@ -412,6 +461,18 @@ static int imgb_read(FILE *fp, oapv_imgb_t *img, int width, int height, int is_y
     int w_shift = (chroma_format == OAPV_CF_YCBCR420) || ((chroma_format == OAPV_CF_YCBCR422) || (chroma_format == OAPV_CF_PLANAR2)) ? 1 : 0;
     int h_shift = chroma_format == OAPV_CF_YCBCR420 ? 1 : 0;
 
+    if(chroma_format == OAPV_CF_UYVY || chroma_format == OAPV_CF_V210) {
+        // all samples are in a plane
+        f_w = imgb_row_size(img->cs, width);
+        p8 = (unsigned char *)img->a[0];
+        for(int j = 0; j < height; j++) {
+            if(fread(p8, 1, f_w, fp) != (unsigned)f_w) {
+                return -1;
+            }
+            p8 += img->s[0];
+        }
+        return 0;
+    }
     if(bit_depth == 8) {
         f_w = width;
         f_h = height;
@@ -463,7 +524,7 @@ static int imgb_read(FILE *fp, oapv_imgb_t *img, int width, int height, int is_y
         }
     }
 
-    if(chroma_format == OAPV_CF_YCBCR4444) {
+    if(chroma_format == OAPV_CF_YCBCR4444 || chroma_format == OAPV_CF_RGBA || chroma_format == OAPV_CF_GBRA) {
         f_w = f_w >> w_shift;
         f_h = f_h >> h_shift;
 
@@ -479,19 +540,244 @@ static int imgb_read(FILE *fp, oapv_imgb_t *img, int width, int height, int is_y
     return 0;
 }
 
+/* output files are kept open while running, and data are written by a
+   writer thread through a bounded queue of buffers, so that file I/O is
+   overlapped with encoding or decoding. without thread, data are written
+   directly. wr_close() should be called before exit */
+#define WR_MAX_FILES  8
+#define WR_QUEUE_SIZE 4 // max number of buffers waiting to be written
+
+typedef struct {
+    FILE          *fp;
+    unsigned char *buf;
+    int            size;
+    int            buf_max;
+} wr_item_t;
+
+typedef struct {
+    char            fname[WR_MAX_FILES][256];
+    FILE           *fp[WR_MAX_FILES];
+    int             num_files;
+    wr_item_t       q[WR_QUEUE_SIZE];
+    int             q_head; // index of the oldest item in queue
+    int             q_num;  // number of items in queue
+    int             err;
+#if WR_USE_THREAD
+    int             run;
+    int             no_thread; // writer thread is not available
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+#endif
+} wr_ctx_t;
+
+static wr_ctx_t wr_ctx;
+
+#if WR_USE_THREAD
+static void *wr_thread(void *arg)
+{
+    wr_ctx_t *wr = (wr_ctx_t *)arg;
+
+    pthread_mutex_lock(&wr->lock);
+    while(1) {
+        while(wr->q_num == 0 && wr->run) {
+            pthread_cond_wait(&wr->cond, &wr->lock);
+        }
+        if(wr->q_num == 0) {
+            break; // stopped and queue is empty
+        }
+        wr_item_t *item = &wr->q[wr->q_head];
+        pthread_mutex_unlock(&wr->lock);
+
+        int ok = (fwrite(item->buf, 1, item->size, item->fp) == (size_t)item->size);
+
+        pthread_mutex_lock(&wr->lock);
+        if(!ok) {
+            wr->err = -1;
+        }
+        wr->q_head = (wr->q_head + 1) % WR_QUEUE_SIZE;
+        wr->q_num--;
+        pthread_cond_broadcast(&wr->cond);
+    }
+    pthread_mutex_unlock(&wr->lock);
+    return NULL;
+}
+#endif
+
+/* wait until all data in queue are written */
+static void wr_sync(void)
+{
+#if WR_USE_THREAD
+    if(wr_ctx.run) {
+        pthread_mutex_lock(&wr_ctx.lock);
+        while(wr_ctx.q_num > 0) {
+            pthread_cond_wait(&wr_ctx.cond, &wr_ctx.lock);
+        }
+        pthread_mutex_unlock(&wr_ctx.lock);
+    }
+#endif
+}
+
+/* handle of output file; it is opened at the first use */
+static FILE *wr_file(char *fname, int truncate)
+{
+    int i;
+
+    for(i = 0; i < wr_ctx.num_files; i++) {
+        if(strcmp(wr_ctx.fname[i], fname) == 0) {
+            break;
+        }
+    }
+    if(i < wr_ctx.num_files && !truncate) {
+        return wr_ctx.fp[i];
+    }
+    if(i == WR_MAX_FILES || strlen(fname) >= sizeof(wr_ctx.fname[0])) {
+        logerr("cannot open more output file = %s\n", fname);
+        return NULL;
+    }
+    if(i < wr_ctx.num_files && wr_ctx.fp[i] != NULL) {
+        fclose(wr_ctx.fp[i]);
+    }
+    wr_ctx.fp[i] = fopen(fname, truncate ? "wb" : "ab");
+    if(wr_ctx.fp[i] == NULL) {
+        // an existing entry is kept with invalid handle, so that the other
+        // entries are still closed by wr_close()
+        logerr("cannot open file = %s\n", fname);
+        return NULL;
+    }
+    if(i == wr_ctx.num_files) {
+        strcpy(wr_ctx.fname[i], fname);
+        wr_ctx.num_files++;
+    }
+    return wr_ctx.fp[i];
+}
+
+/* get buffer of 'size' bytes to be written to the file */
+static unsigned char *wr_reserve(char *fname, int size)
+{
+    FILE *fp = wr_file(fname, 0);
+    int   idx = 0;
+
+    if(fp == NULL) {
+        return NULL;
+    }
+#if WR_USE_THREAD
+    if(!wr_ctx.run && !wr_ctx.no_thread) {
+        pthread_mutex_init(&wr_ctx.lock, NULL);
+        pthread_cond_init(&wr_ctx.cond, NULL);
+        wr_ctx.run = 1;
+        if(pthread_create(&wr_ctx.thread, NULL, wr_thread, &wr_ctx)) {
+            // fall back to direct writing
+            wr_ctx.run = 0;
+            wr_ctx.no_thread = 1;
+            pthread_mutex_destroy(&wr_ctx.lock);
+            pthread_cond_destroy(&wr_ctx.cond);
+        }
+    }
+    if(wr_ctx.run) {
+        pthread_mutex_lock(&wr_ctx.lock);
+        while(wr_ctx.q_num == WR_QUEUE_SIZE) {
+            pthread_cond_wait(&wr_ctx.cond, &wr_ctx.lock);
+        }
+        // the slot after the last item is not touched by writer thread
+        idx = (wr_ctx.q_head + wr_ctx.q_num) % WR_QUEUE_SIZE;
+        pthread_mutex_unlock(&wr_ctx.lock);
+    }
+#endif
+    wr_item_t *item = &wr_ctx.q[idx];
+    if(item->buf_max < size) {
+        unsigned char *buf = (unsigned char *)realloc(item->buf, size);
+        if(buf == NULL) {
+            logerr("cannot allocate output buffer, size=%d\n", size);
+            return NULL;
+        }
+        item->buf = buf;
+        item->buf_max = size;
+    }
+    item->fp = fp;
+    item->size = size;
+    return item->buf;
+}
+
+/* put the reserved buffer into writing queue */
+static int wr_commit(void)
+{
+    int direct = 1, err;
+#if WR_USE_THREAD
+    if(wr_ctx.run) {
+        // error is set by writing thread under the lock
+        pthread_mutex_lock(&wr_ctx.lock);
+        wr_ctx.q_num++;
+        pthread_cond_broadcast(&wr_ctx.cond);
+        err = wr_ctx.err;
+        pthread_mutex_unlock(&wr_ctx.lock);
+        direct = 0;
+    }
+#endif
+    if(direct) {
+        wr_item_t *item = &wr_ctx.q[0];
+        if(fwrite(item->buf, 1, item->size, item->fp) != (size_t)item->size) {
+            wr_ctx.err = -1;
+        }
+        err = wr_ctx.err;
+    }
+    if(err) {
+        logerr("cannot write output file\n");
+        return -1;
+    }
+    return 0;
+}
+
+/* finish writing and close all output files */
+static int wr_close(void)
+{
+    int ret;
+#if WR_USE_THREAD
+    if(wr_ctx.run) {
+        pthread_mutex_lock(&wr_ctx.lock);
+        wr_ctx.run = 0;
+        pthread_cond_broadcast(&wr_ctx.cond);
+        pthread_mutex_unlock(&wr_ctx.lock);
+        pthread_join(wr_ctx.thread, NULL);
+        pthread_mutex_destroy(&wr_ctx.lock);
+        pthread_cond_destroy(&wr_ctx.cond);
+    }
+#endif
+    for(int i = 0; i < wr_ctx.num_files; i++) {
+        if(wr_ctx.fp[i] != NULL && fclose(wr_ctx.fp[i])) {
+            wr_ctx.err = -1;
+        }
+    }
+    for(int i = 0; i < WR_QUEUE_SIZE; i++) {
+        free(wr_ctx.q[i].buf);
+    }
+    ret = wr_ctx.err;
+    memset(&wr_ctx, 0, sizeof(wr_ctx_t));
+    return ret;
+}
+
 static int imgb_write(char *fname, oapv_imgb_t *imgb)
 {
-    unsigned char *p8;
-    int            i, j, bd;
-    FILE          *fp;
+    unsigned char *p8, *dst;
+    int            i, j, bd, size = 0;
 
     int            chroma_format = OAPV_CS_GET_FORMAT(imgb->cs);
     int            bit_depth = OAPV_CS_GET_BIT_DEPTH(imgb->cs);
 
-    fp = fopen(fname, "ab");
-    if(fp == NULL) {
-        logerr("cannot open file = %s\n", fname);
-        return -1;
+    if(chroma_format == OAPV_CF_UYVY || chroma_format == OAPV_CF_V210) {
+        // all samples are in a plane
+        size = imgb_row_size(imgb->cs, imgb->w[0]);
+        dst = wr_reserve(fname, size * imgb->h[0]);
+        if(dst == NULL) {
+            return -1;
+        }
+        p8 = (unsigned char *)imgb->a[0];
+        for(j = 0; j < imgb->h[0]; j++) {
+            memcpy(dst, p8, size);
+            dst += size;
+            p8 += imgb->s[0];
+        }
+        return wr_commit();
     }
     if(bit_depth == 8 && (chroma_format == OAPV_CF_YCBCR400 || chroma_format == OAPV_CF_YCBCR420 || chroma_format == OAPV_CF_YCBCR422 ||
                           chroma_format == OAPV_CF_YCBCR444 || chroma_format == OAPV_CF_YCBCR4444)) {
@@ -503,23 +789,32 @@ static int imgb_write(char *fname, oapv_imgb_t *imgb)
     else if(bit_depth >= 10 && chroma_format == OAPV_CF_PLANAR2) {
         bd = 2;
     }
+    else if(chroma_format == OAPV_CF_RGB || chroma_format == OAPV_CF_GBR || chroma_format == OAPV_CF_RGBA || chroma_format == OAPV_CF_GBRA ||
+            chroma_format == OAPV_CF_RGBF || chroma_format == OAPV_CF_RGBAF) {
+        bd = OAPV_CS_GET_BYTE_DEPTH(imgb->cs);
+    }
     else {
         logerr("cannot support the color space\n");
-        fclose(fp);
         return -1;
     }
 
+    for(i = 0; i < imgb->np; i++) {
+        size += imgb->h[i] * imgb->w[i] * bd;
+    }
+    dst = wr_reserve(fname, size);
+    if(dst == NULL) {
+        return -1;
+    }
     for(i = 0; i < imgb->np; i++) {
         p8 = (unsigned char *)imgb->a[i] + (imgb->s[i] * imgb->y[i]) + (imgb->x[i] * bd);
 
         for(j = 0; j < imgb->h[i]; j++) {
-            fwrite(p8, imgb->w[i] * bd, 1, fp);
+            memcpy(dst, p8, imgb->w[i] * bd);
+            dst += imgb->w[i] * bd;
             p8 += imgb->s[i];
         }
     }
-
-    fclose(fp);
-    return 0;
+    return wr_commit();
 }
 
 static void imgb_cpy_plane(oapv_imgb_t *dst, oapv_imgb_t *src)
@@ -675,10 +970,98 @@ static void imgb_cpy(oapv_imgb_t *dst, oapv_imgb_t *src)
     }
 }
 
+/* sample (x, y) of component 'c' in planar or packed image */
+static int imgb_sample(oapv_imgb_t *imgb, int c, int x, int y)
+{
+    int            cf = OAPV_CS_GET_FORMAT(imgb->cs);
+    unsigned char *row;
+
+    if(cf == OAPV_CF_UYVY || cf == OAPV_CF_V210) {
+        // samples are in order of Cb, Y, Cr, Y
+        int n = (c == 0) ? (x << 1) + 1 : (x << 2) + ((c == 1) ? 0 : 2);
+        row = (unsigned char *)imgb->a[0] + y * imgb->s[0];
+        if(cf == OAPV_CF_UYVY) {
+            return row[n];
+        }
+        row += (n / 3) * 4; // three samples in a 32-bit word
+        unsigned int word = row[0] | (row[1] << 8) | (row[2] << 16) | ((unsigned int)row[3] << 24);
+        return (word >> (10 * (n % 3))) & 0x3FF;
+    }
+    row = (unsigned char *)imgb->a[c] + y * imgb->s[c];
+    return (OAPV_CS_GET_BYTE_DEPTH(imgb->cs) == 1) ? row[x] : ((unsigned short *)row)[x];
+}
+
+/* pack planar YCbCr422 'src' into UYVY or v210 'dst'; samples are rounded to
+   8 bits of UYVY or 10 bits of v210 */
+static int imgb_pack_422(oapv_imgb_t *dst, oapv_imgb_t *src)
+{
+    int cf = OAPV_CS_GET_FORMAT(dst->cs);
+    int bd = OAPV_CS_GET_BIT_DEPTH(src->cs), out_bd = OAPV_CS_GET_BIT_DEPTH(dst->cs);
+    int sft = bd - out_bd, add = (sft > 0) ? 1 << (sft - 1) : 0, max_val = (1 << out_bd) - 1;
+
+    if(OAPV_CS_GET_FORMAT(src->cs) != OAPV_CF_YCBCR422 || sft < 0) {
+        return -1;
+    }
+    for(int y = 0; y < src->h[0]; y++) {
+        unsigned char *row = (unsigned char *)dst->a[0] + y * dst->s[0];
+        memset(row, 0, imgb_row_size(dst->cs, dst->w[0]));
+        for(int n = 0; n < src->w[0] * 2; n++) {
+            // samples are in order of Cb, Y, Cr, Y
+            int c = (n & 1) ? 0 : ((n & 2) ? 2 : 1);
+            int v = imgb_sample(src, c, (n & 1) ? (n >> 1) : (n >> 2), y);
+            v = CLIP_VAL((v + add) >> sft, 0, max_val);
+            if(cf == OAPV_CF_UYVY) {
+                row[n] = (unsigned char)v;
+            }
+            else { // three samples in a little endian 32-bit word
+                unsigned char *p = row + (n / 3) * 4;
+                int            b = 10 * (n % 3);
+                p[b >> 3] |= (unsigned char)(v << (b & 7));
+                p[(b >> 3) + 1] |= (unsigned char)(v >> (8 - (b & 7)));
+            }
+        }
+    }
+    return 0;
+}
+
+/* PSNR of reconstruction in the other format or bit depth than original;
+   samples of original are converted to the bit depth of reconstruction in
+   the same way as encoder does */
+static void measure_psnr_cvt(oapv_imgb_t *org, oapv_imgb_t *rec, double psnr[4], int bit_depth)
+{
+    int bd_org = OAPV_CS_GET_BIT_DEPTH(org->cs);
+    int max_val = (1 << bit_depth) - 1;
+    int factor = 1 << (bit_depth - 8);
+    factor *= factor;
+
+    for(int i = 0; i < rec->np; i++) {
+        double sum = 0, mse;
+        for(int j = 0; j < rec->h[i]; j++) {
+            unsigned short *r = (unsigned short *)((unsigned char *)rec->a[i] + j * rec->s[i]);
+            for(int k = 0; k < rec->w[i]; k++) {
+                int o = imgb_sample(org, i, k, j);
+                if(bd_org < bit_depth) {
+                    o <<= bit_depth - bd_org;
+                }
+                else if(bd_org > bit_depth) {
+                    o = CLIP_VAL((o + (1 << (bd_org - bit_depth - 1))) >> (bd_org - bit_depth), 0, max_val);
+                }
+                sum += (double)(o - r[k]) * (o - r[k]);
+            }
+        }
+        mse = sum / (rec->w[i] * rec->h[i]);
+        psnr[i] = (mse == 0.0) ? 100. : fabs(10 * log10(((255 * 255 * factor) / mse)));
+    }
+}
+
 static void measure_psnr(oapv_imgb_t *org, oapv_imgb_t *rec, double psnr[4], int bit_depth)
 {
     double sum[4], mse[4];
 
+    if(org->cs != rec->cs) {
+        measure_psnr_cvt(org, rec, psnr, OAPV_CS_GET_BIT_DEPTH(rec->cs));
+        return;
+    }
     if(bit_depth == 8) {
         unsigned char *o, *r;
         int            i, j, k;
@@ -730,27 +1113,40 @@ static void measure_psnr(oapv_imgb_t *org, oapv_imgb_t *rec, double psnr[4], int
 
 static int write_data(char *fname, unsigned char *data, int size)
 {
-    FILE *fp;
+    unsigned char *dst = wr_reserve(fname, size);
+    if(dst == NULL) {
+        return -1;
+    }
+    memcpy(dst, data, size);
+    return wr_commit();
+}
+
+static int write_data_segs(char *fname, oapv_bseg_t *segs, int num_segs)
+{
+    unsigned char *dst;
+    int            size = 0;
 
-    fp = fopen(fname, "ab");
-    if(fp == NULL) {
-        logerr("cannot open the output file=%s\n", fname);
+    for(int i = 0; i < num_segs; i++) {
+        size += segs[i].size;
+    }
+    dst = wr_reserve(fname, size);
+    if(dst == NULL) {
         return -1;
     }
-    fwrite(data, 1, size, fp);
-    fclose(fp);
-    return 0;
+    for(int i = 0; i < num_segs; i++) {
+        memcpy(dst, segs[i].addr, segs[i].size);
+        dst += segs[i].size;
+    }
+    return wr_commit();
 }
 
 static int clear_data(char *fname)
 {
-    FILE *fp;
-    fp = fopen(fname, "wb");
-    if(fp == NULL) {
+    wr_sync();
+    if(wr_file(fname, 1) == NULL) {
         logerr("cannot remove file (%s)\n", fname);
         return -1;
     }
-    fclose(fp);
     return 0;
 }
 static unsigned char char_to_hex(char a)
@@ -240,7 +240,6 @@ static int write_y4m_header(char *fname, oapv_imgb_t *imgb)
     char c_buf[16] = {
         '\0',
     };
-    FILE *fp;
 
     if(color_format == OAPV_CF_YCBCR420) {
         if(bit_depth == 8)
@@ -280,33 +279,12 @@ static int write_y4m_header(char *fname, oapv_imgb_t *imgb)
     buff_len = snprintf(buf, len, "YUV4MPEG2 W%d H%d F%d:%d Ip C%s\n",
                         imgb->w[0], imgb->h[0], 30, 1, c_buf);
 
-    fp = fopen(fname, "ab");
-    if(fp == NULL) {
-        logerr("cannot open file = %s\n", fname);
-        return -1;
-    }
-    if(buff_len != fwrite(buf, 1, buff_len, fp)) {
-        fclose(fp);
-        return -1;
-    }
-    fclose(fp);
-    return 0;
+    return write_data(fname, (unsigned char *)buf, buff_len);
 }
 /* Frame level header or separator */
 static int write_y4m_frame_header(char *fname)
 {
-    FILE *fp;
-    fp = fopen(fname, "ab");
-    if(fp == NULL) {
-        logerr("cannot open file = %s\n", fname);
-        return -1;
-    }
-    if(6 != fwrite("FRAME\n", 1, 6, fp)) {
-        fclose(fp);
-        return -1;
-    }
-    fclose(fp);
-    return 0;
+    return write_data(fname, (unsigned char *)"FRAME\n", 6);
 }
 
 // check whether file name is y4m type or not
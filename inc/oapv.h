@@ -136,6 +136,23 @@ extern "C" {
 #define OAPV_CF_YCBCR422N               OAPV_CF_YCBCR422
 #define OAPV_CF_YCBCR422W               (18) /* YCBCR422 wide chroma */
 #define OAPV_CF_PLANAR2                 (20) /* Planar Y, Combined CB-CR, 422 */
+/* packed formats are for encoder input only, and the reconstruction of them
+   is output in planar YCbCr 422 format */
+#define OAPV_CF_UYVY                    (21) /* Packed Cb-Y-Cr-Y 422, 8-bit */
+#define OAPV_CF_V210                    (22) /* Packed 422, 10-bit, 6 pixels in 16 bytes */
+/* RGB formats of encoder input are converted to YCbCr 444 or 4444 by
+   'matrix_coefficients' of encoding parameter, and the reconstruction of them
+   is output in planar YCbCr format. decoder converts decoded YCbCr into RGB
+   formats by 'matrix_coefficients' and 'full_range_flag' of frame header.
+   subsampled chroma is taken as co-sited with even luma columns, and odd
+   columns are interpolated by 2 taps; rows of 4:2:0 are repeated */
+#define OAPV_CF_RGB                     (23) /* Planar R, G, B */
+#define OAPV_CF_GBR                     (24) /* Planar G, B, R */
+#define OAPV_CF_RGBA                    (25) /* Planar R, G, B, alpha */
+#define OAPV_CF_GBRA                    (26) /* Planar G, B, R, alpha */
+/* float formats are for decoder output only; samples are in [0.0, 1.0] */
+#define OAPV_CF_RGBF                    (27) /* Planar R, G, B in 32-bit float */
+#define OAPV_CF_RGBAF                   (28) /* Planar R, G, B, alpha in 32-bit float */
 
 /* macro for color space */
 #define OAPV_CS_GET_FORMAT(cs)          (((cs) >> 0) & 0xFF)
@@ -165,6 +182,12 @@ extern "C" {
 #define OAPV_CS_YCBCR444_12LE           OAPV_CS_SET(OAPV_CF_YCBCR444, 12, 0)
 #define OAPV_CS_YCBCR4444_12LE          OAPV_CS_SET(OAPV_CF_YCBCR4444, 12, 0)
 #define OAPV_CS_P210                    OAPV_CS_SET(OAPV_CF_PLANAR2, 10, 0)
+#define OAPV_CS_UYVY                    OAPV_CS_SET(OAPV_CF_UYVY, 8, 0)
+#define OAPV_CS_V210                    OAPV_CS_SET(OAPV_CF_V210, 10, 0)
+#define OAPV_CS_RGB_12LE                OAPV_CS_SET(OAPV_CF_RGB, 12, 0)
+#define OAPV_CS_GBR_12LE                OAPV_CS_SET(OAPV_CF_GBR, 12, 0)
+#define OAPV_CS_RGBF                    OAPV_CS_SET(OAPV_CF_RGBF, 32, 0)
+#define OAPV_CS_RGBAF                   OAPV_CS_SET(OAPV_CF_RGBAF, 32, 0)
 
 /* max number of color channel: ex) YCbCr4444 -> 4 channels */
 #define OAPV_MAX_CC                     (4)
@@ -180,6 +203,14 @@ extern "C" {
 #define OAPV_CFG_SET_QP_MAX             (209)
 #define OAPV_CFG_SET_USE_FRM_HASH       (301)
 #define OAPV_CFG_SET_AU_BS_FMT          (302)
+#define OAPV_CFG_SET_USE_BS_SCATTER     (303)
+#define OAPV_CFG_SET_STREAM             (304)
+#define OAPV_CFG_SET_AU_SIZE_MAX        (305)
+#define OAPV_CFG_SET_USE_TILE_REUSE     (306)
+#define OAPV_CFG_SET_USE_HUGE_PAGE      (307)
+#define OAPV_CFG_SET_USE_LAZY_REC       (308)
+#define OAPV_CFG_SET_USE_METRIC         (309)
+#define OAPV_CFG_SET_USE_FLAT_BLK       (310)
 #define OAPV_CFG_GET_QP_MIN             (600)
 #define OAPV_CFG_GET_QP_MAX             (601)
 #define OAPV_CFG_GET_QP                 (602)
@@ -190,6 +221,7 @@ extern "C" {
 #define OAPV_CFG_GET_WIDTH              (701)
 #define OAPV_CFG_GET_HEIGHT             (702)
 #define OAPV_CFG_GET_AU_BS_FMT          (802)
+#define OAPV_CFG_GET_USE_BS_SCATTER     (803)
 
 /*****************************************************************************
  * config values
@@ -198,6 +230,16 @@ extern "C" {
 #define OAPV_CFG_VAL_AU_BS_FMT_RBAU     (0)
 /* The output from the encoder is the only AU without bitstream format */
 #define OAPV_CFG_VAL_AU_BS_FMT_NONE     (1)
+/* quality metrics measured in encoder (OAPV_CFG_SET_USE_METRIC), which can
+   be combined by bitwise OR */
+#define OAPV_CFG_VAL_METRIC_PSNR        (1)
+#define OAPV_CFG_VAL_METRIC_SSIM        (2)
+
+/* frame hash of reconstruction (OAPV_CFG_SET_USE_FRM_HASH); MD5 is made over
+   each whole plane sequentially, while fast hash is made of per-tile 64-bit
+   hash values computed in tile threads */
+#define OAPV_CFG_VAL_FRM_HASH_MD5       (1)
+#define OAPV_CFG_VAL_FRM_HASH_FAST      (2)
 
 /*****************************************************************************
  * HLS configs
@@ -230,6 +272,13 @@ extern "C" {
 #define OAPV_METADATA_FILLER            (10)
 #define OAPV_METADATA_USER_DEFINED      (170)
 
+/* UUIDs of user defined metadata carrying frame hash, as initializers of
+   16-byte arrays; MD5 has 16 bytes and fast hash has 8 bytes per plane */
+#define OAPV_UUID_FRM_HASH_MD5          { 0xf8, 0x72, 0x1b, 0x3e, 0xcd, 0xee, 0x47, 0x21, \
+                                          0x98, 0x0d, 0x9b, 0x9e, 0x39, 0x20, 0x28, 0x49 }
+#define OAPV_UUID_FRM_HASH_FAST         { 0x5a, 0x1e, 0x3c, 0x97, 0x0b, 0x64, 0x4d, 0x8e, \
+                                          0xa2, 0x71, 0xc6, 0x19, 0xf4, 0x3d, 0x80, 0x2b }
+
 /*****************************************************************************
  * profiles
  *****************************************************************************/
@@ -375,6 +424,19 @@ struct oapv_frms {
     oapv_frm_t frm[OAPV_MAX_NUM_FRAMES]; // container of frames
 };
 
+/*****************************************************************************
+ * Bitstream segment
+ *****************************************************************************/
+#define OAPV_MAX_BS_SEGS    (OAPV_MAX_NUM_FRAMES * (OAPV_MAX_TILES + 1) + 1)
+
+typedef struct oapv_bseg oapv_bseg_t;
+struct oapv_bseg {
+    /* address of segment */
+    void        *addr;
+    /* byte size of segment */
+    int          size;
+};
+
 /*****************************************************************************
  * Bitstream buffer
  *****************************************************************************/
@@ -396,6 +458,37 @@ struct oapv_bitb {
     void        *pdata[4];
     /* time-stamps */
     oapv_mtime_t ts[4];
+    /* bitstream segments, when OAPV_CFG_SET_USE_BS_SCATTER is enabled.
+       the bitstream is the concatenation of the segments in order.
+       segments point to 'addr' or to internal tile buffers of encoder,
+       which are valid until the next call of oapve_encode() */
+    int          num_segs;
+    oapv_bseg_t *segs;
+};
+
+/*****************************************************************************
+ * in-order bitstream streaming of encoder (OAPV_CFG_SET_STREAM)
+ *
+ * bytes of access unit are handed to the callback in order while encoding,
+ * each tile as soon as it and all the earlier tiles are encoded.
+ * size fields (pbu_size and raw bitstream size) are streamed as zero and
+ * given later by OAPVE_STREAM_PATCH.
+ * the callback is called from encoding threads, but never concurrently,
+ * and other threads keep encoding tiles while it runs.
+ *****************************************************************************/
+#define OAPVE_STREAM_DATA   (0) /* bytes following the streamed ones */
+#define OAPVE_STREAM_PATCH  (1) /* bytes overwriting the streamed ones */
+
+/* 'offset' is byte position of 'data' from the start of access unit.
+   returning a negative value stops encoding with the value */
+typedef int (*oapve_fn_stream_t)(void *arg, int type, int offset, void *data, int size);
+
+typedef struct oapve_stream oapve_stream_t;
+struct oapve_stream {
+    /* callback function; NULL disables streaming */
+    oapve_fn_stream_t fn;
+    /* arbitrary data passed to the callback */
+    void             *arg;
 };
 
 /*****************************************************************************
@@ -535,6 +628,7 @@ static const oapv_dict_str_int_t oapv_param_opts_color_matrix[] = {
 #define OAPV_LEVEL_TO_LEVEL_IDC(level)   (int)(((level) * 30.0) + 0.5)
 #define OAPVE_PARAM_LEVEL_IDC_AUTO       (0)
 #define OAPVE_PARAM_QP_AUTO              (255)
+#define OAPVE_PARAM_TUNE_AUTO            (-1) // determined by preset
 
 typedef struct oapve_param oapve_param_t;
 struct oapve_param {
@@ -566,7 +660,10 @@ struct oapve_param {
     signed char   qp_offset_c3;
     /* bitrate (unit: kbps) */
     int           bitrate;
-    /* use filler data for tight constant bitrate */
+    /* use filler data for tight constant bitrate
+       - with OAPV_RC_ABR only; every frame is followed by a filler PBU
+         so that both take exactly (bitrate / fps) bytes. tiles of a frame
+         over the size are re-encoded with higher QP */
     int           use_filler;
     /* use quantization matrix */
     int           use_q_matrix;
@@ -579,6 +676,29 @@ struct oapve_param {
 
     /* preset for setting trade-off between complexity and coding gain */
     int           preset;
+    /* time budget for encoding a frame (unit: micro-second)
+       - 0: no limit
+       - when encoding is behind the budget, remaining tiles are encoded
+         with OAPV_PRESET_FAST instead of the given preset */
+    int           frm_time_budget;
+    /* analyze one of every N rows of 8x8 blocks for rate control
+       - 0 or 1: all block rows are analyzed
+       - N > 1: complexity of the skipped rows is extrapolated, which
+         reduces rate control analysis time by about N times while
+         the frame bit allocation becomes slightly less accurate */
+    int           rc_subsample;
+    /* tuning values of block coding, which are set by preset in case of
+       OAPVE_PARAM_TUNE_AUTO. index 0 is for luma and 1 for chroma */
+    /* dead-zone offset of quantization (0 ~ 511, 256 means rounding) */
+    int           deadzone[2];
+    /* iterations of coefficient refinement in 'slow' preset */
+    int           rdo_itr[2];
+    /* adjustment range of a coefficient in 'slow' preset (1 ~ 15) */
+    int           rdo_adj_rng[2];
+    /* max number of candidates in an iteration of 'placebo' preset */
+    int           rdo_max_cand;
+    /* iterations of full RDO in 'placebo' preset */
+    int           rdo_full_itr;
     /* color description values */
     int           color_description_present_flag;
     unsigned char color_primaries;
@@ -592,6 +712,14 @@ struct oapve_param {
  *****************************************************************************/
 #define OAPV_CDESC_THREADS_AUTO          0
 
+/*****************************************************************************
+ * SIMD kernels used by encoder & decoder; kernels are limited to the ones
+ * supported by CPU in any case
+ *****************************************************************************/
+#define OAPV_CDESC_SIMD_AUTO             0 // all supported kernels
+#define OAPV_CDESC_SIMD_NONE             1 // C kernels only
+#define OAPV_CDESC_SIMD_SSE              2 // C and SSE kernels (x86)
+
 /*****************************************************************************
  * description for encoder creation
  *****************************************************************************/
@@ -603,6 +731,8 @@ struct oapve_cdesc {
     int           max_num_frms;
     // max number of threads (or OAPV_CDESC_THREADS_AUTO for auto-assignment)
     int           threads;
+    // SIMD kernels (OAPV_CDESC_SIMD_*)
+    int           simd;
     // encoding parameters
     oapve_param_t param[OAPV_MAX_NUM_FRAMES];
 };
@@ -610,6 +740,19 @@ struct oapve_cdesc {
 /*****************************************************************************
  * encoding status
  *****************************************************************************/
+/* status of a tile in encoder */
+typedef struct oapve_tile_stat oapve_tile_stat_t;
+struct oapve_tile_stat {
+    // preset actually used for the tile
+    // (can be lower than the preset parameter because of frame time budget)
+    int            preset;
+    // quality of the tile against the input, measured by tile workers when
+    // OAPV_CFG_SET_USE_METRIC is set; PSNR is in dB (100 means no error) and
+    // SSIM is the average of 8x8 windows
+    float          psnr[OAPV_MAX_CC];
+    float          ssim[OAPV_MAX_CC];
+};
+
 typedef struct oapve_stat oapve_stat_t;
 struct oapve_stat {
     // byte size of encoded bitstream
@@ -618,6 +761,54 @@ struct oapve_stat {
     oapv_au_info_t aui;
     // bitstream byte size of each frame
     int            frm_size[OAPV_MAX_NUM_FRAMES];
+    // 1 if the frame is over its size limit of constant bitrate (use_filler)
+    // or OAPV_CFG_SET_AU_SIZE_MAX after the rounds of re-encoding tiles;
+    // no filler follows such a frame
+    int            size_over[OAPV_MAX_NUM_FRAMES];
+    // number of tiles of each frame
+    int            num_tiles[OAPV_MAX_NUM_FRAMES];
+    // number of tiles copied from previous access unit, as their source
+    // and QP were not changed (OAPV_CFG_SET_USE_TILE_REUSE)
+    int            num_tiles_reused[OAPV_MAX_NUM_FRAMES];
+    // quality of each frame against the input, measured by tile workers
+    // when OAPV_CFG_SET_USE_METRIC is set; PSNR is in dB (100 means no error)
+    // and SSIM is the average of 8x8 windows
+    double         psnr[OAPV_MAX_NUM_FRAMES][OAPV_MAX_CC];
+    double         ssim[OAPV_MAX_NUM_FRAMES][OAPV_MAX_CC];
+    // status of each tile of frame i is written into 'tile[i]' indexed by
+    // tile index, when the caller sets it to an array of 'tile_max' entries
+    // before encoding; tiles beyond 'tile_max' are not reported.
+    // encoder keeps these two members while clearing the others
+    oapve_tile_stat_t *tile[OAPV_MAX_NUM_FRAMES];
+    int            tile_max;
+};
+
+/*****************************************************************************
+ * additional rate of multi-rate encoding (oapve_encode_multi)
+ *
+ * an additional rate shares the input conversion, forward transform and
+ * complexity analysis with the primary output, and is quantized and coded
+ * into its own access unit in the same tile task.
+ * everything but QP is the same as the primary output, including the
+ * level and band signaled in frame header. the blocks are quantized without
+ * RDO, and the size limit, tile reuse, scattered output and streaming of
+ * encoder apply to the primary output only. constant bitrate with filler
+ * (use_filler) is not supported with additional rates.
+ *****************************************************************************/
+#define OAPV_MAX_NUM_RATES  (3) // max number of additional rates
+
+typedef struct oapve_rate oapve_rate_t;
+struct oapve_rate {
+    // average bitrate in kbps; 0 means constant QP of 'qp'
+    int            bitrate;
+    // QP of all frames, used when 'bitrate' is 0
+    int            qp;
+    // output bitstream buffer
+    oapv_bitb_t   *bitb;
+    // encoding status of the output
+    oapve_stat_t  *stat;
+    // reconstructed frames (optional; required for frame hash)
+    oapv_frms_t   *rfrms;
 };
 
 /*****************************************************************************
@@ -627,6 +818,8 @@ typedef struct oapvd_cdesc oapvd_cdesc_t;
 struct oapvd_cdesc {
     // max number of threads (or OAPV_CDESC_THREADS_AUTO for auto-assignment)
     int threads;
+    // SIMD kernels (OAPV_CDESC_SIMD_*)
+    int simd;
 };
 
 /*****************************************************************************
@@ -642,6 +835,28 @@ struct oapvd_stat {
     int            frm_size[OAPV_MAX_NUM_FRAMES];
 };
 
+/*****************************************************************************
+ * parameters of coefficient-domain transcoding (oapv_transcode)
+ *
+ * the coefficients of each block are parsed, dequantized and requantized
+ * with the new tile QPs and quantization matrix without inverse and forward
+ * transform. tiles having the same QPs and matrix are copied as they are.
+ * PBUs other than frames are copied, except that frame hash metadata is
+ * dropped as it does not match the requantized frames.
+ *****************************************************************************/
+typedef struct oapv_transcode_param oapv_transcode_param_t;
+struct oapv_transcode_param {
+    // value added to QP of every tile and component
+    int           dqp;
+    // replace quantization matrix with 'q_matrix'; otherwise it is kept
+    int           use_q_matrix;
+    // q_matrix is meaningful if use_q_matrix is true (raster-scan order)
+    unsigned char q_matrix[OAPV_MAX_CC][OAPV_BLK_D];
+    // dead-zone offset of requantization (0 ~ 511) for luma and chroma;
+    // OAPVE_PARAM_TUNE_AUTO takes the default of block coding in encoder
+    int           deadzone[2];
+};
+
 /*****************************************************************************
  * metadata payload
  *****************************************************************************/
@@ -679,6 +894,30 @@ OAPV_EXPORT int oapve_config(oapve_t eid, int cfg, void *buf, int *size);
 OAPV_EXPORT int oapve_param_default(oapve_param_t *param);
 OAPV_EXPORT int oapve_param_parse(oapve_param_t* param, const char* name,  const char* value);
 OAPV_EXPORT int oapve_encode(oapve_t eid, oapv_frms_t *ifrms, oapvm_t mid, oapv_bitb_t *bitb, oapve_stat_t *stat, oapv_frms_t *rfrms);
+/* same as oapve_encode(), and also encodes the frames into 'num_rates'
+   additional access units having the QPs or bitrates of 'rates'.
+   the index of a rate has to be kept in successive calls for rate control */
+OAPV_EXPORT int oapve_encode_multi(oapve_t eid, oapv_frms_t *ifrms, oapvm_t mid, oapv_bitb_t *bitb, oapve_stat_t *stat, oapv_frms_t *rfrms,
+                                   int num_rates, oapve_rate_t *rates);
+/* hand over the frames of next access unit before calling oapve_encode() for
+   current one, so that rate control analyzes them while encoding current one.
+   the frames have to be kept unchanged until they are encoded.
+   each frame is analyzed while the frame of the same index in current access
+   unit is encoded, by the tile threads having no more tile to encode; the
+   result replaces the analysis of that frame only, and bits are not
+   allocated over access units. */
+OAPV_EXPORT int oapve_lookahead(oapve_t eid, oapv_frms_t *ifrms);
+/* encode the tiles of index in [tile_beg, tile_end) of a frame into
+   successive tile() payloads, so that bands of a frame can be encoded on
+   different encoders. the input image is of whole frame, and only the region
+   of the tiles is read. in ABR mode, the bitrate parameter is the budget of
+   the band. */
+OAPV_EXPORT int oapve_encode_tiles(oapve_t eid, oapv_frm_t *ifrm, int tile_beg, int tile_end, oapv_bitb_t *bitb, oapve_stat_t *stat);
+/* combine the payloads of oapve_encode_tiles() covering all tiles of a frame
+   into an access unit. the image buffer of 'frm' is referred only for its
+   color space and size. encoding parameters have to be the same as the ones
+   of band encoders. */
+OAPV_EXPORT int oapve_stitch(oapve_t eid, oapv_frm_t *frm, oapv_bitb_t *parts, int num_parts, oapvm_t mid, oapv_bitb_t *bitb, oapve_stat_t *stat);
 
 /*****************************************************************************
  * interface for decoder
@@ -688,12 +927,27 @@ typedef void       *oapvd_t; /* instance identifier for OAPV decoder */
 OAPV_EXPORT oapvd_t oapvd_create(oapvd_cdesc_t *cdesc, int *err);
 OAPV_EXPORT void oapvd_delete(oapvd_t did);
 OAPV_EXPORT int oapvd_config(oapvd_t did, int cfg, void *buf, int *size);
+/* frames of NULL image buffer in 'ofrms' are allocated from the frame pool of
+   decoder by the frame header. the caller owns a reference of each of them,
+   and has to call 'imgb->release()' to return it to the pool, also before
+   passing the frame again as NULL; frames still referenced are kept after
+   oapvd_delete() until they are released. if 'ofrms->num_frms' is zero, it
+   is set to the number of decoded frames */
 OAPV_EXPORT int oapvd_decode(oapvd_t did, oapv_bitb_t *bitb, oapv_frms_t *ofrms, oapvm_t mid, oapvd_stat_t *stat);
+/* requantize the access unit in 'bitb' into 'obitb' on the tile threads of
+   decoder; 'stat' reports the input access unit and 'obitb->ssize' is set to
+   the byte size of output */
+OAPV_EXPORT int oapv_transcode(oapvd_t did, oapv_bitb_t *bitb, oapv_transcode_param_t *tcp, oapv_bitb_t *obitb, oapvd_stat_t *stat);
 
 /*****************************************************************************
  * interface for utility
  *****************************************************************************/
 OAPV_EXPORT int oapvd_info(void *au, int au_size, oapv_au_info_t *aui);
+/* rewrite the access unit in 'bitb' into 'obitb' having the tiles covering
+   the rectangle of ('x', 'y', 'w', 'h') only, without decoding. the rectangle
+   is extended to tile boundaries and applied to every frame. frame hash
+   metadata is dropped */
+OAPV_EXPORT int oapv_crop(oapv_bitb_t *bitb, int x, int y, int w, int h, oapv_bitb_t *obitb);
 OAPV_EXPORT int oapve_family_bitrate(int family, int w, int h, int fps_num, int fps_den, int * kbps);
 
 /*****************************************************************************
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2022 Samsung Electronics Co., Ltd.
+ * All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * - Neither the name of the copyright owner, nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "oapv_cvt_avx.h"
+
+#if X86_SSE
+
+/* see oapv_rgb_to_blk(); eight samples of a row are converted at once */
+void oapv_rgb_to_blk_avx(void *src[3], int s_src[3], int byte_depth, int x, int blk_w, int blk_h, int coef[4], int sft, int bit_depth, s16 *dst)
+{
+    if(blk_w != 8) { // partial blocks at right edge of image
+        oapv_rgb_to_blk(src, s_src, byte_depth, x, blk_w, blk_h, coef, sft, bit_depth, dst);
+        return;
+    }
+    u8     *r = (u8 *)src[0] + x * byte_depth;
+    u8     *g = (u8 *)src[1] + x * byte_depth;
+    u8     *b = (u8 *)src[2] + x * byte_depth;
+    __m256i cr = _mm256_set1_epi32(coef[0]);
+    __m256i cg = _mm256_set1_epi32(coef[1]);
+    __m256i cb = _mm256_set1_epi32(coef[2]);
+    __m256i ofs = _mm256_set1_epi32(coef[3]);
+    __m256i max = _mm256_set1_epi32((1 << bit_depth) - 1);
+    __m256i mid = _mm256_set1_epi32(1 << (bit_depth - 1));
+    __m256i zero = _mm256_setzero_si256();
+    __m128i cnt = _mm_cvtsi32_si128(sft);
+    __m256i vr, vg, vb, v;
+
+    for(int h = 0; h < blk_h; h++) {
+        if(byte_depth == 1) {
+            vr = _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i *)r));
+            vg = _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i *)g));
+            vb = _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i *)b));
+        }
+        else {
+            vr = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *)r));
+            vg = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *)g));
+            vb = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *)b));
+        }
+        v = _mm256_add_epi32(_mm256_mullo_epi32(vr, cr), _mm256_mullo_epi32(vg, cg));
+        v = _mm256_add_epi32(v, _mm256_mullo_epi32(vb, cb));
+        v = _mm256_sra_epi32(_mm256_add_epi32(v, ofs), cnt);
+        v = _mm256_sub_epi32(_mm256_min_epi32(_mm256_max_epi32(v, zero), max), mid);
+        _mm_storeu_si128((__m128i *)dst, _mm_packs_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+        r += s_src[0];
+        g += s_src[1];
+        b += s_src[2];
+        dst += OAPV_BLK_W;
+    }
+}
+
+/* see oapv_blk_to_rgb(); eight samples of a row are converted at once */
+void oapv_blk_to_rgb_avx(s16 *src[3], int s_src, int blk_w, int blk_h, int bit_depth, int coef[4], int sft, int out_bit_depth, void *dst, int s_dst)
+{
+    int w8 = blk_w & ~7;
+    if(w8 < blk_w) { // remaining columns
+        s16 *rem[3] = { src[0] + w8, src[1] + w8, src[2] + w8 };
+        oapv_blk_to_rgb(rem, s_src, blk_w - w8, blk_h, bit_depth, coef, sft, out_bit_depth, (u8 *)dst + w8 * ((out_bit_depth + 7) >> 3), s_dst);
+    }
+    const int mid_val = (1 << (bit_depth - 1));
+    s16      *y = src[0], *cb = src[1], *cr = src[2];
+    u8       *d = (u8 *)dst;
+    __m128i   lo = _mm_set1_epi16(-mid_val);
+    __m128i   hi = _mm_set1_epi16(mid_val - 1);
+    __m256i   c0 = _mm256_set1_epi32(coef[0]);
+    __m256i   c1 = _mm256_set1_epi32(coef[1]);
+    __m256i   c2 = _mm256_set1_epi32(coef[2]);
+    __m256i   ofs = _mm256_set1_epi32(coef[3]);
+    __m256i   max = _mm256_set1_epi32((1 << out_bit_depth) - 1);
+    __m256i   zero = _mm256_setzero_si256();
+    __m128i   cnt = _mm_cvtsi32_si128(sft);
+    __m256i   vy, vcb, vcr, v;
+    __m128i   o;
+
+    for(int h = 0; h < blk_h; h++) {
+        for(int w = 0; w < w8; w += 8) {
+            vy = _mm256_cvtepi16_epi32(_mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((__m128i *)(y + w)), lo), hi));
+            vcb = _mm256_cvtepi16_epi32(_mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((__m128i *)(cb + w)), lo), hi));
+            vcr = _mm256_cvtepi16_epi32(_mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((__m128i *)(cr + w)), lo), hi));
+            v = _mm256_add_epi32(_mm256_mullo_epi32(vy, c0), _mm256_mullo_epi32(vcb, c1));
+            v = _mm256_add_epi32(v, _mm256_mullo_epi32(vcr, c2));
+            v = _mm256_sra_epi32(_mm256_add_epi32(v, ofs), cnt);
+            v = _mm256_min_epi32(_mm256_max_epi32(v, zero), max);
+            o = _mm_packus_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+            if(out_bit_depth == 8) {
+                _mm_storel_epi64((__m128i *)(d + w), _mm_packus_epi16(o, o));
+            }
+            else {
+                _mm_storeu_si128((__m128i *)(d + w * 2), o);
+            }
+        }
+        y += s_src;
+        cb += s_src;
+        cr += s_src;
+        d += s_dst;
+    }
+}
+
+/* see oapv_blk_to_rgbf() */
+void oapv_blk_to_rgbf_avx(s16 *src[3], int s_src, int blk_w, int blk_h, int bit_depth, float coef[4], void *dst, int s_dst)
+{
+    int w8 = blk_w & ~7;
+    if(w8 < blk_w) { // remaining columns
+        s16 *rem[3] = { src[0] + w8, src[1] + w8, src[2] + w8 };
+        oapv_blk_to_rgbf(rem, s_src, blk_w - w8, blk_h, bit_depth, coef, (float *)dst + w8, s_dst);
+    }
+    const int mid_val = (1 << (bit_depth - 1));
+    s16      *y = src[0], *cb = src[1], *cr = src[2];
+    float    *d = (float *)dst;
+    __m128i   lo = _mm_set1_epi16(-mid_val);
+    __m128i   hi = _mm_set1_epi16(mid_val - 1);
+    __m256    c0 = _mm256_set1_ps(coef[0]);
+    __m256    c1 = _mm256_set1_ps(coef[1]);
+    __m256    c2 = _mm256_set1_ps(coef[2]);
+    __m256    ofs = _mm256_set1_ps(coef[3]);
+    __m256    one = _mm256_set1_ps(1.0f);
+    __m256    zero = _mm256_setzero_ps();
+    __m256    vy, vcb, vcr, v;
+
+    for(int h = 0; h < blk_h; h++) {
+        for(int w = 0; w < w8; w += 8) {
+            vy = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((__m128i *)(y + w)), lo), hi)));
+            vcb = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((__m128i *)(cb + w)), lo), hi)));
+            vcr = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((__m128i *)(cr + w)), lo), hi)));
+            v = _mm256_mul_ps(vy, c0);
+            v = _mm256_add_ps(v, _mm256_mul_ps(vcb, c1));
+            v = _mm256_add_ps(v, _mm256_mul_ps(vcr, c2));
+            v = _mm256_add_ps(v, ofs);
+            _mm256_storeu_ps(d + w, _mm256_min_ps(_mm256_max_ps(v, zero), one));
+        }
+        y += s_src;
+        cb += s_src;
+        cr += s_src;
+        d = (float *)((u8 *)d + s_dst);
+    }
+}
+#endif /* X86_SSE */
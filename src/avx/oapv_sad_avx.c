@@ -217,4 +217,108 @@ const oapv_fn_diff_t oapv_tbl_fn_diff_16b_avx[2] =
     diff_16b_avx_8x8,
     NULL
 };
+
+/* DC removed hadamard cost ****************************************************/
+static __m256i had_load_row_avx(u16 *s, int step, int ofs, __m128i shift, int two)
+{
+    __m256i x, lo, hi;
+
+    if(step == 1) {
+        x = two ? _mm256_loadu_si256((const __m256i *)(s + ofs))
+                : _mm256_inserti128_si256(_mm256_setzero_si256(), _mm_loadu_si128((const __m128i *)(s + ofs)), 0);
+    }
+    else { // take one of interleaved samples
+        lo = _mm256_loadu_si256((const __m256i *)s);
+        hi = two ? _mm256_loadu_si256((const __m256i *)(s + 16)) : _mm256_setzero_si256();
+        if(ofs) {
+            lo = _mm256_srli_epi32(lo, 16);
+            hi = _mm256_srli_epi32(hi, 16);
+        }
+        else {
+            lo = _mm256_and_si256(lo, _mm256_set1_epi32(0xFFFF));
+            hi = _mm256_and_si256(hi, _mm256_set1_epi32(0xFFFF));
+        }
+        x = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0xD8);
+    }
+    return _mm256_srl_epi16(x, shift);
+}
+
+/* horizontal 8-point hadamard of each 128-bit lane; output signs differ
+   from the C version, which is harmless as only absolute values are used */
+static __m256i had8_hor_avx(__m256i x)
+{
+    __m256i p;
+
+    p = _mm256_permute2x128_si256(x, x, 0x01);
+    x = _mm256_blend_epi32(_mm256_add_epi32(x, p), _mm256_sub_epi32(x, p), 0xF0);
+    p = _mm256_shuffle_epi32(x, 0x4E);
+    x = _mm256_blend_epi32(_mm256_add_epi32(x, p), _mm256_sub_epi32(x, p), 0xCC);
+    p = _mm256_shuffle_epi32(x, 0xB1);
+    x = _mm256_blend_epi32(_mm256_add_epi32(x, p), _mm256_sub_epi32(x, p), 0xAA);
+    return _mm256_abs_epi32(x);
+}
+
+static int hsum_epi32_avx(__m256i x)
+{
+    __m128i y = _mm_add_epi32(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+    y = _mm_hadd_epi32(y, y);
+    y = _mm_hadd_epi32(y, y);
+    return _mm_cvtsi128_si32(y);
+}
+
+/* two 8x8 blocks side by side; lower 128 bits of rows are the left block */
+static int had8x8x2_avx(__m256i *r)
+{
+    __m256i t[8], u[8], acc0, acc1;
+    int     k;
+
+    /* vertical transform in 16 bit; no overflow up to 12 bit samples */
+    for(k = 0; k < 4; k++) {
+        t[k] = _mm256_add_epi16(r[k], r[k + 4]);
+        t[k + 4] = _mm256_sub_epi16(r[k], r[k + 4]);
+    }
+    for(k = 0; k < 8; k += 4) {
+        u[k] = _mm256_add_epi16(t[k], t[k + 2]);
+        u[k + 1] = _mm256_add_epi16(t[k + 1], t[k + 3]);
+        u[k + 2] = _mm256_sub_epi16(t[k], t[k + 2]);
+        u[k + 3] = _mm256_sub_epi16(t[k + 1], t[k + 3]);
+    }
+    for(k = 0; k < 8; k += 2) {
+        t[k] = _mm256_add_epi16(u[k], u[k + 1]);
+        t[k + 1] = _mm256_sub_epi16(u[k], u[k + 1]);
+    }
+
+    /* horizontal transform in 32 bit */
+    acc0 = _mm256_setzero_si256();
+    acc1 = _mm256_setzero_si256();
+    for(k = 0; k < 8; k++) {
+        __m256i h0 = had8_hor_avx(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(t[k])));
+        __m256i h1 = had8_hor_avx(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(t[k], 1)));
+        if(k == 0) { // remove DC
+            h0 = _mm256_blend_epi32(h0, _mm256_setzero_si256(), 0x01);
+            h1 = _mm256_blend_epi32(h1, _mm256_setzero_si256(), 0x01);
+        }
+        acc0 = _mm256_add_epi32(acc0, h0);
+        acc1 = _mm256_add_epi32(acc1, h1);
+    }
+    return ((hsum_epi32_avx(acc0) + 2) >> 2) + ((hsum_epi32_avx(acc1) + 2) >> 2);
+}
+
+int oapv_had8x8_row_avx(u16 *src, int s_src, int step, int ofs, int shift, int num_blk)
+{
+    __m256i r[8];
+    __m128i sft = _mm_cvtsi32_si128(shift);
+    int     sum = 0;
+
+    for(int b = 0; b < num_blk; b += 2) {
+        int  two = (num_blk - b) >= 2; // a zero block costs zero
+        u16 *s = src + b * 8 * step;
+        for(int i = 0; i < 8; i++) {
+            r[i] = had_load_row_avx(s, step, ofs, sft, two);
+            s += s_src;
+        }
+        sum += had8x8x2_avx(r);
+    }
+    return sum;
+}
 #endif
\ No newline at end of file
@@ -39,6 +39,8 @@
 extern const oapv_fn_sad_t oapv_tbl_fn_sad_16b_avx[2];
 extern const oapv_fn_ssd_t oapv_tbl_fn_ssd_16b_avx[2];
 extern const oapv_fn_diff_t oapv_tbl_fn_diff_16b_avx[2];
+
+int oapv_had8x8_row_avx(u16 *src, int s_src, int step, int ofs, int shift, int num_blk);
 #endif /* X86_SSE */
 
 #endif /* _OAPV_SAD_AVX_H_ */
@@ -30,203 +30,7 @@
  */
 
 #include "oapv_def.h"
-
-static void imgb_pad(oapv_imgb_t *imgb, int aw, int ah, int comp_sft[N_C][2])
-{
-    int imgb_w = imgb->w[0];
-    int imgb_h = imgb->h[0];
-
-    if(aw == imgb_w && ah == imgb_h) { // no needs to pad
-        return;
-    }
-
-    if(aw != imgb_w) {
-        for(int c = 0; c < imgb->np; c++) {
-            int  sw = imgb_w >> comp_sft[c][0];
-            int  ew = aw >> comp_sft[c][0];
-            int  th = ah >> comp_sft[c][1];
-            pel *dst = (pel *)imgb->a[c];
-            pel  src;
-
-            for(int h = 0; h < th; h++) {
-                src = dst[sw - 1];
-                for(int w = sw; w < ew; w++) {
-                    dst[w] = src;
-                }
-                dst += (imgb->s[c] >> 1);
-            }
-        }
-    }
-
-    if(ah != imgb_h) {
-        for(int c = 0; c < imgb->np; c++) {
-            int  sh = imgb_h >> comp_sft[c][1];
-            int  eh = ah >> comp_sft[c][1];
-            int  tw = aw >> comp_sft[c][0];
-            pel *dst = ((pel *)imgb->a[c]) + sh * (imgb->s[c] >> 1);
-            pel *src = dst - (imgb->s[c] >> 1);
-
-            for(int h = sh; h < eh; h++) {
-                oapv_mcpy(dst, src, sizeof(pel) * tw);
-                dst += (imgb->s[c] >> 1);
-            }
-        }
-    }
-}
-
-static void imgb_pad_p210(oapv_imgb_t *imgb, int aw, int ah, int comp_sft[N_C][2])
-{
-    int imgb_w = imgb->w[0];
-    int imgb_h = imgb->h[0];
-
-    if(aw == imgb_w && ah == imgb_h) { // no needs to pad
-        return;
-    }
-
-    if(aw != imgb_w) {
-        for(int c = 0; c < imgb->np; c++) {
-            int  shift_w = 0;
-            int  shift_h = 0;
-
-            int  sw = imgb_w >> shift_w;
-            int  ew = aw >> shift_w;
-            int  th = ah >> shift_h;
-            pel *dst = (pel *)imgb->a[c];
-            pel  src;
-
-            for(int h = 0; h < th; h++) {
-                src = dst[sw - 1];
-                for(int w = sw; w < ew; w++) {
-                    dst[w] = src;
-                }
-                dst += (imgb->s[c] >> 1);
-            }
-        }
-    }
-
-    if(ah != imgb_h) {
-        for(int c = 0; c < imgb->np; c++) {
-            int  shift_w = 0;
-            int  shift_h = 0;
-
-            int  sh = imgb_h >> shift_h;
-            int  eh = ah >> shift_h;
-            int  tw = aw >> shift_w;
-            pel *dst = ((pel *)imgb->a[c]) + sh * (imgb->s[c] >> 1);
-            pel *src = dst - (imgb->s[c] >> 1);
-
-            for(int h = sh; h < eh; h++) {
-                oapv_mcpy(dst, src, sizeof(pel) * tw);
-                dst += (imgb->s[c] >> 1);
-            }
-        }
-    }
-}
-
-static void imgb_to_blk(oapv_imgb_t *imgb, int c, int x_l, int y_l, int w_l, int h_l, s16 *blk, int bd)
-{
-    u8 *src, *dst;
-    int i, sft_hor, sft_ver;
-    int byte_depth = (bd + 7) >> 3;
-
-    if(c == 0) {
-        sft_hor = sft_ver = 0;
-    }
-    else {
-        u8 cfi = color_format_to_chroma_format_idc(OAPV_CS_GET_FORMAT(imgb->cs));
-        sft_hor = get_chroma_sft_w(cfi);
-        sft_ver = get_chroma_sft_h(cfi);
-    }
-
-    src = ((u8 *)imgb->a[c]) + ((y_l >> sft_ver) * imgb->s[c]) + ((x_l * byte_depth) >> sft_hor);
-    dst = (u8 *)blk;
-
-    for(i = 0; i < (h_l); i++) {
-        oapv_mcpy(dst, src, (w_l) * byte_depth);
-
-        src += imgb->s[c];
-        dst += (w_l) * byte_depth;
-    }
-}
-
-static void imgb_to_blk_16(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd)
-{
-    const int mid_val = (1 << (bd - 1));
-    s16      *s = (s16 *)src;
-    s16      *d = (s16 *)dst;
-
-    for(int h = 0; h < blk_h; h++) {
-        for(int w = 0; w < blk_w; w++) {
-            d[w] = s[w] - mid_val;
-        }
-        s = (s16 *)(((u8 *)s) + s_src);
-        d = (s16 *)(((u8 *)d) + s_dst);
-    }
-}
-
-static void imgb_to_blk_p21x_y(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd)
-{
-    const int mid_val = (1 << (bd - 1));
-    u16      *s = (s16 *)src;
-    s16      *d = (s16 *)dst;
-    int       shift_pic_bits = 16 - bd;
-
-    for(int h = 0; h < blk_h; h++) {
-        for(int w = 0; w < blk_w; w++) {
-            d[w] = (s16)(s[w] >> shift_pic_bits) - mid_val;
-        }
-        s = (u16 *)(((u8 *)s) + s_src);
-        d = (s16 *)(((u8 *)d) + s_dst);
-    }
-}
-
-static void imgb_to_blk_p21x_uv(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd)
-{
-    const int mid_val = (1 << (bd - 1));
-    u16      *s = (u16 *)src + offset_src;
-    s16      *d = (s16 *)dst;
-    int       shift_pic_bits = 16 - bd;
-
-    for(int h = 0; h < blk_h; h++) {
-        for(int w = 0; w < blk_w; w++) {
-            d[w] = (s16)(s[w * 2] >> shift_pic_bits) - mid_val;
-        }
-        s = (u16 *)(((u8 *)s) + s_src);
-        d = (s16 *)(((u8 *)d) + s_dst);
-    }
-}
-
-static void imgb_to_blk_p21x(oapv_imgb_t *imgb, int c, int x_l, int y_l, int w_l, int h_l, s16 *block, int bd)
-{
-    u16 *src, *dst;
-    int  sft_hor, sft_ver, s_src;
-    int  size_scale = 1;
-    int  tc = c;
-    int  shift_pic_bits = 16 - bd;
-
-    if(c == 0) {
-        sft_hor = sft_ver = 0;
-    }
-    else {
-        u8 cfi = color_format_to_chroma_format_idc(OAPV_CS_GET_FORMAT(imgb->cs));
-        sft_hor = get_chroma_sft_w(cfi);
-        sft_ver = get_chroma_sft_h(cfi);
-        size_scale = 2;
-        tc = 1;
-    }
-
-    s_src = imgb->s[tc] >> (bd > 1 ? 1 : 0);
-    src = ((u16 *)imgb->a[tc]) + ((y_l >> sft_ver) * s_src) + ((x_l * size_scale) >> sft_hor);
-    dst = (u16 *)block;
-
-    for(int i = 0; i < (h_l); i++) {
-        for(int j = 0; j < (w_l); j++) {
-            dst[j] = (src[j * size_scale + (c >> 1)] >> shift_pic_bits);
-        }
-        src += s_src;
-        dst += w_l;
-    }
-}
+#include "oapv_tc.h"
 
 static void blk_to_imgb_16(void *src, int blk_w, int blk_h, int s_src, int offset_dst, int s_dst, void *dst, int bd)
 {
@@ -305,7 +109,7 @@ static void fi_to_finfo(oapv_fi_t *fi, int pbu_type, int group_id, oapv_frm_info
     finfo->capture_time_distance = fi->capture_time_distance;
 }
 
-static void fh_to_finfo(oapv_fh_t *fh, int pbu_type, int group_id, oapv_frm_info_t *finfo)
+void oapv_fh_to_finfo(oapv_fh_t *fh, int pbu_type, int group_id, oapv_frm_info_t *finfo)
 {
     fi_to_finfo(&fh->fi, pbu_type, group_id, finfo);
     finfo->use_q_matrix = fh->use_q_matrix;
@@ -322,6 +126,62 @@ static void fh_to_finfo(oapv_fh_t *fh, int pbu_type, int group_id, oapv_frm_info
     finfo->full_range_flag = fh->full_range_flag;
 }
 
+/* RGB to YCbCr matrix of 'matrix_coefficients' scaled to the range of YCbCr;
+   (Y, Cb, Cr) = m * (R, G, B) + ofs, where R, G and B are full range samples
+   of the same bit depth */
+static int rgb_to_ycbcr_matrix(int matrix_coefficients, int full_range, int bd, double m[3][3], double ofs[3])
+{
+    double kr, kb, scale;
+    int    identity = (matrix_coefficients == 0);
+
+    if(matrix_coefficients == 1) { // BT.709
+        kr = 0.2126;
+        kb = 0.0722;
+    }
+    else if(matrix_coefficients == 5 || matrix_coefficients == 6) { // BT.601
+        kr = 0.299;
+        kb = 0.114;
+    }
+    else if(matrix_coefficients == 9) { // BT.2020 non-constant luminance
+        kr = 0.2627;
+        kb = 0.0593;
+    }
+    else if(identity) { // GBR
+        kr = kb = 0;
+    }
+    else {
+        return OAPV_ERR_INVALID_ARGUMENT;
+    }
+
+    if(identity) {
+        // Y = G, Cb = B, Cr = R
+        double mi[3][3] = { { 0, 1, 0 }, { 0, 0, 1 }, { 1, 0, 0 } };
+        oapv_mcpy(m, mi, sizeof(mi));
+    }
+    else {
+        double kg = 1.0 - kr - kb;
+        double mc[3][3] = { { kr, kg, kb },
+                            { -kr / (2 * (1 - kb)), -kg / (2 * (1 - kb)), 0.5 },
+                            { 0.5, -kg / (2 * (1 - kr)), -kb / (2 * (1 - kr)) } };
+        oapv_mcpy(m, mc, sizeof(mc));
+    }
+    for(int c = 0; c < 3; c++) {
+        int luma = (c == Y_C || identity);
+        if(full_range) {
+            scale = 1.0;
+            ofs[c] = luma ? 0 : (1 << (bd - 1));
+        }
+        else {
+            scale = luma ? 219.0 / 256 : 224.0 / 256;
+            ofs[c] = luma ? (16 << (bd - 8)) : (1 << (bd - 1));
+        }
+        for(int i = 0; i < 3; i++) {
+            m[c][i] *= scale;
+        }
+    }
+    return OAPV_OK;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // start of encoder code
 #if ENABLE_ENCODER
@@ -399,17 +259,29 @@ static int enc_set_tile_info(oapve_tile_t *ti, int w_pel, int h_pel, int tile_w,
     return OAPV_OK;
 }
 
+/* forward transform of the block in 'core->coef'; the transform already
+   done for additional rates is taken, if any */
+static void enc_block_tx(oapve_ctx_t *ctx, oapve_core_t *core, int log2_w, int log2_h)
+{
+    if(core->coef_tx_valid) {
+        oapv_mcpy(core->coef, core->coef_tx, sizeof(s16) * OAPV_BLK_D);
+    }
+    else {
+        oapv_trans(ctx, core->coef, log2_w, log2_h, ctx->bit_depth);
+    }
+}
+
 static double enc_block(oapve_ctx_t *ctx, oapve_core_t *core, int log2_w, int log2_h, int c)
 {
     int bit_depth = ctx->bit_depth;
 
-    oapv_trans(ctx, core->coef, log2_w, log2_h, bit_depth);
-    ctx->fn_quant[0](core->coef, core->qp[c], core->q_mat_enc[c], log2_w, log2_h, bit_depth, c ? 128 : 212);
+    enc_block_tx(ctx, core, log2_w, log2_h);
+    ctx->fn_quant[0](core->coef, core->qp[c], core->q_mat_enc[c], log2_w, log2_h, bit_depth, core->deadzone[c ? 1 : 0]);
 
     core->dc_diff = core->coef[0] - core->prev_dc[c];
     core->prev_dc[c] = core->coef[0];
 
-    if(ctx->imgb_r) {
+    if(ctx->rec_in_loop) {
         oapv_mcpy(core->coef_rec, core->coef, sizeof(s16) * OAPV_BLK_D);
         ctx->fn_dquant[0](core->coef_rec, core->q_mat_dec[c], log2_w, log2_h, core->dq_shift[c]);
         ctx->fn_itx[0](core->coef_rec, ITX_SHIFT1, ITX_SHIFT2(bit_depth), 1 << log2_w);
@@ -424,13 +296,13 @@ static double enc_block_rdo_medium(oapve_ctx_t *ctx, oapve_core_t *core, int log
     int qp = core->qp[c];
     double lambda = 0.57 * pow(2.0, (qp - 12.0) / 3.0);
 
-    oapv_trans(ctx, core->coef, log2_w, log2_h, bit_depth);
+    enc_block_tx(ctx, core, log2_w, log2_h);
     oapve_rdoq(core,core->coef, core->coef, log2_w, log2_h, c, bit_depth, lambda);
 
     core->dc_diff = core->coef[0] - core->prev_dc[c];
     core->prev_dc[c] = core->coef[0];
 
-    if(ctx->imgb_r) {
+    if(ctx->rec_in_loop) {
         oapv_mcpy(core->coef_rec, core->coef, sizeof(s16) * OAPV_BLK_D);
         ctx->fn_dquant[0](core->coef_rec, core->q_mat_dec[c], log2_w, log2_h, core->dq_shift[c]);
         ctx->fn_itx[0](core->coef_rec, ITX_SHIFT1, ITX_SHIFT2(bit_depth), 1 << log2_w);
@@ -464,7 +336,7 @@ static double enc_block_rdo_slow(oapve_ctx_t *ctx, oapve_core_t *core, int log2_
     double     lambda = 0.57 * pow(2.0, (qp - 12.0) / 3.0);
 
     oapv_mcpy(org, core->coef, sizeof(s16) * OAPV_BLK_D);
-    oapv_trans(ctx, core->coef, log2_w, log2_h, bit_depth);
+    enc_block_tx(ctx, core, log2_w, log2_h);
     oapv_mcpy(coeff, core->coef, sizeof(s16) * OAPV_BLK_D);
     oapve_rdoq(core, coeff, coeff, log2_w, log2_h, c, bit_depth, lambda);
 
@@ -476,7 +348,7 @@ static double enc_block_rdo_slow(oapve_ctx_t *ctx, oapve_core_t *core, int log2_
 
         int cost = (int)ctx->fn_ssd[0](blk_w, blk_h, org, recon, blk_w, blk_w);
         oapv_mcpy(best_coeff, coeff, sizeof(s16) * OAPV_BLK_D);
-        if(ctx->imgb_r) {
+        if(ctx->rec_in_loop) {
             oapv_mcpy(best_recon, recon, sizeof(s16) * OAPV_BLK_D);
         }
         if(cost == 0) {
@@ -485,11 +357,11 @@ static double enc_block_rdo_slow(oapve_ctx_t *ctx, oapve_core_t *core, int log2_
         best_cost = cost;
     }
 
-    for(int itr = 0; itr < (c == 0 ? 2 : 1) && !zero_dist; itr++) {
+    for(int itr = 0; itr < ctx->rdo_itr[c ? 1 : 0] && !zero_dist; itr++) {
         for(int j = 0; j < OAPV_BLK_D && !zero_dist; j++) {
             int best_idx = 0;
             s16 org_coef = coeff[scanp[j]];
-            int adj_rng = (c == 0 ? 13 : 5);
+            int adj_rng = ctx->rdo_adj_rng[c ? 1 : 0];
             if(org_coef == 0) {
                 if(c == 0 && scanp[j] < 3) {
                     adj_rng = 3;
@@ -544,7 +416,7 @@ static double enc_block_rdo_slow(oapve_ctx_t *ctx, oapve_core_t *core, int log2_
         }
     }
 
-    if(ctx->imgb_r) {
+    if(ctx->rec_in_loop) {
         oapv_mcpy(best_recon, best_coeff, sizeof(s16) * OAPV_BLK_D);
         ctx->fn_dquant[0](best_recon, core->q_mat_dec[c], log2_w, log2_h, core->dq_shift[c]);
         ctx->fn_itx[0](best_recon, ITX_SHIFT1, ITX_SHIFT2(bit_depth), 1 << log2_w);
@@ -556,8 +428,6 @@ static double enc_block_rdo_slow(oapve_ctx_t *ctx, oapve_core_t *core, int log2_
     return best_cost;
 }
 
-#define OAPV_FULL_RDO_MAX_CAND 6
-
 typedef struct oapve_coef_info oapve_coef_info_t;
 struct oapve_coef_info
 {
@@ -567,13 +437,13 @@ struct oapve_coef_info
     double cost;
 };
 
-void add_coef_list(oapve_coef_info_t* coef_list, oapve_coef_info_t coef_cur, int* list_cnt)
+void add_coef_list(oapve_coef_info_t* coef_list, oapve_coef_info_t coef_cur, int* list_cnt, int max_cand)
 {
-    if((*list_cnt) == OAPV_FULL_RDO_MAX_CAND && coef_cur.cost > coef_list[OAPV_FULL_RDO_MAX_CAND - 1].cost) {
+    if((*list_cnt) == max_cand && coef_cur.cost > coef_list[max_cand - 1].cost) {
         return;
     }
 
-    int curr_pos = (*list_cnt) == OAPV_FULL_RDO_MAX_CAND ? OAPV_FULL_RDO_MAX_CAND - 1 : (*list_cnt);
+    int curr_pos = (*list_cnt) == max_cand ? max_cand - 1 : (*list_cnt);
 
     coef_list[curr_pos] = coef_cur;
 
@@ -589,7 +459,7 @@ void add_coef_list(oapve_coef_info_t* coef_list, oapve_coef_info_t coef_cur, int
         }
     }
 
-    if(*list_cnt < OAPV_FULL_RDO_MAX_CAND) {
+    if(*list_cnt < max_cand) {
         (*list_cnt)++;
     }
 }
@@ -612,8 +482,8 @@ static double enc_block_rdo_placebo(oapve_ctx_t* ctx, oapve_core_t* core, int lo
     const u8* scanp = oapv_tbl_scan;
 
     oapv_mcpy(org, core->coef, sizeof(s16) * OAPV_BLK_D);
-    oapv_trans(ctx, core->coef, log2_w, log2_h, bit_depth);
-    ctx->fn_quant[0](core->coef, qp, core->q_mat_enc[c], log2_w, log2_h, bit_depth, c ? 128 : 128);
+    enc_block_tx(ctx, core, log2_w, log2_h);
+    ctx->fn_quant[0](core->coef, qp, core->q_mat_enc[c], log2_w, log2_h, bit_depth, core->deadzone[c ? 1 : 0]);
 
     oapv_mcpy(recon, core->coef, sizeof(s16) * OAPV_BLK_D);
     ctx->fn_dquant[0](recon, core->q_mat_dec[c], log2_w, log2_h, core->dq_shift[c]);
@@ -624,7 +494,7 @@ static double enc_block_rdo_placebo(oapve_ctx_t* ctx, oapve_core_t* core, int lo
     int rate_org = oapve_vlc_get_coef_rate(core, core->coef, c);
     best_cost += lambda * rate_org;
 
-    for(int itr = 0; itr < 3; itr++) {
+    for(int itr = 0; itr < ctx->rdo_full_itr; itr++) {
         int list_cnt = 0;
         oapve_coef_info_t coef_list[OAPV_FULL_RDO_MAX_CAND] = { 0 };
 
@@ -656,13 +526,13 @@ static double enc_block_rdo_placebo(oapve_ctx_t* ctx, oapve_core_t* core, int lo
             }
 
             if(coef_cur.cost < best_cost) {
-                add_coef_list(coef_list, coef_cur, &list_cnt);
+                add_coef_list(coef_list, coef_cur, &list_cnt, ctx->rdo_max_cand);
             }
         }
 
-        for(int j = 1; j < (1 << list_cnt) && j < (1 << OAPV_FULL_RDO_MAX_CAND); j++) {
+        for(int j = 1; j < (1 << list_cnt); j++) {
             oapv_mcpy(coeff, best_coeff, sizeof(s16) * OAPV_BLK_D);
-            for(int i = 0; i < OAPV_FULL_RDO_MAX_CAND && i < list_cnt; i++) {
+            for(int i = 0; i < list_cnt; i++) {
                 coeff[coef_list[i].coef_pos] = ((j >> i) & 1) ? coef_list[i].coef_test : coef_list[i].coef_org;
             }
             oapv_mcpy(recon, coeff, sizeof(s16) * OAPV_BLK_D);
@@ -678,7 +548,7 @@ static double enc_block_rdo_placebo(oapve_ctx_t* ctx, oapve_core_t* core, int lo
         }
     }
 
-    if(ctx->imgb_r) {
+    if(ctx->rec_in_loop) {
         oapv_mcpy(best_recon, best_coeff, sizeof(s16) * OAPV_BLK_D);
         ctx->fn_dquant[0](best_recon, core->q_mat_dec[c], log2_w, log2_h, core->dq_shift[c]);
         ctx->fn_itx[0](best_recon, ITX_SHIFT1, ITX_SHIFT2(bit_depth), 1 << log2_w);
@@ -690,6 +560,142 @@ static double enc_block_rdo_placebo(oapve_ctx_t* ctx, oapve_core_t* core, int lo
     return best_cost;
 }
 
+/* Flat block shortcut
+ *
+ * Each stage of the forward transform multiplies the residual to the block
+ * mean by at most 89 (largest basis value) and adds one rounding error, so
+ * every AC coefficient is bounded by
+ *     |AC| <= ((89 * 89 * SAD) >> (tx_shift1 + tx_shift2)) + FLAT_BLK_MARGIN
+ * where SAD is measured against the block mean. When the bound is below the
+ * smallest AC value surviving quantization, the block is coded as DC-only
+ * without the transform, and its reconstruction is a constant.
+ */
+#define FLAT_BLK_MARGIN 5
+
+static void enc_set_flat_thr(oapve_ctx_t *ctx, oapve_core_t *core, int c)
+{
+    int bit_depth = ctx->bit_depth;
+    int tx_shift = (OAPV_LOG2_BLK_W - 1 + bit_depth - 8) + (OAPV_LOG2_BLK_H + 6);
+    int q_shift = QUANT_SHIFT + (MAX_TX_DYNAMIC_RANGE - bit_depth - OAPV_LOG2_BLK) + (core->qp[c] / 6);
+    s64 lev_max = ((s64)1 << q_shift) - ((s64)core->deadzone[c ? 1 : 0] << (q_shift - 9)) - 1;
+    s64 zero_max = INT_MAX; // largest absolute AC value quantized to zero
+
+    for(int i = 1; i < OAPV_BLK_D; i++) {
+        zero_max = oapv_min(zero_max, lev_max / core->q_mat_enc[c][i]);
+    }
+    if(zero_max <= FLAT_BLK_MARGIN) {
+        core->flat_thr[c] = -1; // disabled
+    }
+    else {
+        core->flat_thr[c] = (int)((((zero_max - FLAT_BLK_MARGIN + 1) << tx_shift) - 1) / (89 * 89));
+    }
+}
+
+static int enc_block_flat(oapve_ctx_t *ctx, oapve_core_t *core, int log2_w, int log2_h, int c)
+{
+    ALIGNED_16(s16 mean[OAPV_BLK_D]);
+    int blk_w = 1 << log2_w;
+    int blk_h = 1 << log2_h;
+    int bit_depth = ctx->bit_depth;
+    int tx_shift1 = log2_w - 1 + bit_depth - 8;
+    int tx_shift2 = log2_h + 6;
+    int sum = 0, dc = 0;
+
+    if(core->flat_thr[c] < 0) {
+        return 0;
+    }
+
+    for(int i = 0; i < OAPV_BLK_D; i++) {
+        sum += core->coef[i];
+    }
+    s16 m = (s16)((sum + (OAPV_BLK_D >> 1)) >> (log2_w + log2_h));
+    for(int i = 0; i < OAPV_BLK_D; i++) {
+        mean[i] = m;
+    }
+    if(ctx->fn_sad[0](blk_w, blk_h, core->coef, mean, blk_w, blk_w) > core->flat_thr[c]) {
+        return 0;
+    }
+
+    // DC coefficient as the forward transform would produce it
+    for(int y = 0; y < blk_h; y++) {
+        int row_sum = 0;
+        for(int x = 0; x < blk_w; x++) {
+            row_sum += core->coef[y * blk_w + x];
+        }
+        dc += (s16)((oapv_tbl_tm8[0][0] * row_sum + (1 << (tx_shift1 - 1))) >> tx_shift1);
+    }
+    dc = (s16)((oapv_tbl_tm8[0][0] * dc + (1 << (tx_shift2 - 1))) >> tx_shift2);
+
+    // quantization of DC, same as fn_quant
+    int q_shift = QUANT_SHIFT + (MAX_TX_DYNAMIC_RANGE - bit_depth - ((log2_w + log2_h) >> 1)) + (core->qp[c] / 6);
+    int sign = oapv_get_sign(dc);
+    s64 lev = ((s64)oapv_abs(dc) * core->q_mat_enc[c][0] + ((s64)core->deadzone[c ? 1 : 0] << (q_shift - 9))) >> q_shift;
+    lev = oapv_set_sign(lev, sign);
+
+    oapv_mset(core->coef, 0, sizeof(s16) * OAPV_BLK_D);
+    core->coef[0] = (s16)oapv_clip3(-32768, 32767, lev);
+
+    core->dc_diff = core->coef[0] - core->prev_dc[c];
+    core->prev_dc[c] = core->coef[0];
+
+    if(ctx->rec_in_loop) {
+        // reconstruction of DC-only block is flat
+        int dq;
+        if(core->dq_shift[c] > 0) {
+            dq = (core->coef[0] * core->q_mat_dec[c][0] + (1 << (core->dq_shift[c] - 1))) >> core->dq_shift[c];
+        }
+        else {
+            dq = (core->coef[0] * core->q_mat_dec[c][0]) << (-core->dq_shift[c]);
+        }
+        dq = oapv_clip3(-32768, 32767, dq);
+        s16 t = (s16)((oapv_tbl_tm8[0][0] * dq + (1 << (ITX_SHIFT1 - 1))) >> ITX_SHIFT1);
+        s16 r = (s16)((oapv_tbl_tm8[0][0] * t + (1 << (ITX_SHIFT2(bit_depth) - 1))) >> ITX_SHIFT2(bit_depth));
+        for(int i = 0; i < OAPV_BLK_D; i++) {
+            core->coef_rec[i] = r;
+        }
+    }
+    return 1;
+}
+
+static void enc_la_clear(oapve_ctx_t *ctx)
+{
+    for(int i = 0; i < ctx->la_num_frms; i++) {
+        if(ctx->la_imgb[i] != NULL) {
+            imgb_release(ctx->la_imgb[i]);
+            ctx->la_imgb[i] = NULL;
+        }
+    }
+    ctx->la_num_frms = 0;
+}
+
+static void enc_la_res_clear(oapve_ctx_t *ctx)
+{
+    for(int i = 0; i < OAPV_MAX_NUM_FRAMES; i++) {
+        if(ctx->la_res_imgb[i] != NULL) {
+            imgb_release(ctx->la_res_imgb[i]);
+            ctx->la_res_imgb[i] = NULL;
+        }
+    }
+}
+
+static void enc_reuse_clear(oapve_ctx_t *ctx)
+{
+    for(int i = 0; i < OAPV_MAX_NUM_FRAMES; i++) {
+        oapve_reuse_t *ru = &ctx->reuse[i];
+        if(ru->imgb_r != NULL) {
+            imgb_release(ru->imgb_r);
+            ru->imgb_r = NULL;
+        }
+        oapv_mfree(ru->bs);
+        ru->bs = NULL;
+        ru->bs_max = 0;
+        oapv_mfree(ru->src);
+        ru->src = NULL;
+        ru->src_max = 0;
+        ru->valid = 0;
+    }
+}
+
 static void enc_flush(oapve_ctx_t *ctx)
 {
     // Release thread pool controller and created threads
@@ -717,8 +723,23 @@ static void enc_flush(oapve_ctx_t *ctx)
         enc_core_free(ctx->core[i]);
         ctx->core[i] = NULL;
     }
+    enc_la_clear(ctx);
+    enc_la_res_clear(ctx);
+    enc_reuse_clear(ctx);
 
-    oapv_mfree_fast(ctx->tile[0].bs_buf);
+    for(int i = 0; i < OAPV_MAX_TILES; i++) {
+        oapv_mfree(ctx->tile[i].bs_buf);
+        ctx->tile[i].bs_buf = NULL;
+        for(int r = 0; r < OAPV_MAX_NUM_RATES; r++) {
+            oapv_mfree(ctx->tile[i].rate[r].bs_buf);
+            ctx->tile[i].rate[r].bs_buf = NULL;
+        }
+    }
+    oapv_mfree_fast(ctx->bsegs);
+    if(ctx->rate_mid != NULL) {
+        oapvm_delete(ctx->rate_mid);
+        ctx->rate_mid = NULL;
+    }
 }
 
 static int enc_ready(oapve_ctx_t *ctx)
@@ -757,12 +778,19 @@ static int enc_ready(oapve_ctx_t *ctx)
     for(int i = 0; i < OAPV_MAX_TILES; i++) {
         ctx->tile[i].stat = ENC_TILE_STAT_NOT_ENCODED;
     }
-    ctx->tile[0].bs_buf = (u8 *)oapv_malloc(ctx->cdesc.max_bs_buf_size);
-    oapv_assert_gv(ctx->tile[0].bs_buf, ret, OAPV_ERR_UNKNOWN, ERR);
+    ctx->bs_budget = ctx->cdesc.max_bs_buf_size;
+    ctx->bsegs = (oapv_bseg_t *)oapv_malloc(sizeof(oapv_bseg_t) * OAPV_MAX_BS_SEGS);
+    oapv_assert_gv(ctx->bsegs, ret, OAPV_ERR_OUT_OF_MEMORY, ERR);
 
+    ctx->la_frm = -1;
     ctx->rc_param.alpha = OAPV_RC_ALPHA;
     ctx->rc_param.beta = OAPV_RC_BETA;
+    for(int r = 0; r < OAPV_MAX_NUM_RATES; r++) {
+        ctx->rate_rc[r].alpha = OAPV_RC_ALPHA;
+        ctx->rate_rc[r].beta = OAPV_RC_BETA;
+    }
     ctx->au_bs_fmt = OAPV_CFG_VAL_AU_BS_FMT_RBAU; // default: enable raw bitstream format
+    ctx->use_flat_blk = 1; // default: enable flat block shortcut
 
     return OAPV_OK;
 ERR:
@@ -771,139 +799,614 @@ ERR:
     return ret;
 }
 
-static int enc_tile_comp(oapv_bs_t *bs, oapve_tile_t *tile, oapve_ctx_t *ctx, oapve_core_t *core, int c, int s_org, void *org, int s_rec, void *rec)
+/* replace the tile bitstream buffer with one of 'size' bytes, keeping the
+   first 'keep' bytes; fails when the total size of tile buffers is over the
+   budget */
+static int enc_tile_bs_alloc(oapve_ctx_t *ctx, int size, int keep, u8 **bs_buf, u32 *bs_buf_max)
 {
-    int  mb_h, mb_w, mb_y, mb_x, blk_x, blk_y;
-    s16 *o16 = NULL, *r16 = NULL;
-
-    u8  *bs_cur = oapv_bsw_sink(bs);
-    oapv_assert_rv(bsw_is_align8(bs), OAPV_ERR_MALFORMED_BITSTREAM);
-
-    mb_w = OAPV_MB_W >> ctx->comp_sft[c][0];
-    mb_h = OAPV_MB_H >> ctx->comp_sft[c][1];
-
-    int tile_le = tile->x >> ctx->comp_sft[c][0];
-    int tile_ri = (tile->w >> ctx->comp_sft[c][0]) + tile_le;
-    int tile_to = tile->y >> ctx->comp_sft[c][1];
-    int tile_bo = (tile->h >> ctx->comp_sft[c][1]) + tile_to;
-
-    for(mb_y = tile_to; mb_y < tile_bo; mb_y += mb_h) {
-        for(mb_x = tile_le; mb_x < tile_ri; mb_x += mb_w) {
-            for(blk_y = mb_y; blk_y < (mb_y + mb_h); blk_y += OAPV_BLK_H) {
-                for(blk_x = mb_x; blk_x < (mb_x + mb_w); blk_x += OAPV_BLK_W) {
-                    o16 = (s16 *)((u8 *)org + blk_y * s_org) + blk_x;
-                    ctx->fn_imgb_to_blk[c](o16, OAPV_BLK_W, OAPV_BLK_H, s_org, blk_x, (OAPV_BLK_W << 1), core->coef, ctx->bit_depth);
+    int diff = size - (int)(*bs_buf_max);
+    u8 *buf;
 
-                    ctx->fn_enc_blk(ctx, core, OAPV_LOG2_BLK_W, OAPV_LOG2_BLK_H, c);
-                    oapve_vlc_dc_coef(bs, core->dc_diff, &core->kparam_dc[c]);
-                    oapve_vlc_ac_coef(bs, core->coef, &core->kparam_ac[c]);
-                    DUMP_COEF(core->coef, OAPV_BLK_D, blk_x, blk_y, c);
-
-                    if(rec != NULL) {
-                        r16 = (s16 *)((u8 *)rec + blk_y * s_rec) + blk_x;
-                        ctx->fn_blk_to_imgb[c](core->coef_rec, OAPV_BLK_W, OAPV_BLK_H, (OAPV_BLK_W << 1), blk_x, s_rec, r16, ctx->bit_depth);
-                    }
-                }
-            }
-        }
+    if(oapv_tpool_atomic_add(&ctx->bs_alloc, diff) > ctx->bs_budget) {
+        oapv_tpool_atomic_add(&ctx->bs_alloc, -diff);
+        return OAPV_ERR_OUT_OF_BS_BUF;
     }
-
-    /* byte align */
-    while(!bsw_is_align8(bs)) {
-        oapv_bsw_write1(bs, 0);
+    buf = (u8 *)oapv_malloc(size);
+    if(buf == NULL) {
+        oapv_tpool_atomic_add(&ctx->bs_alloc, -diff);
+        return OAPV_ERR_OUT_OF_MEMORY;
     }
+    if(keep > 0) {
+        oapv_mcpy(buf, *bs_buf, keep);
+    }
+    oapv_mfree(*bs_buf);
+    *bs_buf = buf;
+    *bs_buf_max = size;
+    return OAPV_OK;
+}
 
-    /* de-init BSW */
-    oapv_bsw_deinit(bs);
+/* make sure at least 'size' bytes are writable in the tile bitstream;
+   the buffer is moved to a larger one, if needed. it grows by a quarter,
+   but takes no more than half of the free budget, so that little of the
+   budget is held unused by grown buffers and other tiles can grow too */
+static int enc_tile_bs_reserve(oapve_ctx_t *ctx, oapv_bs_t *bs, int size, u8 **bs_buf, u32 *bs_buf_max)
+{
+    int written = (int)(bs->cur - bs->beg);
+    int new_size, ret;
+    // bit writer flushes 4 bytes beyond 'cur' at once
+    if(bs->end - bs->cur >= size + 4) {
+        return OAPV_OK;
+    }
+    int room = oapv_max(0, ctx->bs_budget - ctx->bs_alloc) >> 1; // hint only; checked in allocation
+    new_size = oapv_max(oapv_min((int)(*bs_buf_max) + ((int)(*bs_buf_max) >> 2), (int)(*bs_buf_max) + room), written + size + 4);
+    ret = enc_tile_bs_alloc(ctx, new_size, written, bs_buf, bs_buf_max);
+    if(ret == OAPV_ERR_OUT_OF_BS_BUF) { // no room for growing, try the least
+        new_size = written + size + 4;
+        ret = enc_tile_bs_alloc(ctx, new_size, written, bs_buf, bs_buf_max);
+    }
+    oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
 
-    return (int)(bs->cur - bs_cur);
+    bs->beg = *bs_buf;
+    bs->cur = *bs_buf + written;
+    bs->end = *bs_buf + new_size;
+    bs->size = new_size;
+    return OAPV_OK;
 }
 
-static int enc_tile(oapve_ctx_t *ctx, oapve_core_t *core, oapve_tile_t *tile)
+/* prepare the tile bitstream buffer kept from previous encoding; it is
+   enlarged up to the size of the co-located tile in the previous frame with
+   some slack, and grows on demand while encoding */
+static int enc_tile_bs_claim(oapve_ctx_t *ctx, int size_prev, u8 **bs_buf, u32 *bs_buf_max)
 {
-    oapv_bs_t bs;
-    oapv_bsw_init(&bs, tile->bs_buf, tile->bs_buf_max, NULL);
+    // half of the budget of each rate is left for tiles larger than the equal share
+    int buf_min = oapv_min(OAPV_ENC_TILE_BS_MIN, ctx->cdesc.max_bs_buf_size / (ctx->num_tiles * 2));
+    int buf_size = oapv_max(size_prev + (size_prev >> 3), buf_min);
+    int ret;
 
-    int qp = 0;
-    if(ctx->param->rc_type != OAPV_RC_CQP) {
-        oapve_rc_get_qp(ctx, tile, ctx->qp[Y_C], &qp);
+    if((int)(*bs_buf_max) >= buf_size) {
+        return OAPV_OK;
     }
-    else {
-        qp = ctx->qp[Y_C];
+    ret = enc_tile_bs_alloc(ctx, buf_size, 0, bs_buf, bs_buf_max);
+    if(ret == OAPV_ERR_OUT_OF_BS_BUF && (int)(*bs_buf_max) < buf_min) {
+        ret = enc_tile_bs_alloc(ctx, buf_min, 0, bs_buf, bs_buf_max);
+    }
+    else if(ret == OAPV_ERR_OUT_OF_BS_BUF) {
+        ret = OAPV_OK; // no room for the slack, start from the current one
     }
+    oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+    return OAPV_OK;
+}
 
-    tile->tile_size = 0;
-    DUMP_SAVE(0);
-    oapve_vlc_tile_size(&bs, tile->tile_size);
-    oapve_set_tile_header(ctx, &tile->th, core->tile_idx, qp);
-    oapve_vlc_tile_header(ctx, &bs, &tile->th);
+/* size of the part of a block inside the image; blocks of the partial
+   macroblocks at right and bottom can be partly or entirely out of it */
+static void enc_blk_inside(oapve_ctx_t *ctx, int c, int blk_x, int blk_y, int *w, int *h)
+{
+    *w = oapv_min(OAPV_BLK_W, (ctx->imgb_i->w[0] >> ctx->comp_sft[c][0]) - blk_x);
+    *h = oapv_min(OAPV_BLK_H, (ctx->imgb_i->h[0] >> ctx->comp_sft[c][1]) - blk_y);
+}
 
-    for(int c = 0; c < ctx->num_comp; c++) {
-        int cnt = 0;
-        core->qp[c] = tile->th.tile_qp[c];
-        int qscale = oapv_quant_scale[core->qp[c] % 6];
-        s32 scale_multiply_16 = (s32)(qscale << 4); // 15bit + 4bit
-        for(int y = 0; y < OAPV_BLK_H; y++) {
-            for(int x = 0; x < OAPV_BLK_W; x++) {
-                core->q_mat_enc[c][cnt++] = scale_multiply_16 / ctx->fh.q_matrix[c][y][x];
-            }
+void oapve_imgb_to_blk(oapve_ctx_t *ctx, oapv_imgb_t *imgb, int c, int x, int y, int w, int h, s16 *blk)
+{
+    int   cf = OAPV_CS_GET_FORMAT(imgb->cs);
+    int   s_org;
+    void *org;
+
+    if(c < 3 && color_format_is_rgb(cf)) {
+        // every color component is made from all of R, G and B
+        void *src[3];
+        int   s_src[3];
+        for(int i = 0; i < 3; i++) {
+            int p = color_format_rgb_plane(cf, i);
+            s_src[i] = imgb->s[p];
+            src[i] = (u8 *)imgb->a[p] + y * s_src[i];
         }
+        ctx->fn_rgb_to_blk(src, s_src, OAPV_CS_GET_BYTE_DEPTH(imgb->cs), x, w, h, ctx->rgb_coef[c], ctx->rgb_sft, ctx->bit_depth, blk);
+        return;
+    }
+    org = imgb_comp_plane(imgb, c, &s_org);
+    ctx->fn_imgb_to_blk[c]((u8 *)org + y * s_org, w, h, s_org, x, (OAPV_BLK_W << 1), blk, ctx->bit_depth, ctx->in_bit_depth);
+}
 
-        if(ctx->imgb_r || ctx->param->preset >= OAPV_PRESET_MEDIUM) {
-            core->dq_shift[c] = ctx->bit_depth - 2 - (core->qp[c] / 6);
-
-            int cnt = 0;
-            u8 dq_scale = oapv_tbl_dq_scale[core->qp[c] % 6];
-            for(int y = 0; y < OAPV_BLK_H; y++) {
-                for(int x = 0; x < OAPV_BLK_W; x++) {
-                    core->q_mat_dec[c][cnt++] = dq_scale * ctx->fh.q_matrix[c][y][x];
-                }
+/* read a block of input image; samples out of the image are replicated from
+   the nearest ones inside, so that input image is neither padded nor written */
+void oapve_imgb_to_blk_pad(oapve_ctx_t *ctx, oapv_imgb_t *imgb, int c, int blk_x, int blk_y, s16 *blk)
+{
+    int comp_w = imgb->w[0] >> ctx->comp_sft[c][0];
+    int comp_h = imgb->h[0] >> ctx->comp_sft[c][1];
+    int x = oapv_min(blk_x, comp_w - 1);
+    int y = oapv_min(blk_y, comp_h - 1);
+    int w = oapv_min(OAPV_BLK_W, comp_w - x);
+    int h = oapv_min(OAPV_BLK_H, comp_h - y);
+
+    oapve_imgb_to_blk(ctx, imgb, c, x, y, w, h, blk);
+    if(w < OAPV_BLK_W || h < OAPV_BLK_H) {
+        for(int j = 0; j < h; j++) {
+            for(int i = w; i < OAPV_BLK_W; i++) {
+                blk[j * OAPV_BLK_W + i] = blk[j * OAPV_BLK_W + w - 1];
             }
         }
-
-        if(ctx->param->preset == OAPV_PRESET_MEDIUM || ctx->param->preset == OAPV_PRESET_SLOW) {
-            oapve_init_rdoq(core, ctx->bit_depth, c);
+        for(int j = h; j < OAPV_BLK_H; j++) {
+            oapv_mcpy(blk + j * OAPV_BLK_W, blk + (h - 1) * OAPV_BLK_W, sizeof(s16) * OAPV_BLK_W);
         }
     }
+}
 
-    for(int c = 0; c < ctx->num_comp; c++) {
-        core->kparam_dc[c] = OAPV_KPARAM_DC_MAX;
-        core->kparam_ac[c] = OAPV_KPARAM_AC_MIN;
-        core->prev_dc[c] = 0;
+static void enc_imgb_to_blk(oapve_ctx_t *ctx, int c, int blk_x, int blk_y, s16 *blk)
+{
+    oapve_imgb_to_blk_pad(ctx, ctx->imgb_i, c, blk_x, blk_y, blk);
+}
 
-        int  tc, s_org, s_rec;
-        s16 *org, *rec;
+/* luma size of reconstructed picture to be written; partial macroblocks are
+   written as a whole when the buffer has room for them, like decoder does,
+   because frame hash covers the allocated size */
+static void enc_rec_size(oapve_ctx_t *ctx, oapv_imgb_t *imgb_r, int *w, int *h)
+{
+    *w = oapv_max(ctx->imgb_i->w[0], imgb_r->aw[0]);
+    *h = oapv_max(ctx->imgb_i->h[0], imgb_r->ah[0]);
+}
 
-        if(OAPV_CS_GET_FORMAT(ctx->imgb_i->cs) == OAPV_CF_PLANAR2) {
-            tc = c > 0 ? 1 : 0;
-            org = ctx->imgb_i->a[tc];
-            org += (c > 1) ? 1 : 0;
-            s_org = ctx->imgb_i->s[tc];
-
-            if(ctx->imgb_r) {
-                rec = ctx->imgb_r->a[tc];
-                rec += (c > 1) ? 1 : 0;
-                s_rec = ctx->imgb_i->s[tc];
+/* write the part of a reconstructed block inside the picture of 'imgb_r' */
+static void enc_blk_to_imgb(oapve_ctx_t *ctx, oapv_imgb_t *imgb_r, int c, s16 *blk, s16 *rec, int s_rec, int blk_x, int blk_y)
+{
+    int rw, rh;
+
+    enc_rec_size(ctx, imgb_r, &rw, &rh);
+    int w = oapv_min(OAPV_BLK_W, (rw >> ctx->comp_sft[c][0]) - blk_x);
+    int h = oapv_min(OAPV_BLK_H, (rh >> ctx->comp_sft[c][1]) - blk_y);
+    if(w > 0 && h > 0) {
+        ctx->fn_blk_to_imgb[c](blk, w, h, (OAPV_BLK_W << 1), blk_x, s_rec, (s16 *)((u8 *)rec + blk_y * s_rec) + blk_x, ctx->bit_depth);
+    }
+}
+
+/* SSIM of 8x8 window of source and reconstructed blocks */
+static double enc_ssim_8x8(s16 *org, s16 *rec, int bit_depth)
+{
+    s64    so = 0, sr = 0, soo = 0, srr = 0, sor = 0;
+    double n = OAPV_BLK_D, max_val = (1 << bit_depth) - 1;
+    double c1 = (0.01 * max_val) * (0.01 * max_val);
+    double c2 = (0.03 * max_val) * (0.03 * max_val);
+
+    for(int i = 0; i < OAPV_BLK_D; i++) {
+        so += org[i];
+        sr += rec[i];
+        soo += org[i] * org[i];
+        srr += rec[i] * rec[i];
+        sor += org[i] * rec[i];
+    }
+    double mo = so / n, mr = sr / n;
+    double vo = soo / n - mo * mo, vr = srr / n - mr * mr, cov = sor / n - mo * mr;
+    // means of samples, not of the blocks centered at zero
+    mo += 1 << (bit_depth - 1);
+    mr += 1 << (bit_depth - 1);
+    return ((2 * mo * mr + c1) * (2 * cov + c2)) / ((mo * mo + mr * mr + c1) * (vo + vr + c2));
+}
+
+/* accumulate quality metric of the part of a block inside the image */
+static void enc_blk_metric(oapve_ctx_t *ctx, oapve_metric_t *m, int c, s16 *org, s16 *rec, int blk_x, int blk_y)
+{
+    ALIGNED_16(s16 r[OAPV_BLK_D]);
+    int max_val = (1 << ctx->bit_depth) - 1;
+    int mid_val = 1 << (ctx->bit_depth - 1);
+    int w, h;
+
+    enc_blk_inside(ctx, c, blk_x, blk_y, &w, &h);
+    if(w <= 0 || h <= 0) {
+        return;
+    }
+    // clipped as written into reconstructed picture
+    for(int i = 0; i < OAPV_BLK_D; i++) {
+        r[i] = (s16)(oapv_clip3(0, max_val, rec[i] + mid_val) - mid_val);
+    }
+    if(w == OAPV_BLK_W && h == OAPV_BLK_H) {
+        m->ssd[c] += ctx->fn_ssd[0](OAPV_BLK_W, OAPV_BLK_H, org, r, OAPV_BLK_W, OAPV_BLK_W);
+        if(ctx->use_metric & OAPV_CFG_VAL_METRIC_SSIM) {
+            m->ssim[c] += enc_ssim_8x8(org, r, ctx->bit_depth);
+            m->num_win[c]++;
+        }
+    }
+    else {
+        for(int y = 0; y < h; y++) {
+            for(int x = 0; x < w; x++) {
+                int d = org[y * OAPV_BLK_W + x] - r[y * OAPV_BLK_W + x];
+                m->ssd[c] += d * d;
             }
-            else {
-                rec = NULL;
-                s_rec = 0;
+        }
+    }
+    m->num_pix[c] += w * h;
+}
+
+/* quantize and write the shared transformed block for additional rate 'r' */
+static void enc_block_rate(oapve_ctx_t *ctx, oapve_core_t *core, int r, int c, oapv_bs_t *bs, s16 *rec, int s_rec, int blk_x, int blk_y)
+{
+    ALIGNED_16(s16 coef[OAPV_BLK_D]);
+    oapve_core_rate_t *cr = &core->rate[r];
+    int                bit_depth = ctx->bit_depth;
+
+    oapv_mcpy(coef, core->coef_tx, sizeof(s16) * OAPV_BLK_D);
+    ctx->fn_quant[0](coef, cr->qp[c], cr->q_mat_enc[c], OAPV_LOG2_BLK_W, OAPV_LOG2_BLK_H, bit_depth, core->deadzone[c ? 1 : 0]);
+
+    int dc_diff = coef[0] - cr->prev_dc[c];
+    cr->prev_dc[c] = coef[0];
+    oapve_vlc_dc_coef(bs, dc_diff, &cr->kparam_dc[c]);
+    oapve_vlc_ac_coef(bs, coef, &cr->kparam_ac[c]);
+
+    if(rec != NULL) {
+        ctx->fn_dquant[0](coef, cr->q_mat_dec[c], OAPV_LOG2_BLK_W, OAPV_LOG2_BLK_H, cr->dq_shift[c]);
+        ctx->fn_itx[0](coef, ITX_SHIFT1, ITX_SHIFT2(bit_depth), OAPV_BLK_W);
+        enc_blk_to_imgb(ctx, ctx->rate_imgb_r[r], c, coef, rec, s_rec, blk_x, blk_y);
+    }
+}
+
+static int enc_tile_comp(oapv_bs_t *bs, oapve_tile_t *tile, oapve_ctx_t *ctx, oapve_core_t *core, int c, int s_rec, void *rec,
+                         oapv_bs_t *bs_rate)
+{
+    int  mb_h, mb_w, mb_y, mb_x, blk_x, blk_y, r;
+
+    int  ret;
+    int  bs_beg = (int)((u8 *)oapv_bsw_sink(bs) - bs->beg);
+    oapv_assert_rv(bsw_is_align8(bs), OAPV_ERR_MALFORMED_BITSTREAM);
+
+    int  rate_beg[OAPV_MAX_NUM_RATES], s_rate_rec = 0;
+    s16 *rate_rec[OAPV_MAX_NUM_RATES];
+    for(r = 0; r < ctx->num_rates; r++) {
+        rate_beg[r] = (int)((u8 *)oapv_bsw_sink(&bs_rate[r]) - bs_rate[r].beg);
+        rate_rec[r] = (ctx->rate_imgb_r[r] != NULL && !ctx->use_lazy_rec) ? imgb_comp_plane(ctx->rate_imgb_r[r], c, &s_rate_rec) : NULL;
+    }
+
+    mb_w = OAPV_MB_W >> ctx->comp_sft[c][0];
+    mb_h = OAPV_MB_H >> ctx->comp_sft[c][1];
+
+    int tile_le = tile->x >> ctx->comp_sft[c][0];
+    int tile_ri = (tile->w >> ctx->comp_sft[c][0]) + tile_le;
+    int tile_to = tile->y >> ctx->comp_sft[c][1];
+    int tile_bo = (tile->h >> ctx->comp_sft[c][1]) + tile_to;
+
+    for(mb_y = tile_to; mb_y < tile_bo; mb_y += mb_h) {
+        for(mb_x = tile_le; mb_x < tile_ri; mb_x += mb_w) {
+            ret = enc_tile_bs_reserve(ctx, bs, OAPV_ENC_MB_BS_MAX, &tile->bs_buf, &tile->bs_buf_max);
+            oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+            for(r = 0; r < ctx->num_rates; r++) {
+                ret = enc_tile_bs_reserve(ctx, &bs_rate[r], OAPV_ENC_MB_BS_MAX, &tile->rate[r].bs_buf, &tile->rate[r].bs_buf_max);
+                oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+            }
+
+            for(blk_y = mb_y; blk_y < (mb_y + mb_h); blk_y += OAPV_BLK_H) {
+                for(blk_x = mb_x; blk_x < (mb_x + mb_w); blk_x += OAPV_BLK_W) {
+                    enc_imgb_to_blk(ctx, c, blk_x, blk_y, core->coef);
+                    if(ctx->metric_in_loop) {
+                        oapv_mcpy(core->coef_org, core->coef, sizeof(s16) * OAPV_BLK_D);
+                    }
+                    if(ctx->num_rates > 0) {
+                        // transformed once for all rates
+                        oapv_mcpy(core->coef_tx, core->coef, sizeof(s16) * OAPV_BLK_D);
+                        oapv_trans(ctx, core->coef_tx, OAPV_LOG2_BLK_W, OAPV_LOG2_BLK_H, ctx->bit_depth);
+                        core->coef_tx_valid = 1;
+                    }
+
+                    if(!enc_block_flat(ctx, core, OAPV_LOG2_BLK_W, OAPV_LOG2_BLK_H, c)) {
+                        core->fn_enc_blk(ctx, core, OAPV_LOG2_BLK_W, OAPV_LOG2_BLK_H, c);
+                    }
+                    oapve_vlc_dc_coef(bs, core->dc_diff, &core->kparam_dc[c]);
+                    oapve_vlc_ac_coef(bs, core->coef, &core->kparam_ac[c]);
+                    DUMP_COEF(core->coef, OAPV_BLK_D, blk_x, blk_y, c);
+
+                    if(rec != NULL) {
+                        enc_blk_to_imgb(ctx, ctx->imgb_r, c, core->coef_rec, rec, s_rec, blk_x, blk_y);
+                    }
+                    if(ctx->metric_in_loop) {
+                        enc_blk_metric(ctx, &tile->metric, c, core->coef_org, core->coef_rec, blk_x, blk_y);
+                    }
+                    for(r = 0; r < ctx->num_rates; r++) {
+                        enc_block_rate(ctx, core, r, c, &bs_rate[r], rate_rec[r], s_rate_rec, blk_x, blk_y);
+                    }
+                    core->coef_tx_valid = 0;
+                }
             }
         }
-        else {
-            org = ctx->imgb_i->a[c];
-            s_org = ctx->imgb_i->s[c];
-            if(ctx->imgb_r) {
-                rec = ctx->imgb_r->a[c];
-                s_rec = ctx->imgb_i->s[c];
+    }
+
+    /* byte align */
+    while(!bsw_is_align8(bs)) {
+        oapv_bsw_write1(bs, 0);
+    }
+
+    /* de-init BSW */
+    oapv_bsw_deinit(bs);
+
+    for(r = 0; r < ctx->num_rates; r++) {
+        while(!bsw_is_align8(&bs_rate[r])) {
+            oapv_bsw_write1(&bs_rate[r], 0);
+        }
+        oapv_bsw_deinit(&bs_rate[r]);
+        tile->rate[r].th.tile_data_size[c] = (int)(bs_rate[r].cur - bs_rate[r].beg) - rate_beg[r];
+    }
+
+    return (int)(bs->cur - bs->beg) - bs_beg;
+}
+
+/* base QP of a tile */
+static int enc_tile_qp(oapve_ctx_t *ctx, oapve_tile_t *tile)
+{
+    int qp = 0;
+    if(ctx->param->rc_type != OAPV_RC_CQP) {
+        oapve_rc_get_qp(ctx, &ctx->rc_param, tile, tile->rc.target_bits, ctx->qp[Y_C], &qp);
+    }
+    else {
+        qp = ctx->qp[Y_C];
+    }
+    return oapv_clip3(MIN_QUANT, MAX_QUANT(10), qp + tile->dqp_fit);
+}
+
+static void enc_set_q_mat_enc(oapve_ctx_t *ctx, int c, int qp, int *q_mat_enc)
+{
+    int cnt = 0;
+    int qscale = oapv_quant_scale[qp % 6];
+    s32 scale_multiply_16 = (s32)(qscale << 4); // 15bit + 4bit
+    for(int y = 0; y < OAPV_BLK_H; y++) {
+        for(int x = 0; x < OAPV_BLK_W; x++) {
+            q_mat_enc[cnt++] = scale_multiply_16 / ctx->fh.q_matrix[c][y][x];
+        }
+    }
+}
+
+static void enc_set_q_mat_dec(oapve_ctx_t *ctx, int c, int qp, s16 *q_mat_dec, int *dq_shift)
+{
+    int cnt = 0;
+    u8  dq_scale = oapv_tbl_dq_scale[qp % 6];
+    *dq_shift = ctx->bit_depth - 2 - (qp / 6);
+    for(int y = 0; y < OAPV_BLK_H; y++) {
+        for(int x = 0; x < OAPV_BLK_W; x++) {
+            q_mat_dec[cnt++] = dq_scale * ctx->fh.q_matrix[c][y][x];
+        }
+    }
+}
+
+static void enc_core_set_qp(oapve_ctx_t *ctx, oapve_core_t *core, int c, int qp)
+{
+    core->qp[c] = qp;
+    enc_set_q_mat_enc(ctx, c, qp, core->q_mat_enc[c]);
+}
+
+static int enc_num_planes(oapve_ctx_t *ctx, oapv_imgb_t *imgb)
+{
+    int cf = OAPV_CS_GET_FORMAT(imgb->cs);
+    if(cf == OAPV_CF_UYVY || cf == OAPV_CF_V210) {
+        return 1;
+    }
+    return (cf == OAPV_CF_PLANAR2) ? 2 : ctx->num_comp;
+}
+
+/* bytes of plane 'p' covered by a tile inside the picture of luma size
+   'pw'x'ph' */
+static u8 *enc_tile_region(oapve_ctx_t *ctx, oapv_imgb_t *imgb, int p, oapve_tile_t *tile, int pw, int ph, int *w, int *h)
+{
+    int cf = OAPV_CS_GET_FORMAT(imgb->cs);
+    int tw = oapv_min(tile->w, pw - tile->x);
+    int th = oapv_min(tile->h, ph - tile->y);
+
+    if(cf == OAPV_CF_V210) {
+        // whole groups of 6 pixels overlapped by the tile
+        int x0 = (tile->x / 6) * 16;
+        *w = ((tile->x + tw + 5) / 6) * 16 - x0;
+        *h = th;
+        return (u8 *)imgb->a[0] + tile->y * imgb->s[0] + x0;
+    }
+    if(cf == OAPV_CF_UYVY) {
+        *w = tw << 1;
+        *h = th;
+        return (u8 *)imgb->a[0] + tile->y * imgb->s[0] + (tile->x << 1);
+    }
+    // interleaved chroma plane of P210 has the same byte width as luma
+    int p210 = (cf == OAPV_CF_PLANAR2);
+    int sft_w = p210 ? 0 : ctx->comp_sft[p][0];
+    int sft_h = p210 ? 0 : ctx->comp_sft[p][1];
+    int byte_depth = OAPV_CS_GET_BYTE_DEPTH(imgb->cs);
+
+    *w = (tw >> sft_w) * byte_depth;
+    *h = th >> sft_h;
+    return (u8 *)imgb->a[p] + (tile->y >> sft_h) * imgb->s[p] + (tile->x >> sft_w) * byte_depth;
+}
+
+/* copy source samples of a tile into 'dst', or compare them with 'dst' when
+   'cmp' is set; returns byte size of the samples, or -1 if they differ */
+static int enc_tile_src(oapve_ctx_t *ctx, oapve_tile_t *tile, u8 *dst, int cmp)
+{
+    int size = 0;
+    int w, h;
+
+    for(int p = 0; p < enc_num_planes(ctx, ctx->imgb_i); p++) {
+        u8 *src = enc_tile_region(ctx, ctx->imgb_i, p, tile, ctx->imgb_i->w[0], ctx->imgb_i->h[0], &w, &h);
+        for(int y = 0; y < h; y++) {
+            if(cmp && oapv_mcmp(dst + size, src, w)) {
+                return -1;
             }
-            else {
-                rec = NULL;
-                s_rec = 0;
+            else if(!cmp && dst != NULL) {
+                oapv_mcpy(dst + size, src, w);
+            }
+            size += w;
+            src += ctx->imgb_i->s[p];
+        }
+    }
+    return size;
+}
+
+/* reconstruction is made by decoding of tile bitstream after encoding,
+   instead of in encoding loop (OAPV_CFG_SET_USE_LAZY_REC) */
+static int enc_rec_lazy(oapve_ctx_t *ctx)
+{
+    if(!ctx->use_lazy_rec) {
+        return 0;
+    }
+    if(ctx->imgb_r != NULL) {
+        return 1;
+    }
+    for(int r = 0; r < ctx->num_rates; r++) {
+        if(ctx->rate_imgb_r[r] != NULL) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* hash of reconstructed tile, which makes fast frame hash with the ones of
+   other tiles */
+static void enc_tile_frm_hash(oapve_ctx_t *ctx, oapve_tile_t *tile)
+{
+    if(ctx->use_frm_hash != OAPV_CFG_VAL_FRM_HASH_FAST) {
+        return;
+    }
+    if(ctx->imgb_r != NULL) {
+        for(int p = 0; p < ctx->imgb_r->np; p++) {
+            tile->hash[p] = oapv_imgb_hash64_rect(ctx->imgb_r, p, tile->x, tile->y, tile->w, tile->h);
+        }
+    }
+    for(int r = 0; r < ctx->num_rates; r++) {
+        oapv_imgb_t *imgb_r = ctx->rate_imgb_r[r];
+        for(int p = 0; imgb_r != NULL && p < imgb_r->np; p++) {
+            tile->rate[r].hash[p] = oapv_imgb_hash64_rect(imgb_r, p, tile->x, tile->y, tile->w, tile->h);
+        }
+    }
+}
+
+/* take bitstream and reconstruction of the co-located tile in previous
+   access unit, when the source and QP of the tile are not changed */
+static int enc_tile_reuse(oapve_ctx_t *ctx, oapve_tile_t *tile, int qp)
+{
+    oapve_reuse_t *ru = ctx->reuse_ref;
+    int            i = (int)(tile - ctx->tile);
+    int            w, h;
+
+    if(ru == NULL || enc_tile_src(ctx, tile, ru->src + ru->src_ofs[i], 1) < 0) {
+        return 0;
+    }
+    for(int c = 0; c < ctx->num_comp; c++) {
+        if(ru->th[i].tile_qp[c] != oapv_clip3(MIN_QUANT, MAX_QUANT(10), qp + ctx->qp_offset[c])) {
+            return 0;
+        }
+    }
+    if((int)tile->bs_buf_max < ru->bs_size[i] && enc_tile_bs_alloc(ctx, ru->bs_size[i], 0, &tile->bs_buf, &tile->bs_buf_max) != OAPV_OK) {
+        return 0; // encode it normally
+    }
+    oapv_mcpy(tile->bs_buf, ru->bs + ru->bs_ofs[i], ru->bs_size[i]);
+    tile->bs_size = ru->bs_size[i];
+    tile->tile_size = tile->bs_size - OAPV_TILE_SIZE_LEN;
+    oapv_mcpy(&tile->th, &ru->th[i], sizeof(oapv_th_t));
+    oapv_mcpy(&tile->metric, &ru->metric[i], sizeof(oapve_metric_t));
+
+    if(ctx->imgb_r != NULL && ctx->imgb_r != ru->imgb_r) {
+        int pw, ph, pw_ru, ph_ru;
+        enc_rec_size(ctx, ctx->imgb_r, &pw, &ph);
+        enc_rec_size(ctx, ru->imgb_r, &pw_ru, &ph_ru);
+        pw = oapv_min(pw, pw_ru);
+        ph = oapv_min(ph, ph_ru);
+        for(int p = 0; p < enc_num_planes(ctx, ctx->imgb_r); p++) {
+            u8 *src = enc_tile_region(ctx, ru->imgb_r, p, tile, pw, ph, &w, &h);
+            u8 *dst = enc_tile_region(ctx, ctx->imgb_r, p, tile, pw, ph, &w, &h);
+            for(int y = 0; y < h; y++) {
+                oapv_mcpy(dst, src, w);
+                src += ru->imgb_r->s[p];
+                dst += ctx->imgb_r->s[p];
+            }
+        }
+    }
+    tile->reused = 1;
+    return 1;
+}
+
+static int enc_tile(oapve_ctx_t *ctx, oapve_core_t *core, oapve_tile_t *tile)
+{
+    oapv_bs_t bs, bs_rate[OAPV_MAX_NUM_RATES];
+    int       ret;
+
+    int qp = enc_tile_qp(ctx, tile);
+    tile->reused = 0;
+    tile->rec_pending = 0;
+    oapv_mset(&tile->metric, 0, sizeof(oapve_metric_t));
+    if(ctx->use_tile_reuse && enc_tile_reuse(ctx, tile, qp)) {
+        enc_tile_frm_hash(ctx, tile);
+        return OAPV_OK; // reconstruction was copied, too
+    }
+    tile->rec_pending = enc_rec_lazy(ctx);
+
+    ret = enc_tile_bs_claim(ctx, tile->bs_size, &tile->bs_buf, &tile->bs_buf_max);
+    oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+    oapv_bsw_init(&bs, tile->bs_buf, tile->bs_buf_max, NULL);
+
+    // downgraded tile is encoded without RDO, with dead-zone of enc_block()
+    if(tile->preset == ctx->param->preset) {
+        core->fn_enc_blk = ctx->fn_enc_blk;
+        oapv_mcpy(core->deadzone, ctx->deadzone, sizeof(core->deadzone));
+    }
+    else {
+        core->fn_enc_blk = enc_block;
+        oapv_mcpy(core->deadzone, ctx->deadzone_blk, sizeof(core->deadzone));
+    }
+
+    tile->tile_size = 0;
+    DUMP_SAVE(0);
+    oapve_vlc_tile_size(&bs, tile->tile_size);
+    oapve_set_tile_header(ctx, &tile->th, core->tile_idx, qp);
+    oapve_vlc_tile_header(&bs, ctx->num_comp, &tile->th);
+
+    for(int r = 0; r < ctx->num_rates; r++) {
+        oapve_tile_rate_t *tr = &tile->rate[r];
+        oapve_core_rate_t *cr = &core->rate[r];
+
+        ret = enc_tile_bs_claim(ctx, tr->bs_size, &tr->bs_buf, &tr->bs_buf_max);
+        oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+        oapv_bsw_init(&bs_rate[r], tr->bs_buf, tr->bs_buf_max, NULL);
+        oapve_vlc_tile_size(&bs_rate[r], 0);
+        oapve_set_tile_header(ctx, &tr->th, core->tile_idx, tr->qp);
+        oapve_vlc_tile_header(&bs_rate[r], ctx->num_comp, &tr->th);
+
+        for(int c = 0; c < ctx->num_comp; c++) {
+            cr->qp[c] = tr->th.tile_qp[c];
+            enc_set_q_mat_enc(ctx, c, cr->qp[c], cr->q_mat_enc[c]);
+            if(ctx->rate_imgb_r[r] != NULL && !ctx->use_lazy_rec) {
+                enc_set_q_mat_dec(ctx, c, cr->qp[c], cr->q_mat_dec[c], &cr->dq_shift[c]);
             }
+            cr->kparam_dc[c] = OAPV_KPARAM_DC_MAX;
+            cr->kparam_ac[c] = OAPV_KPARAM_AC_MIN;
+            cr->prev_dc[c] = 0;
+        }
+    }
+
+    for(int c = 0; c < ctx->num_comp; c++) {
+        enc_core_set_qp(ctx, core, c, tile->th.tile_qp[c]);
+
+        if(ctx->rec_in_loop || ctx->param->preset >= OAPV_PRESET_MEDIUM) {
+            enc_set_q_mat_dec(ctx, c, core->qp[c], core->q_mat_dec[c], &core->dq_shift[c]);
         }
 
-        tile->th.tile_data_size[c] = enc_tile_comp(&bs, tile, ctx, core, c, s_org, org, s_rec, rec);
+        if(ctx->param->preset == OAPV_PRESET_MEDIUM || ctx->param->preset == OAPV_PRESET_SLOW) {
+            oapve_init_rdoq(core, ctx->bit_depth, c);
+        }
+
+        // the shortcut reproduces only the plain quantization of enc_block();
+        // RDO presets may decide coefficients differently near the deadzone
+        if(ctx->use_flat_blk && core->fn_enc_blk == enc_block) {
+            enc_set_flat_thr(ctx, core, c);
+        }
+        else {
+            core->flat_thr[c] = -1; // disabled
+        }
+    }
+
+    for(int c = 0; c < ctx->num_comp; c++) {
+        core->kparam_dc[c] = OAPV_KPARAM_DC_MAX;
+        core->kparam_ac[c] = OAPV_KPARAM_AC_MIN;
+        core->prev_dc[c] = 0;
+
+        int   s_rec = 0;
+        void *rec = NULL;
+
+        if(ctx->rec_in_loop && ctx->imgb_r) {
+            rec = imgb_comp_plane(ctx->imgb_r, c, &s_rec);
+        }
+
+        ret = enc_tile_comp(&bs, tile, ctx, core, c, s_rec, rec, bs_rate);
+        oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+        tile->th.tile_data_size[c] = ret;
     }
 
     u32 bs_size = (int)(bs.cur - bs.beg);
@@ -919,9 +1422,232 @@ static int enc_tile(oapve_ctx_t *ctx, oapve_core_t *core, oapve_tile_t *tile)
     DUMP_SAVE(1);
     DUMP_LOAD(0);
     oapve_vlc_tile_size(&bs_th, tile->tile_size);
-    oapve_vlc_tile_header(ctx, &bs_th, &tile->th);
+    oapve_vlc_tile_header(&bs_th, ctx->num_comp, &tile->th);
     DUMP_LOAD(1);
     oapv_bsw_deinit(&bs_th);
+
+    for(int r = 0; r < ctx->num_rates; r++) {
+        oapve_tile_rate_t *tr = &tile->rate[r];
+        tr->bs_size = (int)(bs_rate[r].cur - bs_rate[r].beg);
+        oapv_bsw_init(&bs_th, tr->bs_buf, tr->bs_size, NULL);
+        oapve_vlc_tile_size(&bs_th, tr->bs_size - OAPV_TILE_SIZE_LEN);
+        oapve_vlc_tile_header(&bs_th, ctx->num_comp, &tr->th);
+        oapv_bsw_deinit(&bs_th);
+    }
+    if(!tile->rec_pending) {
+        enc_tile_frm_hash(ctx, tile);
+    }
+    return OAPV_OK;
+}
+
+/* decode tile data in 'bs_buf' into 'imgb_r'; the result is identical with
+   the reconstruction in encoding loop */
+static int enc_tile_rec_bs(oapve_ctx_t *ctx, oapve_tile_t *tile, u8 *bs_buf, int bs_size, oapv_th_t *th, oapv_imgb_t *imgb_r,
+                           oapve_metric_t *metric)
+{
+    ALIGNED_16(s16 coef[OAPV_BLK_D]);
+    ALIGNED_16(s16 org[OAPV_BLK_D]);
+    ALIGNED_16(s16 q_mat_dec[OAPV_BLK_D]);
+    oapv_bs_t bs;
+    int       dq_shift, dc_diff, prev_dc, kparam_dc, kparam_ac, s_rec, ret;
+    int       bit_depth = ctx->bit_depth;
+    u8       *data = bs_buf + bs_size;
+
+    // tile data of components are at the end of tile
+    for(int c = 0; c < ctx->num_comp; c++) {
+        data -= th->tile_data_size[c];
+    }
+    for(int c = 0; c < ctx->num_comp; c++) {
+        s16 *rec = imgb_comp_plane(imgb_r, c, &s_rec);
+        int  mb_w = OAPV_MB_W >> ctx->comp_sft[c][0];
+        int  mb_h = OAPV_MB_H >> ctx->comp_sft[c][1];
+        int  tile_le = tile->x >> ctx->comp_sft[c][0];
+        int  tile_ri = (tile->w >> ctx->comp_sft[c][0]) + tile_le;
+        int  tile_to = tile->y >> ctx->comp_sft[c][1];
+        int  tile_bo = (tile->h >> ctx->comp_sft[c][1]) + tile_to;
+
+        enc_set_q_mat_dec(ctx, c, th->tile_qp[c], q_mat_dec, &dq_shift);
+        oapv_bsr_init(&bs, data, th->tile_data_size[c], NULL);
+        data += th->tile_data_size[c];
+        kparam_dc = OAPV_KPARAM_DC_MAX;
+        kparam_ac = OAPV_KPARAM_AC_MIN;
+        prev_dc = 0;
+
+        // blocks are in the same order as in enc_tile_comp()
+        for(int mb_y = tile_to; mb_y < tile_bo; mb_y += mb_h) {
+            for(int mb_x = tile_le; mb_x < tile_ri; mb_x += mb_w) {
+                for(int blk_y = mb_y; blk_y < (mb_y + mb_h); blk_y += OAPV_BLK_H) {
+                    for(int blk_x = mb_x; blk_x < (mb_x + mb_w); blk_x += OAPV_BLK_W) {
+                        oapv_mset(coef, 0, sizeof(coef));
+                        ret = oapvd_vlc_dc_coef(&bs, &dc_diff, &kparam_dc);
+                        oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+                        ret = oapvd_vlc_ac_coef(&bs, coef, &kparam_ac);
+                        oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+
+                        coef[0] = dc_diff + prev_dc;
+                        prev_dc = coef[0];
+                        ctx->fn_dquant[0](coef, q_mat_dec, OAPV_LOG2_BLK_W, OAPV_LOG2_BLK_H, dq_shift);
+                        ctx->fn_itx[0](coef, ITX_SHIFT1, ITX_SHIFT2(bit_depth), OAPV_BLK_W);
+                        enc_blk_to_imgb(ctx, imgb_r, c, coef, rec, s_rec, blk_x, blk_y);
+                        if(metric != NULL) {
+                            enc_imgb_to_blk(ctx, c, blk_x, blk_y, org);
+                            enc_blk_metric(ctx, metric, c, org, coef, blk_x, blk_y);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return OAPV_OK;
+}
+
+static int enc_tile_rec(oapve_ctx_t *ctx, oapve_tile_t *tile)
+{
+    int ret;
+
+    if(ctx->imgb_r != NULL) {
+        ret = enc_tile_rec_bs(ctx, tile, tile->bs_buf, tile->bs_size, &tile->th, ctx->imgb_r, ctx->use_metric ? &tile->metric : NULL);
+        oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+    }
+    for(int r = 0; r < ctx->num_rates; r++) {
+        if(ctx->rate_imgb_r[r] != NULL) {
+            ret = enc_tile_rec_bs(ctx, tile, tile->rate[r].bs_buf, tile->rate[r].bs_size, &tile->rate[r].th, ctx->rate_imgb_r[r], NULL);
+            oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+        }
+    }
+    enc_tile_frm_hash(ctx, tile);
+    return OAPV_OK;
+}
+
+/* reconstruct encoded tiles not reconstructed yet */
+static int enc_thread_tile_rec(void *arg)
+{
+    oapve_core_t *core = (oapve_core_t *)arg;
+    oapve_ctx_t  *ctx = core->ctx;
+    oapve_tile_t *tile = ctx->tile;
+    int           ret = OAPV_OK, i;
+
+    while(1) {
+        oapv_tpool_enter_cs(ctx->sync_obj);
+        for(i = 0; i < ctx->num_tiles; i++) {
+            if(tile[i].stat == ENC_TILE_STAT_ENCODED && tile[i].rec_pending) {
+                tile[i].rec_pending = 0;
+                break;
+            }
+        }
+        oapv_tpool_leave_cs(ctx->sync_obj);
+        if(i == ctx->num_tiles) {
+            break;
+        }
+        ret = enc_tile_rec(ctx, &tile[i]);
+        oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+    }
+    return ret;
+}
+
+static int enc_tile_preset(oapve_ctx_t *ctx, int tile_idx)
+{
+    int preset = ctx->param->preset;
+
+    if(ctx->param->frm_time_budget <= 0 || preset <= OAPV_PRESET_FAST || ctx->tile_clk_avg == 0) {
+        return preset;
+    }
+    // tiles are taken in raster order, so 'tile_idx' and the following tiles
+    // are not encoded yet
+    int parallel_task = (ctx->threads > ctx->num_tiles) ? ctx->num_tiles : ctx->threads;
+    int rounds = oapv_div_round_up(ctx->num_tiles - tile_idx, parallel_task);
+    u64 elapsed = oapv_clk_usec() - ctx->frm_clk_beg;
+
+    if(elapsed + rounds * ctx->tile_clk_avg > (u64)ctx->param->frm_time_budget) {
+        return OAPV_PRESET_FAST; // behind the budget
+    }
+    return preset;
+}
+
+static int enc_stream(oapve_ctx_t *ctx, int type, int offset, void *data, int size)
+{
+    if(ctx->stream.fn == NULL || size <= 0) {
+        return OAPV_OK;
+    }
+    int ret = ctx->stream.fn(ctx->stream.arg, type, offset, data, size);
+    oapv_assert_rv(ret >= 0, ret);
+    if(type == OAPVE_STREAM_DATA) {
+        ctx->stream_off += size;
+    }
+    return OAPV_OK;
+}
+
+/* stream the tiles encoded in a row from 'stream_tile'.
+   only one thread at a time sends them, and the callback is called out of
+   critical section; the tiles encoded meanwhile are sent by the same thread */
+static int enc_stream_tiles(oapve_ctx_t *ctx)
+{
+    oapve_tile_t *tile = ctx->tile;
+    int           beg, end, ret = OAPV_OK;
+
+    if(ctx->stream.fn == NULL) {
+        return OAPV_OK;
+    }
+    oapv_tpool_enter_cs(ctx->sync_obj);
+    if(ctx->stream_busy || ctx->stream_err) {
+        ret = ctx->stream_err;
+        oapv_tpool_leave_cs(ctx->sync_obj);
+        return ret;
+    }
+    ctx->stream_busy = 1;
+    while(1) {
+        beg = end = ctx->stream_tile;
+        while(end < ctx->num_tiles && tile[end].stat == ENC_TILE_STAT_ENCODED) {
+            end++;
+        }
+        if(beg == end) {
+            break;
+        }
+        oapv_tpool_leave_cs(ctx->sync_obj);
+        for(int i = beg; i < end && OAPV_SUCCEEDED(ret); i++) {
+            if(i == 0) { // headers in front of the first tile
+                ret = enc_stream(ctx, OAPVE_STREAM_DATA, ctx->stream_off, ctx->stream_pos, (int)(ctx->stream_fh_end - ctx->stream_pos));
+                ctx->stream_pos = ctx->stream_fh_end;
+            }
+            if(OAPV_SUCCEEDED(ret)) {
+                ret = enc_stream(ctx, OAPVE_STREAM_DATA, ctx->stream_off, tile[i].bs_buf, tile[i].bs_size);
+            }
+        }
+        oapv_tpool_enter_cs(ctx->sync_obj);
+        ctx->stream_tile = end;
+        if(OAPV_FAILED(ret)) {
+            ctx->stream_err = ret;
+            break;
+        }
+    }
+    ctx->stream_busy = 0;
+    oapv_tpool_leave_cs(ctx->sync_obj);
+    return ret;
+}
+
+/* analyze the tiles of lookahead frame not taken yet; it runs on the tile
+   threads out of tiles to encode, so that no more thread is needed */
+static int enc_la_run(oapve_ctx_t *ctx)
+{
+    int t, ret;
+
+    while(1) {
+        oapv_tpool_enter_cs(ctx->sync_obj);
+        t = (ctx->la_frm >= 0 && ctx->la_next < ctx->num_tiles) ? ctx->la_next++ : -1;
+        oapv_tpool_leave_cs(ctx->sync_obj);
+        if(t < 0) {
+            break;
+        }
+        // same format as current frame, so that its settings are applicable
+        int i = ctx->la_frm;
+        ret = oapve_rc_get_tile_cost(ctx, NULL, ctx->la_imgb[i], &ctx->tile[t], &ctx->la_cost[i][t], &ctx->la_num_pixel[i][t]);
+        oapv_tpool_enter_cs(ctx->sync_obj);
+        if(OAPV_FAILED(ret)) {
+            ctx->la_err = ret;
+        }
+        ctx->la_done++;
+        oapv_tpool_leave_cs(ctx->sync_obj);
+    }
     return OAPV_OK;
 }
 
@@ -931,6 +1657,7 @@ static int enc_thread_tile(void *arg)
     oapve_ctx_t  *ctx = core->ctx;
     oapve_tile_t *tile = ctx->tile;
     int           ret = OAPV_OK, i;
+    u64           clk_beg;
 
     while(1) {
         // find not encoded tile
@@ -938,6 +1665,7 @@ static int enc_thread_tile(void *arg)
         for(i = 0; i < ctx->num_tiles; i++) {
             if(tile[i].stat == ENC_TILE_STAT_NOT_ENCODED) {
                 tile[i].stat = ENC_TILE_STAT_ON_ENCODING;
+                tile[i].preset = enc_tile_preset(ctx, i);
                 core->tile_idx = i;
                 break;
             }
@@ -947,43 +1675,166 @@ static int enc_thread_tile(void *arg)
             break;
         }
 
+        clk_beg = oapv_clk_usec();
         ret = enc_tile(ctx, core, &tile[core->tile_idx]);
         oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
 
-        oapv_tpool_enter_cs(ctx->sync_obj);
-        tile[core->tile_idx].stat = ENC_TILE_STAT_ENCODED;
-        oapv_tpool_leave_cs(ctx->sync_obj);
+        oapv_tpool_enter_cs(ctx->sync_obj);
+        tile[core->tile_idx].stat = ENC_TILE_STAT_ENCODED;
+        if(tile[core->tile_idx].preset == ctx->param->preset && !tile[core->tile_idx].reused) {
+            ctx->tile_clk_sum += oapv_clk_usec() - clk_beg;
+            ctx->tile_clk_cnt++;
+            ctx->tile_clk_avg = ctx->tile_clk_sum / ctx->tile_clk_cnt;
+        }
+        oapv_tpool_leave_cs(ctx->sync_obj);
+
+        // tiles may be re-encoded to fit into size limit, so streamed later
+        if(ctx->fit_limit <= 0) {
+            ret = enc_stream_tiles(ctx);
+            oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
+        }
+    }
+    if(ctx->fit_limit <= 0 && enc_rec_lazy(ctx)) {
+        // thread out of tiles to encode reconstructs the encoded ones
+        ret = enc_thread_tile_rec(arg);
+        oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
+    }
+    // and then analyzes next access unit
+    ret = enc_la_run(ctx);
+ERR:
+    return ret;
+}
+
+static int enc_profile_spec[][5] = {
+    // {profile-idc, cfi-min, cfi-max, bit-depth-min, bit-depth-max}
+    {OAPV_PROFILE_422_10, 2, 2, 10, 10},
+    {OAPV_PROFILE_422_12, 2, 2, 10, 12},
+    {OAPV_PROFILE_444_10, 2, 3, 10, 10},
+    {OAPV_PROFILE_444_12, 2, 3, 10, 12},
+    {OAPV_PROFILE_4444_10, 2, 4, 10, 10},
+    {OAPV_PROFILE_4444_12, 2, 4, 10, 12},
+    {OAPV_PROFILE_400_10, 0, 0, 10, 10},
+    {0, 0, 0, 0, 0} // termination
+};
+
+static int enc_check_profile(int profile_idc, int cfi, int bit_depth)
+{
+    int idx = 0;
+    while(enc_profile_spec[idx][0] != 0) {
+        if(profile_idc == enc_profile_spec[idx][0]) {
+            if(cfi >= enc_profile_spec[idx][1] && cfi <= enc_profile_spec[idx][2]) { // check cfi
+                if(bit_depth >= enc_profile_spec[idx][3] && bit_depth <= enc_profile_spec[idx][4]) { // check bit-depth
+                    return OAPV_OK;
+                }
+            }
+        }
+        idx++;
+    }
+    return OAPV_ERR_INVALID_PROFILE;
+}
+
+/* bit depth of codec for input image of 'in_bit_depth' bits; input out of
+   the range allowed by the profile is converted to the nearest one */
+static int enc_codec_bit_depth(int profile_idc, int in_bit_depth)
+{
+    int idx = 0;
+    while(enc_profile_spec[idx][0] != 0) {
+        if(profile_idc == enc_profile_spec[idx][0]) {
+            return oapv_clip3(enc_profile_spec[idx][3], enc_profile_spec[idx][4], in_bit_depth);
+        }
+        idx++;
+    }
+    return in_bit_depth;
+}
+
+/* check whether input image is one of the formats read by encoder */
+static int enc_check_input_format(oapv_imgb_t *imgb)
+{
+    int cf = OAPV_CS_GET_FORMAT(imgb->cs);
+    int bd = OAPV_CS_GET_BIT_DEPTH(imgb->cs);
+
+    if(cf == OAPV_CF_UYVY) {
+        return (bd == 8) ? OAPV_OK : OAPV_ERR_UNSUPPORTED;
+    }
+    if(cf == OAPV_CF_V210 || cf == OAPV_CF_PLANAR2) {
+        return (bd == 10) ? OAPV_OK : OAPV_ERR_UNSUPPORTED;
+    }
+    return (bd == 8 || (bd >= 10 && bd <= 16)) ? OAPV_OK : OAPV_ERR_UNSUPPORTED;
+}
+
+/* fixed-point conversion of RGB input to YCbCr by 'matrix_coefficients';
+   R, G and B are taken as full range samples */
+static int enc_set_rgb_coef(oapve_ctx_t *ctx, oapve_param_t *param)
+{
+    double m[3][3], ofs[3];
+    int    bd = ctx->bit_depth, in_bd = ctx->in_bit_depth;
+    int    ret;
+
+    oapv_assert_rv(param->color_description_present_flag, OAPV_ERR_INVALID_ARGUMENT);
+    ret = rgb_to_ycbcr_matrix(param->matrix_coefficients, param->full_range_flag, bd, m, ofs);
+    oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+
+    // products are kept in 32 bits for input of up to 16 bits
+    ctx->rgb_sft = 14 + oapv_max(0, in_bd - bd);
+    double unit = (double)(1 << ctx->rgb_sft);
+    double cvt = unit * ((bd >= in_bd) ? (double)(1 << (bd - in_bd)) : 1.0 / (1 << (in_bd - bd)));
+    for(int c = 0; c < 3; c++) {
+        for(int i = 0; i < 3; i++) {
+            double v = m[c][i] * cvt;
+            ctx->rgb_coef[c][i] = (int)(v < 0 ? v - 0.5 : v + 0.5);
+        }
+        ctx->rgb_coef[c][3] = (int)(ofs[c] * unit + 0.5) + (1 << (ctx->rgb_sft - 1));
+    }
+    return OAPV_OK;
+}
+
+#define TUNE_VAL(val, dflt) (((val) == OAPVE_PARAM_TUNE_AUTO) ? (dflt) : (val))
+#define TUNE_IN_RANGE(val, min, max) (((val) == OAPVE_PARAM_TUNE_AUTO) || ((val) >= (min) && (val) <= (max)))
+
+/* tuning values are checked here, since library callers can set them
+   without oapve_param_parse(); ranges are bounded by arrays of RDO */
+static int enc_check_tune(oapve_param_t *param)
+{
+    for(int i = 0; i < 2; i++) {
+        oapv_assert_rv(TUNE_IN_RANGE(param->deadzone[i], 0, 511), OAPV_ERR_INVALID_ARGUMENT);
+        oapv_assert_rv(TUNE_IN_RANGE(param->rdo_itr[i], 0, 16), OAPV_ERR_INVALID_ARGUMENT);
+        oapv_assert_rv(TUNE_IN_RANGE(param->rdo_adj_rng[i], 1, 15), OAPV_ERR_INVALID_ARGUMENT);
     }
-ERR:
-    return ret;
+    oapv_assert_rv(TUNE_IN_RANGE(param->rdo_max_cand, 1, OAPV_FULL_RDO_MAX_CAND), OAPV_ERR_INVALID_ARGUMENT);
+    oapv_assert_rv(TUNE_IN_RANGE(param->rdo_full_itr, 0, 16), OAPV_ERR_INVALID_ARGUMENT);
+    return OAPV_OK;
 }
 
-static int enc_profile_spec[][5] = {
-    // {profile-idc, cfi-min, cfi-max, bit-depth-min, bit-depth-max}
-    {OAPV_PROFILE_422_10, 2, 2, 10, 10},
-    {OAPV_PROFILE_422_12, 2, 2, 10, 12},
-    {OAPV_PROFILE_444_10, 2, 3, 10, 10},
-    {OAPV_PROFILE_444_12, 2, 3, 10, 12},
-    {OAPV_PROFILE_4444_10, 2, 4, 10, 10},
-    {OAPV_PROFILE_4444_12, 2, 4, 10, 12},
-    {OAPV_PROFILE_400_10, 0, 0, 10, 10},
-    {0, 0, 0, 0, 0} // termination
-};
+static void enc_set_tune(oapve_ctx_t *ctx, oapve_param_t *param)
+{
+    int preset = param->preset;
+
+    // default values of presets
+    ctx->deadzone[0] = TUNE_VAL(param->deadzone[0], preset == OAPV_PRESET_PLACEBO ? OAPV_DEADZONE_Y_FULL_RDO : OAPV_DEADZONE_Y);
+    ctx->deadzone[1] = TUNE_VAL(param->deadzone[1], OAPV_DEADZONE_C);
+    ctx->deadzone_blk[0] = TUNE_VAL(param->deadzone[0], OAPV_DEADZONE_Y);
+    ctx->deadzone_blk[1] = TUNE_VAL(param->deadzone[1], OAPV_DEADZONE_C);
+    ctx->rdo_itr[0] = TUNE_VAL(param->rdo_itr[0], 2);
+    ctx->rdo_itr[1] = TUNE_VAL(param->rdo_itr[1], 1);
+    ctx->rdo_adj_rng[0] = TUNE_VAL(param->rdo_adj_rng[0], 13);
+    ctx->rdo_adj_rng[1] = TUNE_VAL(param->rdo_adj_rng[1], 5);
+    ctx->rdo_max_cand = TUNE_VAL(param->rdo_max_cand, 6);
+    ctx->rdo_full_itr = TUNE_VAL(param->rdo_full_itr, 3);
+}
 
-static int enc_check_profile(int profile_idc, int cfi, int bit_depth)
+/* reconstruction is in the format of input image, except for packed formats
+   having it in planar YCbCr 422 */
+static void enc_rec_prepare(oapve_ctx_t *ctx, oapv_imgb_t *imgb_i, oapv_imgb_t *imgb_r)
 {
-    int idx = 0;
-    while(enc_profile_spec[idx][0] != 0) {
-        if(profile_idc == enc_profile_spec[idx][0]) {
-            if(cfi >= enc_profile_spec[idx][1] && cfi <= enc_profile_spec[idx][2]) { // check cfi
-                if(bit_depth >= enc_profile_spec[idx][3] && bit_depth <= enc_profile_spec[idx][4]) { // check bit-depth
-                    return OAPV_OK;
-                }
-            }
-        }
-        idx++;
+    int cf = OAPV_CS_GET_FORMAT(imgb_i->cs);
+    int packed = (cf == OAPV_CF_UYVY || cf == OAPV_CF_V210);
+
+    for(int c = 0; c < ctx->num_comp; c++) {
+        imgb_r->w[c] = packed ? imgb_i->w[0] >> ctx->comp_sft[c][0] : imgb_i->w[c];
+        imgb_r->h[c] = packed ? imgb_i->h[0] >> ctx->comp_sft[c][1] : imgb_i->h[c];
+        imgb_r->x[c] = packed ? imgb_i->x[0] >> ctx->comp_sft[c][0] : imgb_i->x[c];
+        imgb_r->y[c] = packed ? imgb_i->y[0] >> ctx->comp_sft[c][1] : imgb_i->y[c];
     }
-    return OAPV_ERR_INVALID_PROFILE;
 }
 
 static int enc_frm_prepare(oapve_ctx_t *ctx, oapve_param_t *param, oapv_imgb_t *imgb_i, oapv_imgb_t *imgb_r)
@@ -994,9 +1845,14 @@ static int enc_frm_prepare(oapve_ctx_t *ctx, oapve_param_t *param, oapv_imgb_t *
     oapv_assert_rv(param->w == imgb_i->w[0], OAPV_ERR_INVALID_WIDTH);
     oapv_assert_rv(param->h == imgb_i->h[0], OAPV_ERR_INVALID_HEIGHT);
     oapv_assert_rv((param->qp >= MIN_QUANT && param->qp <= MAX_QUANT(10)) || param->qp == OAPVE_PARAM_QP_AUTO, OAPV_ERR_INVALID_QP);
+    ret = enc_check_tune(param);
+    oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+
+    ret = enc_check_input_format(imgb_i);
+    oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
 
     // check width restriction for 422
-    if(OAPV_CS_GET_FORMAT(imgb_i->cs) == OAPV_CF_YCBCR422 && imgb_i->w[0] & 0x1) {
+    if(color_format_to_chroma_format_idc(OAPV_CS_GET_FORMAT(imgb_i->cs)) == 2 && imgb_i->w[0] & 0x1) {
         return OAPV_ERR_INVALID_WIDTH; // odd width is spec-out in YCbCr422
     }
 
@@ -1013,6 +1869,8 @@ static int enc_frm_prepare(oapve_ctx_t *ctx, oapve_param_t *param, oapv_imgb_t *
     else {
         ctx->fn_enc_blk = enc_block;
     }
+    enc_set_tune(ctx, param);
+
     // set dimensions
     ctx->w = oapv_div_round_up(param->w, OAPV_MB_W) * OAPV_MB_W;
     ctx->h = oapv_div_round_up(param->h, OAPV_MB_H) * OAPV_MB_H;
@@ -1028,7 +1886,8 @@ static int enc_frm_prepare(oapve_ctx_t *ctx, oapve_param_t *param, oapv_imgb_t *
     }
     // color information
     ctx->cfi = color_format_to_chroma_format_idc(OAPV_CS_GET_FORMAT(imgb_i->cs));
-    ctx->bit_depth = OAPV_CS_GET_BIT_DEPTH(imgb_i->cs);
+    ctx->in_bit_depth = OAPV_CS_GET_BIT_DEPTH(imgb_i->cs);
+    ctx->bit_depth = enc_codec_bit_depth(param->profile_idc, ctx->in_bit_depth);
     ctx->num_comp = get_num_comp(ctx->cfi);
 
     // check whether input frame type is suitable to profile definition
@@ -1043,40 +1902,48 @@ static int enc_frm_prepare(oapve_ctx_t *ctx, oapve_param_t *param, oapv_imgb_t *
         ctx->comp_sft[i][1] = get_chroma_sft_h(ctx->cfi);
     }
 
+    // input samples are converted to the bit depth of codec while reading
+    // blocks, so that input image of any supported format is used in place
+    switch(OAPV_CS_GET_FORMAT(imgb_i->cs)) {
+    case OAPV_CF_PLANAR2:
+        for(i = 0; i < 3; i++) {
+            ctx->fn_imgb_to_blk[i] = ctx->fn_imgb_to_blk_p21x[i];
+        }
+        break;
+    case OAPV_CF_UYVY:
+        for(i = 0; i < 3; i++) {
+            ctx->fn_imgb_to_blk[i] = ctx->fn_imgb_to_blk_uyvy[i];
+        }
+        break;
+    case OAPV_CF_V210:
+        for(i = 0; i < 3; i++) {
+            ctx->fn_imgb_to_blk[i] = ctx->fn_imgb_to_blk_v210[i];
+        }
+        break;
+    default:
+        for(i = 0; i < ctx->num_comp; i++) {
+            ctx->fn_imgb_to_blk[i] = (ctx->in_bit_depth == 8) ? ctx->fn_imgb_to_blk_8b : ctx->fn_imgb_to_blk_16b;
+        }
+        break;
+    }
+    if(color_format_is_rgb(OAPV_CS_GET_FORMAT(imgb_i->cs))) {
+        ret = enc_set_rgb_coef(ctx, param);
+        oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+    }
+    // reconstruction of P210 is in the same format, and planar for others
+    for(i = 0; i < ctx->num_comp; i++) {
+        ctx->fn_blk_to_imgb[i] = blk_to_imgb_16;
+    }
     if(OAPV_CS_GET_FORMAT(imgb_i->cs) == OAPV_CF_PLANAR2) {
-        ctx->fn_imgb_to_blk_rc = imgb_to_blk_p21x;
-
-        ctx->fn_imgb_to_blk[Y_C] = imgb_to_blk_p21x_y;
-        ctx->fn_imgb_to_blk[U_C] = imgb_to_blk_p21x_uv;
-        ctx->fn_imgb_to_blk[V_C] = imgb_to_blk_p21x_uv;
-
         ctx->fn_blk_to_imgb[Y_C] = blk_to_imgb_p21x_y;
         ctx->fn_blk_to_imgb[U_C] = blk_to_imgb_p21x_uv;
         ctx->fn_blk_to_imgb[V_C] = blk_to_imgb_p21x_uv;
-        ctx->fn_imgb_pad = imgb_pad_p210;
-    }
-    else {
-        ctx->fn_imgb_to_blk_rc = imgb_to_blk;
-        for(int i = 0; i < ctx->num_comp; i++) {
-            ctx->fn_imgb_to_blk[i] = imgb_to_blk_16;
-            ctx->fn_blk_to_imgb[i] = blk_to_imgb_16;
-        }
-        ctx->fn_imgb_pad = imgb_pad;
     }
-    // padding input picture, if needs
-    ctx->fn_imgb_pad(imgb_i, ctx->w, ctx->h, ctx->comp_sft);
 
     // calculate tile info
     ret = enc_set_tile_info(ctx->tile, ctx->w, ctx->h, param->tile_w, param->tile_h, &ctx->num_tile_cols, &ctx->num_tile_rows, &ctx->num_tiles);
     oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
 
-    // set bitstream buffer for each tile
-    int buf_size = ctx->cdesc.max_bs_buf_size / ctx->num_tiles;
-    ctx->tile[0].bs_buf_max = buf_size;
-    for(i = 1; i < ctx->num_tiles; i++) {
-        ctx->tile[i].bs_buf = ctx->tile[i - 1].bs_buf + buf_size;
-        ctx->tile[i].bs_buf_max = buf_size;
-    }
     // set cores
     for(i = 0; i < ctx->threads; i++) {
         ctx->core[i]->ctx = ctx;
@@ -1084,36 +1951,553 @@ static int enc_frm_prepare(oapve_ctx_t *ctx, oapve_param_t *param, oapv_imgb_t *
     }
     // recontruction picture
     if(imgb_r != NULL) {
-        for(int c = 0; c < ctx->num_comp; c++) {
-            imgb_r->w[c] = imgb_i->w[c];
-            imgb_r->h[c] = imgb_i->h[c];
-            imgb_r->x[c] = imgb_i->x[c];
-            imgb_r->y[c] = imgb_i->y[c];
+        enc_rec_prepare(ctx, imgb_i, imgb_r);
+        ctx->imgb_r = imgb_r;
+        imgb_addref(ctx->imgb_r);
+    }
+    // blocks are reconstructed in encoding loop for reconstructed picture
+    // and quality metric, unless the picture is made by decoding of tiles
+    ctx->rec_in_loop = (imgb_r != NULL) ? !ctx->use_lazy_rec : ctx->use_metric != 0;
+    ctx->metric_in_loop = ctx->use_metric && ctx->rec_in_loop;
+    for(i = 0; i < ctx->num_tiles; i++) {
+        ctx->tile[i].stat = ENC_TILE_STAT_NOT_ENCODED;
+        ctx->tile[i].preset = param->preset;
+    }
+    // average tile encoding time of previous frame is kept as initial guess
+    ctx->tile_clk_sum = 0;
+    ctx->tile_clk_cnt = 0;
+
+    ctx->param = param;
+    ctx->imgb_i = imgb_i;
+    imgb_addref(ctx->imgb_i); // increase reference count of input frame
+    return OAPV_OK;
+}
+
+/* fast frame hash of reconstructions from hash values of tiles */
+static void enc_frm_hash64(oapve_ctx_t *ctx)
+{
+    u64 tile_hash[OAPV_MAX_TILES][N_C];
+
+    for(int i = 0; i < ctx->num_tiles; i++) {
+        oapv_mcpy(tile_hash[i], ctx->tile[i].hash, sizeof(tile_hash[i]));
+    }
+    oapv_imgb_set_hash64(ctx->imgb_r, tile_hash, ctx->num_tiles);
+    for(int r = 0; r < ctx->num_rates; r++) {
+        if(ctx->rate_imgb_r[r] == NULL) {
+            continue;
+        }
+        for(int i = 0; i < ctx->num_tiles; i++) {
+            oapv_mcpy(tile_hash[i], ctx->tile[i].rate[r].hash, sizeof(tile_hash[i]));
+        }
+        oapv_imgb_set_hash64(ctx->rate_imgb_r[r], tile_hash, ctx->num_tiles);
+    }
+}
+
+static int enc_frm_finish(oapve_ctx_t *ctx, oapve_stat_t *stat)
+{
+    imgb_release(ctx->imgb_i);
+    if(ctx->imgb_r) {
+        imgb_release(ctx->imgb_r);
+        ctx->imgb_r = NULL;
+    }
+    return OAPV_OK;
+}
+
+static void enc_bseg_add(oapve_ctx_t *ctx, u8 *addr, int size)
+{
+    if(size > 0) {
+        oapv_assert(ctx->num_bsegs < OAPV_MAX_BS_SEGS);
+        ctx->bsegs[ctx->num_bsegs].addr = addr;
+        ctx->bsegs[ctx->num_bsegs].size = size;
+        ctx->num_bsegs++;
+    }
+}
+
+/* set the frame of next access unit having 'frm_idx' to be analyzed along
+   with the encoding of current frame */
+static void enc_la_start(oapve_ctx_t *ctx, int frm_idx)
+{
+    oapv_imgb_t *imgb;
+
+    if(frm_idx >= ctx->la_num_frms || ctx->la_imgb[frm_idx] == NULL) {
+        return;
+    }
+    imgb = ctx->la_imgb[frm_idx];
+    if(imgb->cs != ctx->imgb_i->cs || imgb->w[0] != ctx->imgb_i->w[0] || imgb->h[0] != ctx->imgb_i->h[0]) {
+        imgb_release(imgb);
+        ctx->la_imgb[frm_idx] = NULL;
+        return;
+    }
+    ctx->la_frm = frm_idx;
+    ctx->la_next = 0;
+    ctx->la_done = 0;
+    ctx->la_err = OAPV_OK;
+}
+
+/* keep the result of analysis set by enc_la_start(); it is dropped when not
+   all tiles are analyzed, as encoding of tiles stopped by an error */
+static int enc_la_finish(oapve_ctx_t *ctx)
+{
+    int i = ctx->la_frm;
+
+    if(i < 0) {
+        return OAPV_OK;
+    }
+    if(ctx->la_res_imgb[i] != NULL) {
+        imgb_release(ctx->la_res_imgb[i]);
+        ctx->la_res_imgb[i] = NULL;
+    }
+    if(ctx->la_done == ctx->num_tiles && OAPV_SUCCEEDED(ctx->la_err)) {
+        // reference is kept until the result is taken, so that the address
+        // cannot be reused by other frame in the meantime
+        ctx->la_res_imgb[i] = ctx->la_imgb[i];
+        ctx->la_res_num_tiles[i] = ctx->num_tiles;
+    }
+    else {
+        imgb_release(ctx->la_imgb[i]);
+    }
+    ctx->la_imgb[i] = NULL;
+    ctx->la_frm = -1;
+    return ctx->la_err;
+}
+
+/* get tile costs of current frame from the result of lookahead, if any */
+static int enc_la_take(oapve_ctx_t *ctx, int frm_idx, u64 *cost_sum)
+{
+    int hit = (ctx->la_res_imgb[frm_idx] == ctx->imgb_i && ctx->la_res_num_tiles[frm_idx] == ctx->num_tiles);
+
+    if(ctx->la_res_imgb[frm_idx] != NULL) {
+        imgb_release(ctx->la_res_imgb[frm_idx]);
+        ctx->la_res_imgb[frm_idx] = NULL;
+    }
+    if(!hit) {
+        return 0;
+    }
+    *cost_sum = 0;
+    for(int i = 0; i < ctx->num_tiles; i++) {
+        ctx->tile[i].rc.cost = ctx->la_cost[frm_idx][i];
+        ctx->tile[i].rc.number_pixel = ctx->la_num_pixel[frm_idx][i];
+        *cost_sum += ctx->tile[i].rc.cost;
+    }
+    return 1;
+}
+
+/* run 'fn' for the tiles not encoded yet, 'num' of them, in parallel */
+static int enc_run_tiles(oapve_ctx_t *ctx, int num, oapv_fn_thread_entry_t fn)
+{
+    oapv_tpool_t *tpool = ctx->tpool;
+    int           ret, res, tidx = 0, thread_num1 = 0;
+    int           parallel_task = (ctx->threads > num) ? num : ctx->threads;
+
+    for(tidx = 0; tidx < (parallel_task - 1); tidx++) {
+        tpool->run(ctx->thread_id[tidx], fn, (void *)ctx->core[tidx]);
+    }
+    ret = fn((void *)ctx->core[tidx]);
+
+    for(thread_num1 = 0; thread_num1 < parallel_task - 1; thread_num1++) {
+        int ret_t = OAPV_OK;
+        res = tpool->join(ctx->thread_id[thread_num1], &ret_t);
+        if(res != TPOOL_SUCCESS) {
+            ret = OAPV_ERR_FAILED_SYSCALL;
+        }
+        else if(OAPV_FAILED(ret_t) && OAPV_SUCCEEDED(ret)) {
+            ret = ret_t;
+        }
+    }
+    return ret;
+}
+
+/* estimate byte size of a tile from the blocks quantized by enc_block(), as
+   'fast' preset does, without writing bitstream */
+static int enc_tile_rate(oapve_ctx_t *ctx, oapve_core_t *core, oapve_tile_t *tile)
+{
+    int qp = enc_tile_qp(ctx, tile);
+    int size = OAPV_TILE_SIZE_LEN + 5 + ctx->num_comp * 5; // tile_size and tile header
+
+    for(int c = 0; c < ctx->num_comp; c++) {
+        int  bits = 0;
+        int  tile_le = tile->x >> ctx->comp_sft[c][0];
+        int  tile_ri = (tile->w >> ctx->comp_sft[c][0]) + tile_le;
+        int  tile_to = tile->y >> ctx->comp_sft[c][1];
+        int  tile_bo = (tile->h >> ctx->comp_sft[c][1]) + tile_to;
+
+        enc_core_set_qp(ctx, core, c, oapv_clip3(MIN_QUANT, MAX_QUANT(10), qp + ctx->qp_offset[c]));
+        core->kparam_dc[c] = OAPV_KPARAM_DC_MAX;
+        core->kparam_ac[c] = OAPV_KPARAM_AC_MIN;
+        core->prev_dc[c] = 0;
+
+        // blocks are in the same order as in enc_tile_comp()
+        int mb_w = OAPV_MB_W >> ctx->comp_sft[c][0];
+        int mb_h = OAPV_MB_H >> ctx->comp_sft[c][1];
+        for(int mb_y = tile_to; mb_y < tile_bo; mb_y += mb_h) {
+            for(int mb_x = tile_le; mb_x < tile_ri; mb_x += mb_w) {
+                for(int blk_y = mb_y; blk_y < (mb_y + mb_h); blk_y += OAPV_BLK_H) {
+                    for(int blk_x = mb_x; blk_x < (mb_x + mb_w); blk_x += OAPV_BLK_W) {
+                        enc_imgb_to_blk(ctx, c, blk_x, blk_y, core->coef);
+                        oapv_trans(ctx, core->coef, OAPV_LOG2_BLK_W, OAPV_LOG2_BLK_H, ctx->bit_depth);
+                        ctx->fn_quant[0](core->coef, core->qp[c], core->q_mat_enc[c], OAPV_LOG2_BLK_W, OAPV_LOG2_BLK_H, ctx->bit_depth, ctx->deadzone[c ? 1 : 0]);
+                        bits += oapve_vlc_get_coef_rate(core, core->coef, c);
+
+                        // update contexts as oapve_vlc_dc_coef() and oapve_vlc_ac_coef() do
+                        int dc_diff = oapv_abs32(core->coef[0] - core->prev_dc[c]);
+                        core->kparam_dc[c] = dc_diff ? KPARAM_DC(dc_diff) : OAPV_KPARAM_DC_MIN;
+                        core->prev_dc[c] = core->coef[0];
+                        for(int i = 1; i < OAPV_BLK_D; i++) {
+                            if(core->coef[oapv_tbl_scan[i]]) {
+                                core->kparam_ac[c] = KPARAM_AC(oapv_abs16(core->coef[oapv_tbl_scan[i]]));
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        size += (bits + 7) >> 3;
+    }
+    return size;
+}
+
+static int enc_thread_tile_rate(void *arg)
+{
+    oapve_core_t *core = (oapve_core_t *)arg;
+    oapve_ctx_t  *ctx = core->ctx;
+    oapve_tile_t *tile = ctx->tile;
+    int           i, tidx = 0;
+
+    while(1) {
+        oapv_tpool_enter_cs(ctx->sync_obj);
+        for(i = 0; i < ctx->num_tiles; i++) {
+            if(tile[i].stat == ENC_TILE_STAT_NOT_ENCODED) {
+                tile[i].stat = ENC_TILE_STAT_ON_ENCODING;
+                tidx = i;
+                break;
+            }
+        }
+        oapv_tpool_leave_cs(ctx->sync_obj);
+        if(i == ctx->num_tiles) {
+            break;
+        }
+        tile[tidx].rate_est = enc_tile_rate(ctx, core, &tile[tidx]);
+
+        oapv_tpool_enter_cs(ctx->sync_obj);
+        tile[tidx].stat = ENC_TILE_STAT_ENCODED;
+        oapv_tpool_leave_cs(ctx->sync_obj);
+    }
+    return OAPV_OK;
+}
+
+/* estimated byte size of all tiles, when QP of every tile is increased by 'dqp' */
+static int enc_dry_run(oapve_ctx_t *ctx, int dqp, int *size)
+{
+    int ret;
+
+    for(int i = 0; i < ctx->num_tiles; i++) {
+        ctx->tile[i].dqp_fit = dqp;
+        ctx->tile[i].stat = ENC_TILE_STAT_NOT_ENCODED;
+    }
+    ret = enc_run_tiles(ctx, ctx->num_tiles, enc_thread_tile_rate);
+    oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+
+    *size = 0;
+    for(int i = 0; i < ctx->num_tiles; i++) {
+        *size += ctx->tile[i].rate_est;
+        ctx->tile[i].stat = ENC_TILE_STAT_NOT_ENCODED;
+    }
+    return OAPV_OK;
+}
+
+/* find the least QP increase, the same for every tile, to fit the tiles into
+   'limit' bytes by dry runs, which starts from the increase guessed by the
+   rate of no increase.
+   the sizes of dry runs are approximate (see enc_tile_rate()), so the limit
+   is kept by enc_fit_tiles() after the real encoding */
+static int enc_dry_run_fit(oapve_ctx_t *ctx, int limit)
+{
+    int size, lo = 0, hi = MAX_QUANT(10), mid, ret;
+
+    ret = enc_dry_run(ctx, 0, &size);
+    oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+    if(size > limit) {
+        // bits are roughly halved by every 6 of QP
+        mid = (limit <= 0) ? hi : oapv_clip3(1, hi, (int)ceil(6 * log2((double)size / limit)));
+        while(hi - lo > 1) {
+            ret = enc_dry_run(ctx, mid, &size);
+            oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+            if(size > limit) {
+                lo = mid;
+            }
+            else {
+                hi = mid;
+            }
+            mid = (lo + hi) >> 1;
+        }
+        lo = hi;
+    }
+    for(int i = 0; i < ctx->num_tiles; i++) {
+        ctx->tile[i].dqp_fit = lo;
+    }
+    return OAPV_OK;
+}
+
+/* fit frame header and tiles into 'limit' bytes by re-encoding the tiles
+   exceeding their share of the frame with higher QP. the share is given by
+   complexity in case of rate control, otherwise by size. when no tile over
+   its share can take higher QP, every tile below the highest QP is raised
+   by the same increase of the whole excess.
+   QP increase halving the bits starts from 6 and is updated by the sizes of
+   every round. 'fit_over' is set, if the frame is still over the limit after
+   OAPV_ENC_FIT_MAX_ITR rounds */
+static int enc_fit_tiles(oapve_ctx_t *ctx, int fh_size, u64 cost_sum, int limit)
+{
+    oapve_tile_t *tile = ctx->tile;
+    int           bs_size[OAPV_MAX_TILES];
+    u8            re[OAPV_MAX_TILES] = {0}; // re-encoded in last round
+    double        qp_half = 6, dqp_sum = 0;
+    s64           size_prev = 0;
+    int           i, size, num, ret;
+
+    for(int itr = 0;; itr++) {
+        s64 size_re = 0;
+        size = fh_size;
+        for(i = 0; i < ctx->num_tiles; i++) {
+            size += tile[i].bs_size;
+            if(re[i]) {
+                size_re += tile[i].bs_size;
+            }
+        }
+        if(size_prev > size_re && size_re > 0) {
+            qp_half = oapv_clip3(6.0, 24.0, dqp_sum / size_prev / log2((double)size_prev / size_re));
+        }
+        if(size <= limit) {
+            break;
+        }
+        if(itr == OAPV_ENC_FIT_MAX_ITR) {
+            ctx->fit_over = 1;
+            break;
+        }
+        for(i = 0; i < ctx->num_tiles; i++) {
+            bs_size[i] = tile[i].bs_size;
+            re[i] = 0;
+        }
+        num = 0;
+        dqp_sum = 0;
+        size_prev = 0;
+        for(i = 0; i < ctx->num_tiles; i++) {
+            double share = (double)(limit - fh_size);
+            share *= cost_sum ? tile[i].rc.cost / cost_sum : (double)bs_size[i] / (size - fh_size);
+            if(bs_size[i] > share && tile[i].th.tile_qp[Y_C] < MAX_QUANT(10)) {
+                int dqp = (share < 1) ? 12 : (int)ceil(qp_half * log2(bs_size[i] / share));
+                dqp = oapv_clip3(1, 12, dqp);
+                tile[i].dqp_fit += dqp;
+                tile[i].stat = ENC_TILE_STAT_NOT_ENCODED;
+                re[i] = 1;
+                dqp_sum += (double)dqp * bs_size[i];
+                size_prev += bs_size[i];
+                num++;
+            }
+        }
+        if(num == 0) {
+            double ratio = (double)(size - fh_size) / oapv_max(1, limit - fh_size);
+            int    dqp = oapv_clip3(1, 12, (int)ceil(qp_half * log2(ratio)));
+            for(i = 0; i < ctx->num_tiles; i++) {
+                if(tile[i].th.tile_qp[Y_C] < MAX_QUANT(10)) {
+                    tile[i].dqp_fit += dqp;
+                    tile[i].stat = ENC_TILE_STAT_NOT_ENCODED;
+                    re[i] = 1;
+                    dqp_sum += (double)dqp * bs_size[i];
+                    size_prev += bs_size[i];
+                    num++;
+                }
+            }
+        }
+        if(num == 0) {
+            ctx->fit_over = 1; // no room to lower the rate anymore
+            break;
+        }
+        ret = enc_run_tiles(ctx, num, enc_thread_tile);
+        oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+    }
+    return OAPV_OK;
+}
+
+/* QP increase of constant bitrate for next frame. it is the average increase
+   of tiles when re-encoding was needed, otherwise it is lowered if the size
+   of tiles allows; bits are roughly halved by every 6 of QP */
+static int enc_fit_seed(oapve_ctx_t *ctx, int seed, int size, int limit)
+{
+    int i, sum = 0;
+
+    for(i = 0; i < ctx->num_tiles; i++) {
+        sum += ctx->tile[i].dqp_fit;
+    }
+    if(sum > seed * ctx->num_tiles) {
+        return sum / ctx->num_tiles;
+    }
+    if(size > 0 && limit > 0) {
+        seed += (int)ceil(6 * log2((double)size / limit));
+    }
+    return oapv_clip3(0, MAX_QUANT(10), seed);
+}
+
+/* keep tiles of current frame to be reused by the frame of next access unit */
+static int enc_reuse_store(oapve_ctx_t *ctx, int frm_idx)
+{
+    oapve_reuse_t *ru = &ctx->reuse[frm_idx];
+    oapve_tile_t  *tile = ctx->tile;
+    int            i, size = 0, src_kept;
+
+    ru->valid = 0;
+    for(i = 0; i < ctx->num_tiles; i++) {
+        size += tile[i].bs_size;
+    }
+    if(size > ru->bs_max) {
+        oapv_mfree(ru->bs);
+        ru->bs_max = 0;
+        ru->bs = (u8 *)oapv_malloc(size);
+        oapv_assert_rv(ru->bs != NULL, OAPV_ERR_OUT_OF_MEMORY);
+        ru->bs_max = size;
+    }
+    for(i = 0, size = 0; i < ctx->num_tiles; i++) {
+        ru->src_ofs[i] = size;
+        size += enc_tile_src(ctx, &tile[i], NULL, 0);
+    }
+    src_kept = (size <= ru->src_max);
+    if(!src_kept) {
+        oapv_mfree(ru->src);
+        ru->src_max = 0;
+        ru->src = (u8 *)oapv_malloc(size);
+        oapv_assert_rv(ru->src != NULL, OAPV_ERR_OUT_OF_MEMORY);
+        ru->src_max = size;
+    }
+    for(i = 0, size = 0; i < ctx->num_tiles; i++) {
+        if(!tile[i].reused || !src_kept) { // kept source of reused tile is the same
+            enc_tile_src(ctx, &tile[i], ru->src + ru->src_ofs[i], 0);
+        }
+        oapv_mcpy(&ru->th[i], &tile[i].th, sizeof(oapv_th_t));
+        ru->bs_ofs[i] = size;
+        ru->bs_size[i] = tile[i].bs_size;
+        oapv_mcpy(&ru->metric[i], &tile[i].metric, sizeof(oapve_metric_t));
+        oapv_mcpy(ru->bs + size, tile[i].bs_buf, tile[i].bs_size);
+        size += tile[i].bs_size;
+    }
+    if(ru->imgb_r != ctx->imgb_r) {
+        if(ru->imgb_r != NULL) {
+            imgb_release(ru->imgb_r);
+        }
+        ru->imgb_r = ctx->imgb_r;
+        if(ru->imgb_r != NULL) {
+            imgb_addref(ru->imgb_r);
+        }
+    }
+    ru->cs = ctx->imgb_i->cs;
+    ru->w = ctx->w;
+    ru->h = ctx->h;
+    ru->tile_w = ctx->fh.tile_width_in_mbs;
+    ru->tile_h = ctx->fh.tile_height_in_mbs;
+    ru->num_tiles = ctx->num_tiles;
+    oapv_mcpy(ru->q_matrix, ctx->fh.q_matrix, sizeof(ru->q_matrix));
+    ru->valid = 1;
+    return OAPV_OK;
+}
+
+/* tiles of previous access unit, if they can be reused in current frame */
+static oapve_reuse_t *enc_reuse_get(oapve_ctx_t *ctx, int frm_idx)
+{
+    oapve_reuse_t *ru = &ctx->reuse[frm_idx];
+
+    if(!ctx->use_tile_reuse || ctx->num_rates > 0 || !ru->valid || ru->cs != ctx->imgb_i->cs || ru->w != ctx->w || ru->h != ctx->h ||
+       ru->tile_w != ctx->fh.tile_width_in_mbs || ru->tile_h != ctx->fh.tile_height_in_mbs || ru->num_tiles != ctx->num_tiles ||
+       (ctx->imgb_r != NULL && ru->imgb_r == NULL) || memcmp(ru->q_matrix, ctx->fh.q_matrix, sizeof(ru->q_matrix))) {
+        return NULL;
+    }
+    return ru;
+}
+
+/* QPs of tiles of additional rates; complexity of tiles is analyzed here,
+   if it is not done for the primary output */
+static void enc_rate_set_qp(oapve_ctx_t *ctx, u64 *cost_sum)
+{
+    double fps = (double)ctx->param->fps_num / ctx->param->fps_den;
+
+    for(int r = 0; r < ctx->num_rates; r++) {
+        oapve_rate_t     *rate = &ctx->rates[r];
+        oapve_rc_param_t *rc = &ctx->rate_rc[r];
+
+        if(rate->bitrate <= 0) {
+            for(int i = 0; i < ctx->num_tiles; i++) {
+                ctx->tile[i].rate[r].qp = rate->qp;
+            }
+            continue;
+        }
+        if(ctx->param->rc_type == OAPV_RC_CQP && *cost_sum == 0) {
+            oapve_rc_get_tile_cost_thread(ctx, cost_sum);
+        }
+        double bits_pic = ((double)rate->bitrate * 1000) / fps;
+        rc->lambda = oapve_rc_estimate_pic_lambda(ctx, rc, rate->bitrate, *cost_sum);
+        rc->qp = oapve_rc_estimate_pic_qp(rc->lambda);
+        for(int i = 0; i < ctx->num_tiles; i++) {
+            int qp;
+            oapve_rc_get_qp(ctx, rc, &ctx->tile[i], bits_pic * ctx->tile[i].rc.cost / *cost_sum, rc->qp, &qp);
+            ctx->tile[i].rate[r].qp = qp;
         }
-        ctx->imgb_r = imgb_r;
-        imgb_addref(ctx->imgb_r);
-    }
-    for(i = 0; i < ctx->num_tiles; i++) {
-        ctx->tile[i].stat = ENC_TILE_STAT_NOT_ENCODED;
     }
+}
 
-    ctx->param = param;
-    ctx->imgb_i = imgb_i;
-    imgb_addref(ctx->imgb_i); // increase reference count of input frame
-    return OAPV_OK;
+static double enc_psnr(u64 ssd, int num_pix, int bit_depth)
+{
+    // peak value scaled from 8-bit, as oapv_app_enc has measured
+    double peak = 255.0 * (1 << (bit_depth - 8));
+    double mse = (num_pix > 0) ? (double)ssd / num_pix : 0;
+    return (mse == 0.0) ? 100.0 : 10 * log10(peak * peak / mse);
 }
 
-static int enc_frm_finish(oapve_ctx_t *ctx, oapve_stat_t *stat)
+/* clear encoding status except the tile status buffers given by caller */
+static void enc_stat_init(oapve_stat_t *stat)
 {
-    imgb_release(ctx->imgb_i);
-    if(ctx->imgb_r) {
-        imgb_release(ctx->imgb_r);
-        ctx->imgb_r = NULL;
+    oapve_tile_stat_t *tile[OAPV_MAX_NUM_FRAMES];
+    int                tile_max = stat->tile_max;
+
+    oapv_mcpy(tile, stat->tile, sizeof(tile));
+    oapv_mset(stat, 0, sizeof(oapve_stat_t));
+    oapv_mcpy(stat->tile, tile, sizeof(tile));
+    stat->tile_max = tile_max;
+}
+
+/* status of tile 'tile_idx' of frame 'frm_idx'; NULL if not requested */
+static oapve_tile_stat_t *enc_tile_stat(oapve_stat_t *stat, int frm_idx, int tile_idx)
+{
+    if(stat->tile[frm_idx] == NULL || tile_idx >= stat->tile_max) {
+        return NULL;
+    }
+    return &stat->tile[frm_idx][tile_idx];
+}
+
+/* PSNR and SSIM of frame 'frm_idx' and its tiles in [tile_beg, tile_end) */
+static void enc_metric_stat(oapve_ctx_t *ctx, oapve_stat_t *stat, int frm_idx, int tile_beg, int tile_end)
+{
+    for(int c = 0; c < ctx->num_comp; c++) {
+        u64    ssd = 0;
+        int    num_pix = 0, num_win = 0;
+        double ssim = 0;
+
+        for(int i = tile_beg; i < tile_end; i++) {
+            oapve_metric_t    *m = &ctx->tile[i].metric;
+            oapve_tile_stat_t *ts = enc_tile_stat(stat, frm_idx, i);
+            if(ts != NULL) {
+                ts->psnr[c] = (float)enc_psnr(m->ssd[c], m->num_pix[c], ctx->bit_depth);
+                ts->ssim[c] = m->num_win[c] ? (float)(m->ssim[c] / m->num_win[c]) : 0;
+            }
+            ssd += m->ssd[c];
+            num_pix += m->num_pix[c];
+            ssim += m->ssim[c];
+            num_win += m->num_win[c];
+        }
+        stat->psnr[frm_idx][c] = enc_psnr(ssd, num_pix, ctx->bit_depth);
+        stat->ssim[frm_idx][c] = num_win ? ssim / num_win : 0;
     }
-    return OAPV_OK;
 }
 
-static int enc_frame(oapve_ctx_t *ctx, oapv_bs_t *bs)
+static int enc_frame(oapve_ctx_t *ctx, oapv_bs_t *bs, int frm_idx)
 {
     int        ret = OAPV_OK;
 
@@ -1122,15 +2506,22 @@ static int enc_frame(oapve_ctx_t *ctx, oapv_bs_t *bs)
 
     /* write frame header */
     oapve_set_frame_header(ctx, &ctx->fh);
-    oapve_vlc_frame_header(bs, ctx, &ctx->fh);
+    oapve_vlc_frame_header(bs, &ctx->fh);
 
     /* de-init BSW */
     oapv_bsw_deinit(bs);
+    ctx->stream_fh_end = bs->cur;
+    ctx->stream_tile = 0;
 
     /* rc init */
     u64 cost_sum = 0;
     if(ctx->param->rc_type != OAPV_RC_CQP) {
-        oapve_rc_get_tile_cost_thread(ctx, &cost_sum);
+        int la_hit = enc_la_take(ctx, frm_idx, &cost_sum);
+        // analysis of next access unit goes along with encoding of this frame
+        enc_la_start(ctx, frm_idx);
+        if(!la_hit) {
+            oapve_rc_get_tile_cost_thread(ctx, &cost_sum);
+        }
 
         double bits_pic = ((double)ctx->param->bitrate * 1000) / ((double)ctx->param->fps_num / ctx->param->fps_den);
         for(int i = 0; i < ctx->num_tiles; i++) {
@@ -1138,7 +2529,7 @@ static int enc_frame(oapve_ctx_t *ctx, oapv_bs_t *bs)
             ctx->tile[i].rc.target_bits = ctx->tile[i].rc.target_bits_left;
         }
 
-        ctx->rc_param.lambda = oapve_rc_estimate_pic_lambda(ctx, cost_sum);
+        ctx->rc_param.lambda = oapve_rc_estimate_pic_lambda(ctx, &ctx->rc_param, ctx->param->bitrate, cost_sum);
         if (ctx->param->qp == OAPVE_PARAM_QP_AUTO || ctx->rc_param.is_updated != 0) {
             ctx->rc_param.qp = oapve_rc_estimate_pic_qp(ctx->rc_param.lambda);
         }
@@ -1150,44 +2541,107 @@ static int enc_frame(oapve_ctx_t *ctx, oapv_bs_t *bs)
             ctx->qp[c] = oapv_clip3(MIN_QUANT, MAX_QUANT(10), ctx->rc_param.qp + ctx->qp_offset[c]);
         }
     }
+    enc_rate_set_qp(ctx, &cost_sum);
 
-    oapv_tpool_t *tpool = ctx->tpool;
-    int           res, tidx = 0, thread_num1 = 0;
-    int           parallel_task = (ctx->threads > ctx->num_tiles) ? ctx->num_tiles : ctx->threads;
+    /* size limit of frame header and tiles */
+    int fh_size = (int)(ctx->stream_fh_end - bs_fh.cur);
+    ctx->cbr = ctx->param->use_filler && ctx->param->rc_type == OAPV_RC_ABR;
+    ctx->fit_limit = 0;
+    if(ctx->cbr) {
+        double bits_pic = ((double)ctx->param->bitrate * 1000) / ((double)ctx->param->fps_num / ctx->param->fps_den);
+        ctx->cbr_frm_bytes = (int)(bits_pic / 8);
+        ctx->fit_limit = ctx->cbr_frm_bytes - 8 /* pbu_size and pbu_header */ - OAPV_ENC_FILLER_PBU_MIN - ctx->cbr_md_size;
+    }
+    if(ctx->frm_size_max > 0) {
+        int limit = ctx->frm_size_max - 8 /* pbu_size and pbu_header */;
+        ctx->fit_limit = (ctx->fit_limit > 0) ? oapv_min(ctx->fit_limit, limit) : limit;
+    }
+    // QP of rate control can be too low for the size of constant bitrate,
+    // so it starts from the increase which previous frame needed
+    int fit_seed = ctx->cbr ? ctx->fit_seed[frm_idx] : 0;
+    for(int i = 0; i < ctx->num_tiles; i++) {
+        ctx->tile[i].dqp_fit = fit_seed;
+        ctx->tile[i].reused = 0;
+    }
+    ctx->reuse_ref = enc_reuse_get(ctx, frm_idx);
+    ctx->fit_over = 0;
+    if(ctx->frm_size_max > 0) {
+        ret = enc_dry_run_fit(ctx, ctx->fit_limit - fh_size);
+        oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
+    }
 
     /* encode tiles ************************************/
-    for(tidx = 0; tidx < (parallel_task - 1); tidx++) {
-        tpool->run(ctx->thread_id[tidx], enc_thread_tile,
-                   (void *)ctx->core[tidx]);
-    }
-    ret = enc_thread_tile((void *)ctx->core[tidx]);
+    ret = enc_run_tiles(ctx, ctx->num_tiles, enc_thread_tile);
+    oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
+    /****************************************************/
+    ret = enc_la_finish(ctx);
     oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
 
-    for(thread_num1 = 0; thread_num1 < parallel_task - 1; thread_num1++) {
-        res = tpool->join(ctx->thread_id[thread_num1], &ret);
-        oapv_assert_gv(res == TPOOL_SUCCESS, ret, OAPV_ERR_FAILED_SYSCALL, ERR);
+    if(ctx->fit_limit > 0) {
+        int size = 0;
+        for(int i = 0; i < ctx->num_tiles; i++) {
+            size += ctx->tile[i].bs_size;
+        }
+        // re-encode tiles, if the real size is still over the limit
+        ret = enc_fit_tiles(ctx, fh_size, cost_sum, ctx->fit_limit);
+        oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
+        if(ctx->cbr && ctx->frm_size_max <= 0) {
+            ctx->fit_seed[frm_idx] = enc_fit_seed(ctx, fit_seed, size, ctx->fit_limit - fh_size);
+        }
+        ret = enc_stream_tiles(ctx);
+        oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
+        if(enc_rec_lazy(ctx)) {
+            // tiles are reconstructed after the last re-encoding
+            ret = enc_run_tiles(ctx, ctx->num_tiles, enc_thread_tile_rec);
+            oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
+        }
+    }
+    if(ctx->use_tile_reuse) {
+        ret = enc_reuse_store(ctx, frm_idx);
         oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
     }
-    /****************************************************/
 
-    for(int i = 0; i < ctx->num_tiles; i++) {
-        oapv_mcpy(bs->cur, ctx->tile[i].bs_buf, ctx->tile[i].bs_size);
-        bs->cur = bs->cur + ctx->tile[i].bs_size;
-        ctx->fh.tile_size[i] = ctx->tile[i].bs_size - OAPV_TILE_SIZE_LEN;
+    if(ctx->bs_scatter_frm) {
+        // tile bitstreams are referenced as segments without copy
+        enc_bseg_add(ctx, ctx->bseg_beg, (int)(bs->cur - ctx->bseg_beg));
+        for(int i = 0; i < ctx->num_tiles; i++) {
+            enc_bseg_add(ctx, ctx->tile[i].bs_buf, ctx->tile[i].bs_size);
+            ctx->bs_ext_size += ctx->tile[i].bs_size;
+            ctx->fh.tile_size[i] = ctx->tile[i].bs_size - OAPV_TILE_SIZE_LEN;
+        }
+        ctx->bseg_beg = bs->cur;
+    }
+    else {
+        for(int i = 0; i < ctx->num_tiles; i++) {
+            oapv_mcpy(bs->cur, ctx->tile[i].bs_buf, ctx->tile[i].bs_size);
+            bs->cur = bs->cur + ctx->tile[i].bs_size;
+            ctx->fh.tile_size[i] = ctx->tile[i].bs_size - OAPV_TILE_SIZE_LEN;
+        }
     }
+    ctx->stream_pos = bs->cur; // tiles were streamed already
 
     /* rewrite frame header */
     if(ctx->fh.tile_size_present_in_fh_flag) {
-        oapve_vlc_frame_header(&bs_fh, ctx, &ctx->fh);
+        oapve_vlc_frame_header(&bs_fh, &ctx->fh);
         /* de-init BSW */
         oapv_bsw_sink(&bs_fh);
     }
     if(ctx->param->rc_type != 0) {
-        oapve_rc_update_after_pic(ctx, cost_sum);
+        oapve_rc_update_after_pic(ctx, &ctx->rc_param, ctx->param->bitrate, ctx->fh.tile_size, cost_sum);
+    }
+    for(int r = 0; r < ctx->num_rates; r++) {
+        if(ctx->rates[r].bitrate > 0) {
+            u32 tile_size[OAPV_MAX_TILES];
+            for(int i = 0; i < ctx->num_tiles; i++) {
+                tile_size[i] = ctx->tile[i].rate[r].bs_size - OAPV_TILE_SIZE_LEN;
+            }
+            oapve_rc_update_after_pic(ctx, &ctx->rate_rc[r], ctx->rates[r].bitrate, tile_size, cost_sum);
+        }
     }
     return ret;
 
 ERR:
+    enc_la_finish(ctx);
     return ret;
 }
 
@@ -1203,11 +2657,17 @@ static int enc_platform_init(oapve_ctx_t *ctx)
     ctx->fn_txb = oapv_tbl_fn_tx;
     ctx->fn_quant = oapv_tbl_fn_quant;
     ctx->fn_dquant = oapv_tbl_fn_dquant;
-    ctx->fn_had8x8 = oapv_dc_removed_had8x8;
+    ctx->fn_had8x8_row = oapv_had8x8_row;
+    ctx->fn_imgb_to_blk_16b = oapv_imgb_to_blk_16;
+    ctx->fn_imgb_to_blk_8b = oapv_imgb_to_blk_8;
+    ctx->fn_imgb_to_blk_p21x = oapv_tbl_fn_imgb_to_blk_p21x;
+    ctx->fn_imgb_to_blk_uyvy = oapv_tbl_fn_imgb_to_blk_uyvy;
+    ctx->fn_imgb_to_blk_v210 = oapv_tbl_fn_imgb_to_blk_v210;
+    ctx->fn_rgb_to_blk = oapv_rgb_to_blk;
 #if X86_SSE
     int check_cpu, support_sse, support_avx2;
 
-    check_cpu = oapv_check_cpu_info_x86();
+    check_cpu = oapv_check_cpu_info_x86() & oapv_simd_caps_mask_x86(ctx->cdesc.simd);
     support_sse = (check_cpu >> 0) & 1;
     support_avx2 = (check_cpu >> 2) & 1;
 
@@ -1221,20 +2681,31 @@ static int enc_platform_init(oapve_ctx_t *ctx)
         ctx->fn_txb = oapv_tbl_fn_txb_avx;
         ctx->fn_quant = oapv_tbl_fn_quant_avx;
         ctx->fn_dquant = oapv_tbl_fn_dquant_avx;
-        ctx->fn_had8x8 = oapv_dc_removed_had8x8_sse;
+        ctx->fn_had8x8_row = oapv_had8x8_row_avx;
+        ctx->fn_rgb_to_blk = oapv_rgb_to_blk_avx;
     }
     else if(support_sse) {
         ctx->fn_ssd = oapv_tbl_fn_ssd_16b_sse;
-        ctx->fn_had8x8 = oapv_dc_removed_had8x8_sse;
+        ctx->fn_had8x8_row = oapv_had8x8_row_sse;
+        ctx->fn_rgb_to_blk = oapv_rgb_to_blk_sse;
+    }
+    if(support_sse) {
+        ctx->fn_imgb_to_blk_16b = oapv_imgb_to_blk_16_sse;
+        ctx->fn_imgb_to_blk_8b = oapv_imgb_to_blk_8_sse;
+        ctx->fn_imgb_to_blk_p21x = oapv_tbl_fn_imgb_to_blk_p21x_sse;
+        ctx->fn_imgb_to_blk_uyvy = oapv_tbl_fn_imgb_to_blk_uyvy_sse;
+        ctx->fn_imgb_to_blk_v210 = oapv_tbl_fn_imgb_to_blk_v210_sse;
     }
 #elif ARM_NEON
-    ctx->fn_sad = oapv_tbl_fn_sad_16b_neon;
-    ctx->fn_ssd = oapv_tbl_fn_ssd_16b_neon;
-    ctx->fn_diff = oapv_tbl_fn_diff_16b_neon;
-    ctx->fn_itx = oapv_tbl_fn_itx_neon;
-    ctx->fn_txb = oapv_tbl_fn_txb_neon;
-    ctx->fn_quant = oapv_tbl_fn_quant_neon;
-    ctx->fn_had8x8 = oapv_dc_removed_had8x8;
+    if(ctx->cdesc.simd != OAPV_CDESC_SIMD_NONE) {
+        ctx->fn_sad = oapv_tbl_fn_sad_16b_neon;
+        ctx->fn_ssd = oapv_tbl_fn_ssd_16b_neon;
+        ctx->fn_diff = oapv_tbl_fn_diff_16b_neon;
+        ctx->fn_itx = oapv_tbl_fn_itx_neon;
+        ctx->fn_txb = oapv_tbl_fn_txb_neon;
+        ctx->fn_quant = oapv_tbl_fn_quant_neon;
+        // no NEON version of fn_had8x8_row; C one is used
+    }
 #endif
     return OAPV_OK;
 }
@@ -1288,104 +2759,587 @@ void oapve_delete(oapve_t eid)
     enc_ctx_free(ctx);
 }
 
-int oapve_encode(oapve_t eid, oapv_frms_t *ifrms, oapvm_t mid, oapv_bitb_t *bitb, oapve_stat_t *stat, oapv_frms_t *rfrms)
+int oapve_lookahead(oapve_t eid, oapv_frms_t *ifrms)
 {
-    oapv_bs_t    bsw;
     oapve_ctx_t *ctx;
-    oapv_frm_t  *frm;
-    oapv_bs_t   *bs, bs_pbu_beg;
-    int          i, ret;
-    u8          *bs_pos_pbu_beg, *bs_pos_au_beg;
 
     ctx = enc_id_to_ctx(eid);
-    oapv_assert_rv(ctx != NULL && bitb->addr && bitb->bsize > 0, OAPV_ERR_INVALID_ARGUMENT);
+    oapv_assert_rv(ctx != NULL && ifrms != NULL && ifrms->num_frms <= OAPV_MAX_NUM_FRAMES, OAPV_ERR_INVALID_ARGUMENT);
 
-    bs = &bsw;
+    // frames not analyzed yet are dropped
+    enc_la_clear(ctx);
+    if(ctx->cdesc.param[0].rc_type == OAPV_RC_CQP) {
+        return OAPV_OK; // complexity is not used
+    }
+    for(int i = 0; i < ifrms->num_frms; i++) {
+        ctx->la_imgb[i] = ifrms->frm[i].imgb;
+        imgb_addref(ctx->la_imgb[i]);
+    }
+    ctx->la_num_frms = ifrms->num_frms;
+    return OAPV_OK;
+}
 
-    oapv_bsw_init(bs, bitb->addr, bitb->bsize, NULL);
-    oapv_mset(stat, 0, sizeof(oapve_stat_t));
+/* byte size of metadata PBUs to be written after 'num_frms' frames; frame
+   hash is counted as a new metadata PBU for each frame in worst case */
+static int enc_md_size(oapve_ctx_t *ctx, oapvm_ctx_t *md_list, int num_frms)
+{
+    int size = 0;
+
+    if(md_list != NULL) {
+        for(int i = 0; i < md_list->num; i++) {
+            size += 8 + 4; // pbu_size, pbu_header and metadata_size
+            for(oapv_mdp_t *mdp = md_list->md_arr[i].md_payload; mdp != NULL; mdp = mdp->next) {
+                size += (mdp->pld_type / 255 + 1) + (mdp->pld_size / 255 + 1) + mdp->pld_size;
+            }
+        }
+    }
+    if(ctx->use_frm_hash) {
+        size += num_frms * (8 + 4 + 2 + 16 * (OAPV_MAX_CC + 1));
+    }
+    return size;
+}
 
-    bs_pos_au_beg = oapv_bsw_sink(bs);
+/* write filler PBU padding 'filler_size' bytes of payload; nothing when negative */
+static int enc_filler_write(oapv_bs_t *bs, int filler_size)
+{
+    if(filler_size < 0) {
+        return OAPV_OK;
+    }
+    // bit writer flushes 4 bytes beyond 'cur' at once
+    oapv_assert_rv(bs->end - bs->cur >= filler_size + 8 + 4, OAPV_ERR_OUT_OF_BS_BUF);
+    oapve_vlc_pbu_size(bs, filler_size + 4);
+    oapve_vlc_pbu_header(bs, OAPV_PBU_TYPE_FILLER, 0);
+    return oapve_vlc_filler(bs, filler_size);
+}
+
+/* write the fields of access unit in front of the first PBU */
+static u8 *enc_au_begin(oapve_ctx_t *ctx, oapv_bs_t *bs, oapv_bitb_t *bitb)
+{
+    oapv_bsw_init(bs, bitb->addr, bitb->bsize, NULL);
+    u8 *bs_pos_au_beg = oapv_bsw_sink(bs);
 
     if(ctx->au_bs_fmt == OAPV_CFG_VAL_AU_BS_FMT_RBAU) {
         oapv_bsw_write(bs, 0, 32); // raw bitstream byte size (skip)
     }
     oapv_bsw_write(bs, 0x61507631, 32); // signature ('aPv1')
+    return bs_pos_au_beg;
+}
+
+/* write metadata PBUs */
+void oapve_md_write(oapv_bs_t *bs, oapvm_ctx_t *md_list)
+{
+    oapv_bs_t bs_pbu_beg;
+    u8       *bs_pos_pbu_beg;
+
+    if(md_list == NULL) {
+        return;
+    }
+    for(int i = 0; i < md_list->num; i++) {
+        int group_id = md_list->md_arr[i].group_id;
+        bs_pos_pbu_beg = oapv_bsw_sink(bs);            /* store pbu pos to calculate size */
+        oapv_mcpy(&bs_pbu_beg, bs, sizeof(oapv_bs_t)); /* store pbu pos of ai to re-write */
+        DUMP_SAVE(0);
+
+        oapve_vlc_pbu_size(bs, 0);
+        oapve_vlc_pbu_header(bs, OAPV_PBU_TYPE_METADATA, group_id);
+        oapve_vlc_metadata(&md_list->md_arr[i], bs);
+
+        // rewrite pbu_size
+        int pbu_size = ((u8 *)oapv_bsw_sink(bs)) - bs_pos_pbu_beg - 4;
+        DUMP_SAVE(1);
+        DUMP_LOAD(0);
+        oapve_vlc_pbu_size(&bs_pbu_beg, pbu_size);
+        DUMP_LOAD(1);
+    }
+}
+
+/* write a frame of additional rate 'r' with its tiles encoded along with
+   the ones of primary output */
+static int enc_rate_frame(oapve_ctx_t *ctx, int r, oapv_bs_t *bs, oapv_frm_t *frm, int frm_idx)
+{
+    oapve_stat_t *stat = ctx->rates[r].stat;
+    oapv_fh_t     fh;
+    oapv_bs_t     bs_pbu_beg;
+    u8           *bs_pos_pbu_beg = oapv_bsw_sink(bs);
+
+    oapv_mcpy(&bs_pbu_beg, bs, sizeof(oapv_bs_t));
+    oapve_vlc_pbu_size(bs, 0);
+    oapve_vlc_pbu_header(bs, frm->pbu_type, frm->group_id);
+
+    // frame header differs from the primary one only in tile sizes
+    oapv_mcpy(&fh, &ctx->fh, sizeof(oapv_fh_t));
+    for(int i = 0; i < ctx->num_tiles; i++) {
+        fh.tile_size[i] = ctx->tile[i].rate[r].bs_size - OAPV_TILE_SIZE_LEN;
+    }
+    oapve_vlc_frame_header(bs, &fh);
+    oapv_bsw_deinit(bs);
+
+    for(int i = 0; i < ctx->num_tiles; i++) {
+        oapve_tile_rate_t *tr = &ctx->tile[i].rate[r];
+        oapv_assert_rv(bs->end - bs->cur >= tr->bs_size, OAPV_ERR_OUT_OF_BS_BUF);
+        oapv_mcpy(bs->cur, tr->bs_buf, tr->bs_size);
+        bs->cur += tr->bs_size;
+    }
+
+    int pbu_size = (int)((u8 *)oapv_bsw_sink(bs) - bs_pos_pbu_beg) - 4;
+    oapve_vlc_pbu_size(&bs_pbu_beg, pbu_size);
+
+    stat->frm_size[frm_idx] = pbu_size + 4 /* PUB size length*/;
+    oapv_fh_to_finfo(&fh, frm->pbu_type, frm->group_id, &stat->aui.frm_info[frm_idx]);
+    stat->num_tiles[frm_idx] = ctx->num_tiles;
+    return OAPV_OK;
+}
+
+/* check additional rates and make room for their tiles in the arena */
+/* payloads in the same order as 'mdp' list, as oapvm_set() adds to head */
+static int enc_mdp_copy(oapvm_t mid, int group_id, oapv_mdp_t *mdp)
+{
+    if(mdp == NULL) {
+        return OAPV_OK;
+    }
+    int ret = enc_mdp_copy(mid, group_id, mdp->next);
+    oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+    return oapvm_set(mid, group_id, mdp->pld_type, mdp->pld_data, mdp->pld_size);
+}
+
+/* copy metadata list 'src' into '*dst', which is created at the first use */
+static int enc_md_copy(oapvm_t *dst, oapvm_t src)
+{
+    int ret;
+
+    if(*dst == NULL) {
+        *dst = oapvm_create(&ret);
+        oapv_assert_rv(*dst != NULL, ret);
+    }
+    oapvm_rem_all(*dst);
+    oapvm_ctx_t *md_list = (oapvm_ctx_t *)src;
+    for(int i = 0; md_list != NULL && i < md_list->num; i++) {
+        ret = enc_mdp_copy(*dst, md_list->md_arr[i].group_id, md_list->md_arr[i].md_payload);
+        oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+    }
+    return OAPV_OK;
+}
+
+/* release tile bitstream buffers of rates from 'r_beg', which are no longer
+   encoded, and take them out of the budget */
+static void enc_rate_bs_free(oapve_ctx_t *ctx, int r_beg)
+{
+    for(int i = 0; i < OAPV_MAX_TILES; i++) {
+        for(int r = r_beg; r < OAPV_MAX_NUM_RATES; r++) {
+            oapve_tile_rate_t *tr = &ctx->tile[i].rate[r];
+            if(tr->bs_buf != NULL) {
+                oapv_tpool_atomic_add(&ctx->bs_alloc, -(int)tr->bs_buf_max);
+                oapv_mfree(tr->bs_buf);
+                tr->bs_buf = NULL;
+                tr->bs_buf_max = 0;
+            }
+        }
+    }
+}
+
+static int enc_rate_ready(oapve_ctx_t *ctx, int num_rates, oapve_rate_t *rates)
+{
+    oapv_assert_rv(num_rates >= 0 && num_rates <= OAPV_MAX_NUM_RATES, OAPV_ERR_INVALID_ARGUMENT);
+    oapv_assert_rv(num_rates == 0 || rates != NULL, OAPV_ERR_INVALID_ARGUMENT);
+
+    for(int r = 0; r < num_rates; r++) {
+        oapve_rate_t *rate = &rates[r];
+        oapv_assert_rv(rate->bitb != NULL && rate->bitb->addr && rate->bitb->bsize > 0 && rate->stat != NULL, OAPV_ERR_INVALID_ARGUMENT);
+        oapv_assert_rv(rate->bitrate > 0 || (rate->qp >= MIN_QUANT && rate->qp <= MAX_QUANT(10)), OAPV_ERR_INVALID_QP);
+        // frame hash is calculated from reconstruction
+        oapv_assert_rv(!ctx->use_frm_hash || rate->rfrms != NULL, OAPV_ERR_INVALID_ARGUMENT);
+    }
+    // additional rates have no filler, so constant bitrate cannot hold on them
+    for(int i = 0; i < ctx->cdesc.max_num_frms && num_rates > 0; i++) {
+        oapv_assert_rv(!ctx->cdesc.param[i].use_filler, OAPV_ERR_UNSUPPORTED);
+    }
+
+    // buffers of rates dropped since previous call are not in the budget below
+    enc_rate_bs_free(ctx, num_rates);
+    ctx->bs_budget = ctx->cdesc.max_bs_buf_size * (1 + num_rates);
+    ctx->num_rates = num_rates;
+    ctx->rates = rates;
+    return OAPV_OK;
+}
+
+int oapve_encode(oapve_t eid, oapv_frms_t *ifrms, oapvm_t mid, oapv_bitb_t *bitb, oapve_stat_t *stat, oapv_frms_t *rfrms)
+{
+    return oapve_encode_multi(eid, ifrms, mid, bitb, stat, rfrms, 0, NULL);
+}
+
+int oapve_encode_multi(oapve_t eid, oapv_frms_t *ifrms, oapvm_t mid, oapv_bitb_t *bitb, oapve_stat_t *stat, oapv_frms_t *rfrms,
+                       int num_rates, oapve_rate_t *rates)
+{
+    oapv_bs_t    bsw, bs_rate[OAPV_MAX_NUM_RATES];
+    oapve_ctx_t *ctx;
+    oapv_frm_t  *frm;
+    oapv_bs_t   *bs, bs_pbu_beg;
+    int          i, r, ret;
+    u8          *bs_pos_pbu_beg, *bs_pos_au_beg, *bs_rate_au_beg[OAPV_MAX_NUM_RATES];
+    u32          bs_ext_pbu_beg;
+    int          md_size = 0;
+    int          frm_size_last = 0;
+
+    ctx = enc_id_to_ctx(eid);
+    oapv_assert_rv(ctx != NULL && bitb->addr && bitb->bsize > 0, OAPV_ERR_INVALID_ARGUMENT);
+    ret = enc_rate_ready(ctx, num_rates, rates);
+    oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+
+    bs = &bsw;
+
+    enc_stat_init(stat);
+    bs_pos_au_beg = enc_au_begin(ctx, bs, bitb);
+    for(r = 0; r < num_rates; r++) {
+        enc_stat_init(rates[r].stat);
+        bs_rate_au_beg[r] = enc_au_begin(ctx, &bs_rate[r], rates[r].bitb);
+    }
+    ctx->num_bsegs = 0;
+    ctx->bseg_beg = bs_pos_au_beg;
+    ctx->bs_ext_size = 0;
+    ctx->stream_pos = bs_pos_au_beg;
+    ctx->stream_off = 0;
+    ctx->stream_err = OAPV_OK;
+
+    ctx->frm_size_max = 0;
+    md_size = enc_md_size(ctx, (oapvm_ctx_t *)mid, ifrms->num_frms);
 
     for(i = 0; i < ifrms->num_frms; i++) {
         // prepare for encoding a frame
         frm = &ifrms->frm[i];
+        ctx->frm_clk_beg = oapv_clk_usec();
         ret = enc_frm_prepare(ctx, &ctx->cdesc.param[i], frm->imgb, (rfrms != NULL) ? rfrms->frm[i].imgb : NULL);
         oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+        for(r = 0; r < num_rates; r++) {
+            ctx->rate_imgb_r[r] = (rates[r].rfrms != NULL) ? rates[r].rfrms->frm[i].imgb : NULL;
+            if(ctx->rate_imgb_r[r] != NULL) {
+                enc_rec_prepare(ctx, frm->imgb, ctx->rate_imgb_r[r]);
+            }
+        }
 
         // write headers
         bs_pos_pbu_beg = oapv_bsw_sink(bs);            /* store pbu pos to calculate size */
+        if(ctx->au_size_max > 0) {
+            // remaining bytes of AU are shared by remaining frames evenly
+            int au_used = (int)(bs_pos_pbu_beg - bs_pos_au_beg) + ctx->bs_ext_size + md_size;
+            ctx->frm_size_max = oapv_max(1, (ctx->au_size_max - au_used) / (ifrms->num_frms - i));
+        }
         oapv_mcpy(&bs_pbu_beg, bs, sizeof(oapv_bs_t)); /* store pbu pos of ai to re-write */
+        bs_ext_pbu_beg = ctx->bs_ext_size;
 
         DUMP_SAVE(0);
         oapve_vlc_pbu_size(bs, 0);
         oapve_vlc_pbu_header(bs, frm->pbu_type, frm->group_id);
         // encode a frame
-        ret = enc_frame(ctx, bs);
+        // tile buffers are reused by next frame, so only the last frame
+        // of AU can be output in scatter way
+        ctx->bs_scatter_frm = ctx->use_bs_scatter && (i == ifrms->num_frms - 1);
+        // metadata follows the last frame, so its size is counted in the
+        // constant bitrate of the last frame
+        ctx->cbr_md_size = (i == ifrms->num_frms - 1) ? md_size : 0;
+        ret = enc_frame(ctx, bs, i);
         oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
 
         // rewrite pbu_size
-        int pbu_size = ((u8 *)oapv_bsw_sink(bs)) - bs_pos_pbu_beg - 4;
+        int pbu_size = ((u8 *)oapv_bsw_sink(bs)) - bs_pos_pbu_beg - 4 + (ctx->bs_ext_size - bs_ext_pbu_beg);
         DUMP_SAVE(1);
         DUMP_LOAD(0);
         oapve_vlc_pbu_size(&bs_pbu_beg, pbu_size);
         DUMP_LOAD(1);
+        ret = enc_stream(ctx, OAPVE_STREAM_PATCH, (int)(bs_pos_pbu_beg - bs_pos_au_beg) + bs_ext_pbu_beg, bs_pos_pbu_beg, 4);
+        oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+        for(r = 0; r < num_rates; r++) {
+            ret = enc_rate_frame(ctx, r, &bs_rate[r], frm, i);
+            oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+        }
+
+        // pad frame up to constant bitrate; the last frame is padded after
+        // metadata whose size is known only when written
+        if(ctx->cbr && i < ifrms->num_frms - 1) {
+            ret = enc_filler_write(bs, ctx->cbr_frm_bytes - (pbu_size + 4) - OAPV_ENC_FILLER_PBU_MIN);
+            oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+        }
+        frm_size_last = pbu_size + 4;
+
+        stat->frm_size[i] = pbu_size + 4 /* PUB size length*/;
+        stat->size_over[i] = ctx->fit_over;
+        oapv_fh_to_finfo(&ctx->fh, frm->pbu_type, frm->group_id, &stat->aui.frm_info[i]);
+
+        stat->num_tiles[i] = ctx->num_tiles;
+        for(int j = 0; j < ctx->num_tiles; j++) {
+            oapve_tile_stat_t *ts = enc_tile_stat(stat, i, j);
+            if(ts != NULL) {
+                ts->preset = ctx->tile[j].preset;
+            }
+            stat->num_tiles_reused[i] += ctx->tile[j].reused;
+        }
+        if(ctx->use_metric) {
+            enc_metric_stat(ctx, stat, i, 0, ctx->num_tiles);
+        }
+
+        // add frame hash value of reconstructed frame into metadata list
+        if(ctx->use_frm_hash) {
+            if(frm->pbu_type == OAPV_PBU_TYPE_PRIMARY_FRAME ||
+               frm->pbu_type == OAPV_PBU_TYPE_NON_PRIMARY_FRAME) {
+                oapv_assert_rv(mid != NULL, OAPV_ERR_INVALID_ARGUMENT);
+                if(ctx->use_frm_hash == OAPV_CFG_VAL_FRM_HASH_FAST) {
+                    enc_frm_hash64(ctx);
+                    ret = oapv_set_hash64_pld(mid, frm->group_id, ctx->imgb_r);
+                }
+                else {
+                    ret = oapv_set_md5_pld(mid, frm->group_id, ctx->imgb_r);
+                }
+                oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+            }
+        }
+
+        // finishing of encoding a frame
+        ret = enc_frm_finish(ctx, stat);
+        oapv_assert_rv(ret == OAPV_OK, ret);
+    }
+    stat->aui.num_frms = ifrms->num_frms;
+
+    // encoding metadata
+    u8 *bs_pos_md_beg = oapv_bsw_sink(bs);
+    oapve_md_write(bs, (oapvm_ctx_t *)mid);
+    if(ctx->cbr) {
+        int md_bytes = (int)((u8 *)oapv_bsw_sink(bs) - bs_pos_md_beg);
+        ret = enc_filler_write(bs, ctx->cbr_frm_bytes - frm_size_last - md_bytes - OAPV_ENC_FILLER_PBU_MIN);
+        oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+    }
+
+    if(ctx->au_bs_fmt == OAPV_CFG_VAL_AU_BS_FMT_RBAU) {
+        u32 au_size = (u32)((u8 *)oapv_bsw_sink(bs) - bs_pos_au_beg) - 4 + ctx->bs_ext_size;
+        oapv_bsw_write_direct(bs_pos_au_beg, au_size, 32);
+    }
+
+    oapv_bsw_deinit(bs); /* de-init BSW */
+    stat->write = bsw_get_write_byte(bs) + ctx->bs_ext_size;
+
+    ret = enc_stream(ctx, OAPVE_STREAM_DATA, ctx->stream_off, ctx->stream_pos, (int)(bs->cur - ctx->stream_pos));
+    oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+    if(ctx->au_bs_fmt == OAPV_CFG_VAL_AU_BS_FMT_RBAU) {
+        ret = enc_stream(ctx, OAPVE_STREAM_PATCH, 0, bs_pos_au_beg, 4);
+        oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+    }
+
+    if(ctx->use_bs_scatter) {
+        enc_bseg_add(ctx, ctx->bseg_beg, (int)(bs->cur - ctx->bseg_beg));
+        bitb->num_segs = ctx->num_bsegs;
+        bitb->segs = ctx->bsegs;
+    }
+
+    for(r = 0; r < num_rates; r++) {
+        oapv_bs_t *bsr = &bs_rate[r];
+        oapvm_t    mid_r = mid;
+        // frame hash of the reconstruction of this rate replaces the one of
+        // main output in a private copy of metadata list
+        if(ctx->use_frm_hash) {
+            ret = enc_md_copy(&ctx->rate_mid, mid);
+            oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+            mid_r = ctx->rate_mid;
+            for(i = 0; i < ifrms->num_frms; i++) {
+                frm = &ifrms->frm[i];
+                if(frm->pbu_type == OAPV_PBU_TYPE_PRIMARY_FRAME ||
+                   frm->pbu_type == OAPV_PBU_TYPE_NON_PRIMARY_FRAME) {
+                    if(ctx->use_frm_hash == OAPV_CFG_VAL_FRM_HASH_FAST) {
+                        // made together with fast hash of main reconstruction
+                        ret = oapv_set_hash64_pld(mid_r, frm->group_id, rates[r].rfrms->frm[i].imgb);
+                    }
+                    else {
+                        ret = oapv_set_md5_pld(mid_r, frm->group_id, rates[r].rfrms->frm[i].imgb);
+                    }
+                    oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+                }
+            }
+        }
+        oapve_md_write(bsr, (oapvm_ctx_t *)mid_r);
+        if(ctx->au_bs_fmt == OAPV_CFG_VAL_AU_BS_FMT_RBAU) {
+            u32 au_size = (u32)((u8 *)oapv_bsw_sink(bsr) - bs_rate_au_beg[r]) - 4;
+            oapv_bsw_write_direct(bs_rate_au_beg[r], au_size, 32);
+        }
+        oapv_bsw_deinit(bsr);
+        rates[r].stat->write = bsw_get_write_byte(bsr);
+        rates[r].stat->aui.num_frms = ifrms->num_frms;
+    }
+    ctx->num_rates = 0;
+
+    return OAPV_OK;
+}
+
+int oapve_encode_tiles(oapve_t eid, oapv_frm_t *ifrm, int tile_beg, int tile_end, oapv_bitb_t *bitb, oapve_stat_t *stat)
+{
+    oapve_ctx_t *ctx;
+    oapv_bs_t    bs;
+    int          i, ret;
+    u64          cost_sum = 0;
+    double       cost_eq = 0;
+    u32          tile_size[OAPV_MAX_TILES];
+
+    ctx = enc_id_to_ctx(eid);
+    oapv_assert_rv(ctx != NULL && ifrm != NULL && bitb->addr && bitb->bsize > 0, OAPV_ERR_INVALID_ARGUMENT);
+
+    enc_stat_init(stat);
+    ctx->frm_clk_beg = oapv_clk_usec();
+    ret = enc_frm_prepare(ctx, &ctx->cdesc.param[0], ifrm->imgb, NULL);
+    oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+    oapv_assert_gv(tile_beg >= 0 && tile_beg < tile_end && tile_end <= ctx->num_tiles, ret, OAPV_ERR_INVALID_ARGUMENT, ERR);
+
+    oapve_set_frame_header(ctx, &ctx->fh);
+
+    // tiles out of the range are regarded as encoded ones, and the payloads
+    // are not streamed as they are not a complete access unit
+    for(i = 0; i < ctx->num_tiles; i++) {
+        ctx->tile[i].stat = (i >= tile_beg && i < tile_end) ? ENC_TILE_STAT_NOT_ENCODED : ENC_TILE_STAT_ENCODED;
+        ctx->tile[i].dqp_fit = 0;
+        ctx->tile[i].reused = 0;
+        tile_size[i] = 0;
+    }
+    ctx->stream_tile = ctx->num_tiles;
+    ctx->cbr = 0;
+    ctx->fit_limit = 0;
+    ctx->frm_size_max = 0;
+    ctx->reuse_ref = NULL;
+
+    if(ctx->param->rc_type != OAPV_RC_CQP) {
+        // bitrate is the budget of the band; the model of whole frame is
+        // applied with the cost and bits per pixel of the band
+        int band_pixel = 0;
+        for(i = tile_beg; i < tile_end; i++) {
+            ret = oapve_rc_get_tile_cost(ctx, ctx->core[0], ctx->imgb_i, &ctx->tile[i], &ctx->tile[i].rc.cost, &ctx->tile[i].rc.number_pixel);
+            oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
+            cost_sum += ctx->tile[i].rc.cost;
+            band_pixel += ctx->tile[i].w * ctx->tile[i].h;
+        }
+        double scale = (double)(ctx->w * ctx->h) / band_pixel;
+        double bits_band = ((double)ctx->param->bitrate * 1000) / ((double)ctx->param->fps_num / ctx->param->fps_den);
+        for(i = tile_beg; i < tile_end; i++) {
+            ctx->tile[i].rc.target_bits_left = bits_band * ctx->tile[i].rc.cost / cost_sum;
+            ctx->tile[i].rc.target_bits = ctx->tile[i].rc.target_bits_left;
+        }
+        cost_eq = cost_sum * scale;
+        ctx->rc_param.lambda = oapve_rc_estimate_pic_lambda(ctx, &ctx->rc_param, (int)(ctx->param->bitrate * scale), cost_eq);
+        if(ctx->param->qp == OAPVE_PARAM_QP_AUTO || ctx->rc_param.is_updated != 0) {
+            ctx->rc_param.qp = oapve_rc_estimate_pic_qp(ctx->rc_param.lambda);
+        }
+        else {
+            ctx->rc_param.qp = ctx->param->qp;
+        }
+        for(int c = 0; c < ctx->num_comp; c++) {
+            ctx->qp[c] = oapv_clip3(MIN_QUANT, MAX_QUANT(10), ctx->rc_param.qp + ctx->qp_offset[c]);
+        }
+    }
 
-        stat->frm_size[i] = pbu_size + 4 /* PUB size length*/;
-        fh_to_finfo(&ctx->fh, frm->pbu_type, frm->group_id, &stat->aui.frm_info[i]);
+    ret = enc_run_tiles(ctx, tile_end - tile_beg, enc_thread_tile);
+    oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
 
-        // add frame hash value of reconstructed frame into metadata list
-        if(ctx->use_frm_hash) {
-            if(frm->pbu_type == OAPV_PBU_TYPE_PRIMARY_FRAME ||
-               frm->pbu_type == OAPV_PBU_TYPE_NON_PRIMARY_FRAME) {
-                oapv_assert_rv(mid != NULL, OAPV_ERR_INVALID_ARGUMENT);
-                ret = oapv_set_md5_pld(mid, frm->group_id, ctx->imgb_r);
-                oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
-            }
+    oapv_bsw_init(&bs, bitb->addr, bitb->bsize, NULL);
+    for(i = tile_beg; i < tile_end; i++) {
+        oapv_assert_gv(bs.end - bs.cur >= ctx->tile[i].bs_size, ret, OAPV_ERR_OUT_OF_BS_BUF, ERR);
+        oapv_mcpy(bs.cur, ctx->tile[i].bs_buf, ctx->tile[i].bs_size);
+        bs.cur += ctx->tile[i].bs_size;
+        tile_size[i] = ctx->tile[i].bs_size - OAPV_TILE_SIZE_LEN;
+        oapve_tile_stat_t *ts = enc_tile_stat(stat, 0, i);
+        if(ts != NULL) {
+            ts->preset = ctx->tile[i].preset;
         }
+    }
+    if(ctx->use_metric) {
+        enc_metric_stat(ctx, stat, 0, tile_beg, tile_end);
+    }
+    stat->write = (int)(bs.cur - bs.beg);
+    stat->frm_size[0] = stat->write;
+    stat->num_tiles[0] = tile_end - tile_beg;
 
-        // finishing of encoding a frame
-        ret = enc_frm_finish(ctx, stat);
-        oapv_assert_rv(ret == OAPV_OK, ret);
+    if(ctx->param->rc_type != OAPV_RC_CQP) {
+        oapve_rc_update_after_pic(ctx, &ctx->rc_param, ctx->param->bitrate, tile_size, cost_eq);
     }
-    stat->aui.num_frms = ifrms->num_frms;
+ERR:
+    enc_frm_finish(ctx, stat);
+    return ret;
+}
 
-    // encoding metadata
-    oapvm_ctx_t *md_list = mid;
-    if(md_list != NULL) {
-        int num_md = md_list->num;
-        for(i = 0; i < num_md; i++) {
-            int group_id = md_list->md_arr[i].group_id;
-            bs_pos_pbu_beg = oapv_bsw_sink(bs);            /* store pbu pos to calculate size */
-            oapv_mcpy(&bs_pbu_beg, bs, sizeof(oapv_bs_t)); /* store pbu pos of ai to re-write */
-            DUMP_SAVE(0);
+int oapve_stitch(oapve_t eid, oapv_frm_t *frm, oapv_bitb_t *parts, int num_parts, oapvm_t mid, oapv_bitb_t *bitb, oapve_stat_t *stat)
+{
+    oapve_ctx_t *ctx;
+    oapv_bs_t    bs, bs_pbu_beg;
+    oapv_fh_t   *fh;
+    u8          *tile_pos[OAPV_MAX_TILES] = { NULL };
+    u8          *bs_pos_au_beg, *bs_pos_pbu_beg;
+    int          i, ret, num_tile_cols, num_tile_rows, num_tiles;
 
-            oapve_vlc_pbu_size(bs, 0);
-            oapve_vlc_pbu_header(bs, OAPV_PBU_TYPE_METADATA, group_id);
-            oapve_vlc_metadata(&md_list->md_arr[i], bs);
+    ctx = enc_id_to_ctx(eid);
+    oapv_assert_rv(ctx != NULL && frm != NULL && frm->imgb != NULL && bitb->addr && bitb->bsize > 0, OAPV_ERR_INVALID_ARGUMENT);
+
+    // only the color space and size of image buffer are referred
+    ctx->param = &ctx->cdesc.param[0];
+    oapv_assert_rv(ctx->param->w == frm->imgb->w[0], OAPV_ERR_INVALID_WIDTH);
+    oapv_assert_rv(ctx->param->h == frm->imgb->h[0], OAPV_ERR_INVALID_HEIGHT);
+    ctx->cfi = color_format_to_chroma_format_idc(OAPV_CS_GET_FORMAT(frm->imgb->cs));
+    ctx->bit_depth = enc_codec_bit_depth(ctx->param->profile_idc, OAPV_CS_GET_BIT_DEPTH(frm->imgb->cs));
+    ctx->num_comp = get_num_comp(ctx->cfi);
+    ret = enc_check_profile(ctx->param->profile_idc, ctx->cfi, ctx->bit_depth);
+    oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
 
-            // rewrite pbu_size
-            int pbu_size = ((u8 *)oapv_bsw_sink(bs)) - bs_pos_pbu_beg - 4;
-            DUMP_SAVE(1);
-            DUMP_LOAD(0);
-            oapve_vlc_pbu_size(&bs_pbu_beg, pbu_size);
-            DUMP_LOAD(1);
+    num_tile_cols = oapv_div_round_up(ctx->param->w, ctx->param->tile_w);
+    num_tile_rows = oapv_div_round_up(ctx->param->h, ctx->param->tile_h);
+    num_tiles = num_tile_cols * num_tile_rows;
+    oapv_assert_rv(num_tiles <= OAPV_MAX_TILES, OAPV_ERR_INVALID_ARGUMENT);
+
+    fh = &ctx->fh;
+    oapve_set_frame_header(ctx, fh);
+    fh->tile_size_present_in_fh_flag = 1;
+
+    // tiles are placed by tile_index, so that parts can be in any order
+    for(i = 0; i < num_parts; i++) {
+        u8 *tile = (u8 *)parts[i].addr;
+        u8 *end = tile + parts[i].ssize;
+        while(tile < end) {
+            oapv_assert_rv(end - tile >= OAPV_TILE_SIZE_LEN + 4, OAPV_ERR_MALFORMED_BITSTREAM);
+            u32 tile_size = oapv_bsr_read_direct(tile, 32);
+            oapv_assert_rv(tile_size <= (u32)(end - tile - OAPV_TILE_SIZE_LEN), OAPV_ERR_MALFORMED_BITSTREAM);
+            // tile_index follows tile_size and tile_header_size
+            int tile_idx = oapv_bsr_read_direct(tile + OAPV_TILE_SIZE_LEN + 2, 16);
+            oapv_assert_rv(tile_idx < num_tiles && tile_pos[tile_idx] == NULL, OAPV_ERR_MALFORMED_BITSTREAM);
+            tile_pos[tile_idx] = tile;
+            fh->tile_size[tile_idx] = tile_size;
+            tile += OAPV_TILE_SIZE_LEN + tile_size;
         }
     }
+    for(i = 0; i < num_tiles; i++) {
+        oapv_assert_rv(tile_pos[i] != NULL, OAPV_ERR_INVALID_ARGUMENT); // missing tile
+    }
 
-    if(ctx->au_bs_fmt == OAPV_CFG_VAL_AU_BS_FMT_RBAU) {
-        u32 au_size = (u32)((u8 *)oapv_bsw_sink(bs) - bs_pos_au_beg) - 4;
-        oapv_bsw_write_direct(bs_pos_au_beg, au_size, 32);
+    enc_stat_init(stat);
+    bs_pos_au_beg = enc_au_begin(ctx, &bs, bitb);
+    bs_pos_pbu_beg = oapv_bsw_sink(&bs);
+    oapv_mcpy(&bs_pbu_beg, &bs, sizeof(oapv_bs_t));
+    oapve_vlc_pbu_size(&bs, 0);
+    oapve_vlc_pbu_header(&bs, frm->pbu_type, frm->group_id);
+    oapve_vlc_frame_header(&bs, fh);
+    oapv_bsw_deinit(&bs);
+
+    for(i = 0; i < num_tiles; i++) {
+        u32 size = OAPV_TILE_SIZE_LEN + fh->tile_size[i];
+        oapv_assert_rv(bs.end - bs.cur >= size, OAPV_ERR_OUT_OF_BS_BUF);
+        oapv_mcpy(bs.cur, tile_pos[i], size);
+        bs.cur += size;
     }
 
-    oapv_bsw_deinit(bs); /* de-init BSW */
-    stat->write = bsw_get_write_byte(bs);
+    int pbu_size = (int)((u8 *)oapv_bsw_sink(&bs) - bs_pos_pbu_beg) - 4;
+    oapve_vlc_pbu_size(&bs_pbu_beg, pbu_size);
+
+    stat->frm_size[0] = pbu_size + 4 /* PUB size length*/;
+    oapv_fh_to_finfo(fh, frm->pbu_type, frm->group_id, &stat->aui.frm_info[0]);
+    stat->num_tiles[0] = num_tiles;
+    stat->aui.num_frms = 1;
 
+    oapve_md_write(&bs, (oapvm_ctx_t *)mid);
+    if(ctx->au_bs_fmt == OAPV_CFG_VAL_AU_BS_FMT_RBAU) {
+        u32 au_size = (u32)((u8 *)oapv_bsw_sink(&bs) - bs_pos_au_beg) - 4;
+        oapv_bsw_write_direct(bs_pos_au_beg, au_size, 32);
+    }
+    oapv_bsw_deinit(&bs);
+    stat->write = bsw_get_write_byte(&bs);
     return OAPV_OK;
 }
 
@@ -1426,7 +3380,8 @@ int oapve_config(oapve_t eid, int cfg, void *buf, int *size)
         break;
     case OAPV_CFG_SET_USE_FRM_HASH:
         oapv_assert_rv(*size == sizeof(int), OAPV_ERR_INVALID_ARGUMENT);
-        ctx->use_frm_hash = (*((int *)buf)) ? 1 : 0;
+        t0 = *((int *)buf);
+        ctx->use_frm_hash = (t0 == OAPV_CFG_VAL_FRM_HASH_FAST) ? t0 : (t0 ? OAPV_CFG_VAL_FRM_HASH_MD5 : 0);
         break;
     case OAPV_CFG_SET_AU_BS_FMT:
         oapv_assert_rv(*size == sizeof(int), OAPV_ERR_INVALID_ARGUMENT);
@@ -1434,6 +3389,38 @@ int oapve_config(oapve_t eid, int cfg, void *buf, int *size)
         oapv_assert_rv(t0 == OAPV_CFG_VAL_AU_BS_FMT_RBAU || t0 == OAPV_CFG_VAL_AU_BS_FMT_NONE, OAPV_ERR_INVALID_ARGUMENT);
         ctx->au_bs_fmt = t0;
         break;
+    case OAPV_CFG_SET_USE_BS_SCATTER:
+        oapv_assert_rv(*size == sizeof(int), OAPV_ERR_INVALID_ARGUMENT);
+        ctx->use_bs_scatter = (*((int *)buf)) ? 1 : 0;
+        break;
+    case OAPV_CFG_SET_STREAM:
+        oapv_assert_rv(*size == sizeof(oapve_stream_t), OAPV_ERR_INVALID_ARGUMENT);
+        oapv_mcpy(&ctx->stream, buf, sizeof(oapve_stream_t));
+        break;
+    case OAPV_CFG_SET_USE_TILE_REUSE:
+        oapv_assert_rv(*size == sizeof(int), OAPV_ERR_INVALID_ARGUMENT);
+        ctx->use_tile_reuse = (*((int *)buf)) ? 1 : 0;
+        break;
+    case OAPV_CFG_SET_USE_LAZY_REC:
+        oapv_assert_rv(*size == sizeof(int), OAPV_ERR_INVALID_ARGUMENT);
+        ctx->use_lazy_rec = (*((int *)buf)) ? 1 : 0;
+        break;
+    case OAPV_CFG_SET_USE_METRIC:
+        oapv_assert_rv(*size == sizeof(int), OAPV_ERR_INVALID_ARGUMENT);
+        t0 = *((int *)buf);
+        oapv_assert_rv((t0 & ~(OAPV_CFG_VAL_METRIC_PSNR | OAPV_CFG_VAL_METRIC_SSIM)) == 0, OAPV_ERR_INVALID_ARGUMENT);
+        ctx->use_metric = t0;
+        break;
+    case OAPV_CFG_SET_USE_FLAT_BLK:
+        oapv_assert_rv(*size == sizeof(int), OAPV_ERR_INVALID_ARGUMENT);
+        ctx->use_flat_blk = (*((int *)buf)) ? 1 : 0;
+        break;
+    case OAPV_CFG_SET_AU_SIZE_MAX:
+        oapv_assert_rv(*size == sizeof(int), OAPV_ERR_INVALID_ARGUMENT);
+        t0 = *((int *)buf);
+        oapv_assert_rv(t0 >= 0, OAPV_ERR_INVALID_ARGUMENT);
+        ctx->au_size_max = t0;
+        break;
     /* get config *******************************************************/
     case OAPV_CFG_GET_QP:
         oapv_assert_rv(*size == sizeof(int), OAPV_ERR_INVALID_ARGUMENT);
@@ -1463,6 +3450,10 @@ int oapve_config(oapve_t eid, int cfg, void *buf, int *size)
         oapv_assert_rv(*size == sizeof(int), OAPV_ERR_INVALID_ARGUMENT);
         *((int *)buf) = ctx->au_bs_fmt;
         break;
+    case OAPV_CFG_GET_USE_BS_SCATTER:
+        oapv_assert_rv(*size == sizeof(int), OAPV_ERR_INVALID_ARGUMENT);
+        *((int *)buf) = ctx->use_bs_scatter;
+        break;
     default:
         oapv_trace("unknown config value (%d)\n", cfg);
         oapv_assert_rv(0, OAPV_ERR_UNSUPPORTED);
@@ -1480,7 +3471,7 @@ int oapve_config(oapve_t eid, int cfg, void *buf, int *size)
 // start of decoder code
 #if ENABLE_DECODER
 ///////////////////////////////////////////////////////////////////////////////
-static oapvd_ctx_t *dec_id_to_ctx(oapvd_t id)
+oapvd_ctx_t *oapvd_id_to_ctx(oapvd_t id)
 {
     oapvd_ctx_t *ctx;
     oapv_assert_rv(id, NULL);
@@ -1537,6 +3528,94 @@ static int dec_block(oapvd_ctx_t *ctx, oapvd_core_t *core, int log2_w, int log2_
     return OAPV_OK;
 }
 
+/* parse a block of component 'c' and reconstruct it into core->coef */
+static int dec_read_block(oapvd_ctx_t *ctx, oapvd_core_t *core, oapv_bs_t *bs, int c, int blk_x, int blk_y)
+{
+    int ret;
+
+    // clear coefficient buffers in a macroblock
+    oapv_mset_x128(core->coef, 0, sizeof(s16)*OAPV_MB_D);
+
+    // parse DC coefficient
+    ret = oapvd_vlc_dc_coef(bs, &core->dc_diff, &core->kparam_dc[c]);
+    oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+
+    // parse AC coefficient
+    ret = oapvd_vlc_ac_coef(bs, core->coef, &core->kparam_ac[c]);
+    oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+    DUMP_COEF(core->coef, OAPV_BLK_D, blk_x, blk_y, c);
+
+    // decode a block
+    return dec_block(ctx, core, OAPV_LOG2_BLK_W, OAPV_LOG2_BLK_H, c);
+}
+
+/* fixed-point conversion of decoded YCbCr to RGB output, which is the inverse
+   of the conversion of RGB input in encoder; unspecified matrix is taken as
+   BT.709 */
+static int dec_set_rgb_coef(oapvd_ctx_t *ctx, oapv_imgb_t *imgb)
+{
+    double m[3][3], ofs[3], inv[3][3], det;
+    int    cf = OAPV_CS_GET_FORMAT(imgb->cs);
+    int    bd = ctx->bit_depth, obd = OAPV_CS_GET_BIT_DEPTH(imgb->cs);
+    int    fp = (cf == OAPV_CF_RGBF || cf == OAPV_CF_RGBAF);
+    int    mc = 1, full_range = 0, ret;
+    double max_val = (double)((1 << bd) - 1), mid_val = (double)(1 << (bd - 1));
+
+    oapv_assert_rv(fp ? (obd == 32) : (obd >= 8 && obd <= 16), OAPV_ERR_UNSUPPORTED_COLORSPACE);
+    if(ctx->fh.color_description_present_flag) {
+        mc = (ctx->fh.matrix_coefficients == 2) ? 1 : ctx->fh.matrix_coefficients;
+        full_range = ctx->fh.full_range_flag;
+    }
+    ret = rgb_to_ycbcr_matrix(mc, full_range, bd, m, ofs);
+    oapv_assert_rv(OAPV_SUCCEEDED(ret), OAPV_ERR_UNSUPPORTED_COLORSPACE);
+
+    // inverse matrix by cofactors
+    for(int i = 0; i < 3; i++) {
+        for(int j = 0; j < 3; j++) {
+            inv[j][i] = m[(i + 1) % 3][(j + 1) % 3] * m[(i + 2) % 3][(j + 2) % 3] -
+                        m[(i + 1) % 3][(j + 2) % 3] * m[(i + 2) % 3][(j + 1) % 3];
+        }
+    }
+    det = m[0][0] * inv[0][0] + m[0][1] * inv[1][0] + m[0][2] * inv[2][0];
+
+    // scaling to output bit depth is folded into the shift, so that
+    // coefficients are of 14-bit precision
+    ctx->out_bit_depth = obd;
+    ctx->rgb_sft = fp ? 0 : 14 + bd - obd;
+    double unit = (double)(1 << 14);
+    for(int c = 0; c < 3; c++) {
+        double v, o = 0;
+        for(int i = 0; i < 3; i++) {
+            inv[c][i] /= det;
+            // decoded samples are centered at the middle value
+            o += inv[c][i] * (mid_val - ofs[i]);
+        }
+        for(int i = 0; i < 3; i++) {
+            v = inv[c][i] * unit;
+            ctx->rgb_coef[c][i] = (int)(v < 0 ? v - 0.5 : v + 0.5);
+            ctx->rgb_coef_f[c][i] = (float)(inv[c][i] / max_val);
+        }
+        v = o * unit;
+        ctx->rgb_coef[c][3] = (int)(v < 0 ? v - 0.5 : v + 0.5) + (fp ? 0 : (1 << (ctx->rgb_sft - 1)));
+        ctx->rgb_coef_f[c][3] = (float)(o / max_val);
+    }
+
+    // alpha is carried along, or opaque if the frame has no alpha component
+    oapv_mset(ctx->rgb_coef[X_C], 0, sizeof(ctx->rgb_coef[X_C]));
+    oapv_mset(ctx->rgb_coef_f[X_C], 0, sizeof(ctx->rgb_coef_f[X_C]));
+    if(ctx->num_comp > 3) {
+        ctx->rgb_coef[X_C][0] = 1 << 14;
+        ctx->rgb_coef[X_C][3] = (1 << (bd - 1 + 14)) + (fp ? 0 : (1 << (ctx->rgb_sft - 1)));
+        ctx->rgb_coef_f[X_C][0] = (float)(1.0 / max_val);
+        ctx->rgb_coef_f[X_C][3] = (float)(mid_val / max_val);
+    }
+    else {
+        ctx->rgb_coef[X_C][3] = fp ? 0 : ((1 << obd) - 1) << ctx->rgb_sft;
+        ctx->rgb_coef_f[X_C][3] = 1.0f;
+    }
+    return OAPV_OK;
+}
+
 static int dec_set_tile_info(oapvd_tile_t* tile, int w_pel, int h_pel, int tile_w, int tile_h, int num_tile_cols, int num_tiles)
 {
 
@@ -1552,10 +3631,13 @@ static int dec_set_tile_info(oapvd_tile_t* tile, int w_pel, int h_pel, int tile_
     return OAPV_OK;
 }
 
-static int dec_frm_prepare(oapvd_ctx_t *ctx, oapv_imgb_t *imgb)
+/* 'imgb' is NULL when the frame is transcoded without reconstruction */
+int oapvd_frm_prepare(oapvd_ctx_t *ctx, oapv_imgb_t *imgb)
 {
     ctx->imgb = imgb;
-    imgb_addref(ctx->imgb); // increase reference count
+    if(imgb != NULL) {
+        imgb_addref(ctx->imgb); // increase reference count
+    }
 
     ctx->bit_depth = ctx->fh.fi.bit_depth;
     ctx->cfi = ctx->fh.fi.chroma_format_idc;
@@ -1563,15 +3645,25 @@ static int dec_frm_prepare(oapvd_ctx_t *ctx, oapv_imgb_t *imgb)
     ctx->comp_sft[Y_C][0] = 0;
     ctx->comp_sft[Y_C][1] = 0;
 
+    // RGB output is converted from the decoded components of the frame
+    ctx->rgb_out = (imgb != NULL) && color_format_is_rgb(OAPV_CS_GET_FORMAT(imgb->cs));
+    int cfi = (imgb != NULL && !ctx->rgb_out) ? color_format_to_chroma_format_idc(OAPV_CS_GET_FORMAT(imgb->cs)) : ctx->cfi;
     for(int c = 1; c < ctx->num_comp; c++) {
-        ctx->comp_sft[c][0] = get_chroma_sft_w(color_format_to_chroma_format_idc(OAPV_CS_GET_FORMAT(imgb->cs)));
-        ctx->comp_sft[c][1] = get_chroma_sft_h(color_format_to_chroma_format_idc(OAPV_CS_GET_FORMAT(imgb->cs)));
+        ctx->comp_sft[c][0] = get_chroma_sft_w(cfi);
+        ctx->comp_sft[c][1] = get_chroma_sft_h(cfi);
     }
 
     ctx->w = oapv_align_value(ctx->fh.fi.frame_width, OAPV_MB_W);
     ctx->h = oapv_align_value(ctx->fh.fi.frame_height, OAPV_MB_H);
 
-    if(OAPV_CS_GET_FORMAT(imgb->cs) == OAPV_CF_PLANAR2) {
+    if(imgb == NULL) {
+        // no block is reconstructed
+    }
+    else if(ctx->rgb_out) {
+        int ret = dec_set_rgb_coef(ctx, imgb);
+        oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+    }
+    else if(OAPV_CS_GET_FORMAT(imgb->cs) == OAPV_CF_PLANAR2) {
         ctx->fn_block_to_imgb[Y_C] = blk_to_imgb_p21x_y;
         ctx->fn_block_to_imgb[U_C] = blk_to_imgb_p21x_uv;
         ctx->fn_block_to_imgb[V_C] = blk_to_imgb_p21x_uv;
@@ -1604,11 +3696,69 @@ static int dec_frm_prepare(oapvd_ctx_t *ctx, oapv_imgb_t *imgb)
     return OAPV_OK;
 }
 
-static int dec_frm_finish(oapvd_ctx_t *ctx)
+/* fast frame hash of decoded frame from hash values of tiles */
+static void dec_frm_hash64(oapvd_ctx_t *ctx)
+{
+    u64 tile_hash[OAPV_MAX_TILES][N_C];
+
+    for(int i = 0; i < ctx->num_tiles; i++) {
+        oapv_mcpy(tile_hash[i], ctx->tile[i].hash, sizeof(tile_hash[i]));
+    }
+    oapv_imgb_set_hash64(ctx->imgb, tile_hash, ctx->num_tiles);
+}
+
+static int dec_thread_md5(void *arg)
+{
+    oapvd_core_t *core = (oapvd_core_t *)arg;
+    oapvd_ctx_t  *ctx = core->ctx;
+
+    for(int i = core->md5_job; i < ctx->md5_num; i += ctx->md5_step) {
+        oapv_imgb_set_md5_plane(ctx->md5_imgb[i], ctx->md5_plane[i]);
+    }
+    return OAPV_OK;
+}
+
+/* MD5 of whole frames, of which every plane is made by a thread */
+static void dec_frm_md5(oapvd_ctx_t *ctx, oapv_frms_t *ofrms, oapvm_t mid)
+{
+    oapv_tpool_t *tpool = ctx->tpool;
+    int           tidx, res;
+
+    ctx->md5_num = 0;
+    for(int i = 0; i < ofrms->num_frms; i++) {
+        oapv_imgb_t *imgb = ofrms->frm[i].imgb;
+        if(mid != NULL && oapv_has_hash64_pld(mid, ofrms->frm[i].group_id)) {
+            continue; // fast frame hash is already made
+        }
+        oapv_mset(imgb->hash, 0, sizeof(imgb->hash));
+        for(int p = 0; p < imgb->np; p++) {
+            ctx->md5_imgb[ctx->md5_num] = imgb;
+            ctx->md5_plane[ctx->md5_num] = p;
+            ctx->md5_num++;
+        }
+    }
+    ctx->md5_step = oapv_min(ctx->threads, ctx->md5_num);
+    for(tidx = 0; tidx < ctx->md5_step; tidx++) {
+        ctx->core[tidx]->md5_job = tidx;
+    }
+    for(tidx = 0; tidx < (ctx->md5_step - 1); tidx++) {
+        tpool->run(ctx->thread_id[tidx], dec_thread_md5, (void *)ctx->core[tidx]);
+    }
+    if(ctx->md5_step > 0) {
+        dec_thread_md5((void *)ctx->core[tidx]);
+    }
+    for(tidx = 0; tidx < (ctx->md5_step - 1); tidx++) {
+        tpool->join(ctx->thread_id[tidx], &res);
+    }
+}
+
+int oapvd_frm_finish(oapvd_ctx_t *ctx)
 {
     oapv_mset(&ctx->bs, 0, sizeof(oapv_bs_t)); // clean data
-    imgb_release(ctx->imgb);                   // decrease reference cnout
-    ctx->imgb = NULL;
+    if(ctx->imgb != NULL) {
+        imgb_release(ctx->imgb); // decrease reference cnout
+        ctx->imgb = NULL;
+    }
     return OAPV_OK;
 }
 
@@ -1631,20 +3781,7 @@ static int dec_tile_comp(oapvd_tile_t *tile, oapvd_ctx_t *ctx, oapvd_core_t *cor
         for(mb_x = le; mb_x < ri; mb_x += mb_w) {
             for(blk_y = mb_y; blk_y < (mb_y + mb_h); blk_y += OAPV_BLK_H) {
                 for(blk_x = mb_x; blk_x < (mb_x + mb_w); blk_x += OAPV_BLK_W) {
-                    // clear coefficient buffers in a macroblock
-                    oapv_mset_x128(core->coef, 0, sizeof(s16)*OAPV_MB_D);
-
-                    // parse DC coefficient
-                    ret = oapvd_vlc_dc_coef(bs, &core->dc_diff, &core->kparam_dc[c]);
-                    oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
-
-                    // parse AC coefficient
-                    ret = oapvd_vlc_ac_coef(bs, core->coef, &core->kparam_ac[c]);
-                    oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
-                    DUMP_COEF(core->coef, OAPV_BLK_D, blk_x, blk_y, c);
-
-                    // decode a block
-                    ret = dec_block(ctx, core, OAPV_LOG2_BLK_W, OAPV_LOG2_BLK_H, c);
+                    ret = dec_read_block(ctx, core, bs, c, blk_x, blk_y);
                     oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
 
                     // copy decoded block to image buffer
@@ -1663,17 +3800,126 @@ static int dec_tile_comp(oapvd_tile_t *tile, oapvd_ctx_t *ctx, oapvd_core_t *cor
     return OAPV_OK;
 }
 
-static int dec_tile(oapvd_core_t *core, oapvd_tile_t *tile)
+/* upsample subsampled chroma of a macroblock to the luma positions in place.
+   chroma is co-sited with even luma columns, and odd columns are the average
+   of the two neighbours; 'nxt' is the chroma of the macroblock on the right,
+   or NULL at the right end of tile where the last column is repeated.
+   rows of 4:2:0 are repeated */
+static void dec_mb_chroma_up(s16 *rec, s16 *nxt, int sw, int sh)
 {
-    int          ret, midx, x, y, c;
-    oapvd_ctx_t *ctx = core->ctx;
-    oapv_bs_t    bs; // bs for 'tile()' syntax
+    int cw = OAPV_MB_W >> sw;
 
-    oapv_bsr_init(&bs, tile->bs_beg + OAPV_TILE_SIZE_LEN, tile->data_size, NULL);
-    ret = oapvd_vlc_tile_header(&bs, ctx, &tile->th);
-    oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+    for(int y = OAPV_MB_H - 1; y >= 0; y--) {
+        s16 *src = rec + (y >> sh) * OAPV_MB_W;
+        s16 *dst = rec + y * OAPV_MB_W;
+        int  r = (nxt != NULL) ? nxt[(y >> sh) * OAPV_MB_W] : src[cw - 1];
+
+        for(int x = OAPV_MB_W - 1; x >= 0; x--) {
+            int k = x >> sw;
+            if(sw && (x & 1)) {
+                dst[x] = (s16)((src[k] + ((k + 1 < cw) ? src[k + 1] : r) + 1) >> 1);
+            }
+            else {
+                dst[x] = src[k];
+            }
+        }
+    }
+}
+
+/* convert a decoded macroblock to RGB output */
+static void dec_mb_to_rgb(oapvd_ctx_t *ctx, s16 (*rec)[OAPV_MB_D], s16 (*nxt)[OAPV_MB_D], int mb_x, int mb_y)
+{
+    oapv_imgb_t *imgb = ctx->imgb;
+    int          cf = OAPV_CS_GET_FORMAT(imgb->cs);
+    int          fp = (cf == OAPV_CF_RGBF || cf == OAPV_CF_RGBAF);
+    int          num_out = (imgb->np > 3) ? 4 : 3;
+    int          byte_depth = OAPV_CS_GET_BYTE_DEPTH(imgb->cs);
+
+    for(int c = 1; c < 3 && c < ctx->num_comp; c++) {
+        if(ctx->comp_sft[c][0] || ctx->comp_sft[c][1]) {
+            dec_mb_chroma_up(rec[c], (nxt != NULL) ? nxt[c] : NULL, ctx->comp_sft[c][0], ctx->comp_sft[c][1]);
+        }
+    }
+
+    int w = oapv_min(OAPV_MB_W, imgb->w[0] - mb_x);
+    int h = oapv_min(OAPV_MB_H, imgb->h[0] - mb_y);
+    if(w <= 0 || h <= 0) {
+        return;
+    }
+    s16 *a = rec[(ctx->num_comp > 3) ? X_C : Y_C];
+    s16 *src[2][3] = { { rec[Y_C], rec[U_C], rec[V_C] }, { a, a, a } };
+    for(int i = 0; i < num_out; i++) {
+        int p = color_format_rgb_plane(cf, i);
+        u8 *dst = (u8 *)imgb->a[p] + mb_y * imgb->s[p] + mb_x * byte_depth;
+        if(fp) {
+            ctx->fn_blk_to_rgbf(src[i == X_C], OAPV_MB_W, w, h, ctx->bit_depth, ctx->rgb_coef_f[i], dst, imgb->s[p]);
+        }
+        else {
+            ctx->fn_blk_to_rgb(src[i == X_C], OAPV_MB_W, w, h, ctx->bit_depth, ctx->rgb_coef[i], ctx->rgb_sft, ctx->out_bit_depth, dst, imgb->s[p]);
+        }
+    }
+}
+
+/* decode macroblocks of all components together and convert them to RGB
+   output at once; bitstreams of the components are read in parallel.
+   a macroblock is converted after the one on its right is decoded, as the
+   chroma interpolation needs the next column */
+static int dec_tile_rgb(oapvd_tile_t *tile, oapvd_ctx_t *ctx, oapvd_core_t *core, oapv_bs_t *bs)
+{
+    oapv_bs_t bsc[N_C]; // bs for 'tile_data()' syntax of each component
+    int       ret, c, i, x, y, cur;
+
+    for(c = 0; c < ctx->num_comp; c++) {
+        oapv_bsr_init(&bsc[c], BSR_GET_CUR(bs), tile->th.tile_data_size[c], NULL);
+        BSR_MOVE_BYTE_ALIGN(bs, tile->th.tile_data_size[c]);
+    }
+    if(ctx->num_comp == 1) { // no color difference
+        for(i = 0; i < 2; i++) {
+            oapv_mset(core->mb_rec[i][U_C], 0, sizeof(core->mb_rec[i][U_C]));
+            oapv_mset(core->mb_rec[i][V_C], 0, sizeof(core->mb_rec[i][V_C]));
+        }
+    }
+
+    for(int mb_y = tile->y; mb_y < tile->y + tile->h; mb_y += OAPV_MB_H) {
+        int mb_x;
+        cur = 0;
+        for(mb_x = tile->x; mb_x < tile->x + tile->w; mb_x += OAPV_MB_W) {
+            for(c = 0; c < ctx->num_comp; c++) {
+                int  sw = ctx->comp_sft[c][0], sh = ctx->comp_sft[c][1];
+                s16 *rec = core->mb_rec[cur][c];
+
+                for(y = 0; y < (OAPV_MB_H >> sh); y += OAPV_BLK_H) {
+                    for(x = 0; x < (OAPV_MB_W >> sw); x += OAPV_BLK_W) {
+                        ret = dec_read_block(ctx, core, &bsc[c], c, (mb_x >> sw) + x, (mb_y >> sh) + y);
+                        oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+                        for(i = 0; i < OAPV_BLK_H; i++) {
+                            oapv_mcpy(rec + (y + i) * OAPV_MB_W + x, core->coef + i * OAPV_BLK_W, OAPV_BLK_W * sizeof(s16));
+                        }
+                    }
+                }
+            }
+            if(mb_x > tile->x) {
+                dec_mb_to_rgb(ctx, core->mb_rec[!cur], core->mb_rec[cur], mb_x - OAPV_MB_W, mb_y);
+            }
+            cur = !cur;
+        }
+        dec_mb_to_rgb(ctx, core->mb_rec[!cur], NULL, mb_x - OAPV_MB_W, mb_y);
+    }
 
     for(c = 0; c < ctx->num_comp; c++) {
+        /* byte align */
+        oapv_bsr_align8(&bsc[c]);
+        /* check actual read size of 'tile()' is equal or smaller than 'tile_data_size' in tile header */
+        oapv_assert_rv(BSR_GET_READ_BYTE(&bsc[c]) <= tile->th.tile_data_size[c], OAPV_ERR_MALFORMED_BITSTREAM);
+    }
+    return OAPV_OK;
+}
+
+void oapvd_tile_set_qp(oapvd_ctx_t *ctx, oapvd_core_t *core, oapvd_tile_t *tile)
+{
+    int midx, x, y;
+
+    for(int c = 0; c < ctx->num_comp; c++) {
         core->qp[c] = tile->th.tile_qp[c];
         u8 dq_scale = oapv_tbl_dq_scale[core->qp[c] % 6];
         core->dq_shift[c] = ctx->bit_depth - 2 - (core->qp[c] / 6);
@@ -1689,6 +3935,26 @@ static int dec_tile(oapvd_core_t *core, oapvd_tile_t *tile)
             }
         }
     }
+}
+
+static int dec_tile(oapvd_core_t *core, oapvd_tile_t *tile)
+{
+    int          ret, c;
+    oapvd_ctx_t *ctx = core->ctx;
+    oapv_bs_t    bs; // bs for 'tile()' syntax
+
+    oapv_bsr_init(&bs, tile->bs_beg + OAPV_TILE_SIZE_LEN, tile->data_size, NULL);
+    ret = oapvd_vlc_tile_header(&bs, ctx, &tile->th);
+    oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+
+    oapvd_tile_set_qp(ctx, core, tile);
+
+    if(ctx->rgb_out) {
+        ret = dec_tile_rgb(tile, ctx, core, &bs);
+        oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+        oapvd_vlc_tile_dummy_data(&bs);
+        return OAPV_OK;
+    }
 
     for(c = 0; c < ctx->num_comp; c++) {
         int  tc, s_dst;
@@ -1714,6 +3980,13 @@ static int dec_tile(oapvd_core_t *core, oapvd_tile_t *tile)
         // move bs buffer to next 'tile_data()' component
         BSR_MOVE_BYTE_ALIGN(&bs, tile->th.tile_data_size[c]);
     }
+    // fast frame hash is made of hash values of tiles; it is used instead of
+    // MD5, when frame hash metadata of the frame is fast hash
+    if(ctx->frm_hash64) {
+        for(int p = 0; p < ctx->imgb->np; p++) {
+            tile->hash[p] = oapv_imgb_hash64_rect(ctx->imgb, p, tile->x, tile->y, tile->w, tile->h);
+        }
+    }
 
     oapvd_vlc_tile_dummy_data(&bs);
     return OAPV_OK;
@@ -1767,7 +4040,11 @@ static int dec_thread_tile(void *arg)
         }
         oapv_tpool_leave_cs(ctx->sync_obj);
 
+#if ENABLE_ENCODER
+        ret = (ctx->tcp != NULL) ? oapvd_tc_tile(core, &tile[tile_idx]) : dec_tile(core, &tile[tile_idx]);
+#else
         ret = dec_tile(core, &tile[tile_idx]);
+#endif
 
         oapv_tpool_enter_cs(ctx->sync_obj);
         if (OAPV_SUCCEEDED(ret)) {
@@ -1793,6 +4070,31 @@ ERR:
     return OAPV_ERR_MALFORMED_BITSTREAM;
 }
 
+int oapvd_run_tiles(oapvd_ctx_t *ctx)
+{
+    int           ret, res;
+    oapv_tpool_t *tpool = ctx->tpool;
+    int           parallel_task = 1;
+    int           tidx = 0;
+
+    parallel_task = (ctx->threads > ctx->num_tiles) ? ctx->num_tiles : ctx->threads;
+
+    /* decode tiles ************************************/
+    for(tidx = 0; tidx < (parallel_task - 1); tidx++) {
+        tpool->run(ctx->thread_id[tidx], dec_thread_tile,
+                   (void *)ctx->core[tidx]);
+    }
+    ret = dec_thread_tile((void *)ctx->core[tidx]);
+    for(tidx = 0; tidx < parallel_task - 1; tidx++) {
+        tpool->join(ctx->thread_id[tidx], &res);
+        if(OAPV_FAILED(res)) {
+            ret = res;
+        }
+    }
+    /****************************************************/
+    return ret;
+}
+
 static void dec_flush(oapvd_ctx_t *ctx)
 {
     if(ctx->threads >= 2) {
@@ -1817,6 +4119,19 @@ static void dec_flush(oapvd_ctx_t *ctx)
     for(int i = 0; i < ctx->threads; i++) {
         dec_core_free(ctx->core[i]);
     }
+
+    for(int i = 0; i < OAPV_MAX_TILES; i++) {
+        if(ctx->tile[i].tc_buf != NULL) {
+            oapv_mfree(ctx->tile[i].tc_buf);
+            ctx->tile[i].tc_buf = NULL;
+        }
+    }
+#if ENABLE_ENCODER
+    if(ctx->tc_mid != NULL) {
+        oapvm_delete(ctx->tc_mid);
+        ctx->tc_mid = NULL;
+    }
+#endif
 }
 
 static int dec_ready(oapvd_ctx_t *ctx)
@@ -1871,25 +4186,43 @@ static int dec_platform_init(oapvd_ctx_t *ctx)
     // default settings
     ctx->fn_itx = oapv_tbl_fn_itx;
     ctx->fn_dquant = oapv_tbl_fn_dquant;
+    ctx->fn_blk_to_rgb = oapv_blk_to_rgb;
+    ctx->fn_blk_to_rgbf = oapv_blk_to_rgbf;
+#if ENABLE_ENCODER
+    ctx->fn_quant = oapv_tbl_fn_quant;
+#endif
 
 #if X86_SSE
     int check_cpu, support_sse, support_avx2;
 
-    check_cpu = oapv_check_cpu_info_x86();
+    check_cpu = oapv_check_cpu_info_x86() & oapv_simd_caps_mask_x86(ctx->cdesc.simd);
     support_sse = (check_cpu >> 0) & 1;
     support_avx2 = (check_cpu >> 2) & 1;
 
     if(support_avx2) {
         ctx->fn_itx = oapv_tbl_fn_itx_avx;
         ctx->fn_dquant = oapv_tbl_fn_dquant_avx;
+        ctx->fn_blk_to_rgb = oapv_blk_to_rgb_avx;
+        ctx->fn_blk_to_rgbf = oapv_blk_to_rgbf_avx;
+#if ENABLE_ENCODER
+        ctx->fn_quant = oapv_tbl_fn_quant_avx;
+#endif
     }
     else if(support_sse) {
         ctx->fn_itx = oapv_tbl_fn_itx;
         ctx->fn_dquant = oapv_tbl_fn_dquant;
+        ctx->fn_blk_to_rgb = oapv_blk_to_rgb_sse;
+        ctx->fn_blk_to_rgbf = oapv_blk_to_rgbf_sse;
     }
 #elif ARM_NEON
-    ctx->fn_itx = oapv_tbl_fn_itx_neon;
-    ctx->fn_dquant = oapv_tbl_fn_dquant;
+    if(ctx->cdesc.simd != OAPV_CDESC_SIMD_NONE) {
+        // no NEON version of fn_blk_to_rgb and fn_blk_to_rgbf; C ones are used
+        ctx->fn_itx = oapv_tbl_fn_itx_neon;
+        ctx->fn_dquant = oapv_tbl_fn_dquant;
+#if ENABLE_ENCODER
+        ctx->fn_quant = oapv_tbl_fn_quant_neon;
+#endif
+    }
 #endif
     return OAPV_OK;
 }
@@ -1914,6 +4247,9 @@ oapvd_t oapvd_create(oapvd_cdesc_t *cdesc, int *err)
     ret = dec_platform_init(ctx);
     oapv_assert_g(ret == OAPV_OK, ERR);
 
+    ctx->fpool = oapv_fpool_create();
+    oapv_assert_gv(ctx->fpool != NULL, ret, OAPV_ERR_OUT_OF_MEMORY, ERR);
+
     /* ready for decoding */
     ret = dec_ready(ctx);
     oapv_assert_g(ret == OAPV_OK, ERR);
@@ -1927,6 +4263,9 @@ oapvd_t oapvd_create(oapvd_cdesc_t *cdesc, int *err)
 
 ERR:
     if(ctx) {
+        if(ctx->fpool) {
+            oapv_fpool_delete(ctx->fpool);
+        }
         dec_ctx_free(ctx);
     }
     if(err) {
@@ -1938,14 +4277,49 @@ ERR:
 void oapvd_delete(oapvd_t did)
 {
     oapvd_ctx_t *ctx;
-    ctx = dec_id_to_ctx(did);
+    ctx = oapvd_id_to_ctx(did);
     oapv_assert_r(ctx);
 
     DUMP_DELETE();
     dec_flush(ctx);
+    // frames in use are kept until they are released
+    oapv_fpool_delete(ctx->fpool);
     dec_ctx_free(ctx);
 }
 
+/* decode metadata PBUs of access unit ahead of frames, so that the kind of
+   frame hash is known when frames are decoded */
+static int dec_au_metadata(oapvd_ctx_t *ctx, oapv_bitb_t *bitb, oapvm_t mid, oapvd_stat_t *stat)
+{
+    oapv_pbuh_t pbuh;
+    oapv_bs_t   bs;
+    u32         pbu_size;
+    u32         cur_read_size = 4; // signature
+    int         ret;
+
+    do {
+        u32 remain = bitb->ssize - cur_read_size;
+        oapv_assert_rv(remain >= 8, OAPV_ERR_MALFORMED_BITSTREAM);
+        oapv_bsr_init(&bs, (u8 *)bitb->addr + cur_read_size, remain, NULL);
+
+        ret = oapvd_vlc_pbu_size(&bs, &pbu_size);
+        oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+        oapv_assert_rv(pbu_size <= remain - 4, OAPV_ERR_MALFORMED_BITSTREAM);
+
+        ret = oapvd_vlc_pbu_header(&bs, &pbuh);
+        oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+
+        if(pbuh.pbu_type == OAPV_PBU_TYPE_METADATA) {
+            ret = oapvd_vlc_metadata(&bs, pbu_size, mid, pbuh.group_id);
+            oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+
+            stat->read += BSR_GET_READ_BYTE(&bs);
+        }
+        cur_read_size += pbu_size + 4 /* byte size of 'pbu_size' syntax */;
+    } while(cur_read_size < bitb->ssize);
+    return OAPV_OK;
+}
+
 int oapvd_decode(oapvd_t did, oapv_bitb_t *bitb, oapv_frms_t *ofrms, oapvm_t mid, oapvd_stat_t *stat)
 {
     oapvd_ctx_t *ctx;
@@ -1955,7 +4329,7 @@ int oapvd_decode(oapvd_t did, oapv_bitb_t *bitb, oapv_frms_t *ofrms, oapvm_t mid
     u32          cur_read_size = 0;
     int          frame_cnt = 0;
 
-    ctx = dec_id_to_ctx(did);
+    ctx = oapvd_id_to_ctx(did);
     oapv_assert_rv(ctx, OAPV_ERR_INVALID_ARGUMENT);
 
     // read signature ('aPv1')
@@ -1965,6 +4339,10 @@ int oapvd_decode(oapvd_t did, oapv_bitb_t *bitb, oapv_frms_t *ofrms, oapvm_t mid
     cur_read_size += 4;
     stat->read += 4;
 
+    // metadata follows frames in access unit, so it is decoded first
+    ret = dec_au_metadata(ctx, bitb, mid, stat);
+    oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+
     // decode PBUs
     do {
         oapv_bs_t   *bs;
@@ -1992,40 +4370,30 @@ int oapvd_decode(oapvd_t did, oapv_bitb_t *bitb, oapv_frms_t *ofrms, oapvm_t mid
             ret = oapvd_vlc_frame_header(bs, &ctx->fh);
             oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
 
-            ret = dec_frm_prepare(ctx, ofrms->frm[frame_cnt].imgb);
-            oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
-
-            int           res;
-            oapv_tpool_t *tpool = ctx->tpool;
-            int           parallel_task = 1;
-            int           tidx = 0;
+            if(ofrms->frm[frame_cnt].imgb == NULL) {
+                oapv_fi_t *fi = &ctx->fh.fi;
+                int        cs = OAPV_CS_SET(chroma_format_idc_to_color_format(fi->chroma_format_idc), fi->bit_depth, 0);
+                ofrms->frm[frame_cnt].imgb = oapv_fpool_get(ctx->fpool, fi->frame_width, fi->frame_height, cs);
+                oapv_assert_gv(ofrms->frm[frame_cnt].imgb != NULL, ret, OAPV_ERR_OUT_OF_MEMORY, ERR);
+            }
 
-            parallel_task = (ctx->threads > ctx->num_tiles) ? ctx->num_tiles : ctx->threads;
+            ret = oapvd_frm_prepare(ctx, ofrms->frm[frame_cnt].imgb);
+            oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
 
-            /* decode tiles ************************************/
-            for(tidx = 0; tidx < (parallel_task - 1); tidx++) {
-                tpool->run(ctx->thread_id[tidx], dec_thread_tile,
-                           (void *)ctx->core[tidx]);
-            }
-            ret = dec_thread_tile((void *)ctx->core[tidx]);
-            for(tidx = 0; tidx < parallel_task - 1; tidx++) {
-                tpool->join(ctx->thread_id[tidx], &res);
-                if(OAPV_FAILED(res)) {
-                    ret = res;
-                }
-            }
-            /****************************************************/
+            // hash values of tiles are made only for fast frame hash
+            ctx->frm_hash64 = ctx->use_frm_hash && !ctx->rgb_out && mid != NULL && oapv_has_hash64_pld(mid, pbuh.group_id);
+            ret = oapvd_run_tiles(ctx);
 
             /* READ FILLER HERE !!! */
 
             oapv_bsr_move(&ctx->bs, ctx->tile_end);
             stat->read += BSR_GET_READ_BYTE(&ctx->bs);
 
-            fh_to_finfo(&ctx->fh, pbuh.pbu_type, pbuh.group_id, &stat->aui.frm_info[frame_cnt]);
-            if(ret == OAPV_OK && ctx->use_frm_hash) {
-                oapv_imgb_set_md5(ctx->imgb);
+            oapv_fh_to_finfo(&ctx->fh, pbuh.pbu_type, pbuh.group_id, &stat->aui.frm_info[frame_cnt]);
+            if(ret == OAPV_OK && ctx->frm_hash64) {
+                dec_frm_hash64(ctx);
             }
-            ret = dec_frm_finish(ctx); // FIX-ME
+            ret = oapvd_frm_finish(ctx); // FIX-ME
             oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
 
             ofrms->frm[frame_cnt].pbu_type = pbuh.pbu_type;
@@ -2033,20 +4401,24 @@ int oapvd_decode(oapvd_t did, oapv_bitb_t *bitb, oapv_frms_t *ofrms, oapvm_t mid
             stat->frm_size[frame_cnt] = pbu_size + 4 /* byte size of 'pbu_size' syntax */;
             frame_cnt++;
         }
-        else if(pbuh.pbu_type == OAPV_PBU_TYPE_METADATA) {
-            ret = oapvd_vlc_metadata(bs, pbu_size, mid, pbuh.group_id);
-            oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
-
-            stat->read += BSR_GET_READ_BYTE(&ctx->bs);
-        }
         else if(pbuh.pbu_type == OAPV_PBU_TYPE_FILLER) {
             ret = oapvd_vlc_filler(bs, (pbu_size - 4));
             oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
+
+            stat->read += BSR_GET_READ_BYTE(&ctx->bs);
         }
         cur_read_size += pbu_size + 4 /* byte size of 'pbu_size' syntax */;
     } while(cur_read_size < bitb->ssize);
     stat->aui.num_frms = frame_cnt;
+    if(ofrms->num_frms == 0) {
+        ofrms->num_frms = frame_cnt;
+    }
     oapv_assert_gv(ofrms->num_frms == frame_cnt, ret, OAPV_ERR_MALFORMED_BITSTREAM, ERR);
+
+    // MD5 is made of whole frame, when the frame has no fast frame hash
+    if(ctx->use_frm_hash && !ctx->rgb_out) {
+        dec_frm_md5(ctx, ofrms, mid);
+    }
     return ret;
 
 ERR:
@@ -2057,7 +4429,7 @@ int oapvd_config(oapvd_t did, int cfg, void *buf, int *size)
 {
     oapvd_ctx_t *ctx;
 
-    ctx = dec_id_to_ctx(did);
+    ctx = oapvd_id_to_ctx(did);
     oapv_assert_rv(ctx, OAPV_ERR_INVALID_ARGUMENT);
 
     switch(cfg) {
@@ -2065,6 +4437,9 @@ int oapvd_config(oapvd_t did, int cfg, void *buf, int *size)
     case OAPV_CFG_SET_USE_FRM_HASH:
         ctx->use_frm_hash = (*((int *)buf)) ? 1 : 0;
         break;
+    case OAPV_CFG_SET_USE_HUGE_PAGE:
+        oapv_fpool_set_huge_page(ctx->fpool, (*((int *)buf)) ? 1 : 0);
+        break;
 
     default:
         oapv_assert_rv(0, OAPV_ERR_UNSUPPORTED);
@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2022 Samsung Electronics Co., Ltd.
+ * All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * - Neither the name of the copyright owner, nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "oapv_def.h"
+
+/* 'src' is the start of the row of plane having the component and
+   'offset_src' is x position of the block in unit of component sample.
+   input samples of 'in_bd' bits are converted to 'bd' bits of codec */
+void oapv_imgb_to_blk_16(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd, int in_bd)
+{
+    const int mid_val = (1 << (bd - 1));
+    const int max_val = (1 << bd) - 1;
+    u16      *s = (u16 *)src + offset_src;
+    s16      *d = (s16 *)dst;
+
+    if(in_bd <= bd) {
+        int sft = bd - in_bd;
+        for(int h = 0; h < blk_h; h++) {
+            for(int w = 0; w < blk_w; w++) {
+                d[w] = (s16)(s[w] << sft) - mid_val;
+            }
+            s = (u16 *)(((u8 *)s) + s_src);
+            d = (s16 *)(((u8 *)d) + s_dst);
+        }
+    }
+    else {
+        int sft = in_bd - bd, add = 1 << (sft - 1);
+        for(int h = 0; h < blk_h; h++) {
+            for(int w = 0; w < blk_w; w++) {
+                d[w] = (s16)oapv_min((s[w] + add) >> sft, max_val) - mid_val;
+            }
+            s = (u16 *)(((u8 *)s) + s_src);
+            d = (s16 *)(((u8 *)d) + s_dst);
+        }
+    }
+}
+
+void oapv_imgb_to_blk_8(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd, int in_bd)
+{
+    const int mid_val = (1 << (bd - 1));
+    const int sft = bd - 8;
+    u8       *s = (u8 *)src + offset_src;
+    s16      *d = (s16 *)dst;
+
+    for(int h = 0; h < blk_h; h++) {
+        for(int w = 0; w < blk_w; w++) {
+            d[w] = (s16)(s[w] << sft) - mid_val;
+        }
+        s = s + s_src;
+        d = (s16 *)(((u8 *)d) + s_dst);
+    }
+}
+
+static void imgb_to_blk_p21x_y(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd, int in_bd)
+{
+    const int mid_val = (1 << (bd - 1));
+    u16      *s = (u16 *)src + offset_src;
+    s16      *d = (s16 *)dst;
+    int       shift_pic_bits = 16 - bd;
+
+    for(int h = 0; h < blk_h; h++) {
+        for(int w = 0; w < blk_w; w++) {
+            d[w] = (s16)(s[w] >> shift_pic_bits) - mid_val;
+        }
+        s = (u16 *)(((u8 *)s) + s_src);
+        d = (s16 *)(((u8 *)d) + s_dst);
+    }
+}
+
+static void imgb_to_blk_p21x_uv(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd, int in_bd)
+{
+    const int mid_val = (1 << (bd - 1));
+    u16      *s = (u16 *)src + offset_src * 2;
+    s16      *d = (s16 *)dst;
+    int       shift_pic_bits = 16 - bd;
+
+    for(int h = 0; h < blk_h; h++) {
+        for(int w = 0; w < blk_w; w++) {
+            d[w] = (s16)(s[w * 2] >> shift_pic_bits) - mid_val;
+        }
+        s = (u16 *)(((u8 *)s) + s_src);
+        d = (s16 *)(((u8 *)d) + s_dst);
+    }
+}
+
+/* packed 422 formats have samples in the order of Cb, Y, Cr, Y, so that
+   n-th sample of a row is Y(x) for n = 2x + 1, Cb(x) for n = 4x and Cr(x)
+   for n = 4x + 2 */
+static void imgb_to_blk_uyvy(u8 *s, int ofs, int step, int blk_w, int blk_h, int s_src, int s_dst, s16 *d, int bd)
+{
+    const int mid_val = (1 << (bd - 1));
+    const int sft = bd - 8;
+
+    s += ofs;
+    for(int h = 0; h < blk_h; h++) {
+        for(int w = 0; w < blk_w; w++) {
+            d[w] = (s16)(s[w * step] << sft) - mid_val;
+        }
+        s = s + s_src;
+        d = (s16 *)(((u8 *)d) + s_dst);
+    }
+}
+
+static void imgb_to_blk_uyvy_y(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd, int in_bd)
+{
+    imgb_to_blk_uyvy((u8 *)src, offset_src * 2 + 1, 2, blk_w, blk_h, s_src, s_dst, (s16 *)dst, bd);
+}
+
+static void imgb_to_blk_uyvy_u(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd, int in_bd)
+{
+    imgb_to_blk_uyvy((u8 *)src, offset_src * 4, 4, blk_w, blk_h, s_src, s_dst, (s16 *)dst, bd);
+}
+
+static void imgb_to_blk_uyvy_v(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd, int in_bd)
+{
+    imgb_to_blk_uyvy((u8 *)src, offset_src * 4 + 2, 4, blk_w, blk_h, s_src, s_dst, (s16 *)dst, bd);
+}
+
+/* v210 has three 10-bit samples in each little endian 32-bit word, and
+   12 samples (6 pixels) in every 4 words in the same order as UYVY */
+static void imgb_to_blk_v210(u8 *src, int n, int step, int blk_w, int blk_h, int s_src, int s_dst, s16 *d, int bd)
+{
+    const int mid_val = (1 << (bd - 1));
+    const int sft = bd - 10;
+
+    for(int h = 0; h < blk_h; h++) {
+        for(int w = 0, i = n; w < blk_w; w++, i += step) {
+            u8 *p = src + (i / 3) * 4;
+            u32 word = p[0] | (p[1] << 8) | (p[2] << 16) | ((u32)p[3] << 24);
+            d[w] = (s16)(((word >> (10 * (i % 3))) & 0x3FF) << sft) - mid_val;
+        }
+        src = src + s_src;
+        d = (s16 *)(((u8 *)d) + s_dst);
+    }
+}
+
+static void imgb_to_blk_v210_y(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd, int in_bd)
+{
+    imgb_to_blk_v210((u8 *)src, offset_src * 2 + 1, 2, blk_w, blk_h, s_src, s_dst, (s16 *)dst, bd);
+}
+
+static void imgb_to_blk_v210_u(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd, int in_bd)
+{
+    imgb_to_blk_v210((u8 *)src, offset_src * 4, 4, blk_w, blk_h, s_src, s_dst, (s16 *)dst, bd);
+}
+
+static void imgb_to_blk_v210_v(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd, int in_bd)
+{
+    imgb_to_blk_v210((u8 *)src, offset_src * 4 + 2, 4, blk_w, blk_h, s_src, s_dst, (s16 *)dst, bd);
+}
+
+const oapv_fn_imgb_to_blk_t oapv_tbl_fn_imgb_to_blk_p21x[3] = {
+    imgb_to_blk_p21x_y,
+    imgb_to_blk_p21x_uv,
+    imgb_to_blk_p21x_uv
+};
+
+const oapv_fn_imgb_to_blk_t oapv_tbl_fn_imgb_to_blk_uyvy[3] = {
+    imgb_to_blk_uyvy_y,
+    imgb_to_blk_uyvy_u,
+    imgb_to_blk_uyvy_v
+};
+
+const oapv_fn_imgb_to_blk_t oapv_tbl_fn_imgb_to_blk_v210[3] = {
+    imgb_to_blk_v210_y,
+    imgb_to_blk_v210_u,
+    imgb_to_blk_v210_v
+};
+
+/* convert a block of planar R, G and B samples to a color component as
+   (coef[0] * R + coef[1] * G + coef[2] * B + coef[3]) >> sft, and subtract
+   the middle value of 'bit_depth'. src[] has the rows of R, G and B planes
+   and 'x' is the position of the block in the rows */
+void oapv_rgb_to_blk(void *src[3], int s_src[3], int byte_depth, int x, int blk_w, int blk_h, int coef[4], int sft, int bit_depth, s16 *dst)
+{
+    const int max_val = (1 << bit_depth) - 1;
+    const int mid_val = (1 << (bit_depth - 1));
+    u8       *r = (u8 *)src[0] + x * byte_depth;
+    u8       *g = (u8 *)src[1] + x * byte_depth;
+    u8       *b = (u8 *)src[2] + x * byte_depth;
+
+    for(int h = 0; h < blk_h; h++) {
+        for(int w = 0; w < blk_w; w++) {
+            int v;
+            if(byte_depth == 1) {
+                v = coef[0] * r[w] + coef[1] * g[w] + coef[2] * b[w];
+            }
+            else {
+                v = coef[0] * ((u16 *)r)[w] + coef[1] * ((u16 *)g)[w] + coef[2] * ((u16 *)b)[w];
+            }
+            dst[w] = (s16)oapv_clip3(0, max_val, (v + coef[3]) >> sft) - mid_val;
+        }
+        r += s_src[0];
+        g += s_src[1];
+        b += s_src[2];
+        dst += OAPV_BLK_W;
+    }
+}
+
+/* convert a block of decoded Y, Cb and Cr samples, which are centered at the
+   middle value of 'bit_depth', to a component of RGB output as
+   (coef[0] * Y + coef[1] * Cb + coef[2] * Cr + coef[3]) >> sft in
+   'out_bit_depth'; output samples are u8 for 8 bits and u16 for more */
+void oapv_blk_to_rgb(s16 *src[3], int s_src, int blk_w, int blk_h, int bit_depth, int coef[4], int sft, int out_bit_depth, void *dst, int s_dst)
+{
+    const int mid_val = (1 << (bit_depth - 1));
+    const int max_val = (1 << out_bit_depth) - 1;
+    s16      *y = src[0], *cb = src[1], *cr = src[2];
+    u8       *d = (u8 *)dst;
+
+    for(int h = 0; h < blk_h; h++) {
+        for(int w = 0; w < blk_w; w++) {
+            int v = coef[0] * oapv_clip3(-mid_val, mid_val - 1, y[w]) + coef[1] * oapv_clip3(-mid_val, mid_val - 1, cb[w]) +
+                    coef[2] * oapv_clip3(-mid_val, mid_val - 1, cr[w]) + coef[3];
+            v = oapv_clip3(0, max_val, v >> sft);
+            if(out_bit_depth == 8) {
+                d[w] = (u8)v;
+            }
+            else {
+                ((u16 *)d)[w] = (u16)v;
+            }
+        }
+        y += s_src;
+        cb += s_src;
+        cr += s_src;
+        d += s_dst;
+    }
+}
+
+/* same as oapv_blk_to_rgb() but to 32-bit float output in [0.0, 1.0] */
+void oapv_blk_to_rgbf(s16 *src[3], int s_src, int blk_w, int blk_h, int bit_depth, float coef[4], void *dst, int s_dst)
+{
+    const int mid_val = (1 << (bit_depth - 1));
+    s16      *y = src[0], *cb = src[1], *cr = src[2];
+    float    *d = (float *)dst;
+
+    for(int h = 0; h < blk_h; h++) {
+        for(int w = 0; w < blk_w; w++) {
+            float v = coef[0] * (float)oapv_clip3(-mid_val, mid_val - 1, y[w]);
+            v = v + coef[1] * (float)oapv_clip3(-mid_val, mid_val - 1, cb[w]);
+            v = v + coef[2] * (float)oapv_clip3(-mid_val, mid_val - 1, cr[w]);
+            v = v + coef[3];
+            d[w] = (v < 0.0f) ? 0.0f : ((v > 1.0f) ? 1.0f : v);
+        }
+        y += s_src;
+        cb += s_src;
+        cr += s_src;
+        d = (float *)((u8 *)d + s_dst);
+    }
+}
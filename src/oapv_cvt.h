@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2022 Samsung Electronics Co., Ltd.
+ * All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * - Neither the name of the copyright owner, nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _OAPV_CVT_H_
+#define _OAPV_CVT_H_
+
+#include "oapv_port.h"
+
+void oapv_imgb_to_blk_16(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd, int in_bd);
+void oapv_imgb_to_blk_8(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd, int in_bd);
+void oapv_rgb_to_blk(void *src[3], int s_src[3], int byte_depth, int x, int blk_w, int blk_h, int coef[4], int sft, int bit_depth, s16 *dst);
+void oapv_blk_to_rgb(s16 *src[3], int s_src, int blk_w, int blk_h, int bit_depth, int coef[4], int sft, int out_bit_depth, void *dst, int s_dst);
+void oapv_blk_to_rgbf(s16 *src[3], int s_src, int blk_w, int blk_h, int bit_depth, float coef[4], void *dst, int s_dst);
+
+extern const oapv_fn_imgb_to_blk_t oapv_tbl_fn_imgb_to_blk_p21x[3];
+extern const oapv_fn_imgb_to_blk_t oapv_tbl_fn_imgb_to_blk_uyvy[3];
+extern const oapv_fn_imgb_to_blk_t oapv_tbl_fn_imgb_to_blk_v210[3];
+
+#endif /* _OAPV_CVT_H_ */
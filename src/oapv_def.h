@@ -44,6 +44,7 @@
 #include "oapv_port.h"
 #include "oapv_bs.h"
 #include "oapv_tpool.h"
+#include "oapv_fpool.h"
 
 /* oapv encoder magic code */
 #define OAPVE_MAGIC_CODE          0x41503145 /* AP1E */
@@ -79,6 +80,25 @@
 #define QUANT_SHIFT               14
 #define QUANT_DQUANT_SHIFT        20
 
+/* max number of candidates in full RDO */
+#define OAPV_FULL_RDO_MAX_CAND    8
+
+/* default dead-zone offsets of quantization; luma of full RDO ('placebo'
+   preset) uses rounding offset of chroma */
+#define OAPV_DEADZONE_Y           212
+#define OAPV_DEADZONE_Y_FULL_RDO  128
+#define OAPV_DEADZONE_C           128
+
+/* worst-case byte size of one coded macroblock of a component
+   (a coefficient never takes more than 64 bits) */
+#define OAPV_ENC_MB_BS_MAX        ((OAPV_MB_W * OAPV_MB_H) << 3)
+/* minimum byte size of a tile bitstream buffer */
+#define OAPV_ENC_TILE_BS_MIN      (64 * 1024)
+/* byte size of filler PBU without filler data */
+#define OAPV_ENC_FILLER_PBU_MIN   (8)
+/* max re-encoding rounds of tiles to fit a frame into size limit */
+#define OAPV_ENC_FIT_MAX_ITR      (8)
+
 /* encoder status */
 #define ENC_TILE_STAT_NOT_ENCODED 0
 #define ENC_TILE_STAT_ON_ENCODING 1
@@ -162,6 +182,9 @@ struct oapv_aui {
     // int reserved_zero_8bits // u(8)
 };
 
+/* frame information of access unit information, from frame header */
+void oapv_fh_to_finfo(oapv_fh_t *fh, int pbu_type, int group_id, oapv_frm_info_t *finfo);
+
 ///////////////////////////////////////////////////////////////////////////////
 // start of encoder code
 #if ENABLE_ENCODER
@@ -186,11 +209,12 @@ typedef s64 (*oapv_fn_ssd_t)(int w, int h, void *src1, void *src2, int s_src1, i
 typedef void (*oapv_fn_diff_t)(int w, int h, void *src1, void *src2, int s_src1, int s_src2, int s_diff, s16 *diff);
 
 typedef double (*oapv_fn_enc_blk_cost_t)(oapve_ctx_t *ctx, oapve_core_t *core, int log2_w, int log2_h, int c);
-typedef void (*oapv_fn_imgb_to_blk_rc_t)(oapv_imgb_t *imgb, int c, int x_l, int y_l, int w_l, int h_l, s16 *block, int bit_depth);
-typedef void (*oapv_fn_imgb_to_blk_t)(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bit_depth);
+typedef void (*oapv_fn_imgb_to_blk_t)(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bit_depth, int in_bit_depth);
 typedef void (*oapv_fn_blk_to_imgb_t)(void *src, int blk_w, int blk_h, int s_src, int offset_dst, int s_dst, void *dst, int bit_depth);
-typedef void (*oapv_fn_imgb_pad_t)(oapv_imgb_t *imgb, int aw, int ah, int comp_sft[N_C][2]);
-typedef int (*oapv_fn_had8x8_t)(pel *org, int s_org);
+typedef int (*oapv_fn_had8x8_row_t)(u16 *src, int s_src, int step, int ofs, int shift, int num_blk);
+typedef void (*oapv_fn_rgb_to_blk_t)(void *src[3], int s_src[3], int byte_depth, int x, int blk_w, int blk_h, int coef[4], int sft, int bit_depth, s16 *dst);
+typedef void (*oapv_fn_blk_to_rgb_t)(s16 *src[3], int s_src, int blk_w, int blk_h, int bit_depth, int coef[4], int sft, int out_bit_depth, void *dst, int s_dst);
+typedef void (*oapv_fn_blk_to_rgbf_t)(s16 *src[3], int s_src, int blk_w, int blk_h, int bit_depth, float coef[4], void *dst, int s_dst);
 
 /*****************************************************************************
  * rate-control related
@@ -217,6 +241,17 @@ typedef struct oapve_rc_tile {
     oapve_rc_param_t rc_param;
 } oapve_rc_tile_t;
 
+/* block coding state of an additional rate in a core */
+typedef struct oapve_core_rate {
+    int          qp[N_C];
+    int          dq_shift[N_C];
+    int          q_mat_enc[N_C][OAPV_BLK_D];
+    s16          q_mat_dec[N_C][OAPV_BLK_D];
+    int          kparam_dc[N_C];
+    int          kparam_ac[N_C];
+    int          prev_dc[N_C];
+} oapve_core_rate_t;
+
 /*****************************************************************************
  * CORE information used for encoding process.
  *
@@ -225,6 +260,9 @@ typedef struct oapve_rc_tile {
 struct oapve_core {
     ALIGNED_16(s16 coef[OAPV_BLK_D]);
     ALIGNED_16(s16 coef_rec[OAPV_BLK_D]);
+    ALIGNED_16(s16 coef_tx[OAPV_BLK_D]); // transformed block shared by rates
+    ALIGNED_16(s16 coef_org[OAPV_BLK_D]); // source block kept for quality metric
+    int          coef_tx_valid;
 
     int          kparam_dc[N_C];
     int          kparam_ac[N_C];
@@ -240,13 +278,35 @@ struct oapve_core {
     int          q_mat_enc[N_C][OAPV_BLK_D];
     s16          q_mat_dec[N_C][OAPV_BLK_D];
     double       err_scale_tbl[N_C][OAPV_BLK_D];
+    int          flat_thr[N_C];  // max SAD-to-mean of a block whose AC coefficients are all quantized to zero
+    int          deadzone[2];    // dead-zone offsets of the block coder of current tile
     int          thread_idx;
+    oapv_fn_enc_blk_cost_t fn_enc_blk;
+    oapve_core_rate_t rate[OAPV_MAX_NUM_RATES];
 
     oapve_ctx_t *ctx;
     /* platform specific data, if needed */
     void        *pf;
 };
 
+/* quality metric of a tile (OAPV_CFG_SET_USE_METRIC) */
+typedef struct oapve_metric {
+    u64             ssd[N_C];     /* sum of squared error */
+    int             num_pix[N_C]; /* number of samples */
+    double          ssim[N_C];    /* sum of SSIM of 8x8 windows */
+    int             num_win[N_C]; /* number of SSIM windows */
+} oapve_metric_t;
+
+/* tile of an additional rate */
+typedef struct oapve_tile_rate {
+    oapv_th_t       th;
+    int             qp;
+    u8             *bs_buf;
+    s32             bs_size;
+    u32             bs_buf_max;
+    u64             hash[N_C]; /* hash of reconstructed tile */
+} oapve_tile_rate_t;
+
 typedef struct oapve_tile oapve_tile_t;
 struct oapve_tile {
     oapv_th_t       th;
@@ -261,6 +321,37 @@ struct oapve_tile {
     s32             bs_size;
     u32             bs_buf_max;
     volatile s32    stat;
+    int             preset; /* preset actually used for encoding the tile */
+    int             dqp_fit;   /* QP increase for fitting into frame size limit */
+    int             rate_est;  /* estimated byte size by dry run */
+    int             reused;    /* bitstream of previous access unit is reused */
+    int             rec_pending; /* reconstruction is left to decoding of bitstream */
+    oapve_metric_t  metric;
+    u64             hash[N_C]; /* hash of reconstructed tile for fast frame hash */
+    oapve_tile_rate_t rate[OAPV_MAX_NUM_RATES];
+};
+
+/* tiles of a frame in previous access unit, for reusing unchanged tiles */
+typedef struct oapve_reuse oapve_reuse_t;
+struct oapve_reuse {
+    int             valid;
+    int             cs;
+    int             w;
+    int             h;
+    int             tile_w; /* in unit of MB */
+    int             tile_h; /* in unit of MB */
+    int             num_tiles;
+    u8              q_matrix[N_C][OAPV_BLK_H][OAPV_BLK_W];
+    int             src_ofs[OAPV_MAX_TILES]; /* source samples of tiles in 'src' */
+    u8             *src;
+    int             src_max;
+    oapv_th_t       th[OAPV_MAX_TILES];
+    int             bs_ofs[OAPV_MAX_TILES];
+    int             bs_size[OAPV_MAX_TILES];
+    u8             *bs;
+    int             bs_max;
+    oapv_imgb_t    *imgb_r; /* reconstruction holding the tiles */
+    oapve_metric_t  metric[OAPV_MAX_TILES];
 };
 
 /******************************************************************************
@@ -289,6 +380,9 @@ struct oapve_ctx {
     int                       cfi;
     int                       num_comp;
     int                       bit_depth;
+    int                       in_bit_depth; // bit depth of input image
+    int                       rgb_coef[N_C][4]; // RGB to YCbCr conversion of RGB input
+    int                       rgb_sft;
     int                       comp_sft[N_C][2];
     oapv_tpool_t             *tpool;
     oapv_thread_t             thread_id[OAPV_MAX_THREADS];
@@ -304,21 +398,106 @@ struct oapve_ctx {
     const oapv_fn_sad_t      *fn_sad;
     const oapv_fn_ssd_t      *fn_ssd;
     const oapv_fn_diff_t     *fn_diff;
-    oapv_fn_imgb_to_blk_rc_t  fn_imgb_to_blk_rc;
     oapv_fn_imgb_to_blk_t     fn_imgb_to_blk[N_C];
     oapv_fn_blk_to_imgb_t     fn_blk_to_imgb[N_C];
-    oapv_fn_imgb_pad_t        fn_imgb_pad;
+    oapv_fn_imgb_to_blk_t     fn_imgb_to_blk_16b; // planar 16-bit input
+    oapv_fn_imgb_to_blk_t     fn_imgb_to_blk_8b;  // planar 8-bit input
+    const oapv_fn_imgb_to_blk_t *fn_imgb_to_blk_p21x; // P210 input, by component
+    const oapv_fn_imgb_to_blk_t *fn_imgb_to_blk_uyvy; // UYVY input, by component
+    const oapv_fn_imgb_to_blk_t *fn_imgb_to_blk_v210; // v210 input, by component
+    oapv_fn_rgb_to_blk_t      fn_rgb_to_blk;
     oapv_fn_enc_blk_cost_t    fn_enc_blk;
-    oapv_fn_had8x8_t          fn_had8x8;
+    oapv_fn_had8x8_row_t      fn_had8x8_row;
 
     int                       use_frm_hash;
     oapve_rc_param_t          rc_param;
 
     int                       threads; // num of thread for encoding
     int                       au_bs_fmt; // access unit bitstream format
+
+    int                       use_bs_scatter; // tile bitstreams are not copied to output buffer
+    int                       bs_scatter_frm; // current frame is output in scatter way
+    oapv_bseg_t              *bsegs;          // bitstream segments of output
+    int                       num_bsegs;
+    u8                       *bseg_beg;       // start of current segment in output buffer
+    u32                       bs_ext_size;    // byte size of segments out of output buffer
+
+    oapve_stream_t            stream;         // in-order streaming callback
+    u8                       *stream_pos;     // next byte to stream in output buffer
+    int                       stream_off;     // byte offset of streamed data in AU
+    u8                       *stream_fh_end;  // end of headers before tiles
+    int                       stream_tile;    // next tile to stream
+    int                       stream_err;
+    int                       stream_busy;    // a thread is calling the callback
+
+    /* lookahead: complexity of next access unit is analyzed while the
+       frame of the same index in current access unit is encoded, by the
+       tile threads out of tiles to encode */
+    int                       la_num_frms;
+    oapv_imgb_t              *la_imgb[OAPV_MAX_NUM_FRAMES];     // frames waiting for analysis
+    oapv_imgb_t              *la_res_imgb[OAPV_MAX_NUM_FRAMES]; // frames having analysis result
+    int                       la_res_num_tiles[OAPV_MAX_NUM_FRAMES];
+    double                    la_cost[OAPV_MAX_NUM_FRAMES][OAPV_MAX_TILES];
+    int                       la_num_pixel[OAPV_MAX_NUM_FRAMES][OAPV_MAX_TILES];
+    int                       la_frm;  // index of frame under analysis
+    int                       la_next; // next tile to analyze
+    int                       la_done; // number of analyzed tiles
+    int                       la_err;
+
+    /* tile bitstream buffers are owned by tiles and grow on demand;
+       their total byte size is limited to 'bs_budget' */
+    int                       bs_budget;
+    volatile int              bs_alloc;
+
+    /* tuning values of block coding resolved from preset and parameters */
+    int                       deadzone[2];
+    int                       deadzone_blk[2]; // of enc_block(), for downgraded tiles
+    int                       rdo_itr[2];
+    int                       rdo_adj_rng[2];
+    int                       rdo_max_cand;
+    int                       rdo_full_itr;
+
+    u64                       frm_clk_beg;  // start time of frame encoding (usec)
+    u64                       tile_clk_sum; // sum of encoding time of full-effort tiles in a frame
+    int                       tile_clk_cnt; // number of full-effort tiles in a frame
+    u64                       tile_clk_avg; // average encoding time of a full-effort tile
+    /* constant bitrate; each frame is followed by filler up to 'cbr_frm_bytes' */
+    int                       cbr;
+    int                       cbr_frm_bytes;
+    int                       cbr_md_size;  // bytes of metadata counted in constant bitrate of current frame
+    int                       au_size_max;  // max byte size of access unit (0: no limit)
+    int                       frm_size_max; // max byte size of current frame from 'au_size_max'
+    int                       fit_limit;    // max byte size of frame header and tiles (0: no limit)
+    int                       fit_over;     // frame is over 'fit_limit' after re-encoding
+    int                       fit_seed[OAPV_MAX_NUM_FRAMES]; // QP increase of constant bitrate from previous frame
+    /* reuse of unchanged tiles of previous access unit */
+    int                       use_tile_reuse;
+    oapve_reuse_t             reuse[OAPV_MAX_NUM_FRAMES];
+    oapve_reuse_t            *reuse_ref; // reusable tiles for current frame, if any
+    /* reconstruction by decoding of tile bitstream, not in encoding loop */
+    int                       use_lazy_rec;
+    int                       rec_in_loop; // reconstruction is made in encoding loop
+    /* quality metrics of reconstruction (OAPV_CFG_VAL_METRIC_*) */
+    int                       use_metric;
+    int                       metric_in_loop; // measured in encoding loop
+    /* DC-only coding of flat blocks without forward transform */
+    int                       use_flat_blk;
+    /* additional rates of multi-rate encoding */
+    int                       num_rates;
+    oapve_rate_t             *rates;
+    oapve_rc_param_t          rate_rc[OAPV_MAX_NUM_RATES];  // rate control state of each rate
+    oapv_imgb_t              *rate_imgb_r[OAPV_MAX_NUM_RATES];
+    oapvm_t                   rate_mid; // metadata with frame hash of a rate
     /* platform specific data, if needed */
     void                     *pf;
 };
+
+/* read a block of input image, converted to the bit depth and color space
+   of codec; it is also used by analysis of rate control */
+void oapve_imgb_to_blk(oapve_ctx_t *ctx, oapv_imgb_t *imgb, int c, int x, int y, int w, int h, s16 *blk);
+/* read a block at any position of macroblocks, replicating samples out of
+   the image */
+void oapve_imgb_to_blk_pad(oapve_ctx_t *ctx, oapv_imgb_t *imgb, int c, int blk_x, int blk_y, s16 *blk);
 ///////////////////////////////////////////////////////////////////////////////
 // end of encoder code
 #endif // ENABLE_ENCODER
@@ -346,6 +525,11 @@ struct oapvd_tile {
     u8          *bs_beg; /* start position of tile in input bistream */
     u8          *bs_end; /* end position of tile() in input bistream */
     volatile s32 stat;   // decoding status
+
+    u8          *tc_buf;     /* transcoded tile() including tile_size syntax */
+    u32          tc_buf_max; /* allocated byte size of 'tc_buf' */
+    u32          tc_size;    /* written byte size of 'tc_buf' */
+    u64          hash[N_C];  /* hash of decoded tile for fast frame hash */
 };
 
 typedef struct oapvd_core oapvd_core_t;
@@ -353,6 +537,9 @@ typedef struct oapvd_ctx  oapvd_ctx_t;
 
 struct oapvd_core {
     ALIGNED_16(s16 coef[OAPV_MB_D]);
+    /* decoded macroblock of every component for RGB output; two of them, as
+       a macroblock is converted after the next one is decoded */
+    ALIGNED_32(s16 mb_rec[2][N_C][OAPV_MB_D]);
     s16          q_mat[N_C][OAPV_BLK_D];
 
     int          kparam_dc[N_C];
@@ -363,6 +550,14 @@ struct oapvd_core {
     int          qp[N_C];
     int          dq_shift[N_C];
     int          tile_idx;
+    int          md5_job;   /* first plane of MD5 jobs made by this core */
+
+    /* requantization state of transcoding */
+    int          tc_q_mat_enc[N_C][OAPV_BLK_D];
+    int          tc_qp[N_C];
+    int          tc_kparam_dc[N_C];
+    int          tc_kparam_ac[N_C];
+    int          tc_prev_dc[N_C];
 
     oapvd_ctx_t *ctx;
     /* platform specific data, if needed */
@@ -394,15 +589,47 @@ struct oapvd_ctx {
     oapv_tpool_t           *tpool;
     oapv_thread_t           thread_id[OAPV_MAX_THREADS];
     oapv_sync_obj_t         sync_obj;
+    oapv_fpool_t           *fpool;            // pool of output frames allocated by decoder
     int                     cfi;              // chroma format indicator
     int                     bit_depth;        // bit depth of decoding picture
     int                     num_comp;         // number of components
     int                     comp_sft[N_C][2]; // width or height shift value of each compoents, 0: width, 1: height
     int                     use_frm_hash;
+    int                     frm_hash64;       // fast frame hash is made for current frame
+    /* planes of decoded frames whose MD5 is made by threads */
+    oapv_imgb_t            *md5_imgb[OAPV_MAX_NUM_FRAMES * OAPV_MAX_CC];
+    int                     md5_plane[OAPV_MAX_NUM_FRAMES * OAPV_MAX_CC];
+    int                     md5_num;
+    int                     md5_step;
+
+    /* conversion of decoded YCbCr to RGB output formats */
+    int                     rgb_out;          // output image buffer is in RGB format
+    int                     out_bit_depth;    // bit depth of RGB output
+    int                     rgb_coef[N_C][4]; // coefficients of R, G, B and alpha
+    int                     rgb_sft;
+    float                   rgb_coef_f[N_C][4];
+    oapv_fn_blk_to_rgb_t    fn_blk_to_rgb;
+    oapv_fn_blk_to_rgbf_t   fn_blk_to_rgbf;
+
+#if ENABLE_ENCODER
+    /* coefficient-domain transcoding (oapv_transcode) */
+    const oapv_fn_quant_t  *fn_quant;
+    oapv_transcode_param_t *tcp;   // not NULL while transcoding
+    oapv_fh_t               tc_fh; // frame header of transcoded frame
+    int                     tc_deadzone[2]; // dead-zone offsets of requantization
+    oapvm_t                 tc_mid;
+#endif
 
     /* platform specific data, if needed */
     void                   *pf;
 };
+
+/* decoding steps of a frame, shared with coefficient-domain transcoding */
+oapvd_ctx_t *oapvd_id_to_ctx(oapvd_t id);
+int oapvd_frm_prepare(oapvd_ctx_t *ctx, oapv_imgb_t *imgb);
+int oapvd_frm_finish(oapvd_ctx_t *ctx);
+int oapvd_run_tiles(oapvd_ctx_t *ctx);
+void oapvd_tile_set_qp(oapvd_ctx_t *ctx, oapvd_core_t *core, oapvd_tile_t *tile);
 ///////////////////////////////////////////////////////////////////////////////
 // end of decoder code
 #endif // ENABLE_DECODER
@@ -418,13 +645,16 @@ struct oapvd_ctx {
 #include "oapv_tbl.h"
 #include "oapv_rc.h"
 #include "oapv_sad.h"
+#include "oapv_cvt.h"
 #include "oapv_param.h"
 
 #if X86_SSE
 #include "sse/oapv_sad_sse.h"
 #include "sse/oapv_tq_sse.h"
+#include "sse/oapv_cvt_sse.h"
 #include "avx/oapv_sad_avx.h"
 #include "avx/oapv_tq_avx.h"
+#include "avx/oapv_cvt_avx.h"
 #elif ARM_NEON
 #include "neon/oapv_sad_neon.h"
 #include "neon/oapv_tq_neon.h"
@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2022 Samsung Electronics Co., Ltd.
+ * All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * - Neither the name of the copyright owner, nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // for madvise()
+#endif
+
+#include "oapv_def.h"
+#include "oapv_fpool.h"
+#if defined(_WIN32)
+#include <malloc.h>
+#else
+#include <stdlib.h>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+#endif
+
+#define FPOOL_ALIGN     (64)
+#define FPOOL_HUGE_PAGE (2 << 20)
+#define FPOOL_MAX_FREE  (OAPV_MAX_NUM_FRAMES * 2)
+
+typedef struct fpool_imgb {
+    oapv_imgb_t   imgb; // has to be the first member
+    oapv_fpool_t *fp;
+} fpool_imgb_t;
+
+struct oapv_fpool {
+    oapv_sync_obj_t sync;
+    int             refcnt; // owner and image buffers in use
+    int             closed; // owner has deleted the pool
+    int             huge_page;
+    int             num_free;
+    fpool_imgb_t   *free[FPOOL_MAX_FREE];
+};
+
+static void *fpool_plane_alloc(int size, int huge_page)
+{
+    void *p = NULL;
+#if defined(_WIN32)
+    p = _aligned_malloc(size, FPOOL_ALIGN);
+#else
+    int align = FPOOL_ALIGN;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if(huge_page && size >= FPOOL_HUGE_PAGE) {
+        align = FPOOL_HUGE_PAGE;
+        size = oapv_align_value(size, FPOOL_HUGE_PAGE);
+    }
+#endif
+    if(posix_memalign(&p, align, size) != 0) {
+        return NULL;
+    }
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if(align == FPOOL_HUGE_PAGE) {
+        madvise(p, size, MADV_HUGEPAGE); // just a hint; ignored if unavailable
+    }
+#endif
+#endif
+    return p;
+}
+
+static void fpool_plane_free(void *p)
+{
+#if defined(_WIN32)
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+static void fpool_imgb_free(fpool_imgb_t *fi)
+{
+    for(int i = 0; i < fi->imgb.np; i++) {
+        fpool_plane_free(fi->imgb.baddr[i]);
+    }
+    oapv_mfree(fi);
+}
+
+static void fpool_free(oapv_fpool_t *fp)
+{
+    oapv_tpool_sync_obj_delete(&fp->sync);
+    oapv_mfree(fp);
+}
+
+static int fpool_imgb_addref(oapv_imgb_t *imgb)
+{
+    oapv_fpool_t *fp = ((fpool_imgb_t *)imgb)->fp;
+    int           cnt;
+
+    oapv_tpool_enter_cs(fp->sync);
+    cnt = ++imgb->refcnt;
+    oapv_tpool_leave_cs(fp->sync);
+    return cnt;
+}
+
+static int fpool_imgb_getref(oapv_imgb_t *imgb)
+{
+    oapv_fpool_t *fp = ((fpool_imgb_t *)imgb)->fp;
+    int           cnt;
+
+    oapv_tpool_enter_cs(fp->sync);
+    cnt = imgb->refcnt;
+    oapv_tpool_leave_cs(fp->sync);
+    return cnt;
+}
+
+static int fpool_imgb_release(oapv_imgb_t *imgb)
+{
+    fpool_imgb_t *fi = (fpool_imgb_t *)imgb;
+    oapv_fpool_t *fp = fi->fp;
+    int           cnt, del_pool = 0;
+
+    oapv_tpool_enter_cs(fp->sync);
+    cnt = --imgb->refcnt;
+    if(cnt == 0) {
+        // back to pool for recycling, unless the pool is deleted or full
+        if(!fp->closed && fp->num_free < FPOOL_MAX_FREE) {
+            fp->free[fp->num_free++] = fi;
+            fi = NULL;
+        }
+        del_pool = (--fp->refcnt == 0);
+    }
+    else {
+        fi = NULL;
+    }
+    oapv_tpool_leave_cs(fp->sync);
+
+    if(fi != NULL) {
+        fpool_imgb_free(fi);
+    }
+    if(del_pool) {
+        fpool_free(fp);
+    }
+    return cnt;
+}
+
+static fpool_imgb_t *fpool_imgb_alloc(oapv_fpool_t *fp, int w, int h, int cs)
+{
+    fpool_imgb_t *fi;
+    oapv_imgb_t  *imgb;
+    int           cfi = color_format_to_chroma_format_idc(OAPV_CS_GET_FORMAT(cs));
+    int           byte_depth = OAPV_CS_GET_BYTE_DEPTH(cs);
+
+    fi = (fpool_imgb_t *)oapv_malloc(sizeof(fpool_imgb_t));
+    oapv_assert_rv(fi != NULL, NULL);
+    oapv_mset(fi, 0, sizeof(fpool_imgb_t));
+    fi->fp = fp;
+    imgb = &fi->imgb;
+    imgb->np = get_num_comp(cfi);
+
+    for(int i = 0; i < imgb->np; i++) {
+        int sw = (i == 0) ? 0 : get_chroma_sft_w(cfi);
+        int sh = (i == 0) ? 0 : get_chroma_sft_h(cfi);
+        // width and height are aligned to macroblock size for decoding
+        imgb->w[i] = (w + (1 << sw) - 1) >> sw;
+        imgb->h[i] = (h + (1 << sh) - 1) >> sh;
+        imgb->aw[i] = oapv_align_value(w, OAPV_MB_W) >> sw;
+        imgb->ah[i] = oapv_align_value(h, OAPV_MB_H) >> sh;
+        imgb->s[i] = oapv_align_value(imgb->aw[i] * byte_depth, FPOOL_ALIGN);
+        imgb->e[i] = imgb->ah[i];
+        imgb->bsize[i] = imgb->s[i] * imgb->e[i];
+        imgb->a[i] = imgb->baddr[i] = fpool_plane_alloc(imgb->bsize[i], fp->huge_page);
+        if(imgb->a[i] == NULL) {
+            fpool_imgb_free(fi);
+            return NULL;
+        }
+    }
+    imgb->cs = cs;
+    imgb->addref = fpool_imgb_addref;
+    imgb->getref = fpool_imgb_getref;
+    imgb->release = fpool_imgb_release;
+    return fi;
+}
+
+oapv_fpool_t *oapv_fpool_create(void)
+{
+    oapv_fpool_t *fp = (oapv_fpool_t *)oapv_malloc(sizeof(oapv_fpool_t));
+    oapv_assert_rv(fp != NULL, NULL);
+    oapv_mset(fp, 0, sizeof(oapv_fpool_t));
+    fp->sync = oapv_tpool_sync_obj_create();
+    if(fp->sync == NULL) {
+        oapv_mfree(fp);
+        return NULL;
+    }
+    fp->refcnt = 1;
+    return fp;
+}
+
+void oapv_fpool_delete(oapv_fpool_t *fp)
+{
+    int del_pool;
+
+    oapv_tpool_enter_cs(fp->sync);
+    while(fp->num_free > 0) {
+        fpool_imgb_free(fp->free[--fp->num_free]);
+    }
+    fp->closed = 1;
+    del_pool = (--fp->refcnt == 0);
+    oapv_tpool_leave_cs(fp->sync);
+
+    if(del_pool) {
+        fpool_free(fp);
+    }
+}
+
+void oapv_fpool_set_huge_page(oapv_fpool_t *fp, int enable)
+{
+    fp->huge_page = enable;
+}
+
+oapv_imgb_t *oapv_fpool_get(oapv_fpool_t *fp, int w, int h, int cs)
+{
+    fpool_imgb_t *fi = NULL;
+
+    oapv_tpool_enter_cs(fp->sync);
+    while(fp->num_free > 0) {
+        fi = fp->free[--fp->num_free];
+        if(fi->imgb.cs == cs && fi->imgb.w[0] == w && fi->imgb.h[0] == h) {
+            break;
+        }
+        fpool_imgb_free(fi); // not reusable after change of stream
+        fi = NULL;
+    }
+    oapv_tpool_leave_cs(fp->sync);
+
+    if(fi == NULL) {
+        fi = fpool_imgb_alloc(fp, w, h, cs);
+        oapv_assert_rv(fi != NULL, NULL);
+    }
+    // clear what previous user has left
+    oapv_mset(fi->imgb.x, 0, sizeof(fi->imgb.x));
+    oapv_mset(fi->imgb.y, 0, sizeof(fi->imgb.y));
+    oapv_mset(fi->imgb.ts, 0, sizeof(fi->imgb.ts));
+    oapv_mset(fi->imgb.ndata, 0, sizeof(fi->imgb.ndata));
+    oapv_mset(fi->imgb.pdata, 0, sizeof(fi->imgb.pdata));
+    fi->imgb.refcnt = 1;
+
+    oapv_tpool_enter_cs(fp->sync);
+    fp->refcnt++;
+    oapv_tpool_leave_cs(fp->sync);
+    return &fi->imgb;
+}
@@ -248,17 +248,15 @@ int oapvm_get(oapvm_t mid, int group_id, int type, void **data, int *size, unsig
 {
     oapvm_ctx_t *ctx = meta_id_to_ctx(mid);
     oapv_assert_rv(ctx, OAPV_ERR_INVALID_ARGUMENT);
+    // absence of payload is a normal result of query, not an error
     oapv_md_t   *md = meta_find_md(ctx, group_id);
-    oapv_assert_g(md != NULL, ERR);
-    oapv_mdp_t *mdp = meta_find_mdp(md, type, uuid);
-    oapv_assert_g(mdp != NULL, ERR);
-
+    oapv_mdp_t  *mdp = (md != NULL) ? meta_find_mdp(md, type, uuid) : NULL;
+    if(mdp == NULL) {
+        return OAPV_ERR_NOT_FOUND;
+    }
     *data = mdp->pld_data;
     *size = mdp->pld_size;
     return OAPV_OK;
-
-ERR:
-    return OAPV_ERR_NOT_FOUND;
 }
 
 int oapvm_rem(oapvm_t mid, int group_id, int type, unsigned char *uuid)
@@ -51,6 +51,12 @@ int oapve_param_default(oapve_param_t *param)
 
     param->use_q_matrix = 0;
 
+    param->deadzone[0] = param->deadzone[1] = OAPVE_PARAM_TUNE_AUTO;
+    param->rdo_itr[0] = param->rdo_itr[1] = OAPVE_PARAM_TUNE_AUTO;
+    param->rdo_adj_rng[0] = param->rdo_adj_rng[1] = OAPVE_PARAM_TUNE_AUTO;
+    param->rdo_max_cand = OAPVE_PARAM_TUNE_AUTO;
+    param->rdo_full_itr = OAPVE_PARAM_TUNE_AUTO;
+
     for(int c = 0; c < OAPV_MAX_CC; c++) {
         for(int i = 0; i < OAPV_BLK_D; i++) {
             param->q_matrix[c][i] = 16;
@@ -203,6 +209,46 @@ int oapve_param_parse(oapve_param_t *param, const char *name,  const char *value
         }
         param->preset = ti0;
     }
+    NAME_CMP("frm-time-budget") {
+        GET_INTEGER_MIN_OR_ERR(value, ti0, 0, OAPV_ERR_INVALID_ARGUMENT);
+        param->frm_time_budget = ti0;
+    }
+    NAME_CMP("rc-subsample") {
+        GET_INTEGER_MIN_MAX_OR_ERR(value, ti0, 0, 16, OAPV_ERR_INVALID_ARGUMENT);
+        param->rc_subsample = ti0;
+    }
+    NAME_CMP("deadzone-y") {
+        GET_INTEGER_MIN_MAX_OR_ERR(value, ti0, 0, 511, OAPV_ERR_INVALID_ARGUMENT);
+        param->deadzone[0] = ti0;
+    }
+    NAME_CMP("deadzone-c") {
+        GET_INTEGER_MIN_MAX_OR_ERR(value, ti0, 0, 511, OAPV_ERR_INVALID_ARGUMENT);
+        param->deadzone[1] = ti0;
+    }
+    NAME_CMP("rdo-itr-y") {
+        GET_INTEGER_MIN_MAX_OR_ERR(value, ti0, 0, 16, OAPV_ERR_INVALID_ARGUMENT);
+        param->rdo_itr[0] = ti0;
+    }
+    NAME_CMP("rdo-itr-c") {
+        GET_INTEGER_MIN_MAX_OR_ERR(value, ti0, 0, 16, OAPV_ERR_INVALID_ARGUMENT);
+        param->rdo_itr[1] = ti0;
+    }
+    NAME_CMP("rdo-adj-rng-y") {
+        GET_INTEGER_MIN_MAX_OR_ERR(value, ti0, 1, 15, OAPV_ERR_INVALID_ARGUMENT);
+        param->rdo_adj_rng[0] = ti0;
+    }
+    NAME_CMP("rdo-adj-rng-c") {
+        GET_INTEGER_MIN_MAX_OR_ERR(value, ti0, 1, 15, OAPV_ERR_INVALID_ARGUMENT);
+        param->rdo_adj_rng[1] = ti0;
+    }
+    NAME_CMP("rdo-max-cand") {
+        GET_INTEGER_MIN_MAX_OR_ERR(value, ti0, 1, OAPV_FULL_RDO_MAX_CAND, OAPV_ERR_INVALID_ARGUMENT);
+        param->rdo_max_cand = ti0;
+    }
+    NAME_CMP("rdo-full-itr") {
+        GET_INTEGER_MIN_MAX_OR_ERR(value, ti0, 0, 16, OAPV_ERR_INVALID_ARGUMENT);
+        param->rdo_full_itr = ti0;
+    }
     NAME_CMP("width") {
         GET_INTEGER_OR_ERR(value, ti0, OAPV_ERR_INVALID_WIDTH);
         oapv_assert_rv(ti0 > 0, OAPV_ERR_INVALID_WIDTH);
@@ -264,6 +310,10 @@ int oapve_param_parse(oapve_param_t *param, const char *name,  const char *value
         }
         else return OAPV_ERR_INVALID_ARGUMENT;
     }
+    NAME_CMP("use-filler") {
+        GET_INTEGER_MIN_MAX_OR_ERR(value, ti0, 0, 1, OAPV_ERR_INVALID_ARGUMENT);
+        param->use_filler = ti0;
+    }
     NAME_CMP("q-matrix-c0") {
 
         if(get_q_matrix(value, q_matrix)) {
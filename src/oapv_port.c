@@ -29,6 +29,10 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L // for clock_gettime() with strict ISO C
+#endif
+
 #include <stdarg.h>
 #include "oapv_port.h"
 
@@ -94,6 +98,7 @@ void oapv_trace_line(char *pre)
 #include <sysinfoapi.h>
 #else /* LINUX, MACOS, Android */
 #include <unistd.h>
+#include <time.h>
 #endif
 
 int oapv_get_num_cpu_cores(void)
@@ -120,3 +125,17 @@ int oapv_get_num_cpu_cores(void)
 #endif
     return num_cores;
 }
+
+u64 oapv_clk_usec(void)
+{
+#if defined(WIN32) || defined(WIN64) || defined(_WIN32)
+    LARGE_INTEGER freq, cnt;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&cnt);
+    return (u64)(cnt.QuadPart / freq.QuadPart) * 1000000 + (u64)(cnt.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000 + (u64)ts.tv_nsec / 1000;
+#endif
+}
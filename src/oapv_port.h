@@ -203,5 +203,8 @@ static __inline void oapv_mset_16b(s16 *dst, s16 v, int cnt)
 /* CPU information */
 int oapv_get_num_cpu_cores(void);
 
+/* monotonic clock in unit of micro-second */
+u64 oapv_clk_usec(void);
+
 #endif /* _OAPV_PORT_H_ */
 
@@ -31,26 +31,92 @@
 
 #include "oapv_rc.h"
 
-int oapve_rc_get_tile_cost(oapve_ctx_t* ctx, oapve_core_t* core, oapve_tile_t* tile)
+/* cost of 'num_blk' blocks in a row of input image, which is not read by
+   oapv_had8x8_row() in place; blocks are converted as encoding does */
+static s64 rc_had8x8_row_cvt(oapve_ctx_t* ctx, oapv_imgb_t* imgb, int c, int x, int y, int num_blk)
 {
-    int sum = 0;
-    tile->rc.number_pixel = 0;
+    ALIGNED_16(pel blk[64]);
+    s64 sum = 0;
+
+    for (int b = 0; b < num_blk; b++) {
+        oapve_imgb_to_blk(ctx, imgb, c, x + b * 8, y, 8, 8, blk);
+        sum += oapv_dc_removed_had8x8(blk, 8);
+    }
+    return sum;
+}
+
+int oapve_rc_get_tile_cost(oapve_ctx_t* ctx, oapve_core_t* core, oapv_imgb_t* imgb, oapve_tile_t* tile, double* cost, int* num_pixel)
+{
+    int cf = OAPV_CS_GET_FORMAT(imgb->cs);
+    int p210 = (cf == OAPV_CF_PLANAR2);
+    /* samples of packed and RGB formats and of the other bit depth than
+       codec are converted before the analysis, as encoding does */
+    int in_place = p210 || (cf != OAPV_CF_UYVY && cf != OAPV_CF_V210 && !color_format_is_rgb(cf) && ctx->in_bit_depth == ctx->bit_depth);
+    int sub = (ctx->param->rc_subsample > 1) ? ctx->param->rc_subsample : 1;
+    s64 sum = 0;
+
+    *num_pixel = 0;
     for (int c = Y_C; c < ctx->num_comp; c++) {
-        int step_w = 8 << ctx->comp_sft[c][0];
-        int step_h = 8 << ctx->comp_sft[c][1];
-        for (int y = 0; y < tile->h; y += step_h) {
-            for (int x = 0; x < tile->w; x += step_w) {
-                int tx = tile->x + x;
-                int ty = tile->y + y;
-
-                ctx->fn_imgb_to_blk_rc(ctx->imgb_i, c, tx, ty, 8, 8, core->coef, ctx->bit_depth);
-                sum += ctx->fn_had8x8(core->coef, 8);
-                tile->rc.number_pixel += 64;
+        int sft_w = ctx->comp_sft[c][0];
+        int sft_h = ctx->comp_sft[c][1];
+        int step_w = 8 << sft_w;
+        int step_h = 8 << sft_h;
+        int num_blk = (tile->w + step_w - 1) / step_w;
+        int num_row = (tile->h + step_h - 1) / step_h;
+        int step, ofs, shift, s_src, row_cnt = 0;
+        s64 csum = 0;
+        u8* plane;
+        ALIGNED_16(pel blk[64]);
+
+        if (p210) {
+            /* luma plane and interleaved UV plane, MSB aligned */
+            int tc = (c == Y_C) ? 0 : 1;
+            plane = (u8*)imgb->a[tc];
+            s_src = imgb->s[tc];
+            step = tc + 1;
+            ofs = c >> 1;
+            shift = 16 - ctx->bit_depth;
+        }
+        else {
+            plane = (u8*)imgb_comp_plane(imgb, c, &s_src);
+            step = 1;
+            ofs = 0;
+            shift = 0;
+        }
+        /* input image is not padded, so the blocks over right and bottom
+           edges are read with the samples out of it replicated, as encoding
+           does, and the others are read in rows */
+        int bx = tile->x >> sft_w;
+        int num_in = oapv_max(0, oapv_min(num_blk, ((imgb->w[0] >> sft_w) - bx) / 8));
+        int comp_h = imgb->h[0] >> sft_h;
+
+        for (int r = 0; r < num_row; r += sub) {
+            int by = (tile->y >> sft_h) + r * 8;
+            int n = (by + 8 <= comp_h) ? num_in : 0;
+            if (n > 0) {
+                if (!in_place) {
+                    csum += rc_had8x8_row_cvt(ctx, imgb, c, bx, by, n);
+                }
+                else {
+                    u16* row16 = (u16*)(plane + by * s_src);
+                    csum += ctx->fn_had8x8_row(row16 + bx * step, s_src >> 1, step, ofs, shift, n);
+                }
             }
+            for (int b = n; b < num_blk; b++) {
+                oapve_imgb_to_blk_pad(ctx, imgb, c, bx + b * 8, by, blk);
+                csum += oapv_dc_removed_had8x8(blk, 8);
+            }
+            row_cnt++;
+        }
+        /* extrapolate the skipped block rows from the analyzed ones */
+        if (row_cnt < num_row) {
+            csum = (csum * num_row + (row_cnt >> 1)) / row_cnt;
         }
+        sum += csum;
+        *num_pixel += 64 * num_blk * num_row;
     }
 
-    tile->rc.cost = sum;
+    *cost = (double)sum;
 
     return OAPV_OK;
 }
@@ -77,7 +143,7 @@ int get_tile_cost_thread(void* arg)
             break;
         }
 
-        ret = oapve_rc_get_tile_cost(ctx, core, &tile[tidx]);
+        ret = oapve_rc_get_tile_cost(ctx, core, ctx->imgb_i, &tile[tidx], &tile[tidx].rc.cost, &tile[tidx].rc.number_pixel);
         oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
 
         oapv_tpool_enter_cs(ctx->sync_obj);
@@ -127,16 +193,16 @@ static double rc_calculate_lambda(double alpha, double beta, double cost_pixel,
     return ((alpha / 256.0) * pow(cost_pixel / bits_pixel, beta));
 }
 
-double oapve_rc_estimate_pic_lambda(oapve_ctx_t* ctx, double cost)
+double oapve_rc_estimate_pic_lambda(oapve_ctx_t* ctx, oapve_rc_param_t* rc_param, int bitrate, double cost)
 {
     int num_pixel = ctx->w * ctx->h;
     for (int c = 1; c < ctx->num_comp; c++) {
         num_pixel += (ctx->w * ctx->h) >> (ctx->comp_sft[c][0] + ctx->comp_sft[c][1]);
     }
 
-    double alpha = ctx->rc_param.alpha;
-    double beta = ctx->rc_param.beta;
-    double bpp = ((double)ctx->param->bitrate * 1000) / ((double)num_pixel * ((double)ctx->param->fps_num / ctx->param->fps_den));
+    double alpha = rc_param->alpha;
+    double beta = rc_param->beta;
+    double bpp = ((double)bitrate * 1000) / ((double)num_pixel * ((double)ctx->param->fps_num / ctx->param->fps_den));
 
     double est_lambda = rc_calculate_lambda(alpha, beta, pow(cost / (double)num_pixel, OAPV_RC_BETA), bpp);
     est_lambda = oapv_clip3(0.1, 10000.0, est_lambda);
@@ -154,15 +220,15 @@ int oapve_rc_estimate_pic_qp(double lambda)
     return qp;
 }
 
-void oapve_rc_get_qp(oapve_ctx_t* ctx, oapve_tile_t* tile, int frame_qp, int* qp)
+void oapve_rc_get_qp(oapve_ctx_t* ctx, oapve_rc_param_t* rc_param, oapve_tile_t* tile, double target_bits, int frame_qp, int* qp)
 {
-    double   alpha = ctx->rc_param.alpha;
-    double   beta = ctx->rc_param.beta;
+    double   alpha = rc_param->alpha;
+    double   beta = rc_param->beta;
 
     double cost_pixel = tile->rc.cost / (double)tile->rc.number_pixel;
     cost_pixel = pow(cost_pixel, OAPV_RC_BETA);
 
-    double bit_pixel =  (double)tile->rc.target_bits / (double)tile->rc.number_pixel;
+    double bit_pixel =  target_bits / (double)tile->rc.number_pixel;
     double est_lambda = rc_calculate_lambda(alpha, beta, cost_pixel, bit_pixel);
 
     int min_qp = frame_qp - 2 - OAPV_RC_QP_OFFSET;
@@ -180,7 +246,7 @@ void oapve_rc_get_qp(oapve_ctx_t* ctx, oapve_tile_t* tile, int frame_qp, int* qp
     *qp = oapv_clip3(MIN_QUANT, MAX_QUANT(10), *qp);
 }
 
-void oapve_rc_update_after_pic(oapve_ctx_t* ctx, double cost)
+void oapve_rc_update_after_pic(oapve_ctx_t* ctx, oapve_rc_param_t* rc_param, int bitrate, u32* tile_size, double cost)
 {
     int num_pixel = ctx->w * ctx->h;
     for (int c = 1; c < ctx->num_comp; c++) {
@@ -189,14 +255,14 @@ void oapve_rc_update_after_pic(oapve_ctx_t* ctx, double cost)
 
     int total_bits = 0;
     for (int i = 0; i < ctx->num_tiles; i++) {
-        total_bits += ctx->fh.tile_size[i] * 8;
+        total_bits += tile_size[i] * 8;
     }
 
     double ln_bpp = log(pow(cost / (double)num_pixel, OAPV_RC_BETA));
-    double diff_lambda = (ctx->rc_param.beta) * (log((double)total_bits) - log(((double)ctx->param->bitrate * 1000 / ((double)ctx->param->fps_num / ctx->param->fps_den))));
+    double diff_lambda = (rc_param->beta) * (log((double)total_bits) - log(((double)bitrate * 1000 / ((double)ctx->param->fps_num / ctx->param->fps_den))));
 
     diff_lambda = oapv_clip3(-0.125, 0.125, 0.25 * diff_lambda);
-    ctx->rc_param.alpha = (ctx->rc_param.alpha) * exp(diff_lambda);
-    ctx->rc_param.beta = (ctx->rc_param.beta) + diff_lambda / ln_bpp;
-    ctx->rc_param.is_updated = 1;
+    rc_param->alpha = (rc_param->alpha) * exp(diff_lambda);
+    rc_param->beta = (rc_param->beta) + diff_lambda / ln_bpp;
+    rc_param->is_updated = 1;
 }
@@ -39,11 +39,11 @@
 #define OAPV_RC_BETA                      (1.2517)
 #define OAPV_RC_QP_OFFSET                  12
 
-int oapve_rc_get_tile_cost(oapve_ctx_t* ctx, oapve_core_t* core, oapve_tile_t* tile);
-double oapve_rc_estimate_pic_lambda(oapve_ctx_t* ctx, double cost);
+int oapve_rc_get_tile_cost(oapve_ctx_t* ctx, oapve_core_t* core, oapv_imgb_t* imgb, oapve_tile_t* tile, double* cost, int* num_pixel);
+double oapve_rc_estimate_pic_lambda(oapve_ctx_t* ctx, oapve_rc_param_t* rc_param, int bitrate, double cost);
 int oapve_rc_estimate_pic_qp(double lambda);
-void oapve_rc_get_qp(oapve_ctx_t* ctx, oapve_tile_t* tile, int frame_qp, int* qp);
-void oapve_rc_update_after_pic(oapve_ctx_t* ctx, double cost);
+void oapve_rc_get_qp(oapve_ctx_t* ctx, oapve_rc_param_t* rc_param, oapve_tile_t* tile, double target_bits, int frame_qp, int* qp);
+void oapve_rc_update_after_pic(oapve_ctx_t* ctx, oapve_rc_param_t* rc_param, int bitrate, u32* tile_size, double cost);
 int oapve_rc_get_tile_cost_thread(oapve_ctx_t* ctx, u64* sum);
 
 #endif
\ No newline at end of file
@@ -207,4 +207,25 @@ int oapv_dc_removed_had8x8(pel *org, int s_org)
     satd = ((satd + 2) >> 2);
 
     return satd;
-}
\ No newline at end of file
+}
+
+/* sum of DC removed hadamard costs of 'num_blk' 8x8 blocks in a row.
+   sample (x, y) is src[y * s_src + x * step + ofs] >> shift, so that
+   interleaved (step 2) and MSB aligned formats are read in place */
+int oapv_had8x8_row(u16 *src, int s_src, int step, int ofs, int shift, int num_blk)
+{
+    pel blk[64];
+    int sum = 0;
+
+    for(int b = 0; b < num_blk; b++) {
+        u16 *s = src + b * 8 * step + ofs;
+        for(int i = 0; i < 8; i++) {
+            for(int j = 0; j < 8; j++) {
+                blk[i * 8 + j] = s[j * step] >> shift;
+            }
+            s += s_src;
+        }
+        sum += oapv_dc_removed_had8x8(blk, 8);
+    }
+    return sum;
+}
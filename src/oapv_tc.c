@@ -0,0 +1,539 @@
+/*
+ * Copyright (c) 2022 Samsung Electronics Co., Ltd.
+ * All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * - Neither the name of the copyright owner, nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "oapv_tc.h"
+
+#if ENABLE_DECODER && ENABLE_ENCODER
+
+/* bitstream of transcoded tile grows on demand */
+static int tc_reserve(oapvd_tile_t *tile, oapv_bs_t *bs, int size)
+{
+    int written = (int)(bs->cur - bs->beg);
+    // bit writer flushes 4 bytes beyond 'cur' at once
+    if(bs->end - bs->cur >= size + 4) {
+        return OAPV_OK;
+    }
+    int new_size = oapv_max(tile->tc_buf_max << 1, written + size + 4);
+    u8 *buf = (u8 *)oapv_malloc(new_size);
+    oapv_assert_rv(buf != NULL, OAPV_ERR_OUT_OF_MEMORY);
+
+    oapv_mcpy(buf, bs->beg, written);
+    oapv_mfree(tile->tc_buf);
+    bs->beg = buf;
+    bs->cur = buf + written;
+    bs->end = buf + new_size;
+    bs->size = new_size;
+    tile->tc_buf = buf;
+    tile->tc_buf_max = new_size;
+    return OAPV_OK;
+}
+
+static int tc_tile_comp(oapvd_tile_t *tile, oapvd_ctx_t *ctx, oapvd_core_t *core, oapv_bs_t *bs, oapv_bs_t *bsw, int c)
+{
+    int mb_h, mb_w, mb_y, mb_x, blk_y, blk_x;
+    int le, ri, to, bo;
+    int ret, dc_diff;
+    int bs_beg = (int)(bsw->cur - bsw->beg);
+    int deadzone = ctx->tc_deadzone[c ? 1 : 0];
+
+    mb_h = OAPV_MB_H >> ctx->comp_sft[c][1];
+    mb_w = OAPV_MB_W >> ctx->comp_sft[c][0];
+
+    le = tile->x >> ctx->comp_sft[c][0];        // left position of tile
+    ri = (tile->w >> ctx->comp_sft[c][0]) + le; // right pixel position of tile
+    to = tile->y >> ctx->comp_sft[c][1];        // top pixel position of tile
+    bo = (tile->h >> ctx->comp_sft[c][1]) + to; // bottom pixel position of tile
+
+    for(mb_y = to; mb_y < bo; mb_y += mb_h) {
+        for(mb_x = le; mb_x < ri; mb_x += mb_w) {
+            ret = tc_reserve(tile, bsw, OAPV_ENC_MB_BS_MAX);
+            oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+
+            for(blk_y = mb_y; blk_y < (mb_y + mb_h); blk_y += OAPV_BLK_H) {
+                for(blk_x = mb_x; blk_x < (mb_x + mb_w); blk_x += OAPV_BLK_W) {
+                    oapv_mset_x128(core->coef, 0, sizeof(s16) * OAPV_BLK_D);
+
+                    ret = oapvd_vlc_dc_coef(bs, &core->dc_diff, &core->kparam_dc[c]);
+                    oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+                    ret = oapvd_vlc_ac_coef(bs, core->coef, &core->kparam_ac[c]);
+                    oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+
+                    // DC prediction and inverse quantization as decoding,
+                    // then quantization as encoding without transforms
+                    core->coef[0] = core->dc_diff + core->prev_dc[c];
+                    core->prev_dc[c] = core->coef[0];
+                    ctx->fn_dquant[0](core->coef, core->q_mat[c], OAPV_LOG2_BLK_W, OAPV_LOG2_BLK_H, core->dq_shift[c]);
+                    ctx->fn_quant[0](core->coef, core->tc_qp[c], core->tc_q_mat_enc[c], OAPV_LOG2_BLK_W, OAPV_LOG2_BLK_H, ctx->bit_depth, deadzone);
+
+                    dc_diff = core->coef[0] - core->tc_prev_dc[c];
+                    core->tc_prev_dc[c] = core->coef[0];
+                    oapve_vlc_dc_coef(bsw, dc_diff, &core->tc_kparam_dc[c]);
+                    oapve_vlc_ac_coef(bsw, core->coef, &core->tc_kparam_ac[c]);
+                }
+            }
+        }
+    }
+
+    oapv_bsr_align8(bs);
+    oapv_assert_rv(BSR_GET_READ_BYTE(bs) <= tile->th.tile_data_size[c], OAPV_ERR_MALFORMED_BITSTREAM);
+
+    while(!bsw_is_align8(bsw)) {
+        oapv_bsw_write1(bsw, 0);
+    }
+    oapv_bsw_deinit(bsw);
+    return (int)(bsw->cur - bsw->beg) - bs_beg;
+}
+
+/* requantize a tile into 'tile->tc_buf' */
+int oapvd_tc_tile(oapvd_core_t *core, oapvd_tile_t *tile)
+{
+    int          ret, c;
+    oapvd_ctx_t *ctx = core->ctx;
+    oapv_bs_t    bs, bsw;
+    oapv_th_t    th;
+
+    oapv_bsr_init(&bs, tile->bs_beg + OAPV_TILE_SIZE_LEN, tile->data_size, NULL);
+    ret = oapvd_vlc_tile_header(&bs, ctx, &tile->th);
+    oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+
+    u32 size = tile->data_size + OAPV_TILE_SIZE_LEN;
+    u32 buf_size = size + (size >> 3) + OAPV_ENC_MB_BS_MAX;
+    if(tile->tc_buf_max < buf_size) {
+        oapv_mfree(tile->tc_buf);
+        tile->tc_buf = (u8 *)oapv_malloc(buf_size);
+        tile->tc_buf_max = (tile->tc_buf != NULL) ? buf_size : 0;
+        oapv_assert_rv(tile->tc_buf != NULL, OAPV_ERR_OUT_OF_MEMORY);
+    }
+
+    int same = !ctx->tcp->use_q_matrix || !oapv_mcmp(ctx->fh.q_matrix, ctx->tc_fh.q_matrix, sizeof(ctx->fh.q_matrix));
+    oapv_mcpy(&th, &tile->th, sizeof(oapv_th_t));
+    for(c = 0; c < ctx->num_comp; c++) {
+        th.tile_qp[c] = oapv_clip3(MIN_QUANT, MAX_QUANT(ctx->bit_depth), tile->th.tile_qp[c] + ctx->tcp->dqp);
+        same = same && (th.tile_qp[c] == tile->th.tile_qp[c]);
+    }
+    if(same) {
+        // nothing to be changed
+        oapv_mcpy(tile->tc_buf, tile->bs_beg, size);
+        tile->tc_size = size;
+        return OAPV_OK;
+    }
+
+    oapvd_tile_set_qp(ctx, core, tile);
+    for(c = 0; c < ctx->num_comp; c++) {
+        int qscale = oapv_quant_scale[th.tile_qp[c] % 6] << 4; // 15bit + 4bit
+        for(int i = 0; i < OAPV_BLK_D; i++) {
+            core->tc_q_mat_enc[c][i] = qscale / ctx->tc_fh.q_matrix[c][i >> OAPV_LOG2_BLK_W][i & (OAPV_BLK_W - 1)];
+        }
+        core->tc_qp[c] = th.tile_qp[c];
+        core->tc_kparam_dc[c] = OAPV_KPARAM_DC_MAX;
+        core->tc_kparam_ac[c] = OAPV_KPARAM_AC_MIN;
+        core->tc_prev_dc[c] = 0;
+        th.tile_data_size[c] = 1; // prevents underflow of dummy writing
+    }
+
+    oapv_bsw_init(&bsw, tile->tc_buf, tile->tc_buf_max, NULL);
+    oapve_vlc_tile_size(&bsw, 0);
+    oapve_vlc_tile_header(&bsw, ctx->num_comp, &th);
+
+    for(c = 0; c < ctx->num_comp; c++) {
+        oapv_bs_t bsc; // bs for 'tile_data()' syntax
+
+        oapv_bsr_init(&bsc, BSR_GET_CUR(&bs), tile->th.tile_data_size[c], NULL);
+        ret = tc_tile_comp(tile, ctx, core, &bsc, &bsw, c);
+        oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+        th.tile_data_size[c] = ret;
+
+        // move bs buffer to next 'tile_data()' component
+        BSR_MOVE_BYTE_ALIGN(&bs, tile->th.tile_data_size[c]);
+    }
+    tile->tc_size = (u32)(bsw.cur - bsw.beg);
+
+    oapv_bs_t bs_th;
+    oapv_bsw_init(&bs_th, tile->tc_buf, tile->tc_size, NULL);
+    oapve_vlc_tile_size(&bs_th, tile->tc_size - OAPV_TILE_SIZE_LEN);
+    oapve_vlc_tile_header(&bs_th, ctx->num_comp, &th);
+    oapv_bsw_deinit(&bs_th);
+    return OAPV_OK;
+}
+
+/* write the transcoded frame; only tile sizes and quantization matrix differ
+   from the input frame header */
+static int tc_frame(oapvd_ctx_t *ctx, oapv_pbuh_t *pbuh, u8 *buf, int buf_size, int *size)
+{
+    oapv_bs_t bs;
+
+    oapv_assert_rv(buf_size > (int)(8 + sizeof(oapv_fh_t)), OAPV_ERR_OUT_OF_BS_BUF);
+    oapv_bsw_init(&bs, buf, buf_size, NULL);
+    oapve_vlc_pbu_size(&bs, 0);
+    oapve_vlc_pbu_header(&bs, pbuh->pbu_type, pbuh->group_id);
+    for(int i = 0; i < ctx->num_tiles; i++) {
+        ctx->tc_fh.tile_size[i] = ctx->tile[i].tc_size - OAPV_TILE_SIZE_LEN;
+    }
+    oapve_vlc_frame_header(&bs, &ctx->tc_fh);
+    oapv_bsw_deinit(&bs);
+
+    for(int i = 0; i < ctx->num_tiles; i++) {
+        oapvd_tile_t *tile = &ctx->tile[i];
+        oapv_assert_rv(bs.end - bs.cur >= tile->tc_size, OAPV_ERR_OUT_OF_BS_BUF);
+        oapv_mcpy(bs.cur, tile->tc_buf, tile->tc_size);
+        bs.cur += tile->tc_size;
+    }
+    *size = (int)(bs.cur - bs.beg);
+    oapv_bsw_write_direct(buf, *size - 4, 32); // pbu_size
+    return OAPV_OK;
+}
+
+/* copy a metadata PBU dropping frame hash unless 'keep_hash'; the PBU is
+   dropped if nothing is left. '*mid' is created at the first use */
+static int tc_md_copy(oapvm_t *mid, oapv_bs_t *bs, u8 *pbu, u32 pbu_size, int group_id, int keep_hash, u8 *buf, int buf_size, int *size)
+{
+    int ret;
+
+    oapv_assert_rv(buf_size >= (int)pbu_size + 8, OAPV_ERR_OUT_OF_BS_BUF);
+    if(!keep_hash) {
+        if(*mid == NULL) {
+            *mid = oapvm_create(&ret);
+            oapv_assert_rv(*mid != NULL, ret);
+        }
+        oapvm_rem_all(*mid);
+        ret = oapvd_vlc_metadata(bs, pbu_size, *mid, group_id);
+        oapv_assert_rv(OAPV_SUCCEEDED(ret), ret);
+    }
+    // metadata without frame hash is kept as it is
+    int rem_hash = 0;
+    if(!keep_hash) {
+        rem_hash = oapv_has_hash64_pld(*mid, group_id) ? OAPV_SUCCEEDED(oapv_rem_hash64_pld(*mid, group_id))
+                                                       : OAPV_SUCCEEDED(oapv_rem_md5_pld(*mid, group_id));
+    }
+    if(!rem_hash) {
+        oapv_mcpy(buf, pbu, pbu_size + 4);
+        *size = pbu_size + 4;
+        return OAPV_OK;
+    }
+
+    oapvm_ctx_t *md_list = (oapvm_ctx_t *)(*mid);
+    *size = 0;
+    if(md_list->num > 0 && md_list->md_arr[0].mdp_num > 0) {
+        oapv_bs_t bsw;
+        oapv_bsw_init(&bsw, buf, buf_size, NULL);
+        oapve_md_write(&bsw, md_list);
+        *size = (int)((u8 *)oapv_bsw_sink(&bsw) - buf);
+    }
+    return OAPV_OK;
+}
+
+int oapv_transcode(oapvd_t did, oapv_bitb_t *bitb, oapv_transcode_param_t *tcp, oapv_bitb_t *obitb, oapvd_stat_t *stat)
+{
+    oapvd_ctx_t *ctx;
+    oapv_pbuh_t  pbuh;
+    int          ret = OAPV_OK;
+    u32          pbu_size;
+    u32          cur_read_size = 0;
+    int          frame_cnt = 0;
+    u8          *out;
+    int          out_size = 0, size = 0;
+
+    ctx = oapvd_id_to_ctx(did);
+    oapv_assert_rv(ctx, OAPV_ERR_INVALID_ARGUMENT);
+    oapv_assert_rv(tcp != NULL && obitb != NULL && obitb->addr != NULL && stat != NULL, OAPV_ERR_INVALID_ARGUMENT);
+    for(int i = 0; i < 2; i++) {
+        oapv_assert_rv(tcp->deadzone[i] == OAPVE_PARAM_TUNE_AUTO || (tcp->deadzone[i] >= 0 && tcp->deadzone[i] <= 511), OAPV_ERR_INVALID_ARGUMENT);
+    }
+    if(tcp->use_q_matrix) {
+        for(int c = 0; c < OAPV_MAX_CC; c++) {
+            for(int i = 0; i < OAPV_BLK_D; i++) {
+                oapv_assert_rv(tcp->q_matrix[c][i] > 0, OAPV_ERR_INVALID_ARGUMENT);
+            }
+        }
+    }
+
+    // read signature ('aPv1')
+    oapv_assert_rv(bitb->ssize > 4, OAPV_ERR_MALFORMED_BITSTREAM);
+    u32 signature = oapv_bsr_read_direct(bitb->addr, 32);
+    oapv_assert_rv(signature == 0x61507631, OAPV_ERR_MALFORMED_BITSTREAM);
+    oapv_assert_rv(obitb->bsize > 4, OAPV_ERR_OUT_OF_BS_BUF);
+    out = (u8 *)obitb->addr;
+    oapv_bsw_write_direct(out, signature, 32);
+    cur_read_size += 4;
+    out_size += 4;
+
+    ctx->tcp = tcp;
+    // same dead-zone offsets as block coding of encoder by default
+    ctx->tc_deadzone[0] = (tcp->deadzone[0] == OAPVE_PARAM_TUNE_AUTO) ? OAPV_DEADZONE_Y : tcp->deadzone[0];
+    ctx->tc_deadzone[1] = (tcp->deadzone[1] == OAPVE_PARAM_TUNE_AUTO) ? OAPV_DEADZONE_C : tcp->deadzone[1];
+    do {
+        oapv_bs_t *bs;
+        u32 remain = bitb->ssize - cur_read_size;
+        oapv_assert_gv((remain >= 8), ret, OAPV_ERR_MALFORMED_BITSTREAM, ERR);
+        oapv_bsr_init(&ctx->bs, (u8 *)bitb->addr + cur_read_size, remain, NULL);
+        bs = &ctx->bs;
+
+        ret = oapvd_vlc_pbu_size(bs, &pbu_size); // read pbu_size (4 byte)
+        oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
+        remain -= 4; // size of pbu_size syntax
+        oapv_assert_gv(pbu_size <= remain, ret, OAPV_ERR_MALFORMED_BITSTREAM, ERR);
+
+        ret = oapvd_vlc_pbu_header(bs, &pbuh);
+        oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
+
+        if(pbuh.pbu_type == OAPV_PBU_TYPE_PRIMARY_FRAME ||
+           pbuh.pbu_type == OAPV_PBU_TYPE_NON_PRIMARY_FRAME ||
+           pbuh.pbu_type == OAPV_PBU_TYPE_PREVIEW_FRAME ||
+           pbuh.pbu_type == OAPV_PBU_TYPE_DEPTH_FRAME ||
+           pbuh.pbu_type == OAPV_PBU_TYPE_ALPHA_FRAME) {
+
+            oapv_assert_gv(frame_cnt < OAPV_MAX_NUM_FRAMES, ret, OAPV_ERR_REACHED_MAX, ERR);
+
+            ret = oapvd_vlc_frame_header(bs, &ctx->fh);
+            oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
+
+            ret = oapvd_frm_prepare(ctx, NULL);
+            oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
+
+            oapv_mcpy(&ctx->tc_fh, &ctx->fh, sizeof(oapv_fh_t));
+            if(tcp->use_q_matrix) {
+                ctx->tc_fh.use_q_matrix = 1;
+                for(int c = 0; c < ctx->num_comp; c++) {
+                    for(int i = 0; i < OAPV_BLK_D; i++) {
+                        ctx->tc_fh.q_matrix[c][i >> OAPV_LOG2_BLK_W][i & (OAPV_BLK_W - 1)] = tcp->q_matrix[c][i];
+                    }
+                }
+            }
+
+            ret = oapvd_run_tiles(ctx);
+            oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
+
+            oapv_bsr_move(&ctx->bs, ctx->tile_end);
+            oapv_fh_to_finfo(&ctx->fh, pbuh.pbu_type, pbuh.group_id, &stat->aui.frm_info[frame_cnt]);
+            ret = oapvd_frm_finish(ctx);
+            oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
+
+            ret = tc_frame(ctx, &pbuh, out + out_size, obitb->bsize - out_size, &size);
+            oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
+
+            stat->frm_size[frame_cnt] = pbu_size + 4 /* byte size of 'pbu_size' syntax */;
+            frame_cnt++;
+        }
+        else if(pbuh.pbu_type == OAPV_PBU_TYPE_METADATA) {
+            // frame hash is kept when nothing is requantized
+            ret = tc_md_copy(&ctx->tc_mid, bs, (u8 *)bitb->addr + cur_read_size, pbu_size, pbuh.group_id,
+                             tcp->dqp == 0 && !tcp->use_q_matrix, out + out_size, obitb->bsize - out_size, &size);
+            oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
+        }
+        else {
+            // access unit information, filler and others are copied
+            size = pbu_size + 4;
+            oapv_assert_gv(obitb->bsize - out_size >= size, ret, OAPV_ERR_OUT_OF_BS_BUF, ERR);
+            oapv_mcpy(out + out_size, (u8 *)bitb->addr + cur_read_size, size);
+        }
+        out_size += size;
+        cur_read_size += pbu_size + 4 /* byte size of 'pbu_size' syntax */;
+    } while(cur_read_size < bitb->ssize);
+    ctx->tcp = NULL;
+
+    stat->read = cur_read_size;
+    stat->aui.num_frms = frame_cnt;
+    obitb->ssize = out_size;
+    return OAPV_OK;
+
+ERR:
+    ctx->tcp = NULL;
+    return ret;
+}
+
+/* write a frame having the tiles covering the rectangle; 'tile' is the first
+   tile in input and 'end' is the end of input frame PBU */
+static int tc_crop_frame(oapv_fh_t *fh, oapv_pbuh_t *pbuh, int x, int y, int w, int h, u8 *tile, u8 *end,
+                          u8 *buf, int buf_size, int *size)
+{
+    u8       *tile_pos[OAPV_MAX_TILES];
+    oapv_bs_t bs;
+    int       tile_w = fh->tile_width_in_mbs * OAPV_MB_W;
+    int       tile_h = fh->tile_height_in_mbs * OAPV_MB_H;
+    int       num_tile_cols = oapv_div_round_up(fh->fi.frame_width, tile_w);
+    int       num_tiles = num_tile_cols * oapv_div_round_up(fh->fi.frame_height, tile_h);
+
+    oapv_assert_rv(x >= 0 && y >= 0 && w > 0 && h > 0, OAPV_ERR_INVALID_ARGUMENT);
+    oapv_assert_rv(x + w <= fh->fi.frame_width && y + h <= fh->fi.frame_height, OAPV_ERR_INVALID_ARGUMENT);
+
+    // tile sizes are always in front of tiles
+    for(int i = 0; i < num_tiles; i++) {
+        oapv_assert_rv(end - tile >= OAPV_TILE_SIZE_LEN, OAPV_ERR_MALFORMED_BITSTREAM);
+        u32 tile_size = oapv_bsr_read_direct(tile, 32);
+        oapv_assert_rv(tile_size <= (u32)(end - tile - OAPV_TILE_SIZE_LEN), OAPV_ERR_MALFORMED_BITSTREAM);
+        tile_pos[i] = tile;
+        tile += OAPV_TILE_SIZE_LEN + tile_size;
+    }
+
+    int col0 = x / tile_w, col1 = (x + w - 1) / tile_w;
+    int row0 = y / tile_h, row1 = (y + h - 1) / tile_h;
+    int num_tiles_out = 0;
+
+    oapv_fh_t fho;
+    oapv_mcpy(&fho, fh, sizeof(oapv_fh_t));
+    fho.fi.frame_width = oapv_min((col1 + 1) * tile_w, fh->fi.frame_width) - col0 * tile_w;
+    fho.fi.frame_height = oapv_min((row1 + 1) * tile_h, fh->fi.frame_height) - row0 * tile_h;
+    for(int row = row0; row <= row1; row++) {
+        for(int col = col0; col <= col1; col++) {
+            fho.tile_size[num_tiles_out++] = oapv_bsr_read_direct(tile_pos[row * num_tile_cols + col], 32);
+        }
+    }
+
+    oapv_assert_rv(buf_size > (int)(8 + sizeof(oapv_fh_t)), OAPV_ERR_OUT_OF_BS_BUF);
+    oapv_bsw_init(&bs, buf, buf_size, NULL);
+    oapve_vlc_pbu_size(&bs, 0);
+    oapve_vlc_pbu_header(&bs, pbuh->pbu_type, pbuh->group_id);
+    oapve_vlc_frame_header(&bs, &fho);
+    oapv_bsw_deinit(&bs);
+
+    for(int i = 0; i < num_tiles_out; i++) {
+        int row = row0 + i / (col1 - col0 + 1);
+        int col = col0 + i % (col1 - col0 + 1);
+        u32 tile_size = OAPV_TILE_SIZE_LEN + fho.tile_size[i];
+
+        oapv_assert_rv(bs.end - bs.cur >= tile_size, OAPV_ERR_OUT_OF_BS_BUF);
+        oapv_mcpy(bs.cur, tile_pos[row * num_tile_cols + col], tile_size);
+        // tile_index follows tile_size and tile_header_size
+        oapv_bsw_write_direct(bs.cur + OAPV_TILE_SIZE_LEN + 2, i, 16);
+        bs.cur += tile_size;
+    }
+    *size = (int)(bs.cur - bs.beg);
+    oapv_bsw_write_direct(buf, *size - 4, 32); // pbu_size
+    return OAPV_OK;
+}
+
+int oapv_crop(oapv_bitb_t *bitb, int x, int y, int w, int h, oapv_bitb_t *obitb)
+{
+    oapv_bs_t   bs;
+    oapv_pbuh_t pbuh;
+    oapv_fh_t   fh;
+    oapvm_t     mid = NULL;
+    u8         *au, *out;
+    u32         pbu_size, cur_read_size = 0;
+    int         ret = OAPV_OK, size = 0, out_size = 0;
+    int         frame_cnt = 0, aui_pos = -1;
+    int         frm_w[OAPV_MAX_NUM_FRAMES], frm_h[OAPV_MAX_NUM_FRAMES];
+    int         frm_cropped[OAPV_MAX_NUM_FRAMES], frm_group[OAPV_MAX_NUM_FRAMES];
+
+    oapv_assert_rv(bitb != NULL && obitb != NULL && obitb->addr != NULL, OAPV_ERR_INVALID_ARGUMENT);
+    au = (u8 *)bitb->addr;
+    out = (u8 *)obitb->addr;
+
+    // read signature ('aPv1')
+    oapv_assert_rv(bitb->ssize > 4, OAPV_ERR_MALFORMED_BITSTREAM);
+    u32 signature = oapv_bsr_read_direct(au, 32);
+    oapv_assert_rv(signature == 0x61507631, OAPV_ERR_MALFORMED_BITSTREAM);
+    oapv_assert_rv(obitb->bsize > 4, OAPV_ERR_OUT_OF_BS_BUF);
+    oapv_bsw_write_direct(out, signature, 32);
+    cur_read_size += 4;
+    out_size += 4;
+
+    do {
+        u32 remain = bitb->ssize - cur_read_size;
+        oapv_assert_gv(remain >= 8, ret, OAPV_ERR_MALFORMED_BITSTREAM, ERR);
+        oapv_bsr_init(&bs, au + cur_read_size, remain, NULL);
+
+        ret = oapvd_vlc_pbu_size(&bs, &pbu_size); // read pbu_size (4 byte)
+        oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
+        remain -= 4; // size of pbu_size syntax
+        oapv_assert_gv(pbu_size <= remain, ret, OAPV_ERR_MALFORMED_BITSTREAM, ERR);
+
+        ret = oapvd_vlc_pbu_header(&bs, &pbuh);
+        oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
+
+        if(pbuh.pbu_type == OAPV_PBU_TYPE_PRIMARY_FRAME ||
+           pbuh.pbu_type == OAPV_PBU_TYPE_NON_PRIMARY_FRAME ||
+           pbuh.pbu_type == OAPV_PBU_TYPE_PREVIEW_FRAME ||
+           pbuh.pbu_type == OAPV_PBU_TYPE_DEPTH_FRAME ||
+           pbuh.pbu_type == OAPV_PBU_TYPE_ALPHA_FRAME) {
+
+            oapv_assert_gv(frame_cnt < OAPV_MAX_NUM_FRAMES, ret, OAPV_ERR_REACHED_MAX, ERR);
+
+            ret = oapvd_vlc_frame_header(&bs, &fh);
+            oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
+
+            ret = tc_crop_frame(&fh, &pbuh, x, y, w, h, oapv_bsr_sink(&bs), au + cur_read_size + 4 + pbu_size,
+                                 out + out_size, obitb->bsize - out_size, &size);
+            oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
+
+            // frame_info() of cropped frame is at the same position as input
+            frm_w[frame_cnt] = oapv_bsr_read_direct(out + out_size + 8 + 3, 24);
+            frm_h[frame_cnt] = oapv_bsr_read_direct(out + out_size + 8 + 6, 24);
+            frm_cropped[frame_cnt] = frm_w[frame_cnt] != fh.fi.frame_width || frm_h[frame_cnt] != fh.fi.frame_height;
+            frm_group[frame_cnt] = pbuh.group_id;
+            frame_cnt++;
+        }
+        else if(pbuh.pbu_type == OAPV_PBU_TYPE_METADATA) {
+            // frame hash does not match cropped frames, but it is kept for
+            // the frames covered by the rectangle as a whole
+            int keep_hash = 1;
+            for(int i = 0; i < frame_cnt; i++) {
+                if(frm_group[i] == pbuh.group_id && frm_cropped[i]) {
+                    keep_hash = 0;
+                }
+            }
+            ret = tc_md_copy(&mid, &bs, au + cur_read_size, pbu_size, pbuh.group_id, keep_hash, out + out_size, obitb->bsize - out_size, &size);
+            oapv_assert_g(OAPV_SUCCEEDED(ret), ERR);
+        }
+        else {
+            if(pbuh.pbu_type == OAPV_PBU_TYPE_AU_INFO) {
+                aui_pos = out_size;
+            }
+            size = pbu_size + 4;
+            oapv_assert_gv(obitb->bsize - out_size >= size, ret, OAPV_ERR_OUT_OF_BS_BUF, ERR);
+            oapv_mcpy(out + out_size, au + cur_read_size, size);
+        }
+        out_size += size;
+        cur_read_size += pbu_size + 4 /* byte size of 'pbu_size' syntax */;
+    } while(cur_read_size < bitb->ssize);
+
+    // frame sizes in access unit information; every entry has 4 bytes of
+    // pbu_type, group_id and reserved bits followed by 12 bytes of frame_info()
+    if(aui_pos >= 0) {
+        u8 *aui = out + aui_pos + 8; // after pbu_size and pbu_header()
+        oapv_assert_gv(oapv_bsr_read_direct(aui, 16) == frame_cnt, ret, OAPV_ERR_MALFORMED_BITSTREAM, ERR);
+        for(int i = 0; i < frame_cnt; i++) {
+            u8 *fi = aui + 2 + i * 16 + 4;
+            oapv_bsw_write_direct(fi + 3, frm_w[i], 24);
+            oapv_bsw_write_direct(fi + 6, frm_h[i], 24);
+        }
+    }
+    obitb->ssize = out_size;
+
+ERR:
+    if(mid != NULL) {
+        oapvm_delete(mid);
+    }
+    return ret;
+}
+
+#endif // ENABLE_DECODER && ENABLE_ENCODER
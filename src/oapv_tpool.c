@@ -679,3 +679,12 @@ int oapv_tpool_spinlock_wait(volatile int *addr, int val)
     return temp;
 }
 
+
+int oapv_tpool_atomic_add(volatile int *addr, int val)
+{
+#if defined(WIN32) || defined(WIN64)
+    return (int)InterlockedExchangeAdd((volatile LONG *)addr, (LONG)val) + val;
+#else
+    return __sync_add_and_fetch(addr, val);
+#endif
+}
@@ -77,6 +77,8 @@ tpool_result_t oapv_tpool_deinit(oapv_tpool_t *tp);
 oapv_sync_obj_t oapv_tpool_sync_obj_create();
 tpool_result_t oapv_tpool_sync_obj_delete(oapv_sync_obj_t *sobj);
 int oapv_tpool_spinlock_wait(volatile int *addr, int val);
+// atomically adds 'val' to '*addr'; returns the new value
+int oapv_tpool_atomic_add(volatile int *addr, int val);
 
 void oapv_tpool_enter_cs(oapv_sync_obj_t sobj);
 void oapv_tpool_leave_cs(oapv_sync_obj_t sobj);
@@ -253,27 +253,35 @@ static void md5_finish(oapv_md5_t *md5, u8 digest[16])
     oapv_mset(md5, 0, sizeof(oapv_md5_t));
 }
 
-static unsigned char uuid_frm_hash[16] = {
-    0xf8, 0x72, 0x1b, 0x3e, 0xcd, 0xee, 0x47, 0x21,
-    0x98, 0x0d, 0x9b, 0x9e, 0x39, 0x20, 0x28, 0x49
-};
+static unsigned char uuid_frm_hash[16] = OAPV_UUID_FRM_HASH_MD5;
 
-void oapv_imgb_set_md5(oapv_imgb_t *imgb)
+/* MD5 of plane 'p'; planes are independent, so they can be made in parallel */
+void oapv_imgb_set_md5_plane(oapv_imgb_t *imgb, int p)
 {
+    oapv_md5_t md5;
+    int        j;
+    oapv_assert(imgb != NULL && p < imgb->np);
+
+    md5_init(&md5);
+    if(imgb->s[p] == imgb->aw[p] * 2) {
+        // rows without padding are made in one update
+        md5_update(&md5, imgb->a[p], imgb->s[p] * imgb->ah[p]);
+    }
+    else {
+        for(j = 0; j < imgb->ah[p]; j++) {
+            md5_update(&md5, ((u8 *)imgb->a[p]) + j * imgb->s[p], imgb->aw[p] * 2);
+        }
+    }
+    md5_finish(&md5, imgb->hash[p]);
+}
 
-    oapv_md5_t md5[N_C];
-    int        i, j;
+void oapv_imgb_set_md5(oapv_imgb_t *imgb)
+{
     oapv_assert(imgb != NULL);
     memset(imgb->hash, 0, sizeof(imgb->hash));
 
-    for(i = 0; i < imgb->np; i++) {
-        md5_init(&md5[i]);
-
-        for(j = 0; j < imgb->ah[i]; j++) {
-            md5_update(&md5[i], ((u8 *)imgb->a[i]) + j * imgb->s[i], imgb->aw[i] * 2);
-        }
-
-        md5_finish(&md5[i], imgb->hash[i]);
+    for(int i = 0; i < imgb->np; i++) {
+        oapv_imgb_set_md5_plane(imgb, i);
     }
 }
 
@@ -292,6 +300,171 @@ int oapv_set_md5_pld(oapvm_t mid, int group_id, oapv_imgb_t *rec)
     return OAPV_OK;
 }
 
+int oapv_rem_md5_pld(oapvm_t mid, int group_id)
+{
+    return oapvm_rem(mid, group_id, OAPV_METADATA_USER_DEFINED, uuid_frm_hash);
+}
+
+static unsigned char uuid_frm_hash64[16] = OAPV_UUID_FRM_HASH_FAST;
+
+/* 64-bit hash of visible samples of plane 'p' covered by the rectangle,
+   which is given in luma sample unit */
+u64 oapv_imgb_hash64_rect(oapv_imgb_t *imgb, int p, int x, int y, int w, int h)
+{
+    int cf = OAPV_CS_GET_FORMAT(imgb->cs);
+    int byte_depth = OAPV_CS_GET_BYTE_DEPTH(imgb->cs);
+    int sft_w = 0, sft_h = 0;
+    u64 hash = 0;
+
+    // interleaved chroma plane of P210 has the same byte width as luma
+    if(p > 0 && cf != OAPV_CF_PLANAR2) {
+        sft_w = (cf == OAPV_CF_YCBCR420 || cf == OAPV_CF_YCBCR422) ? 1 : 0;
+        sft_h = (cf == OAPV_CF_YCBCR420) ? 1 : 0;
+    }
+    int x1 = oapv_min((x + w + (1 << sft_w) - 1) >> sft_w, imgb->w[p]);
+    int y1 = oapv_min((y + h + (1 << sft_h) - 1) >> sft_h, imgb->h[p]);
+    x >>= sft_w;
+    y >>= sft_h;
+    if(x >= x1 || y >= y1) {
+        return 0;
+    }
+    u8 *row = (u8 *)imgb->a[p] + y * imgb->s[p] + x * byte_depth;
+    for(; y < y1; y++) {
+        hash = oapv_hash64(row, (x1 - x) * byte_depth, hash);
+        row += imgb->s[p];
+    }
+    return hash;
+}
+
+/* set frame hash of each plane from hash values of tiles in tile order */
+void oapv_imgb_set_hash64(oapv_imgb_t *imgb, u64 (*tile_hash)[N_C], int num_tiles)
+{
+    u8 hash[OAPV_MAX_TILES * 8];
+
+    memset(imgb->hash, 0, sizeof(imgb->hash));
+    for(int p = 0; p < imgb->np; p++) {
+        for(int i = 0; i < num_tiles; i++) {
+            for(int j = 0; j < 8; j++) {
+                hash[i * 8 + j] = (u8)(tile_hash[i][p] >> (j * 8)); // little endian
+            }
+        }
+        u64 v = oapv_hash64(hash, num_tiles * 8, 0);
+        for(int i = 0; i < 8; i++) {
+            imgb->hash[p][i] = (u8)(v >> (56 - i * 8)); // big endian
+        }
+    }
+}
+
+int oapv_set_hash64_pld(oapvm_t mid, int group_id, oapv_imgb_t *rec)
+{
+    u8 mdp_data[16 + 8 * OAPV_MAX_CC];
+
+    memcpy(mdp_data, uuid_frm_hash64, 16);
+    for(int i = 0; i < rec->np; i++) {
+        memcpy(mdp_data + 16 + i * 8, rec->hash[i], 8);
+    }
+    return oapvm_set(mid, group_id, OAPV_METADATA_USER_DEFINED, mdp_data, 8 * rec->np + 16);
+}
+
+int oapv_rem_hash64_pld(oapvm_t mid, int group_id)
+{
+    return oapvm_rem(mid, group_id, OAPV_METADATA_USER_DEFINED, uuid_frm_hash64);
+}
+
+int oapv_has_hash64_pld(oapvm_t mid, int group_id)
+{
+    void *data;
+    int   size;
+    return OAPV_SUCCEEDED(oapvm_get(mid, group_id, OAPV_METADATA_USER_DEFINED, &data, &size, uuid_frm_hash64));
+}
+
+/* 64-bit non-cryptographic hash (XXH64); data is processed in 4 independent
+   lanes, so that multiplications of the lanes are pipelined */
+#define HASH64_P1 0x9E3779B185EBCA87ULL
+#define HASH64_P2 0xC2B2AE3D27D4EB4FULL
+#define HASH64_P3 0x165667B19E3779F9ULL
+#define HASH64_P4 0x85EBCA77C2B2AE63ULL
+#define HASH64_P5 0x27D4EB2F165667C5ULL
+#define HASH64_ROTL(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+/* hash value goes into bitstream, so data is read in little-endian order
+   regardless of the host */
+static inline u64 hash64_read64(const u8 *p)
+{
+    return (u64)p[0] | ((u64)p[1] << 8) | ((u64)p[2] << 16) | ((u64)p[3] << 24) |
+           ((u64)p[4] << 32) | ((u64)p[5] << 40) | ((u64)p[6] << 48) | ((u64)p[7] << 56);
+}
+
+static inline u32 hash64_read32(const u8 *p)
+{
+    return (u32)p[0] | ((u32)p[1] << 8) | ((u32)p[2] << 16) | ((u32)p[3] << 24);
+}
+
+static inline u64 hash64_round(u64 acc, u64 v)
+{
+    acc += v * HASH64_P2;
+    acc = HASH64_ROTL(acc, 31);
+    return acc * HASH64_P1;
+}
+
+static inline u64 hash64_merge(u64 acc, u64 v)
+{
+    acc ^= hash64_round(0, v);
+    return acc * HASH64_P1 + HASH64_P4;
+}
+
+u64 oapv_hash64(const void *buf, int size, u64 seed)
+{
+    const u8 *p = (const u8 *)buf;
+    const u8 *end = p + size;
+    u64       h;
+
+    if(size >= 32) {
+        u64 v1 = seed + HASH64_P1 + HASH64_P2;
+        u64 v2 = seed + HASH64_P2;
+        u64 v3 = seed;
+        u64 v4 = seed - HASH64_P1;
+        do {
+            v1 = hash64_round(v1, hash64_read64(p));
+            v2 = hash64_round(v2, hash64_read64(p + 8));
+            v3 = hash64_round(v3, hash64_read64(p + 16));
+            v4 = hash64_round(v4, hash64_read64(p + 24));
+            p += 32;
+        } while(p + 32 <= end);
+        h = HASH64_ROTL(v1, 1) + HASH64_ROTL(v2, 7) + HASH64_ROTL(v3, 12) + HASH64_ROTL(v4, 18);
+        h = hash64_merge(h, v1);
+        h = hash64_merge(h, v2);
+        h = hash64_merge(h, v3);
+        h = hash64_merge(h, v4);
+    }
+    else {
+        h = seed + HASH64_P5;
+    }
+    h += (u64)size;
+
+    while(p + 8 <= end) {
+        h ^= hash64_round(0, hash64_read64(p));
+        h = HASH64_ROTL(h, 27) * HASH64_P1 + HASH64_P4;
+        p += 8;
+    }
+    if(p + 4 <= end) {
+        h ^= (u64)hash64_read32(p) * HASH64_P1;
+        h = HASH64_ROTL(h, 23) * HASH64_P2 + HASH64_P3;
+        p += 4;
+    }
+    while(p < end) {
+        h ^= (*p) * HASH64_P5;
+        h = HASH64_ROTL(h, 11) * HASH64_P1;
+        p++;
+    }
+    h ^= h >> 33;
+    h *= HASH64_P2;
+    h ^= h >> 29;
+    h *= HASH64_P3;
+    h ^= h >> 32;
+    return h;
+}
+
 void oapv_block_copy(s16 *src, int src_stride, s16 *dst, int dst_stride, int log2_copy_w, int log2_copy_h)
 {
     int  h;
@@ -367,7 +540,13 @@ int oapv_check_cpu_info_x86()
         }
     }
 
-    return ((support_avx2 << 2) | (support_avx << 1) | (support_sse << 0));
+    return (support_avx2 << 2) | (support_avx << 1) | (support_sse << 0);
+}
+
+/* capabilities of oapv_check_cpu_info_x86() allowed by 'simd' of cdesc */
+int oapv_simd_caps_mask_x86(int simd)
+{
+    return (simd == OAPV_CDESC_SIMD_NONE) ? 0 : (simd == OAPV_CDESC_SIMD_SSE) ? 1 : ~0;
 }
 #endif
 
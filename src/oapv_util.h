@@ -85,9 +85,15 @@ static inline int chroma_format_idc_to_color_format(int chroma_format_idc)
 
 static inline int color_format_to_chroma_format_idc(int color_format)
 {
-    if(color_format == OAPV_CF_PLANAR2) {
+    if(color_format == OAPV_CF_PLANAR2 || color_format == OAPV_CF_UYVY || color_format == OAPV_CF_V210) {
         return 2;
     }
+    else if(color_format == OAPV_CF_RGB || color_format == OAPV_CF_GBR || color_format == OAPV_CF_RGBF) {
+        return 3;
+    }
+    else if(color_format == OAPV_CF_RGBA || color_format == OAPV_CF_GBRA || color_format == OAPV_CF_RGBAF) {
+        return 4;
+    }
     else {
         return ((color_format == OAPV_CF_YCBCR400)   ? 0
                 : (color_format == OAPV_CF_YCBCR420) ? 1
@@ -119,6 +125,37 @@ static inline int get_num_comp(int chroma_format_idc)
                                       : 3;
 }
 
+static inline int color_format_is_rgb(int color_format)
+{
+    return (color_format == OAPV_CF_RGB || color_format == OAPV_CF_GBR || color_format == OAPV_CF_RGBA || color_format == OAPV_CF_GBRA ||
+            color_format == OAPV_CF_RGBF || color_format == OAPV_CF_RGBAF);
+}
+
+/* plane index of R, G, B, and alpha component of RGB formats */
+static inline int color_format_rgb_plane(int color_format, int c)
+{
+    return (c < 3 && (color_format == OAPV_CF_GBR || color_format == OAPV_CF_GBRA)) ? (c + 2) % 3 : c;
+}
+
+/* samples of component 'c' in an image buffer; all components of packed
+   formats are in the first plane */
+static inline void *imgb_comp_plane(oapv_imgb_t *imgb, int c, int *stride)
+{
+    int cf = OAPV_CS_GET_FORMAT(imgb->cs);
+
+    if(cf == OAPV_CF_PLANAR2) {
+        int tc = c > 0 ? 1 : 0;
+        *stride = imgb->s[tc];
+        return (s16 *)imgb->a[tc] + ((c > 1) ? 1 : 0);
+    }
+    if(cf == OAPV_CF_UYVY || cf == OAPV_CF_V210) {
+        *stride = imgb->s[0];
+        return imgb->a[0];
+    }
+    *stride = imgb->s[c];
+    return imgb->a[c];
+}
+
 static inline void imgb_addref(oapv_imgb_t *imgb)
 {
     if(imgb->addref) {
@@ -143,11 +180,20 @@ typedef struct
 
 /* MD5 Functions */
 void oapv_imgb_set_md5(oapv_imgb_t *imgb);
+void oapv_imgb_set_md5_plane(oapv_imgb_t *imgb, int p);
 void oapv_block_copy(s16 *src, int src_stride, s16 *dst, int dst_stride, int log2_copy_w, int log2_copy_h);
 int oapv_set_md5_pld(oapvm_t mid, int group_id, oapv_imgb_t *rec);
+int oapv_rem_md5_pld(oapvm_t mid, int group_id);
+u64 oapv_imgb_hash64_rect(oapv_imgb_t *imgb, int p, int x, int y, int w, int h);
+void oapv_imgb_set_hash64(oapv_imgb_t *imgb, u64 (*tile_hash)[N_C], int num_tiles);
+int oapv_set_hash64_pld(oapvm_t mid, int group_id, oapv_imgb_t *rec);
+int oapv_rem_hash64_pld(oapvm_t mid, int group_id);
+int oapv_has_hash64_pld(oapvm_t mid, int group_id);
+u64 oapv_hash64(const void *buf, int size, u64 seed);
 
 #if X86_SSE
 int oapv_check_cpu_info_x86();
+int oapv_simd_caps_mask_x86(int simd);
 #endif
 
 /* For debugging (START) */
@@ -148,9 +148,10 @@ static u32 enc_vlc_write_to_code(oapv_bs_t *bs, int val, int k, int *nbits)
     return code;
 }
 
-static int enc_vlc_quantization_matrix(oapv_bs_t *bs, oapve_ctx_t *ctx, oapv_fh_t *fh)
+static int enc_vlc_quantization_matrix(oapv_bs_t *bs, oapv_fh_t *fh)
 {
-    for(int cidx = 0; cidx < ctx->num_comp; cidx++) {
+    int num_comp = get_num_comp(fh->fi.chroma_format_idc);
+    for(int cidx = 0; cidx < num_comp; cidx++) {
         for(int y = 0; y < 8; y++) {
             for(int x = 0; x < 8; x++) {
                 oapv_bsw_write(bs, fh->q_matrix[cidx][y][x], 8);
@@ -161,7 +162,7 @@ static int enc_vlc_quantization_matrix(oapv_bs_t *bs, oapve_ctx_t *ctx, oapv_fh_
     return 0;
 }
 
-static int enc_vlc_tile_info(oapv_bs_t *bs, oapve_ctx_t *ctx, oapv_fh_t *fh)
+static int enc_vlc_tile_info(oapv_bs_t *bs, oapv_fh_t *fh)
 {
     oapv_bsw_write(bs, fh->tile_width_in_mbs, 20);
     DUMP_HLS(fh->tile_width_in_mbs, fh->tile_width_in_mbs);
@@ -170,7 +171,10 @@ static int enc_vlc_tile_info(oapv_bs_t *bs, oapve_ctx_t *ctx, oapv_fh_t *fh)
     oapv_bsw_write(bs, fh->tile_size_present_in_fh_flag, 1);
     DUMP_HLS(fh->tile_size_present_in_fh_flag, fh->tile_size_present_in_fh_flag);
     if(fh->tile_size_present_in_fh_flag) {
-        for(int i = 0; i < ctx->num_tiles; i++) {
+        int tile_w = fh->tile_width_in_mbs * OAPV_MB_W;
+        int tile_h = fh->tile_height_in_mbs * OAPV_MB_H;
+        int num_tiles = oapv_div_round_up(fh->fi.frame_width, tile_w) * oapv_div_round_up(fh->fi.frame_height, tile_h);
+        for(int i = 0; i < num_tiles; i++) {
             oapv_bsw_write(bs, fh->tile_size[i], 32);
             DUMP_HLS(fh->tile_size, fh->tile_size[i]);
         }
@@ -333,7 +337,7 @@ int oapve_vlc_frame_info(oapv_bs_t *bs, oapv_fi_t *fi)
     return OAPV_OK;
 }
 
-int oapve_vlc_frame_header(oapv_bs_t *bs, oapve_ctx_t *ctx, oapv_fh_t *fh)
+int oapve_vlc_frame_header(oapv_bs_t *bs, oapv_fh_t *fh)
 {
     oapv_assert_rv(bsw_is_align8(bs), OAPV_ERR_MALFORMED_BITSTREAM);
 
@@ -355,9 +359,9 @@ int oapve_vlc_frame_header(oapv_bs_t *bs, oapve_ctx_t *ctx, oapv_fh_t *fh)
     oapv_bsw_write1(bs, fh->use_q_matrix);
     DUMP_HLS(fh->use_q_matrix, fh->use_q_matrix);
     if(fh->use_q_matrix) {
-        enc_vlc_quantization_matrix(bs, ctx, fh);
+        enc_vlc_quantization_matrix(bs, fh);
     }
-    enc_vlc_tile_info(bs, ctx, fh);
+    enc_vlc_tile_info(bs, fh);
 
     oapv_bsw_write(bs, 0, 8); // reserved_zero_8bits
     DUMP_HLS(reserved_zero, 0);
@@ -372,21 +376,21 @@ int oapve_vlc_tile_size(oapv_bs_t *bs, int tile_size)
     return OAPV_OK;
 }
 
-int oapve_vlc_tile_header(oapve_ctx_t *ctx, oapv_bs_t *bs, oapv_th_t *th)
+int oapve_vlc_tile_header(oapv_bs_t *bs, int num_comp, oapv_th_t *th)
 {
     oapv_assert_rv(bsw_is_align8(bs), OAPV_ERR_MALFORMED_BITSTREAM);
-    th->tile_header_size = 5;                    // tile_header_size + tile_index + reserved_zero_8bits
-    th->tile_header_size += (ctx->num_comp * 5); // tile_data_size + tile_qp
+    th->tile_header_size = 5;               // tile_header_size + tile_index + reserved_zero_8bits
+    th->tile_header_size += (num_comp * 5); // tile_data_size + tile_qp
 
     oapv_bsw_write(bs, th->tile_header_size, 16);
     DUMP_HLS(th->tile_header_size, th->tile_header_size);
     oapv_bsw_write(bs, th->tile_index, 16);
     DUMP_HLS(th->tile_index, th->tile_index);
-    for(int c = 0; c < ctx->num_comp; c++) {
+    for(int c = 0; c < num_comp; c++) {
         oapv_bsw_write(bs, th->tile_data_size[c], 32);
         DUMP_HLS(th->tile_data_size, th->tile_data_size[c]);
     }
-    for(int c = 0; c < ctx->num_comp; c++) {
+    for(int c = 0; c < num_comp; c++) {
         oapv_bsw_write(bs, th->tile_qp[c], 8);
         DUMP_HLS(th->tile_qp, th->tile_qp[c]);
     }
@@ -482,6 +486,16 @@ int oapve_vlc_metadata(oapv_md_t *md, oapv_bs_t *bs)
     return OAPV_OK;
 }
 
+int oapve_vlc_filler(oapv_bs_t *bs, int filler_size)
+{
+    // filler follows byte-aligned pbu_header, so the run is set at once
+    u8 *p = (u8 *)oapv_bsw_sink(bs);
+    oapv_assert_rv(p != NULL && bs->end - p >= filler_size, OAPV_ERR_OUT_OF_BS_BUF);
+    oapv_mset(p, 0xFF, filler_size);
+    bs->cur = p + filler_size;
+    return OAPV_OK;
+}
+
 static __inline int get_vlc_rate(int val, int k)
 {
     if (val < 100 && k < 5)
@@ -41,11 +41,12 @@
 
 void oapve_set_frame_header(oapve_ctx_t * ctx, oapv_fh_t * fh);
 int  oapve_vlc_frame_info(oapv_bs_t* bs, oapv_fi_t* fi);
-int  oapve_vlc_frame_header(oapv_bs_t* bs, oapve_ctx_t* ctx, oapv_fh_t* fh);
+int  oapve_vlc_frame_header(oapv_bs_t* bs, oapv_fh_t* fh);
 int  oapve_vlc_tile_size(oapv_bs_t* bs, int tile_size);
 void oapve_set_tile_header(oapve_ctx_t* ctx, oapv_th_t* th, int tile_idx, int qp);
-int  oapve_vlc_tile_header(oapve_ctx_t* ctx, oapv_bs_t* bs, oapv_th_t* th);
+int  oapve_vlc_tile_header(oapv_bs_t* bs, int num_comp, oapv_th_t* th);
 int  oapve_vlc_metadata(oapv_md_t* md, oapv_bs_t* bs);
+int  oapve_vlc_filler(oapv_bs_t* bs, int filler_size);
 int  oapve_vlc_au_info(oapv_bs_t* bs, oapve_ctx_t* ctx, oapv_frms_t* frms, oapv_bs_t** bs_fi_pos);
 int  oapve_vlc_pbu_header(oapv_bs_t* bs, int pbu_type, int group_id);
 int  oapve_vlc_pbu_size(oapv_bs_t* bs, int pbu_size);
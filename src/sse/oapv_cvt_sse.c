@@ -0,0 +1,446 @@
+/*
+ * Copyright (c) 2022 Samsung Electronics Co., Ltd.
+ * All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * - Neither the name of the copyright owner, nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "oapv_cvt_sse.h"
+
+#if X86_SSE
+
+/* conversion of planar input samples to the block of codec bit depth; see
+   oapv_imgb_to_blk_16() and oapv_imgb_to_blk_8() for the parameters */
+void oapv_imgb_to_blk_16_sse(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd, int in_bd)
+{
+    const int mid_val = (1 << (bd - 1));
+    const int max_val = (1 << bd) - 1;
+    u16      *s = (u16 *)src + offset_src;
+    s16      *d = (s16 *)dst;
+    int       sft = oapv_abs(bd - in_bd), add = (in_bd > bd) ? 1 << (sft - 1) : 0;
+    __m128i   mid = _mm_set1_epi16((s16)mid_val), max = _mm_set1_epi16((s16)max_val);
+    __m128i   rnd = _mm_set1_epi32(add), zero = _mm_setzero_si128(), s0, s1;
+    __m128i   cnt = _mm_cvtsi32_si128(sft);
+
+    for(int h = 0; h < blk_h; h++) {
+        int w = 0;
+        if(blk_w == 8) {
+            s0 = _mm_loadu_si128((__m128i *)s);
+            if(in_bd <= bd) {
+                s0 = _mm_sll_epi16(s0, cnt);
+            }
+            else { // 32-bit, since 16-bit input can overflow with rounding
+                s1 = _mm_unpackhi_epi16(s0, zero);
+                s0 = _mm_unpacklo_epi16(s0, zero);
+                s0 = _mm_srl_epi32(_mm_add_epi32(s0, rnd), cnt);
+                s1 = _mm_srl_epi32(_mm_add_epi32(s1, rnd), cnt);
+                s0 = _mm_min_epi16(_mm_packus_epi32(s0, s1), max);
+            }
+            _mm_storeu_si128((__m128i *)d, _mm_sub_epi16(s0, mid));
+            w = 8;
+        }
+        for(; w < blk_w; w++) {
+            d[w] = (s16)((in_bd <= bd) ? (s[w] << sft) : oapv_min((s[w] + add) >> sft, max_val)) - mid_val;
+        }
+        s = (u16 *)(((u8 *)s) + s_src);
+        d = (s16 *)(((u8 *)d) + s_dst);
+    }
+}
+
+void oapv_imgb_to_blk_8_sse(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd, int in_bd)
+{
+    const int mid_val = (1 << (bd - 1));
+    const int sft = bd - 8;
+    u8       *s = (u8 *)src + offset_src;
+    s16      *d = (s16 *)dst;
+    __m128i   mid = _mm_set1_epi16((s16)mid_val), s0;
+    __m128i   cnt = _mm_cvtsi32_si128(sft);
+
+    for(int h = 0; h < blk_h; h++) {
+        int w = 0;
+        if(blk_w == 8) {
+            s0 = _mm_cvtepu8_epi16(_mm_loadl_epi64((__m128i *)s));
+            s0 = _mm_sll_epi16(s0, cnt);
+            _mm_storeu_si128((__m128i *)d, _mm_sub_epi16(s0, mid));
+            w = 8;
+        }
+        for(; w < blk_w; w++) {
+            d[w] = (s16)(s[w] << sft) - mid_val;
+        }
+        s = s + s_src;
+        d = (s16 *)(((u8 *)d) + s_dst);
+    }
+}
+
+/* P210 has 'bd' bits at MSB of 16-bit samples, and Cb and Cr interleaved in
+   the second plane; Cr is read from the address of Cb of the same pair, so
+   that samples out of the row are not read */
+static void imgb_to_blk_p21x_sse(u16 *s, int blk_h, int s_src, int s_dst, s16 *d, int bd, int c)
+{
+    __m128i mid = _mm_set1_epi16((s16)(1 << (bd - 1)));
+    __m128i cnt = _mm_cvtsi32_si128(16 - bd);
+    __m128i mask = _mm_set1_epi32(0xFFFF), s0, s1;
+
+    for(int h = 0; h < blk_h; h++) {
+        s0 = _mm_loadu_si128((__m128i *)s);
+        if(c != Y_C) {
+            s1 = _mm_loadu_si128((__m128i *)(s + 8));
+            if(c == U_C) {
+                s0 = _mm_packus_epi32(_mm_and_si128(s0, mask), _mm_and_si128(s1, mask));
+            }
+            else {
+                s0 = _mm_packus_epi32(_mm_srli_epi32(s0, 16), _mm_srli_epi32(s1, 16));
+            }
+        }
+        _mm_storeu_si128((__m128i *)d, _mm_sub_epi16(_mm_srl_epi16(s0, cnt), mid));
+        s = (u16 *)(((u8 *)s) + s_src);
+        d = (s16 *)(((u8 *)d) + s_dst);
+    }
+}
+
+static void imgb_to_blk_p21x_y_sse(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd, int in_bd)
+{
+    if(blk_w != 8) {
+        oapv_tbl_fn_imgb_to_blk_p21x[Y_C](src, blk_w, blk_h, s_src, offset_src, s_dst, dst, bd, in_bd);
+        return;
+    }
+    imgb_to_blk_p21x_sse((u16 *)src + offset_src, blk_h, s_src, s_dst, (s16 *)dst, bd, Y_C);
+}
+
+static void imgb_to_blk_p21x_u_sse(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd, int in_bd)
+{
+    if(blk_w != 8) {
+        oapv_tbl_fn_imgb_to_blk_p21x[U_C](src, blk_w, blk_h, s_src, offset_src, s_dst, dst, bd, in_bd);
+        return;
+    }
+    imgb_to_blk_p21x_sse((u16 *)src + offset_src * 2, blk_h, s_src, s_dst, (s16 *)dst, bd, U_C);
+}
+
+static void imgb_to_blk_p21x_v_sse(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd, int in_bd)
+{
+    if(blk_w != 8) {
+        oapv_tbl_fn_imgb_to_blk_p21x[V_C](src, blk_w, blk_h, s_src, offset_src, s_dst, dst, bd, in_bd);
+        return;
+    }
+    // 'src' is at Cr of the first pair
+    imgb_to_blk_p21x_sse((u16 *)src + offset_src * 2 - 1, blk_h, s_src, s_dst, (s16 *)dst, bd, V_C);
+}
+
+const oapv_fn_imgb_to_blk_t oapv_tbl_fn_imgb_to_blk_p21x_sse[3] = {
+    imgb_to_blk_p21x_y_sse,
+    imgb_to_blk_p21x_u_sse,
+    imgb_to_blk_p21x_v_sse
+};
+
+/* UYVY has a byte of sample in the order of Cb, Y, Cr, Y; 16 bytes of a row
+   have eight Y samples, and 32 bytes have eight Cb and Cr samples */
+static void imgb_to_blk_uyvy_sse(u8 *s, int blk_h, int s_src, int s_dst, s16 *d, int bd, int c)
+{
+    __m128i mid = _mm_set1_epi16((s16)(1 << (bd - 1)));
+    __m128i cnt = _mm_cvtsi32_si128(bd - 8);
+    __m128i mask = _mm_set1_epi32(0xFF), s0, s1;
+
+    for(int h = 0; h < blk_h; h++) {
+        s0 = _mm_loadu_si128((__m128i *)s);
+        if(c == Y_C) {
+            s0 = _mm_srli_epi16(s0, 8);
+        }
+        else {
+            s1 = _mm_loadu_si128((__m128i *)(s + 16));
+            if(c == V_C) {
+                s0 = _mm_srli_epi32(s0, 16);
+                s1 = _mm_srli_epi32(s1, 16);
+            }
+            s0 = _mm_packus_epi32(_mm_and_si128(s0, mask), _mm_and_si128(s1, mask));
+        }
+        _mm_storeu_si128((__m128i *)d, _mm_sub_epi16(_mm_sll_epi16(s0, cnt), mid));
+        s = s + s_src;
+        d = (s16 *)(((u8 *)d) + s_dst);
+    }
+}
+
+static void imgb_to_blk_uyvy_y_sse(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd, int in_bd)
+{
+    if(blk_w != 8) {
+        oapv_tbl_fn_imgb_to_blk_uyvy[Y_C](src, blk_w, blk_h, s_src, offset_src, s_dst, dst, bd, in_bd);
+        return;
+    }
+    imgb_to_blk_uyvy_sse((u8 *)src + offset_src * 2, blk_h, s_src, s_dst, (s16 *)dst, bd, Y_C);
+}
+
+static void imgb_to_blk_uyvy_u_sse(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd, int in_bd)
+{
+    if(blk_w != 8) {
+        oapv_tbl_fn_imgb_to_blk_uyvy[U_C](src, blk_w, blk_h, s_src, offset_src, s_dst, dst, bd, in_bd);
+        return;
+    }
+    imgb_to_blk_uyvy_sse((u8 *)src + offset_src * 4, blk_h, s_src, s_dst, (s16 *)dst, bd, U_C);
+}
+
+static void imgb_to_blk_uyvy_v_sse(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd, int in_bd)
+{
+    if(blk_w != 8) {
+        oapv_tbl_fn_imgb_to_blk_uyvy[V_C](src, blk_w, blk_h, s_src, offset_src, s_dst, dst, bd, in_bd);
+        return;
+    }
+    imgb_to_blk_uyvy_sse((u8 *)src + offset_src * 4, blk_h, s_src, s_dst, (s16 *)dst, bd, V_C);
+}
+
+const oapv_fn_imgb_to_blk_t oapv_tbl_fn_imgb_to_blk_uyvy_sse[3] = {
+    imgb_to_blk_uyvy_y_sse,
+    imgb_to_blk_uyvy_u_sse,
+    imgb_to_blk_uyvy_v_sse
+};
+
+/* unpack 'num_grp' groups of v210, four 32-bit words having 12 samples, into
+   16-bit samples */
+static void v210_unpack_sse(u8 *src, int num_grp, u16 *dst)
+{
+    __m128i mask = _mm_set1_epi32(0x3FF);
+    // a, b and c are the first, second and third samples of the words
+    __m128i ab_lo = _mm_setr_epi8(0, 1, 8, 9, -1, -1, 2, 3, 10, 11, -1, -1, 4, 5, 12, 13);
+    __m128i c_lo = _mm_setr_epi8(-1, -1, -1, -1, 0, 1, -1, -1, -1, -1, 2, 3, -1, -1, -1, -1);
+    __m128i ab_hi = _mm_setr_epi8(-1, -1, 6, 7, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    __m128i c_hi = _mm_setr_epi8(4, 5, -1, -1, -1, -1, 6, 7, -1, -1, -1, -1, -1, -1, -1, -1);
+    __m128i w, ab, c;
+
+    for(int g = 0; g < num_grp; g++) {
+        w = _mm_loadu_si128((__m128i *)(src + g * 16));
+        ab = _mm_packus_epi32(_mm_and_si128(w, mask), _mm_and_si128(_mm_srli_epi32(w, 10), mask));
+        c = _mm_packus_epi32(_mm_srli_epi32(w, 20), _mm_srli_epi32(w, 20));
+        _mm_storeu_si128((__m128i *)(dst + g * 12), _mm_or_si128(_mm_shuffle_epi8(ab, ab_lo), _mm_shuffle_epi8(c, c_lo)));
+        _mm_storel_epi64((__m128i *)(dst + g * 12 + 8), _mm_or_si128(_mm_shuffle_epi8(ab, ab_hi), _mm_shuffle_epi8(c, c_hi)));
+    }
+}
+
+/* eight samples of every 'step' samples from n-th one in rows; the groups
+   having the samples are read as a whole, since rows of v210 consist of
+   groups (and padded to 128 bytes) */
+static void imgb_to_blk_v210_sse(u8 *src, int n, int step, int blk_h, int s_src, int s_dst, s16 *d, int bd)
+{
+    u16     t[48] = { 0 }; // four groups at most
+    int     g0 = n / 12, num_grp = (n + step * 7) / 12 - g0 + 1;
+    u16    *p = t + n - g0 * 12;
+    __m128i mid = _mm_set1_epi16((s16)(1 << (bd - 1)));
+    __m128i cnt = _mm_cvtsi32_si128(bd - 10);
+    __m128i mask = _mm_set1_epi32(0xFFFF), s0, s1;
+
+    src += g0 * 16;
+    for(int h = 0; h < blk_h; h++) {
+        v210_unpack_sse(src, num_grp, t);
+        // every second sample, and every fourth by repeating it
+        s0 = _mm_packus_epi32(_mm_and_si128(_mm_loadu_si128((__m128i *)p), mask), _mm_and_si128(_mm_loadu_si128((__m128i *)(p + 8)), mask));
+        if(step == 4) {
+            s1 = _mm_packus_epi32(_mm_and_si128(_mm_loadu_si128((__m128i *)(p + 16)), mask), _mm_and_si128(_mm_loadu_si128((__m128i *)(p + 24)), mask));
+            s0 = _mm_packus_epi32(_mm_and_si128(s0, mask), _mm_and_si128(s1, mask));
+        }
+        _mm_storeu_si128((__m128i *)d, _mm_sub_epi16(_mm_sll_epi16(s0, cnt), mid));
+        src = src + s_src;
+        d = (s16 *)(((u8 *)d) + s_dst);
+    }
+}
+
+static void imgb_to_blk_v210_y_sse(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd, int in_bd)
+{
+    if(blk_w != 8) {
+        oapv_tbl_fn_imgb_to_blk_v210[Y_C](src, blk_w, blk_h, s_src, offset_src, s_dst, dst, bd, in_bd);
+        return;
+    }
+    imgb_to_blk_v210_sse((u8 *)src, offset_src * 2 + 1, 2, blk_h, s_src, s_dst, (s16 *)dst, bd);
+}
+
+static void imgb_to_blk_v210_u_sse(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd, int in_bd)
+{
+    if(blk_w != 8) {
+        oapv_tbl_fn_imgb_to_blk_v210[U_C](src, blk_w, blk_h, s_src, offset_src, s_dst, dst, bd, in_bd);
+        return;
+    }
+    imgb_to_blk_v210_sse((u8 *)src, offset_src * 4, 4, blk_h, s_src, s_dst, (s16 *)dst, bd);
+}
+
+static void imgb_to_blk_v210_v_sse(void *src, int blk_w, int blk_h, int s_src, int offset_src, int s_dst, void *dst, int bd, int in_bd)
+{
+    if(blk_w != 8) {
+        oapv_tbl_fn_imgb_to_blk_v210[V_C](src, blk_w, blk_h, s_src, offset_src, s_dst, dst, bd, in_bd);
+        return;
+    }
+    imgb_to_blk_v210_sse((u8 *)src, offset_src * 4 + 2, 4, blk_h, s_src, s_dst, (s16 *)dst, bd);
+}
+
+const oapv_fn_imgb_to_blk_t oapv_tbl_fn_imgb_to_blk_v210_sse[3] = {
+    imgb_to_blk_v210_y_sse,
+    imgb_to_blk_v210_u_sse,
+    imgb_to_blk_v210_v_sse
+};
+
+/* coef[0] * a + coef[1] * b + coef[2] * c + coef[3] for four samples */
+static __m128i cvt_mac3_sse(__m128i a, __m128i b, __m128i c, __m128i c0, __m128i c1, __m128i c2, __m128i ofs)
+{
+    __m128i v = _mm_add_epi32(_mm_mullo_epi32(a, c0), _mm_mullo_epi32(b, c1));
+    v = _mm_add_epi32(v, _mm_mullo_epi32(c, c2));
+    return _mm_add_epi32(v, ofs);
+}
+
+/* see oapv_rgb_to_blk(); eight samples of a row are converted at once */
+void oapv_rgb_to_blk_sse(void *src[3], int s_src[3], int byte_depth, int x, int blk_w, int blk_h, int coef[4], int sft, int bit_depth, s16 *dst)
+{
+    if(blk_w != 8) { // partial blocks at right edge of image
+        oapv_rgb_to_blk(src, s_src, byte_depth, x, blk_w, blk_h, coef, sft, bit_depth, dst);
+        return;
+    }
+    u8     *r = (u8 *)src[0] + x * byte_depth;
+    u8     *g = (u8 *)src[1] + x * byte_depth;
+    u8     *b = (u8 *)src[2] + x * byte_depth;
+    __m128i cr = _mm_set1_epi32(coef[0]);
+    __m128i cg = _mm_set1_epi32(coef[1]);
+    __m128i cb = _mm_set1_epi32(coef[2]);
+    __m128i ofs = _mm_set1_epi32(coef[3]);
+    __m128i max = _mm_set1_epi32((1 << bit_depth) - 1);
+    __m128i mid = _mm_set1_epi32(1 << (bit_depth - 1));
+    __m128i zero = _mm_setzero_si128();
+    __m128i cnt = _mm_cvtsi32_si128(sft);
+    __m128i vr, vg, vb, v[2];
+
+    for(int h = 0; h < blk_h; h++) {
+        if(byte_depth == 1) {
+            vr = _mm_cvtepu8_epi16(_mm_loadl_epi64((__m128i *)r));
+            vg = _mm_cvtepu8_epi16(_mm_loadl_epi64((__m128i *)g));
+            vb = _mm_cvtepu8_epi16(_mm_loadl_epi64((__m128i *)b));
+        }
+        else {
+            vr = _mm_loadu_si128((__m128i *)r);
+            vg = _mm_loadu_si128((__m128i *)g);
+            vb = _mm_loadu_si128((__m128i *)b);
+        }
+        v[0] = cvt_mac3_sse(_mm_unpacklo_epi16(vr, zero), _mm_unpacklo_epi16(vg, zero), _mm_unpacklo_epi16(vb, zero), cr, cg, cb, ofs);
+        v[1] = cvt_mac3_sse(_mm_unpackhi_epi16(vr, zero), _mm_unpackhi_epi16(vg, zero), _mm_unpackhi_epi16(vb, zero), cr, cg, cb, ofs);
+        for(int k = 0; k < 2; k++) {
+            v[k] = _mm_sra_epi32(v[k], cnt);
+            v[k] = _mm_sub_epi32(_mm_min_epi32(_mm_max_epi32(v[k], zero), max), mid);
+        }
+        _mm_storeu_si128((__m128i *)dst, _mm_packs_epi32(v[0], v[1]));
+        r += s_src[0];
+        g += s_src[1];
+        b += s_src[2];
+        dst += OAPV_BLK_W;
+    }
+}
+
+/* see oapv_blk_to_rgb(); eight samples of a row are converted at once */
+void oapv_blk_to_rgb_sse(s16 *src[3], int s_src, int blk_w, int blk_h, int bit_depth, int coef[4], int sft, int out_bit_depth, void *dst, int s_dst)
+{
+    int w8 = blk_w & ~7;
+    if(w8 < blk_w) { // remaining columns
+        s16 *rem[3] = { src[0] + w8, src[1] + w8, src[2] + w8 };
+        oapv_blk_to_rgb(rem, s_src, blk_w - w8, blk_h, bit_depth, coef, sft, out_bit_depth, (u8 *)dst + w8 * ((out_bit_depth + 7) >> 3), s_dst);
+    }
+    const int mid_val = (1 << (bit_depth - 1));
+    s16      *y = src[0], *cb = src[1], *cr = src[2];
+    u8       *d = (u8 *)dst;
+    __m128i   lo = _mm_set1_epi16(-mid_val);
+    __m128i   hi = _mm_set1_epi16(mid_val - 1);
+    __m128i   c0 = _mm_set1_epi32(coef[0]);
+    __m128i   c1 = _mm_set1_epi32(coef[1]);
+    __m128i   c2 = _mm_set1_epi32(coef[2]);
+    __m128i   ofs = _mm_set1_epi32(coef[3]);
+    __m128i   max = _mm_set1_epi32((1 << out_bit_depth) - 1);
+    __m128i   zero = _mm_setzero_si128();
+    __m128i   cnt = _mm_cvtsi32_si128(sft);
+    __m128i   vy, vcb, vcr, v[2], o;
+
+    for(int h = 0; h < blk_h; h++) {
+        for(int w = 0; w < w8; w += 8) {
+            vy = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((__m128i *)(y + w)), lo), hi);
+            vcb = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((__m128i *)(cb + w)), lo), hi);
+            vcr = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((__m128i *)(cr + w)), lo), hi);
+            v[0] = cvt_mac3_sse(_mm_cvtepi16_epi32(vy), _mm_cvtepi16_epi32(vcb), _mm_cvtepi16_epi32(vcr), c0, c1, c2, ofs);
+            v[1] = cvt_mac3_sse(_mm_cvtepi16_epi32(_mm_srli_si128(vy, 8)), _mm_cvtepi16_epi32(_mm_srli_si128(vcb, 8)),
+                                _mm_cvtepi16_epi32(_mm_srli_si128(vcr, 8)), c0, c1, c2, ofs);
+            for(int k = 0; k < 2; k++) {
+                v[k] = _mm_min_epi32(_mm_max_epi32(_mm_sra_epi32(v[k], cnt), zero), max);
+            }
+            o = _mm_packus_epi32(v[0], v[1]);
+            if(out_bit_depth == 8) {
+                _mm_storel_epi64((__m128i *)(d + w), _mm_packus_epi16(o, o));
+            }
+            else {
+                _mm_storeu_si128((__m128i *)(d + w * 2), o);
+            }
+        }
+        y += s_src;
+        cb += s_src;
+        cr += s_src;
+        d += s_dst;
+    }
+}
+
+/* see oapv_blk_to_rgbf() */
+void oapv_blk_to_rgbf_sse(s16 *src[3], int s_src, int blk_w, int blk_h, int bit_depth, float coef[4], void *dst, int s_dst)
+{
+    int w8 = blk_w & ~7;
+    if(w8 < blk_w) { // remaining columns
+        s16 *rem[3] = { src[0] + w8, src[1] + w8, src[2] + w8 };
+        oapv_blk_to_rgbf(rem, s_src, blk_w - w8, blk_h, bit_depth, coef, (float *)dst + w8, s_dst);
+    }
+    const int mid_val = (1 << (bit_depth - 1));
+    s16      *y = src[0], *cb = src[1], *cr = src[2];
+    float    *d = (float *)dst;
+    __m128i   lo = _mm_set1_epi16(-mid_val);
+    __m128i   hi = _mm_set1_epi16(mid_val - 1);
+    __m128    c0 = _mm_set1_ps(coef[0]);
+    __m128    c1 = _mm_set1_ps(coef[1]);
+    __m128    c2 = _mm_set1_ps(coef[2]);
+    __m128    ofs = _mm_set1_ps(coef[3]);
+    __m128    one = _mm_set1_ps(1.0f);
+    __m128    zero = _mm_setzero_ps();
+    __m128i   vy, vcb, vcr;
+    __m128    v;
+
+    for(int h = 0; h < blk_h; h++) {
+        for(int w = 0; w < w8; w += 8) {
+            vy = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((__m128i *)(y + w)), lo), hi);
+            vcb = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((__m128i *)(cb + w)), lo), hi);
+            vcr = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((__m128i *)(cr + w)), lo), hi);
+            for(int k = 0; k < 2; k++) {
+                // multiplications and additions are in the same order as C code
+                v = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(vy)), c0);
+                v = _mm_add_ps(v, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(vcb)), c1));
+                v = _mm_add_ps(v, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(vcr)), c2));
+                v = _mm_add_ps(v, ofs);
+                _mm_storeu_ps(d + w + k * 4, _mm_min_ps(_mm_max_ps(v, zero), one));
+                vy = _mm_srli_si128(vy, 8);
+                vcb = _mm_srli_si128(vcb, 8);
+                vcr = _mm_srli_si128(vcr, 8);
+            }
+        }
+        y += s_src;
+        cb += s_src;
+        cr += s_src;
+        d = (float *)((u8 *)d + s_dst);
+    }
+}
+#endif /* X86_SSE */
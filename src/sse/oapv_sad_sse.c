@@ -434,4 +434,38 @@ int oapv_dc_removed_had8x8_sse(pel* org, int s_org)
         return sad;
     }
 }
+
+int oapv_had8x8_row_sse(u16 *src, int s_src, int step, int ofs, int shift, int num_blk)
+{
+    pel     blk[64];
+    int     sum = 0;
+    __m128i s0, s1, mask = _mm_set1_epi32(0xFFFF);
+
+    if(step == 1 && shift == 0) { // planar; read in place
+        for(int b = 0; b < num_blk; b++) {
+            sum += oapv_dc_removed_had8x8_sse((pel *)src + ofs + (b << 3), s_src);
+        }
+        return sum;
+    }
+    for(int b = 0; b < num_blk; b++) {
+        u16 *s = src + b * 8 * step;
+        for(int i = 0; i < 8; i++) {
+            if(step == 1) {
+                s0 = _mm_loadu_si128((__m128i *)(s + ofs));
+            }
+            else { // take one of interleaved samples
+                s0 = _mm_loadu_si128((__m128i *)s);
+                s1 = _mm_loadu_si128((__m128i *)(s + 8));
+                s0 = ofs ? _mm_srli_epi32(s0, 16) : _mm_and_si128(s0, mask);
+                s1 = ofs ? _mm_srli_epi32(s1, 16) : _mm_and_si128(s1, mask);
+                s0 = _mm_packus_epi32(s0, s1);
+            }
+            s0 = _mm_srl_epi16(s0, _mm_cvtsi32_si128(shift));
+            _mm_storeu_si128((__m128i *)(blk + i * 8), s0);
+            s += s_src;
+        }
+        sum += oapv_dc_removed_had8x8_sse(blk, 8);
+    }
+    return sum;
+}
 #endif /* X86_SSE */
\ No newline at end of file
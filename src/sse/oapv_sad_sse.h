@@ -37,6 +37,7 @@
 #if X86_SSE
 extern const oapv_fn_ssd_t oapv_tbl_fn_ssd_16b_sse[2];
 int oapv_dc_removed_had8x8_sse(pel* org, int s_org);
+int oapv_had8x8_row_sse(u16 *src, int s_src, int step, int ofs, int shift, int num_blk);
 
 #endif /* X86_SSE */
 
@@ -0,0 +1,50 @@
+# check access units of bitstream files 'A' and 'B' are the same, except the
+# first 'FROM' ones; both files have to have the same number of access units
+# ex) cmake -DA=a.apv -DB=b.apv -DFROM=1 -P au.cmake
+if(NOT DEFINED FROM)
+    set(FROM 0)
+endif()
+
+# sizes and offsets of access units of file 'IN'
+macro(read_aus IN SIZES OFFSETS)
+    file(SIZE ${IN} FILE_SIZE)
+    set(${SIZES} "")
+    set(${OFFSETS} "")
+    set(AU_OFS 0)
+    while(AU_OFS LESS FILE_SIZE)
+        file(READ ${IN} HEX_VAL OFFSET ${AU_OFS} LIMIT 4 HEX)
+        math(EXPR AU_SIZE "0x${HEX_VAL} + 4")
+        list(APPEND ${SIZES} ${AU_SIZE})
+        list(APPEND ${OFFSETS} ${AU_OFS})
+        math(EXPR AU_OFS "${AU_OFS} + ${AU_SIZE}")
+    endwhile()
+endmacro()
+
+read_aus(${A} A_SIZES A_OFFSETS)
+read_aus(${B} B_SIZES B_OFFSETS)
+list(LENGTH A_SIZES NUM_AU)
+list(LENGTH B_SIZES NUM_AU_B)
+if(NOT NUM_AU EQUAL NUM_AU_B)
+    message(FATAL_ERROR "${NUM_AU} and ${NUM_AU_B} access units in ${A} and ${B}")
+endif()
+if(NOT NUM_AU GREATER FROM)
+    message(FATAL_ERROR "no access unit to compare from ${FROM}")
+endif()
+
+math(EXPR LAST "${NUM_AU} - 1")
+foreach(i RANGE ${FROM} ${LAST})
+    list(GET A_SIZES ${i} A_SIZE)
+    list(GET B_SIZES ${i} B_SIZE)
+    if(NOT A_SIZE EQUAL B_SIZE)
+        message(FATAL_ERROR "access unit ${i}: ${A_SIZE} and ${B_SIZE} bytes")
+    endif()
+    list(GET A_OFFSETS ${i} A_OFS)
+    list(GET B_OFFSETS ${i} B_OFS)
+    file(READ ${A} A_DATA OFFSET ${A_OFS} LIMIT ${A_SIZE} HEX)
+    file(READ ${B} B_DATA OFFSET ${B_OFS} LIMIT ${B_SIZE} HEX)
+    if(NOT A_DATA STREQUAL B_DATA)
+        message(FATAL_ERROR "access unit ${i} is not the same")
+    endif()
+endforeach()
+math(EXPR NUM "${NUM_AU} - ${FROM}")
+message("${NUM} access unit(s) are the same")
@@ -0,0 +1,8 @@
+# concatenate comma separated 'FILES' into 'OUT'; tests use it to make a
+# bitstream of repeated access units
+# ex) cmake -DFILES=a.apv,a.apv,b.apv -DOUT=out.apv -P cat.cmake
+string(REPLACE "," ";" FILE_LIST "${FILES}")
+execute_process(COMMAND ${CMAKE_COMMAND} -E cat ${FILE_LIST} OUTPUT_FILE ${OUT} RESULT_VARIABLE RET)
+if(NOT RET EQUAL 0)
+    message(FATAL_ERROR "cannot concatenate ${FILES}")
+endif()
@@ -0,0 +1,69 @@
+# check byte sizes of PBUs in bitstream file 'IN'. With 'SAME', every frame
+# and the metadata and filler following it take the same bytes, and filler
+# has to be there. With 'AU_MAX', every access unit is 'AU_MAX' bytes or less
+# ex) cmake -DIN=a.apv -DSAME=1 -P pbu.cmake
+#     cmake -DIN=a.apv -DAU_MAX=100000 -P pbu.cmake
+file(SIZE ${IN} FILE_SIZE)
+
+# big endian integer of 'LEN' bytes at 'OFS'
+macro(read_be VAR OFS LEN)
+    file(READ ${IN} HEX_VAL OFFSET ${OFS} LIMIT ${LEN} HEX)
+    math(EXPR ${VAR} "0x${HEX_VAL}")
+endmacro()
+
+set(AU_OFS 0)
+set(NUM_AU 0)
+set(FRM_SIZE -1)
+set(PADDED "")
+set(NO_FILLER 0)
+while(AU_OFS LESS FILE_SIZE)
+    read_be(AU_SIZE ${AU_OFS} 4)
+    message("AU ${NUM_AU}: ${AU_SIZE} bytes")
+    if(DEFINED AU_MAX AND AU_SIZE GREATER AU_MAX)
+        message(FATAL_ERROR "access unit ${NUM_AU} is over ${AU_MAX} bytes")
+    endif()
+    # PBUs after signature
+    math(EXPR OFS "${AU_OFS} + 8")
+    math(EXPR AU_END "${AU_OFS} + 4 + ${AU_SIZE}")
+    while(OFS LESS AU_END)
+        read_be(PBU_SIZE ${OFS} 4)
+        math(EXPR TYPE_OFS "${OFS} + 4")
+        read_be(PBU_TYPE ${TYPE_OFS} 1)
+        math(EXPR SIZE "${PBU_SIZE} + 4")
+        if(PBU_TYPE LESS_EQUAL 2 OR (PBU_TYPE GREATER_EQUAL 25 AND PBU_TYPE LESS_EQUAL 27))
+            if(FRM_SIZE GREATER_EQUAL 0)
+                list(APPEND PADDED ${FRM_SIZE})
+                math(EXPR NO_FILLER "${NO_FILLER} + 1")
+            endif()
+            set(FRM_SIZE ${SIZE})
+        elseif(PBU_TYPE EQUAL 66 AND FRM_SIZE GREATER_EQUAL 0)
+            math(EXPR FRM_SIZE "${FRM_SIZE} + ${SIZE}")
+        elseif(PBU_TYPE EQUAL 67 AND FRM_SIZE GREATER_EQUAL 0)
+            math(EXPR FRM_SIZE "${FRM_SIZE} + ${SIZE}")
+            list(APPEND PADDED ${FRM_SIZE})
+            set(FRM_SIZE -1)
+        endif()
+        math(EXPR OFS "${OFS} + ${SIZE}")
+    endwhile()
+    math(EXPR AU_OFS "${AU_END}")
+    math(EXPR NUM_AU "${NUM_AU} + 1")
+endwhile()
+if(FRM_SIZE GREATER_EQUAL 0)
+    list(APPEND PADDED ${FRM_SIZE})
+    math(EXPR NO_FILLER "${NO_FILLER} + 1")
+endif()
+
+if(NUM_AU EQUAL 0)
+    message(FATAL_ERROR "no access unit in ${IN}")
+endif()
+if(DEFINED SAME)
+    message("frames with filler: ${PADDED}")
+    if(NO_FILLER GREATER 0)
+        message(FATAL_ERROR "${NO_FILLER} frame(s) without filler")
+    endif()
+    list(REMOVE_DUPLICATES PADDED)
+    list(LENGTH PADDED NUM)
+    if(NOT NUM EQUAL 1)
+        message(FATAL_ERROR "frames with filler are not of the same size")
+    endif()
+endif()
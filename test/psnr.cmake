@@ -0,0 +1,81 @@
+# check luma PSNR of the first frames of y4m files 'A' and 'B' is 'MIN' dB or
+# more; 'MIN' is a multiple of 10 and samples are 10-bit. Without 'MIN', the
+# frames have to be the same. With 'X' and 'Y', 'A' is compared to the region
+# of 'B' at the position. With 'W' and 'H', 'A' and 'B' are raw files of
+# planes of the size, and 'A_PLANE' and 'B_PLANE' are the planes compared
+# ex) cmake -DA=a.y4m -DB=b.y4m -DMIN=30 -P psnr.cmake
+#     cmake -DA=a.y4m -DB=b.y4m -DX=256 -DY=128 -P psnr.cmake
+#     cmake -DA=a.rgb -DB=b.rgb -DW=256 -DH=128 -DB_PLANE=1 -P psnr.cmake
+if(NOT DEFINED X)
+    set(X 0)
+    set(Y 0)
+endif()
+
+foreach(F A B)
+    if(DEFINED W)
+        if(NOT DEFINED ${F}_PLANE)
+            set(${F}_PLANE 0)
+        endif()
+        math(EXPR ${F}_POS "${${F}_PLANE} * ${W} * ${H} * 2")
+        set(${F}_W ${W})
+        set(${F}_H ${H})
+        continue()
+    endif()
+    file(READ ${${F}} HDR LIMIT 128)
+    string(FIND "${HDR}" "FRAME\n" POS)
+    string(REGEX MATCH "W([0-9]+) H([0-9]+)" WH "${HDR}")
+    if(POS LESS 0 OR NOT WH)
+        message(FATAL_ERROR "not y4m file: ${${F}}")
+    endif()
+    math(EXPR ${F}_POS "${POS} + 6")
+    set(${F}_W ${CMAKE_MATCH_1})
+    set(${F}_H ${CMAKE_MATCH_2})
+endforeach()
+
+if(B_W LESS A_W OR B_H LESS A_H)
+    message(FATAL_ERROR "frame of ${A} is larger than ${B}")
+endif()
+math(EXPR SIZE "${A_W} * ${A_H} * 2")
+file(READ ${A} DATA OFFSET ${A_POS} LIMIT ${SIZE} HEX)
+set(DATA_B "")
+math(EXPR ROW_END "${Y} + ${A_H} - 1")
+math(EXPR ROW_SIZE "${A_W} * 2")
+foreach(ROW RANGE ${Y} ${ROW_END})
+    math(EXPR OFS "${B_POS} + (${ROW} * ${B_W} + ${X}) * 2")
+    file(READ ${B} ROW_DATA OFFSET ${OFS} LIMIT ${ROW_SIZE} HEX)
+    string(APPEND DATA_B "${ROW_DATA}")
+endforeach()
+
+# 16-bit little endian samples into lists
+string(REGEX REPLACE "(..)(..)" "\\2\\1;" A_PEL "${DATA}")
+string(REGEX REPLACE ";$" "" A_PEL "${A_PEL}")
+string(REGEX REPLACE "(..)(..)" "\\2\\1;" B_PEL "${DATA_B}")
+string(REGEX REPLACE ";$" "" B_PEL "${B_PEL}")
+list(LENGTH A_PEL NUM)
+list(LENGTH B_PEL NUM_B)
+if(NOT NUM EQUAL NUM_B)
+    message(FATAL_ERROR "cannot read ${NUM} samples from ${B}")
+endif()
+
+set(SSE 0)
+foreach(PA PB IN ZIP_LISTS A_PEL B_PEL)
+    math(EXPR D "0x${PA} - 0x${PB}")
+    math(EXPR SSE "${SSE} + ${D} * ${D}")
+endforeach()
+message("SSE of ${NUM} luma samples = ${SSE}")
+
+if(NOT DEFINED MIN)
+    if(NOT SSE EQUAL 0)
+        message(FATAL_ERROR "frames are not the same")
+    endif()
+    return()
+endif()
+
+# PSNR >= MIN when SSE * 10^(MIN / 10) <= 1023^2 * NUM
+math(EXPR EXP "${MIN} / 10")
+string(REPEAT "0" ${EXP} ZEROS)
+math(EXPR LHS "${SSE} * 1${ZEROS}")
+math(EXPR RHS "1023 * 1023 * ${NUM}")
+if(LHS GREATER RHS)
+    message(FATAL_ERROR "PSNR is less than ${MIN} dB")
+endif()